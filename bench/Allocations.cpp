@@ -0,0 +1,24 @@
+#include <cstdlib>
+#include <new>
+
+#include "Bench.hpp"
+
+std::atomic<size_t> g_Allocations{ 0 }, g_AllocatedBytes{ 0 };
+
+void* operator new(size_t size) {
+    g_Allocations++;
+    g_AllocatedBytes += size;
+
+    if (void* ptr = std::malloc(size ? size : 1))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
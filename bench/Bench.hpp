@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <utility>
+
+#include "Config.hpp"
+
+// Every heap allocation goes through Allocations.cpp, so the benchmarks can check that a hot path doesn't allocate.
+extern std::atomic<size_t> g_Allocations, g_AllocatedBytes;
+
+using Clock = std::chrono::steady_clock;
+
+// Runs the editor with the default config, so that the results don't depend on config.json. Doesn't
+// create one either, nor journal the edits into 'recovery', both of which go to the working directory.
+inline void useDefaultConfig() {
+    Config::Properties properties;
+    properties.crashRecovery = false;
+    Config::Set(std::move(properties));
+}
+
+// Generates a document of roughly 'size' bytes made of 60-column lines.
+inline std::string generateDocument(size_t size) {
+    std::string ret;
+    ret.reserve(size);
+
+    while (ret.size() < size) {
+        ret.append("The quick brown fox jumps over the lazy dog, 0123456789 ...");
+        ret.push_back('\n');
+    }
+
+    ret.resize(size);
+    return ret;
+}
+
+// Writes a generated document of 'size' bytes to a file in the temporary directory and returns its path.
+inline std::filesystem::path writeDocument(const std::string& name, size_t size) {
+    auto path = std::filesystem::temp_directory_path() / name;
+
+    std::ofstream out(path, std::ios::binary);
+    out << generateDocument(size);
+
+    return path;
+}
+
+// Times 'iterations' calls of op and returns the mean duration in nanoseconds.
+template <typename Op>
+double measure(size_t iterations, Op&& op) {
+    auto begin = Clock::now();
+    for (size_t i = 0; i < iterations; i++)
+        op(i);
+    auto end = Clock::now();
+
+    return std::chrono::duration<double, std::nano>(end - begin).count() / iterations;
+}
@@ -0,0 +1,685 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "Bench.hpp"
+#include "DocumentSearch.h"
+#include "Editor.h"
+#include "HighlightLayer.h"
+#include "NewlineScanner.h"
+#include "PieceTable.h"
+#include "RecoveryJournal.h"
+#include "RegexSearch.h"
+#include "SubstringSearch.h"
+#include "SyntaxHighlighter.h"
+#include "UndoJournal.h"
+#include "Utf8.h"
+#include "VisualRows.h"
+
+// Benchmarks of the document and the editing logic. Only links visionary_core, so it runs without a display.
+namespace {
+    // Per-keystroke latency of the document storage for a single document size.
+    void benchmarkDocument(size_t size) {
+        constexpr size_t iterations = 100000;
+
+        PieceTable document(generateDocument(size));
+        std::mt19937_64 rng(42);
+
+        const auto randomRow = [&]() { return rng() % document.getLineCount(); };
+
+        double type = measure(iterations, [&](size_t) {
+            size_t row = randomRow();
+            document.insert({ row, document.getLineLength(row) / 2 }, "x");
+        });
+
+        // Enter near the top, which used to shift every line below it.
+        double enter = measure(iterations, [&](size_t i) {
+            document.insert({ i % 16, 0 }, "\n");
+        });
+
+        double erase = measure(iterations, [&](size_t) {
+            size_t row = randomRow();
+            if (document.getLineLength(row) > 0)
+                document.erase({ row, 0 }, { row, 1 });
+        });
+
+        double lookup = measure(iterations, [&](size_t) {
+            volatile size_t length = document.getLineLength(randomRow());
+            (void)length;
+        });
+
+        std::cout << "document  " << size << " bytes" <<
+                     "  type: " << type << " ns" <<
+                     "  enter: " << enter << " ns" <<
+                     "  erase: " << erase << " ns" <<
+                     "  row lookup: " << lookup << " ns\n";
+    }
+
+    // The line accesses a cursor move is made of, on a document that is one 10 MB line.
+    // Reports the cost and the heap allocations per access, before and after editing the line.
+    void benchmarkLineAccess() {
+        constexpr size_t iterations = 100000;
+
+        PieceTable document(std::string(10 << 20, '{'));
+
+        for (bool edited : { false, true }) {
+            // Splits the line into several pieces.
+            if (edited)
+                document.insert({ 0, 5 << 20 }, "\"key\": 1,");
+
+            size_t allocations = g_Allocations;
+            double nanoseconds = measure(iterations, [&](size_t i) {
+                volatile size_t length = document.getLineLength(0);
+                volatile char c = document.line(0).value()[i % length];
+                (void)c;
+            });
+
+            std::cout << "line      10 MB line" << (edited ? " (edited)  " : "           ") <<
+                         nanoseconds << " ns" <<
+                         "  " << double(g_Allocations - allocations) / iterations << " allocations/op\n";
+        }
+
+        // Typing on the row above keeps the joined line, and typing into it
+        // only joins the part that is read, e.g. the part in view.
+        constexpr size_t keystrokes = 1000;
+        document.insert({ 0, 0 }, "\n");
+
+        double above = measure(keystrokes, [&](size_t i) {
+            document.insert({ 0, 0 }, "x");
+            volatile char c = document.line(1).value()[i % document.getLineLength(1)];
+            (void)c;
+        });
+
+        double into = measure(keystrokes, [&](size_t) {
+            document.insert({ 1, 5 << 20 }, "x");
+            volatile char c = document.linePart(1, (5 << 20) - 2048, (5 << 20) + 2048).value()[0];
+            (void)c;
+        });
+
+        std::cout << "line      10 MB line  type above: " << above << " ns  type into, read 4 KB of it: " << into << " ns\n";
+    }
+
+    // Pastes a blob of 'size' bytes into the middle of a small document, as a single bulk insert.
+    void benchmarkPaste(size_t size) {
+        PieceTable document(generateDocument(1 << 20));
+        std::string blob = generateDocument(size);
+
+        size_t row = document.getLineCount() / 2;
+        double nanoseconds = measure(1, [&](size_t) {
+            document.insert({ row, document.getLineLength(row) / 2 }, blob);
+        });
+
+        std::cout << "paste     " << size << " bytes" <<
+                     "  " << nanoseconds / 1e6 << " ms" <<
+                     "  (" << (size / 1e6) / (nanoseconds / 1e9) << " MB/s)\n";
+    }
+
+    // Scans a block of 'size' bytes for newlines with NewlineScanner and with a plain memchr loop.
+    void benchmarkNewlineScanner(size_t size) {
+        std::string text = generateDocument(size);
+        std::vector<size_t> offsets;
+        offsets.reserve(size / 32);
+
+        const auto throughput = [size](double nanoseconds) { return size / nanoseconds; }; // Bytes per ns = GB/s.
+
+        double simd = measure(10, [&](size_t) {
+            offsets.clear();
+            NewlineScanner::scan(text, 0, offsets);
+        });
+
+        double memchrLoop = measure(10, [&](size_t) {
+            offsets.clear();
+            const char* begin = text.data();
+            const char* end = begin + text.size();
+
+            for (const char* it = begin; (it = static_cast<const char*>(std::memchr(it, '\n', end - it))); it++)
+                offsets.push_back(it - begin);
+        });
+
+        std::cout << "newlines  " << size << " bytes" <<
+                     "  " << NewlineScanner::getInstructionSet() << ": " << throughput(simd) << " GB/s" <<
+                     "  memchr: " << throughput(memchrLoop) << " GB/s\n";
+    }
+
+    // Validates a document of 'size' bytes as UTF-8 with Utf8::validate() and with the scalar fallback,
+    // once as plain ASCII and once with a multi-byte character every few words, like a log with names in it.
+    void benchmarkUtf8(size_t size) {
+        const auto throughput = [size](double nanoseconds) { return size / nanoseconds; }; // Bytes per ns = GB/s.
+
+        std::string ascii = generateDocument(size);
+
+        // Same size, with 2, 3 and 4 byte characters in place of some of the ASCII.
+        std::string mixed = ascii;
+        const std::string_view characters[] = { "\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80" };
+        for (size_t i = 0, n = 0; i + 4 < mixed.size(); i += 23, n++) {
+            auto character = characters[n % std::size(characters)];
+            mixed.replace(i, character.size(), character);
+        }
+
+        for (const auto& [name, text] : { std::pair<const char*, const std::string&>{ "ascii", ascii }, { "mixed", mixed } }) {
+            volatile bool valid = false;
+            double simd = measure(10, [&](size_t) { valid = Utf8::validate(text); });
+            double scalar = measure(10, [&](size_t) { valid = Utf8::validateScalar(text); });
+
+            std::cout << "utf-8     " << size << " bytes " << name <<
+                         "  " << Utf8::getInstructionSet() << ": " << throughput(simd) << " GB/s" <<
+                         "  scalar: " << throughput(scalar) << " GB/s" <<
+                         (valid ? "" : "  (invalid!)") << "\n";
+        }
+    }
+
+    // Looks for a string that only occurs at the very end of a document of 'size' bytes,
+    // so every implementation has to go through all of it.
+    void benchmarkSearch(size_t size) {
+        const std::string needle = "needle in a haystack";
+        size = std::max(size, needle.size());
+
+        std::string text = generateDocument(size);
+        text.replace(text.size() - needle.size(), needle.size(), needle);
+
+        const auto throughput = [size](double nanoseconds) { return size / nanoseconds; }; // Bytes per ns = GB/s.
+
+        volatile size_t found = 0;
+        double simd = measure(10, [&](size_t) { found = SubstringSearch::find(text, needle); });
+        double scalar = measure(10, [&](size_t) { found = SubstringSearch::findScalar(text, needle); });
+
+        // Compares every position byte by byte, the way a search without any skipping walks the text.
+        double naive = measure(1, [&](size_t) {
+            for (size_t i = 0; i + needle.size() <= text.size(); i++) {
+                size_t j = 0;
+                while (j < needle.size() && text[i + j] == needle[j])
+                    j++;
+
+                if (j == needle.size()) {
+                    found = i;
+                    break;
+                }
+            }
+        });
+
+        // Through the piece table, after it has been cut into a piece per edit.
+        PieceTable document(std::move(text));
+        for (size_t i = 1; i <= 1000; i++)
+            document.insert(document.toLocation(i * (size / 1001)), "x");
+
+        double pieces = measure(10, [&](size_t) { found = DocumentSearch::findNext(document, needle, 0).value_or(0); });
+
+        std::cout << "search    " << size << " bytes" <<
+                     "  " << SubstringSearch::getInstructionSet() << ": " << throughput(simd) << " GB/s" <<
+                     "  memchr: " << throughput(scalar) << " GB/s" <<
+                     "  naive: " << throughput(naive) << " GB/s" <<
+                     "  piece table: " << throughput(pieces) << " GB/s\n";
+    }
+
+    // Replaces every "fox" in a document of 'size' bytes, once a line, through the editor, then undoes it.
+    void benchmarkReplaceAll(size_t size) {
+        auto path = writeDocument("visionary_bench_replace.txt", size);
+
+        {
+            // Searching alone, to tell it apart from applying the edit.
+            PieceTable document;
+            document.open(path);
+
+            size_t matches = 0;
+            double search = measure(1, [&](size_t) { matches = RegexSearch("fox").findAll(document).size(); });
+
+            Editor editor;
+            editor.open(path);
+            editor.waitForIndex();
+
+            size_t replaced = 0;
+            double replace = measure(1, [&](size_t) { replaced = editor.replaceAll("f(o)x", "c$1t").value_or(0); });
+            double undo = measure(1, [&](size_t) { editor.undo(); });
+
+            std::cout << "replace   " << size << " bytes" <<
+                         "  " << replaced << " of " << matches << " matches" <<
+                         "  search: " << search / 1e6 << " ms" <<
+                         "  replace all: " << replace / 1e6 << " ms" <<
+                         "  undo: " << undo / 1e6 << " ms\n";
+        }
+
+        std::filesystem::remove(path);
+    }
+
+    // Finds the highlights on a screen of rows, at random scroll positions of a 10M-line document
+    // that is selected as a whole and has a match on every 10th row, next to a few long diagnostics.
+    // Counts the view updates an edit would cause, like TextBox does.
+    class CountingEditor : public Editor {
+    public:
+        size_t updates = 0;
+
+    protected:
+        void onLinesChanged(size_t, size_t) override { updates++; }
+        void onDocumentChanged() override { updates++; }
+    };
+
+    // Typing at many carets at once, which should be one edit and one view update per keystroke.
+    void benchmarkCarets(size_t caretCount) {
+        constexpr size_t iterations = 100;
+        auto path = writeDocument("visionary_bench_carets.txt", caretCount * 60);
+
+        {
+            CountingEditor editor;
+            editor.open(path);
+            editor.waitForIndex();
+
+            // A caret at the end of every line.
+            double split = measure(1, [&](size_t) {
+                editor.selectAll();
+                editor.splitSelectionIntoLines();
+                editor.stopSelecting();
+            });
+
+            size_t carets = editor.getCaretCount();
+            editor.updates = 0;
+
+            double type = measure(iterations, [&](size_t) { editor.add('x'); });
+            size_t typeUpdates = editor.updates;
+
+            double erase = measure(iterations, [&](size_t) { editor.remove(); });
+            double undo = measure(1, [&](size_t) { editor.undo(); });
+
+            std::cout << "carets    " << carets << " carets" <<
+                         "  split: " << split / 1e6 << " ms" <<
+                         "  type: " << type / 1e6 << " ms" <<
+                         "  erase: " << erase / 1e6 << " ms" <<
+                         "  undo: " << undo / 1e6 << " ms" <<
+                         "  (" << double(typeUpdates) / iterations << " updates/keystroke)\n";
+        }
+
+        std::filesystem::remove(path);
+    }
+
+    // Lexing a C++ file for syntax highlighting: the first screen, the whole file, and an edit in the middle of it.
+    void benchmarkSyntax(size_t lineCount) {
+        constexpr size_t screenRows = 60;
+        auto path = std::filesystem::temp_directory_path() / "visionary_bench_syntax.cpp";
+
+        {
+            std::ofstream out(path, std::ios::binary);
+            for (size_t row = 0; row < lineCount; row++) {
+                switch (row % 8) {
+                case 0:  out << "/* A comment\n"; break;
+                case 1:  out << "   over two lines. */\n"; break;
+                case 2:  out << "#define VALUE(x) ((x) * 2)\n"; break;
+                default: out << "static const char* name = \"fox\"; int count = 0x2A; // The quick brown fox\n"; break;
+                }
+            }
+        }
+
+        {
+            Editor editor;
+            editor.open(path);
+            editor.waitForIndex();
+
+            SyntaxHighlighter& syntax = editor.getSyntax();
+
+            double firstScreen = measure(1, [&](size_t) { syntax.lexUpTo(screenRows); });
+            double full = measure(1, [&](size_t) { syntax.lexUpTo(lineCount); });
+
+            // Typing in the middle, then opening and closing a comment there, which changes every row below it.
+            size_t row = lineCount / 2 + 3;
+            editor.moveTo({ row, 0 });
+
+            uint64_t lexed = syntax.getLinesLexed();
+            double type = measure(1, [&](size_t) { editor.add('x'); syntax.lexUpTo(row + screenRows); });
+            uint64_t typeLexed = syntax.getLinesLexed() - lexed;
+
+            lexed = syntax.getLinesLexed();
+            double comment = measure(1, [&](size_t) { editor.add("/*"); syntax.lexUpTo(row + screenRows); });
+            uint64_t commentLexed = syntax.getLinesLexed() - lexed;
+
+            std::cout << "syntax    " << lineCount << " lines" <<
+                         "  first screen: " << firstScreen / 1e3 << " us" <<
+                         "  full: " << full / 1e6 << " ms" <<
+                         "  type: " << type / 1e3 << " us (" << typeLexed << " lines lexed)" <<
+                         "  open comment: " << comment / 1e3 << " us (" << commentLexed << " lines lexed)\n";
+        }
+
+        std::filesystem::remove(path);
+    }
+
+    void benchmarkVisualRows(size_t lineCount) {
+        constexpr size_t iterations = 100000;
+
+        VisualRows rows;
+        rows.reset(lineCount);
+
+        // Every tenth line wraps once, like a source file in a narrow window.
+        double wrapAll = measure(1, [&](size_t) {
+            for (size_t row = 0; row < lineCount; row++)
+                rows.set(row, (row % 10 == 0) ? 2 : 1);
+        });
+
+        volatile uint64_t sink = 0;
+        double toVisual = measure(iterations, [&](size_t i) { sink = sink + rows.toVisualRow(i * 7919 % lineCount); });
+        double fromVisual = measure(iterations, [&](size_t i) { sink = sink + rows.fromVisualRow(i * 7919 % lineCount).first; });
+
+        // Typing on a line that wraps once more, and pressing enter in the middle of the document.
+        size_t row = lineCount / 2;
+        double rewrap = measure(iterations, [&](size_t i) { rows.set(row, 2 + i % 2); });
+        double newline = measure(100, [&](size_t) { rows.onLinesChanged(row, rows.getRowCount(), rows.getRowCount() + 1); });
+
+        std::cout << "visual    " << lineCount << " lines" <<
+                     "  wrap all: " << wrapAll / 1e6 << " ms" <<
+                     "  to visual: " << toVisual << " ns" <<
+                     "  from visual: " << fromVisual << " ns" <<
+                     "  rewrap line: " << rewrap << " ns" <<
+                     "  newline: " << newline / 1e3 << " us\n";
+    }
+
+    void benchmarkHighlights(size_t lineCount) {
+        constexpr size_t screenRows = 60, iterations = 100000;
+
+        HighlightLayer layer;
+        layer.set(HighlightLayer::Kind::Selection, { { { 0, 0 }, { lineCount - 1, 10 } } });
+
+        std::vector<HighlightLayer::Range> matches, diagnostics;
+        for (size_t row = 0; row < lineCount; row += 10)
+            matches.push_back({ { row, 4 }, { row, 9 } });
+        for (size_t row = 0; row < lineCount; row += lineCount / 8)
+            diagnostics.push_back({ { row, 0 }, { row + lineCount / 16, 0 } });
+
+        double build = measure(1, [&](size_t) { layer.set(HighlightLayer::Kind::Match, matches); });
+        layer.set(HighlightLayer::Kind::Diagnostic, diagnostics);
+
+        std::mt19937_64 rng(42);
+        size_t found = 0;
+        double query = measure(iterations, [&](size_t) {
+            size_t first = rng() % (lineCount - screenRows);
+
+            for (size_t i = 0; i < static_cast<size_t>(HighlightLayer::Kind::Count); i++)
+                layer.forEachInRows(static_cast<HighlightLayer::Kind>(i), { first, first + screenRows }, [&](const auto&) { found++; });
+        });
+
+        std::cout << "highlight " << lineCount << " lines  " << matches.size() << " matches" <<
+                     "  build: " << build / 1e6 << " ms" <<
+                     "  screen: " << query << " ns" <<
+                     "  (" << double(found) / iterations << " ranges/screen)\n";
+    }
+
+    // Deletes a whole document of 'size' bytes, like a select-all delete, then undoes and redoes it.
+    void benchmarkUndo(size_t size) {
+        PieceTable document(generateDocument(size));
+        UndoJournal history(64 << 20);
+
+        size_t bytesBefore = g_AllocatedBytes;
+        double erase = measure(1, [&](size_t) {
+            history.recordErase(document, 0, document.getSize());
+            document.erase(0, document.getSize());
+        });
+        double undo = measure(1, [&](size_t) { history.undo(document); });
+        double redo = measure(1, [&](size_t) { history.redo(document); });
+
+        // Neither step should allocate anything close to the size of the document.
+        std::cout << "undo      " << size << " bytes" <<
+                     "  erase: " << erase / 1e3 << " us" <<
+                     "  undo: " << undo / 1e3 << " us" <<
+                     "  redo: " << redo / 1e3 << " us" <<
+                     "  allocated: " << g_AllocatedBytes - bytesBefore << " bytes\n";
+    }
+
+    // The outcome of running one editing workload on one document size.
+    struct WorkloadResult {
+        std::string workload;
+        size_t size;
+        size_t ops;
+        double opsPerSecond;
+        double p50, p99; // Latency of a single op, in nanoseconds.
+        double allocationsPerOp;
+    };
+
+    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(WorkloadResult, workload, size, ops, opsPerSecond, p50, p99, allocationsPerOp)
+
+    // An editing workload, run through the Editor like a user would.
+    struct Workload {
+        const char* name;
+        size_t ops; // How many times op is run. Capped for workloads that touch the whole document.
+        std::function<void(Editor&)> op;
+    };
+
+    std::vector<Workload> getWorkloads(size_t size) {
+        static const std::string clipboard = generateDocument(4096);
+
+        // Select-all+copy copies the whole document every time.
+        size_t copies = std::clamp<size_t>((size_t(64) << 20) / size, 3, 1000);
+
+        // Stop deleting words before running out of them, a backspace at the very start does nothing.
+        size_t words = std::min<size_t>(size / 16, 10000);
+
+        return {
+            { "typing", 10000, [](Editor& editor) { editor.add('x'); } },
+            { "paste", 1000, [](Editor& editor) { editor.add(clipboard); } },
+            { "delete-word", words, [](Editor& editor) { editor.skipRemove(); } },
+            { "select-all+copy", copies, [](Editor& editor) {
+                editor.selectAll();
+                volatile size_t copied = editor.getSelection().value().size();
+                (void)copied;
+                editor.stopSelecting();
+            } },
+            { "navigation", 10000, [step = size_t(0)](Editor& editor) mutable {
+                // A mix of the moves made while reading code, that keeps roughly to the same place.
+                switch (step++ % 8) {
+                case 0: editor.skipRight(); break;
+                case 1: editor.moveDown(); break;
+                case 2: editor.skipLeft(); break;
+                case 3: editor.moveEnd(); break;
+                case 4: editor.moveUp(); break;
+                case 5: editor.moveStart(); break;
+                case 6: editor.moveRight(); break;
+                case 7: editor.moveDown(); break;
+                }
+            } },
+        };
+    }
+
+    // Runs a workload on a freshly opened document, starting from its middle row, and times every op on its own.
+    WorkloadResult runWorkload(const Workload& workload, const std::filesystem::path& path, size_t size) {
+        Editor editor;
+        editor.open(path);
+        editor.waitForIndex();
+        editor.moveTo({ editor.getLineCount() / 2, 0 });
+        editor.moveEnd();
+
+        std::vector<double> latencies;
+        latencies.reserve(workload.ops);
+
+        size_t allocations = g_Allocations;
+        auto begin = Clock::now();
+
+        for (size_t i = 0; i < workload.ops; i++) {
+            auto opBegin = Clock::now();
+            workload.op(editor);
+            latencies.push_back(std::chrono::duration<double, std::nano>(Clock::now() - opBegin).count());
+        }
+
+        double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+        size_t allocated = g_Allocations - allocations;
+
+        const auto percentile = [&](double p) {
+            auto it = latencies.begin() + static_cast<size_t>(p * (latencies.size() - 1));
+            std::nth_element(latencies.begin(), it, latencies.end());
+            return *it;
+        };
+
+        return { workload.name, size, workload.ops, workload.ops / seconds,
+                 percentile(0.5), percentile(0.99), double(allocated) / workload.ops };
+    }
+
+    // Runs every editing workload on a generated document of 'size' bytes.
+    void benchmarkWorkloads(size_t size, std::vector<WorkloadResult>& results) {
+        auto path = writeDocument("visionary_bench_workload.txt", size);
+
+        for (const Workload& workload : getWorkloads(size)) {
+            WorkloadResult result = runWorkload(workload, path, size);
+
+            std::cout << "workload  " << result.workload << "  " << size << " bytes" <<
+                         "  " << result.opsPerSecond << " ops/s" <<
+                         "  p50: " << result.p50 << " ns" <<
+                         "  p99: " << result.p99 << " ns" <<
+                         "  " << result.allocationsPerOp << " allocations/op\n";
+
+            results.push_back(std::move(result));
+        }
+
+        std::filesystem::remove(path);
+    }
+
+    // Opens a file of 'size' bytes and reads the first screen of it.
+    void benchmarkOpen(size_t size) {
+        auto path = writeDocument("visionary_bench_open.txt", size);
+
+        PieceTable document;
+        double firstScreen = measure(1, [&](size_t) {
+            document.open(path);
+
+            for (size_t row = 0; row < 100; row++)
+                document.line(row);
+        });
+
+        // The rest of the file is indexed in the background.
+        double fullIndex = firstScreen + measure(1, [&](size_t) {
+            document.waitForIndex();
+        });
+
+        std::cout << "open      " << size << " bytes" <<
+                     "  first screen: " << firstScreen / 1e6 << " ms" <<
+                     "  full index: " << fullIndex / 1e6 << " ms\n";
+
+        document.load("");
+        std::filesystem::remove(path);
+    }
+
+    // Journals edits to a file of 'size' bytes, then writes all of it to an autosave.
+    void benchmarkAutosave(size_t size) {
+        auto path = writeDocument("visionary_bench_autosave.txt", size);
+        auto directory = std::filesystem::temp_directory_path() / "visionary_bench_recovery";
+
+        PieceTable document;
+        RecoveryJournal recovery(directory, std::chrono::seconds(0));
+        recovery.open(path, document);
+        document.waitForIndex();
+
+        // Typing in the middle, with the record of every keystroke queued for the writer.
+        size_t middle = document.getSize() / 2;
+        double keystroke = measure(10000, [&](size_t i) {
+            document.insert(document.toLocation(middle + i), "x");
+        });
+
+        double journal = measure(1, [&](size_t) { recovery.flush(); });
+
+        // The UI thread only takes the pieces, the writer copies the text in the background.
+        double checkpoint = measure(1, [&](size_t) { recovery.checkpoint(); });
+        double autosave = measure(1, [&](size_t) { recovery.flush(); });
+
+        std::cout << "autosave  " << size << " bytes" <<
+                     "  keystroke: " << keystroke << " ns" <<
+                     "  journal sync: " << journal / 1e6 << " ms" <<
+                     "  checkpoint: " << checkpoint / 1e3 << " us" <<
+                     "  autosave in background: " << autosave / 1e6 << " ms\n";
+
+        recovery.close();
+        document.load("");
+        std::filesystem::remove(path);
+        std::filesystem::remove(directory);
+    }
+}
+
+int main(int argc, char** argv) {
+    // The largest document size can be lowered on machines without enough memory.
+    // With '--json <path>', the workload results are also written to a file, to track regressions.
+    constexpr size_t defaultMaxSize = size_t(1) << 30;
+    size_t maxSize = defaultMaxSize;
+    std::filesystem::path jsonPath;
+
+    const auto usage = [&]() {
+        std::cerr << "Usage: " << argv[0] << " [max document size in bytes, default " << defaultMaxSize << "] [--json <path>]" << std::endl;
+    };
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            jsonPath = argv[++i];
+            continue;
+        }
+
+        if (std::strcmp(argv[i], "--help") == 0 || std::strcmp(argv[i], "-h") == 0) {
+            usage();
+            return 0;
+        }
+
+        char* end = nullptr;
+        unsigned long long size = std::isdigit(static_cast<unsigned char>(argv[i][0])) ? std::strtoull(argv[i], &end, 10) : 0;
+        if (size == 0 || *end != '\0') {
+            std::cerr << "[BENCH]: Not a size: '" << argv[i] << "'" << std::endl;
+            usage();
+            return 1;
+        }
+
+        maxSize = size;
+    }
+
+    useDefaultConfig();
+
+    for (size_t size = 1024; size <= maxSize; size *= 32)
+        benchmarkDocument(size);
+
+    benchmarkLineAccess();
+
+    for (size_t size : { 1000000, 10000000, 100000000 }) {
+        benchmarkPaste(std::min(size, maxSize));
+        if (size >= maxSize)
+            break;
+    }
+
+    benchmarkNewlineScanner(std::min(maxSize, size_t(256) << 20));
+    benchmarkUtf8(std::min(maxSize, size_t(256) << 20));
+    benchmarkSearch(std::min(maxSize, size_t(256) << 20));
+
+    for (size_t size = 1024; size <= maxSize; size *= 32)
+        benchmarkUndo(size);
+
+    for (size_t size = 1024; size <= maxSize; size *= 32)
+        benchmarkReplaceAll(size);
+
+    for (size_t carets : { 100, 10000 })
+        benchmarkCarets(carets);
+
+    benchmarkSyntax(100000);
+    benchmarkVisualRows(1000000);
+    // As many lines as a document of maxSize bytes has, but enough for a few screens of them.
+    benchmarkHighlights(std::clamp<size_t>(maxSize / 64, 1000, 10000000));
+
+    std::vector<WorkloadResult> results;
+    for (size_t size = 1024; size <= maxSize; size *= 32)
+        benchmarkWorkloads(size, results);
+
+    for (size_t size = 1024; size <= maxSize; size *= 32)
+        benchmarkOpen(size);
+
+    benchmarkAutosave(std::min(maxSize, size_t(1) << 30));
+
+    if (!jsonPath.empty()) {
+        std::ofstream out(jsonPath);
+        if (!out) {
+            std::cerr << "[BENCH]: Cannot create " << jsonPath << std::endl;
+            return 1;
+        }
+
+        out << nlohmann::json(results).dump(4) << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,323 @@
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <SFML/Graphics.hpp>
+
+#include "Bench.hpp"
+#include "GlyphCache.h"
+#include "PieceTable.h"
+#include "TextBox.h"
+#include "Utf8.h"
+
+// Benchmarks of everything that draws, which needs a display and the editor's font and theme.
+namespace {
+    // The x position of a column of a line, walking the line from its start
+    // like sf::Text does, unless every column is equally wide.
+    float findCharacterX(const GlyphCache& glyphs, std::string_view line, size_t col) {
+        col = std::min(col, line.size());
+
+        if (glyphs.isMonospace() && std::all_of(line.begin(), line.begin() + col, [](char c) { return c >= ' ' && c <= '~'; }))
+            return col * glyphs.getMonospaceAdvance();
+
+        float x = 0;
+        uint32_t prev = 0;
+
+        for (size_t pos = 0; pos < col;) {
+            uint32_t c;
+            pos = Utf8::decode(line, pos, c);
+
+            x += glyphs.getKerning(prev, c) + glyphs.getAdvance(c);
+            prev = c;
+        }
+
+        return x;
+    }
+
+    // Finds the x position of both ends of every row of a 100k-line selection, which is what
+    // highlighting it takes, once with a throwaway sf::Text per lookup and once with GlyphCache.
+    void benchmarkGlyphLayout() {
+        sf::Font font;
+        if (!font.openFromFile("Fonts/CascadiaCode.ttf")) {
+            std::cout << "layout    skipped, Fonts/CascadiaCode.ttf not found\n";
+            return;
+        }
+
+        constexpr size_t rows = 100000;
+        constexpr uint32_t fontSize = 24;
+
+        PieceTable document(generateDocument(rows * 60));
+        float sink = 0;
+
+        size_t allocationsBefore = g_Allocations;
+        double before = measure(1, [&](size_t) {
+            for (size_t row = 0; row < rows; row++) {
+                auto line = document.line(row).value_or(std::string_view());
+
+                sf::Text text(font, sf::String::fromUtf8(line.begin(), line.end()), fontSize);
+                sink += text.findCharacterPos(0).x + text.findCharacterPos(line.size()).x;
+            }
+        });
+        size_t allocationsAfterBefore = g_Allocations;
+
+        const GlyphCache& glyphs = GlyphCache::get(font, fontSize);
+        double after = measure(1, [&](size_t) {
+            for (size_t row = 0; row < rows; row++) {
+                auto line = document.line(row).value_or(std::string_view());
+                sink += findCharacterX(glyphs, line, 0) + findCharacterX(glyphs, line, line.size());
+            }
+        });
+        size_t allocationsAfter = g_Allocations;
+
+        std::cout << "layout    " << rows << " rows" <<
+                     "  sf::Text: " << before / 1e6 << " ms, " << double(allocationsAfterBefore - allocationsBefore) / rows << " allocations/row" <<
+                     "  GlyphCache" << (glyphs.isMonospace() ? " (monospace)" : "") << ": " << after / 1e6 << " ms, " <<
+                     double(allocationsAfter - allocationsAfterBefore) / rows << " allocations/row" <<
+                     "  (" << sink << ")\n";
+    }
+
+    // Renders a TextBox that fills a 4K window, scrolling one line per frame.
+    void benchmarkRender() {
+        constexpr unsigned width = 3840, height = 2160;
+        constexpr size_t frames = 300;
+
+        sf::RenderTexture target;
+        if (!target.resize({ width, height })) {
+            std::cout << "render    skipped, cannot create a " << width << "x" << height << " render target\n";
+            return;
+        }
+
+        auto path = writeDocument("visionary_bench_render.txt", size_t(16) << 20);
+
+        // Scoped, so that the file is no longer mapped when it's removed.
+        {
+            TextBox textBox({ 0, 0 }, { static_cast<float>(width), static_cast<float>(height) });
+            textBox.open(path);
+
+            const auto frame = [&](size_t) {
+                textBox.scrollDown();
+                textBox.update(1.0 / 60);
+
+                target.clear();
+                target.draw(textBox);
+                target.display();
+            };
+
+            // The first frames load the glyphs into the atlas.
+            measure(10, frame);
+
+            double nanoseconds = measure(frames, frame);
+            target.getTexture().copyToImage(); // Wait for the GPU to catch up.
+
+            std::cout << "render    " << width << "x" << height <<
+                         "  " << nanoseconds / 1e6 << " ms/frame" <<
+                         "  (" << 1e9 / nanoseconds << " fps)\n";
+        }
+
+        std::filesystem::remove(path);
+    }
+
+    // Scrolls through a million lines at a wheel fling's speed and at the speed of dragging a scrollbar,
+    // and reports the slowest frame next to how often the rows in frame had to be laid out again.
+    void benchmarkFling() {
+        constexpr unsigned width = 1920, height = 1080;
+        constexpr size_t frames = 600;
+
+        sf::RenderTexture target;
+        if (!target.resize({ width, height })) {
+            std::cout << "fling     skipped, cannot create a " << width << "x" << height << " render target\n";
+            return;
+        }
+
+        auto path = writeDocument("visionary_bench_fling.txt", size_t(60) << 20);
+
+        // Scoped, so that the file is no longer mapped when it's removed.
+        {
+            TextBox textBox({ 0, 0 }, { static_cast<float>(width), static_cast<float>(height) });
+            textBox.open(path);
+
+            for (size_t scrollsPerFrame : { size_t(20), size_t(2000) }) {
+                double slowest = 0;
+                const auto frame = [&](size_t) {
+                    auto begin = Clock::now();
+
+                    for (size_t i = 0; i < scrollsPerFrame; i++)
+                        textBox.scrollDown();
+                    textBox.update(1.0 / 60);
+
+                    target.clear();
+                    target.draw(textBox);
+                    target.display();
+
+                    slowest = std::max(slowest, std::chrono::duration<double, std::milli>(Clock::now() - begin).count());
+                };
+
+                // The first frames load the glyphs into the atlas.
+                measure(10, frame);
+                slowest = 0;
+
+                RenderCounters before = textBox.getRenderCounters();
+                double nanoseconds = measure(frames, frame);
+                target.getTexture().copyToImage(); // Wait for the GPU to catch up.
+                RenderCounters after = textBox.getRenderCounters();
+
+                std::cout << "fling     " << scrollsPerFrame << " scrolls/frame" <<
+                             "  " << nanoseconds / 1e6 << " ms/frame, slowest " << slowest << " ms" <<
+                             "  text updates: " << (after.textUpdates - before.textUpdates) <<
+                             "  view only: " << (after.viewMoves - before.viewMoves) << "\n";
+            }
+        }
+
+        std::filesystem::remove(path);
+    }
+
+    // Draws the first screen of a 50 MB file that is a single line, like minified JSON, then pans along it by following
+    // the cursor, types into it and jumps to its end. Next to it, the same for a file of regular lines, which should cost
+    // about as much.
+    void benchmarkLongLine() {
+        constexpr unsigned width = 1920, height = 1080;
+        constexpr size_t size = size_t(50) << 20;
+        constexpr size_t frames = 300;
+        constexpr size_t keystrokes = 100;
+
+        sf::RenderTexture target;
+        if (!target.resize({ width, height })) {
+            std::cout << "long line skipped, cannot create a " << width << "x" << height << " render target\n";
+            return;
+        }
+
+        std::string lines = generateDocument(size);
+        std::string line = lines;
+        std::replace(line.begin(), line.end(), '\n', ' ');
+
+        // Same line, with a two byte character every so often, so that columns aren't all equally wide.
+        std::string utf8 = line;
+        for (size_t i = 0; i + 2 <= utf8.size(); i += 97)
+            utf8.replace(i, 2, "\xC3\xA9");
+
+        for (const auto& [name, contents] : { std::pair<const char*, const std::string&>{ "lines    ", lines },
+                                              { "one line ", line }, { "utf-8    ", utf8 } }) {
+            auto path = std::filesystem::temp_directory_path() / "visionary_bench_long_line.txt";
+            {
+                std::ofstream out(path, std::ios::binary);
+                out << contents;
+            }
+
+            // Scoped, so that the file is no longer mapped when it's removed.
+            {
+                TextBox textBox({ 0, 0 }, { static_cast<float>(width), static_cast<float>(height) });
+                const auto draw = [&] {
+                    target.clear();
+                    target.draw(textBox);
+                    target.display();
+                };
+
+                // Waits for the indexer, so that only laying out and drawing is timed.
+                textBox.open(path);
+                textBox.waitForIndex();
+
+                double first = measure(1, [&](size_t) { textBox.update(1.0 / 60); draw(); });
+
+                double slowest = 0;
+                RenderCounters before = textBox.getRenderCounters();
+                double pan = measure(frames, [&](size_t) {
+                    auto begin = Clock::now();
+
+                    for (size_t i = 0; i < 100; i++)
+                        textBox.moveRight();
+                    textBox.update(1.0 / 60);
+                    draw();
+
+                    slowest = std::max(slowest, std::chrono::duration<double, std::milli>(Clock::now() - begin).count());
+                });
+                RenderCounters after = textBox.getRenderCounters();
+
+                // Typing where the panning stopped, which splits the line into pieces, and erasing it again.
+                double slowestKeystroke = 0;
+                const auto keystroke = [&](const std::function<void()>& edit) {
+                    auto begin = Clock::now();
+
+                    edit();
+                    textBox.update(1.0 / 60);
+                    draw();
+
+                    slowestKeystroke = std::max(slowestKeystroke, std::chrono::duration<double, std::milli>(Clock::now() - begin).count());
+                };
+
+                double type = measure(keystrokes, [&](size_t) { keystroke([&] { textBox.add('x'); }); });
+                double erase = measure(keystrokes, [&](size_t) { keystroke([&] { textBox.remove(); }); });
+
+                double end = measure(1, [&](size_t) { textBox.moveEnd(); textBox.update(1.0 / 60); draw(); });
+                target.getTexture().copyToImage(); // Wait for the GPU to catch up.
+
+                std::cout << "long line " << name <<
+                             "  first screen: " << first / 1e6 << " ms" <<
+                             "  panning: " << pan / 1e6 << " ms/frame, slowest " << slowest << " ms, " <<
+                             (after.linesLaidOut - before.linesLaidOut) / double(frames) << " lines laid out/frame" <<
+                             "  typing: " << type / 1e6 << " ms, erasing: " << erase / 1e6 << " ms, slowest " << slowestKeystroke << " ms" <<
+                             "  jump to end: " << end / 1e6 << " ms\n";
+            }
+
+            std::filesystem::remove(path);
+        }
+    }
+
+    // Counts what a TextBox redoes after the most common actions, per action.
+    void benchmarkDamage() {
+        constexpr size_t actions = 100;
+
+        auto path = writeDocument("visionary_bench_damage.txt", size_t(1) << 20);
+
+        // Scoped, so that the file is no longer mapped when it's removed.
+        {
+            TextBox textBox({ 0, 0 }, { 1920, 1080 });
+            textBox.open(path);
+            textBox.update(1.0 / 60);
+
+            const auto report = [&](const char* name, const std::function<void()>& action) {
+                RenderCounters before = textBox.getRenderCounters();
+
+                for (size_t i = 0; i < actions; i++) {
+                    action();
+                    textBox.update(1.0 / 60);
+                }
+
+                RenderCounters after = textBox.getRenderCounters();
+                std::cout << "damage    " << name <<
+                             "  updates: " << (after.updates - before.updates) / double(actions) <<
+                             "  caret: " << (after.caretUpdates - before.caretUpdates) / double(actions) <<
+                             "  gutter: " << (after.gutterUpdates - before.gutterUpdates) / double(actions) <<
+                             "  text: " << (after.textUpdates - before.textUpdates) / double(actions) <<
+                             "  lines laid out: " << (after.linesLaidOut - before.linesLaidOut) / double(actions) <<
+                             "  highlight: " << (after.highlightUpdates - before.highlightUpdates) / double(actions) <<
+                             "  view only: " << (after.viewMoves - before.viewMoves) / double(actions) << "\n";
+            };
+
+            // Moving the cursor within the screen shouldn't lay out a single line.
+            report("arrow key", [&] { textBox.moveDown(); textBox.moveRight(); textBox.moveUp(); });
+            report("typing   ", [&] { textBox.add('x'); });
+            report("newline  ", [&] { textBox.add('\n'); });
+            report("scroll   ", [&] { textBox.scrollDown(); });
+        }
+
+        std::filesystem::remove(path);
+    }
+}
+
+int main() {
+    useDefaultConfig();
+
+    benchmarkGlyphLayout();
+    benchmarkRender();
+    benchmarkFling();
+    benchmarkLongLine();
+    benchmarkDamage();
+
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <iterator>
+
+#include "ColumnMap.h"
+#include "Utf8.h"
+
+ColumnMap::ColumnMap(const Document& document) : m_Document(document), m_Columns() {}
+
+bool ColumnMap::isAscii(size_t row) const {
+    return getColumns(row).ascii;
+}
+
+bool ColumnMap::isPrintableAscii(size_t row) const {
+    return getColumns(row).printable;
+}
+
+size_t ColumnMap::toColumn(size_t row, size_t byte) const {
+    const Columns& columns = getColumns(row);
+    if (columns.ascii)
+        return std::min(byte, m_Document.getLineLength(row));
+
+    auto line = m_Document.line(row).value_or(std::string_view());
+    byte = std::min(byte, line.size());
+
+    // Start from the last checkpoint at or before the byte. The first one is always 0.
+    const auto& checkpoints = columns.checkpoints;
+    size_t index = std::prev(std::upper_bound(checkpoints.begin(), checkpoints.end(), byte)) - checkpoints.begin();
+
+    size_t column = index * checkpointInterval;
+    for (size_t pos = checkpoints[index]; pos < byte; column++)
+        pos = Utf8::nextCluster(line, pos);
+
+    return column;
+}
+
+size_t ColumnMap::toByte(size_t row, size_t column) const {
+    const Columns& columns = getColumns(row);
+    if (columns.ascii)
+        return std::min(column, m_Document.getLineLength(row));
+
+    auto line = m_Document.line(row).value_or(std::string_view());
+
+    const auto& checkpoints = columns.checkpoints;
+    size_t index = std::min(column / checkpointInterval, checkpoints.size() - 1);
+
+    size_t pos = checkpoints[index];
+    for (size_t steps = column - index * checkpointInterval; steps > 0 && pos < line.size(); steps--)
+        pos = Utf8::nextCluster(line, pos);
+
+    return pos;
+}
+
+size_t ColumnMap::next(size_t row, size_t byte) const {
+    if (getColumns(row).ascii)
+        return std::min(byte + 1, m_Document.getLineLength(row));
+
+    return Utf8::nextCluster(m_Document.line(row).value_or(std::string_view()), byte);
+}
+
+size_t ColumnMap::prev(size_t row, size_t byte) const {
+    if (getColumns(row).ascii)
+        return std::min(byte, m_Document.getLineLength(row)) - (byte > 0 ? 1 : 0);
+
+    return Utf8::prevCluster(m_Document.line(row).value_or(std::string_view()), byte);
+}
+
+size_t ColumnMap::snap(size_t row, size_t byte) const {
+    if (getColumns(row).ascii)
+        return std::min(byte, m_Document.getLineLength(row));
+
+    // The character that ends right after the byte starts where it does.
+    auto line = m_Document.line(row).value_or(std::string_view());
+    return (byte < line.size()) ? Utf8::prevCluster(line, byte + 1) : line.size();
+}
+
+void ColumnMap::onLinesChanged(size_t firstRow, size_t lineCountBefore, std::string_view inserted) {
+    size_t lineCount = m_Document.getLineCount();
+
+    if (lineCount == lineCountBefore) {
+        auto it = m_Columns.find(firstRow);
+        if (it == m_Columns.end())
+            return;
+
+        // Erasing from a line of ASCII, or typing more of it, leaves it one. Anything else is looked at again.
+        Columns& columns = it->second;
+        for (char c : inserted) {
+            columns.printable &= (c >= ' ' && c <= '~');
+            columns.ascii &= (static_cast<unsigned char>(c) < 0x80);
+        }
+
+        if (!columns.ascii)
+            m_Columns.erase(it);
+
+        return;
+    }
+
+    // The edited rows are gone, the ones below them moved by the amount of lines added or removed.
+    size_t removed = (lineCountBefore > lineCount) ? lineCountBefore - lineCount : 0;
+    std::unordered_map<size_t, Columns> moved;
+
+    for (auto it = m_Columns.begin(); it != m_Columns.end();) {
+        if (it->first < firstRow) {
+            ++it;
+            continue;
+        }
+
+        if (it->first > firstRow + removed)
+            moved.emplace(it->first + lineCount - lineCountBefore, std::move(it->second));
+
+        it = m_Columns.erase(it);
+    }
+
+    m_Columns.merge(moved);
+}
+
+void ColumnMap::clear() noexcept {
+    m_Columns.clear();
+}
+
+const ColumnMap::Columns& ColumnMap::getColumns(size_t row) const {
+    // Rows past the end aren't cached, they might be appended by indexing later.
+    static const Columns none;
+    if (row >= m_Document.getLineCount())
+        return none;
+
+    if (m_Columns.size() >= maxCachedLines)
+        m_Columns.clear();
+
+    auto [it, inserted] = m_Columns.try_emplace(row);
+    if (!inserted)
+        return it->second;
+
+    Columns& columns = it->second;
+    size_t length = m_Document.getLineLength(row);
+
+    // Read a chunk at a time, so that a huge line doesn't have to be joined just to find out it's ASCII.
+    for (size_t begin = 0; begin < length && columns.ascii; begin += scanChunkSize) {
+        for (char c : m_Document.linePart(row, begin, begin + scanChunkSize).value_or(std::string_view())) {
+            columns.printable &= (c >= ' ' && c <= '~');
+            columns.ascii &= (static_cast<unsigned char>(c) < 0x80);
+
+            if (!columns.ascii)
+                break;
+        }
+    }
+
+    if (columns.ascii)
+        return columns;
+
+    columns.printable = false;
+    auto line = m_Document.line(row).value_or(std::string_view());
+
+    // A single pass over the characters, remembering where every 'checkpointInterval'th one starts.
+    size_t column = 0;
+    for (size_t pos = 0; pos < line.size(); column++) {
+        if (column % checkpointInterval == 0)
+            columns.checkpoints.push_back(pos);
+
+        pos = Utf8::nextCluster(line, pos);
+    }
+
+    if (columns.checkpoints.empty())
+        columns.checkpoints.push_back(0);
+
+    return columns;
+}
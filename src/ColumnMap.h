@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Document.h"
+
+/**
+ * @brief   Maps the bytes of a line to the characters the user sees, and back.
+ *
+ *          Locations in the document are in bytes of UTF-8, but the cursor moves by
+ *          character, and moving up or down keeps the character column rather than the
+ *          byte. A character here is a code point along with anything that belongs to it,
+ *          like an accent, see Utf8::isExtender().
+ *
+ *          Whether a line is pure ASCII is cached until the line is edited, see onLinesChanged().
+ *          On those lines a byte is a column, so every lookup is O(1). Other lines keep the byte
+ *          offset of every 64th column, so a lookup only has to step over the characters after one.
+ *
+ * @note    Never looks past the line it is asked about. A byte that isn't part of a valid
+ *          sequence is a column of its own.
+ */
+class ColumnMap {
+public:
+    /**
+     * @param document  The document to look at. Must outlive the ColumnMap.
+     */
+    explicit ColumnMap(const Document& document);
+
+    /**
+     * @brief   Checks if every byte of a line is ASCII, i.e. every byte is a column.
+     */
+    bool isAscii(size_t row) const;
+
+    /**
+     * @brief   Checks if every byte of a line is printable ASCII, e.g. no tabs.
+     *
+     * @note    Every column of such a line is equally wide in a monospace font.
+     */
+    bool isPrintableAscii(size_t row) const;
+
+    /**
+     * @brief   Gets the column of a byte, i.e. how many characters come before it.
+     */
+    size_t toColumn(size_t row, size_t byte) const;
+
+    /**
+     * @brief   Gets the first byte of a column.
+     *
+     * @returns The byte, or the length of the line if it has fewer columns than that.
+     */
+    size_t toByte(size_t row, size_t column) const;
+
+    /**
+     * @brief   Gets the byte right after the character at @p byte.
+     *
+     * @returns The byte, or the length of the line if @p byte is at its end.
+     */
+    size_t next(size_t row, size_t byte) const;
+
+    /**
+     * @brief   Gets the first byte of the character before @p byte.
+     *
+     * @returns The byte, or 0 if @p byte is at the start of the line.
+     */
+    size_t prev(size_t row, size_t byte) const;
+
+    /**
+     * @brief   Gets the first byte of the character @p byte is in, e.g. after hit testing by byte.
+     */
+    size_t snap(size_t row, size_t byte) const;
+
+    /**
+     * @brief                   Forgets the rows changed by an edit that started on @p firstRow.
+     *                          The rows below it are kept, and move along with the lines added or removed.
+     *
+     * @note                    Lines appended by indexing pass the old line count as both, which keeps every cached row.
+     *
+     * @param lineCountBefore   The amount of lines before the edit.
+     * @param inserted          The text the edit added, if it stayed on @p firstRow. A line of ASCII that only
+     *                          had ASCII typed into it, or anything erased from it, is still known to be one,
+     *                          so typing into a huge line doesn't look at all of it again.
+     */
+    void onLinesChanged(size_t firstRow, size_t lineCountBefore, std::string_view inserted = {});
+
+    /**
+     * @brief   Forgets every row, e.g. when it isn't known which ones an edit changed.
+     */
+    void clear() noexcept;
+
+private:
+    /**
+     * @brief   What is known about the columns of a line.
+     */
+    struct Columns {
+        bool ascii = true;
+        bool printable = true;
+        std::vector<size_t> checkpoints; // The first byte of every 'checkpointInterval'th column. Empty for ASCII.
+    };
+
+    /**
+     * @brief   Gets the columns of a row.
+     *
+     * @note    Looks at the line the first time it's asked for after it changed.
+     */
+    const Columns& getColumns(size_t row) const;
+
+    // The columns between two checkpoints, which have to be stepped over one at a time.
+    static constexpr size_t checkpointInterval = 64;
+
+    // The amount of bytes of a line getColumns() reads at a time, while checking if it's ASCII.
+    static constexpr size_t scanChunkSize = size_t(64) << 10;
+
+    // Lines looked at by getColumns() are cached, up to this many at a time. Every caret
+    // looks at its row on every keystroke, so there's room for a caret on every row of a big selection.
+    static constexpr size_t maxCachedLines = size_t(1) << 16;
+
+    const Document& m_Document;
+
+    mutable std::unordered_map<size_t, Columns> m_Columns; // By row.
+};
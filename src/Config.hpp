@@ -12,16 +12,33 @@ namespace Config {
         std::string themeName = "default.json";
         std::string defaultText = "Hello, World!";
         uint32_t tabWidth = 4;
+        uint64_t undoMemoryBudget = 64ull << 20; // In bytes. Older undo history is moved to a temporary file.
+        std::string renderMode = "continuous"; // "continuous" redraws every frame, "onDemand" only when something changed.
+        uint32_t wakeupInterval = 16; // In milliseconds. How often "onDemand" wakes up while work is running in the background.
+        bool renderStats = false; // Periodically prints wakeups, frames and CPU usage.
+        bool wordWrap = false; // Wraps long lines at the width of the window, instead of scrolling sideways.
+        uint32_t overscanLines = 50; // Rows laid out above and below the view ahead of time. Scrolling over them only moves the view.
+        bool smoothScrolling = true; // Glides to where the mouse wheel scrolls to over a few frames, instead of jumping.
+        bool crashRecovery = true; // Journals the edits to an opened file, so that they are recovered when it's opened again after a crash.
+        uint32_t autosaveInterval = 30; // In seconds. How often an edited file is written to an autosave, so that its journal can start over.
+        std::string recoveryDirectory = "recovery"; // Where the journals and autosaves are kept.
     };
 
-    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Properties, themeName, defaultText, tabWidth)
+    // Missing keys keep their defaults, so that older config files still load.
+    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(Properties, themeName, defaultText, tabWidth, undoMemoryBudget,
+                                                    renderMode, wakeupInterval, renderStats, wordWrap,
+                                                    overscanLines, smoothScrolling, crashRecovery,
+                                                    autosaveInterval, recoveryDirectory)
+
+    // Filled in by the first Get(), unless Set() came first.
+    inline Properties g_Properties;
+    inline bool g_Loaded = false;
 
     inline Properties& Get() {
-        static Properties properties; 
-        static bool firstCall = true;
+        Properties& properties = g_Properties;
 
-        if (firstCall) {
-            firstCall = false;
+        if (!g_Loaded) {
+            g_Loaded = true;
             constexpr const char* path = "config.json";
             try {
                 if (std::filesystem::exists(path)) {
@@ -46,5 +63,11 @@ namespace Config {
 
         return properties;
     }
+
+    // Uses 'properties' from then on, config.json is neither read nor created. Meant for the benchmarks.
+    inline void Set(Properties properties) {
+        g_Properties = std::move(properties);
+        g_Loaded = true;
+    }
 };
 
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief   What changed since a TextBox last updated its elements,
+ *          so that each element only redoes the work that is actually needed.
+ */
+struct Damage {
+    enum Flags : uint8_t {
+        None        = 0,
+        Caret       = 1 << 0,   // The cursor moved, or the text under it did.
+        Lines       = 1 << 1,   // The contents of some rows changed. Text knows which, see Text::onLinesChanged().
+        Gutter      = 1 << 2,   // The line count changed, and maybe the width of the gutter with it.
+        Scroll      = 1 << 3,   // The rows in frame have to be laid out around the view again.
+        Selection   = 1 << 4,   // The selected range changed.
+        Matches     = 1 << 5,   // The search query changed, or the matches of it might have.
+        View        = 1 << 6,   // The scroll offset changed. Only becomes 'Scroll' once the view leaves the rows laid out around it.
+        All         = Caret | Lines | Gutter | Scroll | Selection | Matches | View
+    };
+
+    uint8_t flags = All;
+
+    bool has(uint8_t mask) const noexcept {
+        return (flags & mask) != 0;
+    }
+
+    void add(uint8_t mask) noexcept {
+        flags |= mask;
+    }
+
+    void clear() noexcept {
+        flags = None;
+    }
+};
+
+/**
+ * @brief   How much work the elements of a TextBox have done so far.
+ *
+ * @note    Only ever goes up. Compare two snapshots to see what an action cost.
+ */
+struct RenderCounters {
+    uint64_t updates = 0;           // Updates that had any damage to repair.
+    uint64_t caretUpdates = 0;
+    uint64_t gutterUpdates = 0;
+    uint64_t textUpdates = 0;       // Passes over the rows in frame.
+    uint64_t linesLaidOut = 0;      // Rows that had to be laid out again during those passes.
+    uint64_t highlightUpdates = 0;
+    uint64_t viewMoves = 0;         // Updates that only moved the view over rows that were already laid out.
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#include "CursorLocation.hpp"
+
+/**
+ * @brief   Read-only, line-oriented access to the contents of a TextBox.
+ *
+ *          Cursor, Text and LineIndicator only need to know how many lines
+ *          there are and what a given line contains, so they go through this
+ *          interface instead of depending on how the text is actually stored.
+ */
+class Document {
+public:
+    virtual ~Document() = default;
+
+    /**
+     * @brief   Get the amount of lines.
+     *
+     * @note    A document always has at least one (possibly empty) line.
+     */
+    virtual size_t getLineCount() const noexcept = 0;
+
+    /**
+     * @brief       Get the length of a line, excluding the implicit newline.
+     *
+     * @param row   The row.
+     *
+     * @returns     The length of the line, or 0 if the row is out of range.
+     */
+    virtual size_t getLineLength(size_t row) const noexcept = 0;
+
+    /**
+     * @brief       Get a line at a specific row, without copying it.
+     *
+     * @param row   The row.
+     *
+     * @returns     A view of the line, or 'std::nullopt'
+     *              if the provided row is out of range.
+     *
+     * @note        The view is only valid until the document is
+     *              modified, or until line() is called again.
+     */
+    virtual std::optional<std::string_view> line(size_t row) const = 0;
+
+    /**
+     * @brief       Get part of a line, without looking at the rest of it.
+     *
+     * @param row   The row.
+     * @param begin The first byte of the part, clamped to the length of the line.
+     * @param end   The byte past the part, likewise.
+     *
+     * @returns     A view of the bytes in [begin, end) of the line, or
+     *              'std::nullopt' if the provided row is out of range.
+     *
+     * @note        Meant for lines that are too long to be read whole, e.g. to lay out the part
+     *              of one that is in view. The view is valid as long as one from line() is.
+     */
+    virtual std::optional<std::string_view> linePart(size_t row, size_t begin, size_t end) const {
+        auto view = line(row);
+        if (!view)
+            return std::nullopt;
+
+        begin = std::min(begin, view->size());
+        return view->substr(begin, std::clamp(end, begin, view->size()) - begin);
+    }
+
+    /**
+     * @brief   Get a number that changes whenever the document does.
+     *
+     * @note    Lets anything derived from the lines, like their layout,
+     *          be cached until the document changes.
+     */
+    virtual uint64_t getVersion() const noexcept = 0;
+};
@@ -0,0 +1,288 @@
+#include <algorithm>
+
+#include "SubstringSearch.h"
+#include "DocumentSearch.h"
+
+namespace {
+    /**
+     * @brief   Calls onMatch with the offset of every match in a run of consecutive chunks, in order.
+     *
+     * @note    Both callbacks return false to stop early. beforeChunk is called before each
+     *          chunk is searched. Returns false if either of them stopped the search.
+     */
+    template <typename Chunks, typename BeforeChunk, typename OnMatch>
+    bool forEachMatch(const Chunks& chunks, std::string_view query, BeforeChunk&& beforeChunk, OnMatch&& onMatch) {
+        if (query.empty())
+            return true;
+
+        // A match that doesn't fit in one chunk starts in the last few bytes before it.
+        const size_t overlap = query.size() - 1;
+        std::string carry, joined;
+
+        for (const auto& chunk : chunks) {
+            if (!beforeChunk())
+                return false;
+
+            // Matches that start in the carry and end in this chunk.
+            // A match that lies in the carry entirely would have to be shorter than the query.
+            if (!carry.empty()) {
+                joined.assign(carry);
+                joined.append(chunk.text.substr(0, overlap));
+
+                for (size_t pos = SubstringSearch::find(joined, query); pos < carry.size();
+                     pos = SubstringSearch::find(joined, query, pos + 1)) {
+                    if (!onMatch(chunk.offset - carry.size() + pos))
+                        return false;
+                }
+            }
+
+            for (size_t pos = SubstringSearch::find(chunk.text, query); pos != std::string_view::npos;
+                 pos = SubstringSearch::find(chunk.text, query, pos + 1)) {
+                if (!onMatch(chunk.offset + pos))
+                    return false;
+            }
+
+            // Pieces can be shorter than the query, e.g. a single typed character.
+            if (chunk.text.size() >= overlap) {
+                carry.assign(chunk.text.substr(chunk.text.size() - overlap));
+            }
+            else {
+                carry.append(chunk.text);
+                if (carry.size() > overlap)
+                    carry.erase(0, carry.size() - overlap);
+            }
+        }
+
+        return true;
+    }
+
+    // Cuts a run of consecutive chunks down to the bytes in [begin, end).
+    template <typename Chunk>
+    std::vector<Chunk> sliceChunks(const std::vector<Chunk>& chunks, size_t begin, size_t end) {
+        std::vector<Chunk> ret;
+
+        // The chunks are sorted by offset, so skip straight to the first one that reaches past begin.
+        auto it = std::upper_bound(chunks.begin(), chunks.end(), begin,
+                                   [](size_t offset, const Chunk& chunk) { return offset < chunk.offset + chunk.text.size(); });
+
+        for (; it != chunks.end() && it->offset < end; it++) {
+            size_t from = std::max(begin, it->offset);
+            size_t to = std::min(end, it->offset + it->text.size());
+            ret.push_back({ it->text.substr(from - it->offset, to - from), from });
+        }
+
+        return ret;
+    }
+
+    constexpr auto keepGoing = []() { return true; };
+}
+
+DocumentSearch::DocumentSearch() :
+                m_Query(), m_Snapshot(), m_Added(), m_Version(0),
+                m_Stop(false), m_Mutex(), m_Status(), m_Worker() {}
+
+DocumentSearch::~DocumentSearch() {
+    cancel();
+}
+
+void DocumentSearch::start(const PieceTable& document, std::string query, size_t from) {
+    cancel();
+
+    m_Query = std::move(query);
+    launch(document, from);
+}
+
+void DocumentSearch::recount(const PieceTable& document) {
+    // The first match is kept, so that the editor doesn't jump to it again.
+    std::optional<size_t> firstMatch = getStatus().firstMatch;
+    m_Stop = true;
+    if (m_Worker.joinable())
+        m_Worker.join();
+
+    {
+        std::lock_guard lock(m_Mutex);
+        m_Status = { firstMatch, true, 0, false };
+    }
+
+    launch(document, std::nullopt);
+}
+
+void DocumentSearch::cancel() noexcept {
+    m_Stop = true;
+    if (m_Worker.joinable())
+        m_Worker.join();
+
+    m_Query.clear();
+    m_Snapshot.clear(); m_Added.reset();
+
+    std::lock_guard lock(m_Mutex);
+    m_Status = {};
+}
+
+void DocumentSearch::wait() {
+    if (m_Worker.joinable())
+        m_Worker.join();
+}
+
+DocumentSearch::Status DocumentSearch::getStatus() const {
+    std::lock_guard lock(m_Mutex);
+    return m_Status;
+}
+
+const std::string& DocumentSearch::getQuery() const noexcept {
+    return m_Query;
+}
+
+uint64_t DocumentSearch::getVersion() const noexcept {
+    return m_Version;
+}
+
+void DocumentSearch::launch(const PieceTable& document, std::optional<size_t> from) {
+    m_Snapshot.clear();
+    m_Version = document.getVersion();
+
+    // Only the pieces are taken here. Their text is read by the worker, straight from the buffers,
+    // so that even after pasting hundreds of megabytes, refining the query copies none of it.
+    m_Added = document.shareAdded();
+
+    size_t offset = 0;
+    for (const auto& piece : document.getPieces(0, document.getSize())) {
+        std::string_view text = (piece.buffer == PieceTable::BufferKind::Added) ?
+                                std::string_view(*m_Added).substr(piece.start, piece.length) : document.view(piece);
+
+        // Big pieces are cut up, so that the worker publishes and checks for cancellation regularly.
+        for (size_t i = 0; i < text.size(); i += chunkSize)
+            m_Snapshot.push_back({ text.substr(i, chunkSize), offset + i });
+
+        offset += text.size();
+    }
+
+    if (from.has_value()) {
+        std::lock_guard lock(m_Mutex);
+        m_Status = {};
+    }
+
+    m_Stop = false;
+    m_Worker = std::thread(&DocumentSearch::run, this, from);
+}
+
+void DocumentSearch::run(std::optional<size_t> from) {
+    const auto notStopped = [this]() { return !m_Stop; };
+    size_t size = m_Snapshot.empty() ? 0 : m_Snapshot.back().offset + m_Snapshot.back().text.size();
+
+    // 1. The first match at or after 'from'. If there is none, wrap around to the first one before it.
+    if (from.has_value()) {
+        std::optional<size_t> firstMatch;
+        const auto takeFirst = [&](size_t offset) { firstMatch = offset; return false; };
+
+        forEachMatch(sliceChunks(m_Snapshot, from.value(), size), m_Query, notStopped, takeFirst);
+
+        if (!firstMatch.has_value() && from.value() > 0) {
+            size_t end = std::min(size, from.value() + m_Query.size() - 1);
+
+            forEachMatch(sliceChunks(m_Snapshot, 0, end), m_Query, notStopped, [&](size_t offset) {
+                if (offset < from.value())
+                    firstMatch = offset;
+                return false;
+            });
+        }
+
+        if (m_Stop)
+            return;
+
+        std::lock_guard lock(m_Mutex);
+        m_Status.firstMatch = firstMatch;
+        m_Status.searched = true;
+    }
+
+    // 2. Every match, publishing the count so far before every chunk.
+    size_t count = 0;
+
+    bool finished = forEachMatch(m_Snapshot, m_Query, [&]() {
+        std::lock_guard lock(m_Mutex);
+        m_Status.count = count;
+        return !m_Stop;
+    }, [&](size_t) { count++; return true; });
+
+    if (!finished)
+        return;
+
+    std::lock_guard lock(m_Mutex);
+    m_Status.count = count;
+    m_Status.counted = true;
+}
+
+std::vector<DocumentSearch::Chunk> DocumentSearch::getChunks(const PieceTable& document, size_t begin, size_t end) {
+    std::vector<Chunk> ret;
+
+    for (const auto& piece : document.getPieces(begin, end)) {
+        ret.push_back({ document.view(piece), begin });
+        begin += piece.length;
+    }
+
+    return ret;
+}
+
+std::optional<size_t> DocumentSearch::findNext(const PieceTable& document, std::string_view query, size_t from) {
+    size_t size = document.getSize();
+    if (query.empty())
+        return std::nullopt;
+
+    // Matches that start in [begin, begin + windowSize). The window reaches far enough
+    // past that to find the ones that straddle its end, the next window skips them.
+    for (size_t begin = from; begin < size; begin += windowSize) {
+        size_t end = std::min(size, begin + windowSize + query.size() - 1);
+        std::optional<size_t> found;
+
+        forEachMatch(getChunks(document, begin, end), query, keepGoing, [&](size_t offset) {
+            if (offset < begin + windowSize)
+                found = offset;
+            return false;
+        });
+
+        if (found.has_value())
+            return found;
+    }
+
+    return std::nullopt;
+}
+
+std::optional<size_t> DocumentSearch::findPrevious(const PieceTable& document, std::string_view query, size_t before) {
+    size_t size = document.getSize();
+    if (query.empty())
+        return std::nullopt;
+
+    // Walks back one window at a time, keeping the last match that starts in it.
+    for (size_t end = std::min(before, size); end > 0;) {
+        size_t begin = (end > windowSize) ? end - windowSize : 0;
+        std::optional<size_t> found;
+
+        forEachMatch(getChunks(document, begin, std::min(size, end + query.size() - 1)), query, keepGoing, [&](size_t offset) {
+            if (offset >= end)
+                return false;
+
+            found = offset;
+            return true;
+        });
+
+        if (found.has_value())
+            return found;
+
+        end = begin;
+    }
+
+    return std::nullopt;
+}
+
+void DocumentSearch::findAll(const PieceTable& document, std::string_view query, size_t begin, size_t end,
+                             size_t limit, std::vector<size_t>& out) {
+    end = std::min(end, document.getSize());
+    if (begin >= end || limit == 0)
+        return;
+
+    size_t found = 0;
+    forEachMatch(getChunks(document, begin, end), query, keepGoing, [&](size_t offset) {
+        out.push_back(offset);
+        return ++found < limit;
+    });
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "PieceTable.h"
+
+/**
+ * @brief   Finds a string in a PieceTable, without ever joining its pieces.
+ *
+ *          Every piece is searched with SubstringSearch where it lies in its buffer.
+ *          Matches that straddle two pieces are found by also searching the last
+ *          few bytes of one piece joined with the first few bytes of the next.
+ *
+ *          The first match of a query and the total amount of matches are found
+ *          on a worker thread, which publishes how far it got after every chunk,
+ *          so the owner can show the first match long before everything is counted.
+ *          Starting another search cancels the one that is running.
+ */
+class DocumentSearch {
+public:
+    /**
+     * @brief   How far the worker got with the current query.
+     */
+    struct Status {
+        std::optional<size_t> firstMatch;   // The first match at or after where the search started, wrapping around.
+        bool searched = false;              // Whether firstMatch is final.
+        size_t count = 0;                   // The matches counted so far.
+        bool counted = false;               // Whether count is final.
+
+        bool operator==(const Status& other) const noexcept {
+            return firstMatch == other.firstMatch && searched == other.searched &&
+                   count == other.count && counted == other.counted;
+        }
+
+        bool operator!=(const Status& other) const noexcept {
+            return !(*this == other);
+        }
+    };
+
+    DocumentSearch();
+
+    /**
+     * @brief   Stops the worker, without waiting for it to finish.
+     */
+    ~DocumentSearch();
+
+    DocumentSearch(const DocumentSearch&) = delete;
+    DocumentSearch& operator=(const DocumentSearch&) = delete;
+
+    /**
+     * @brief           Starts looking for @p query in the background. Cancels any running search.
+     *
+     * @note            The worker searches a snapshot of the pieces of the document. It shares the
+     *                  'Added' buffer rather than copying it, see PieceTable::shareAdded(), and reads
+     *                  the original buffer in place, so the document must not be replaced by load()
+     *                  or open() before cancel() is called.
+     *
+     * @param from      The offset to look for the first match from.
+     */
+    void start(const PieceTable& document, std::string query, size_t from);
+
+    /**
+     * @brief   Counts the matches of the current query again, e.g. after the document changed.
+     *          Keeps the first match that was already found.
+     */
+    void recount(const PieceTable& document);
+
+    /**
+     * @brief   Stops the worker and forgets the query.
+     */
+    void cancel() noexcept;
+
+    /**
+     * @brief   Blocks until the worker is done, keeping what it found.
+     */
+    void wait();
+
+    /**
+     * @brief   Get how far the worker got.
+     */
+    Status getStatus() const;
+
+    const std::string& getQuery() const noexcept;
+
+    /**
+     * @brief   Get the version of the document the current snapshot was taken of.
+     */
+    uint64_t getVersion() const noexcept;
+
+    /**
+     * @brief   Finds the first match that starts at or after @p from, without wrapping around.
+     */
+    static std::optional<size_t> findNext(const PieceTable& document, std::string_view query, size_t from);
+
+    /**
+     * @brief   Finds the last match that starts before @p before, without wrapping around.
+     */
+    static std::optional<size_t> findPrevious(const PieceTable& document, std::string_view query, size_t before);
+
+    /**
+     * @brief       Appends the offset of every match that lies entirely within [begin, end) to @p out.
+     *
+     * @param limit Stops after this many matches.
+     */
+    static void findAll(const PieceTable& document, std::string_view query, size_t begin, size_t end,
+                        size_t limit, std::vector<size_t>& out);
+
+private:
+    // A contiguous part of the document.
+    struct Chunk {
+        std::string_view text;
+        size_t offset;
+    };
+
+    // The most bytes searched between two publishes.
+    static constexpr size_t chunkSize = size_t(4) << 20;
+
+    // findNext() and findPrevious() look at this many bytes of the document at a time,
+    // so that a match close by doesn't have to collect the pieces of the whole document.
+    static constexpr size_t windowSize = size_t(1) << 20;
+
+    /**
+     * @brief   Get the chunks of the document in [begin, end), as they are right now.
+     */
+    static std::vector<Chunk> getChunks(const PieceTable& document, size_t begin, size_t end);
+
+    /**
+     * @brief   Snapshots the document, then starts the worker.
+     *
+     * @param from  Where to look for the first match from, or 'std::nullopt' to only count.
+     */
+    void launch(const PieceTable& document, std::optional<size_t> from);
+
+    void run(std::optional<size_t> from);
+
+    std::string m_Query;
+    std::vector<Chunk> m_Snapshot; // Points into the original buffer and m_Added.
+    std::shared_ptr<const std::string> m_Added; // The 'Added' buffer as it was, which stays put while it's shared.
+    uint64_t m_Version;
+
+    std::atomic<bool> m_Stop;
+
+    mutable std::mutex m_Mutex;
+    Status m_Status; // Guarded by m_Mutex.
+
+    std::thread m_Worker;
+};
@@ -0,0 +1,1143 @@
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <iterator>
+#include <utility>
+
+#include "Config.hpp"
+#include "Editor.h"
+#include "RegexSearch.h"
+
+namespace {
+    // Newlines, printable ASCII and the bytes of UTF-8 can be typed or pasted, other control characters can't.
+    bool isInsertable(char c) noexcept {
+        return c == '\n' || std::isprint(static_cast<unsigned char>(c)) || static_cast<unsigned char>(c) >= 0x80;
+    }
+}
+
+Editor::Editor() : m_Document(), m_History(Config::Get().undoMemoryBudget), m_Syntax(m_Document), m_Words(m_Document),
+                   m_Columns(m_Document), m_ValidUtf8(true),
+                   m_Recovery(Config::Get().recoveryDirectory, std::chrono::seconds(Config::Get().autosaveInterval)),
+                   m_Search(), m_SearchStatus(), m_SearchFrom(0), m_Recounting(false),
+                   m_CursorLocation({ 0, 0 }), m_SelectPos(CursorLocation::npos()), m_Carets() {}
+
+bool Editor::open(const std::filesystem::path& path) noexcept {
+    // The search reads straight from the old document, so it has to stop first.
+    endSearch();
+
+    try {
+        if (Config::Get().crashRecovery)
+            m_Recovery.open(path, m_Document);
+        else
+            m_Document.open(path);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "[EDITOR]: " << e.what() << std::endl;
+        return false;
+    }
+
+    m_ValidUtf8 = true;
+    checkEncoding();
+    m_Columns.clear();
+
+    // The old cursor position and history mean nothing in the new document.
+    m_History.clear();
+    m_Syntax.setLanguage(SyntaxHighlighter::detect(path));
+    clearCarets();
+    stopSelecting();
+    moveTop();
+
+    onOpened();
+    return true;
+}
+
+bool Editor::updateIndex() {
+    size_t lineCount = getLineCount();
+    if (!m_Document.updateIndex())
+        return false;
+
+    checkEncoding();
+
+    // The new lines are all appended after the last known line, nothing above that changed.
+    m_Syntax.onLinesChanged(lineCount, lineCount);
+    m_Columns.onLinesChanged(lineCount, lineCount);
+    onLinesChanged(lineCount, lineCount);
+    return true;
+}
+
+void Editor::waitForIndex() {
+    size_t lineCount = getLineCount();
+    m_Document.waitForIndex();
+    checkEncoding();
+
+    if (getLineCount() != lineCount) {
+        m_Syntax.onLinesChanged(lineCount, lineCount);
+        m_Columns.onLinesChanged(lineCount, lineCount);
+        onLinesChanged(lineCount, lineCount);
+    }
+}
+
+void Editor::updateAutosave() {
+    m_Recovery.update();
+}
+
+bool Editor::hasPendingAutosave() const noexcept {
+    return m_Recovery.isEdited();
+}
+
+bool Editor::isFullyIndexed() const noexcept {
+    return m_Document.isFullyIndexed();
+}
+
+bool Editor::isValidUtf8() const noexcept {
+    return m_Document.isValidUtf8();
+}
+
+void Editor::checkEncoding() {
+    if (m_ValidUtf8 && !m_Document.isValidUtf8())
+        std::cerr << "[EDITOR]: The file isn't valid UTF-8, bytes outside of a valid character are shown as U+FFFD." << std::endl;
+
+    m_ValidUtf8 = m_Document.isValidUtf8();
+}
+
+void Editor::clearHistory() noexcept {
+    m_History.clear();
+}
+
+const Document& Editor::getDocument() const noexcept {
+    return m_Document;
+}
+
+SyntaxHighlighter& Editor::getSyntax() noexcept {
+    return m_Syntax;
+}
+
+const ColumnMap& Editor::getColumns() const noexcept {
+    return m_Columns;
+}
+
+std::optional<std::string_view> Editor::line(size_t row) const noexcept {
+    return m_Document.line(row);
+}
+
+CursorLocation Editor::getCursorLocation() const noexcept {
+    return m_CursorLocation;
+}
+
+size_t Editor::getLineCount() const noexcept {
+    return m_Document.getLineCount();
+}
+
+std::optional<char> Editor::getCharAt(const CursorLocation& pos) const noexcept {
+    auto [row, col] = pos;
+
+    // Make sure the position is within bounds.
+    // Check if the row isn't bigger than lineCount
+    // and the column isn't bigger than the line's size.
+    if (row >= getLineCount() || col >= m_Document.getLineLength(row))
+        return std::nullopt;
+
+    return m_Document.getChar(m_Document.toOffset(pos));
+}
+
+std::optional<char> Editor::getRightChar() const noexcept {
+    return getCharAt(getCursorLocation());
+}
+
+std::optional<char> Editor::getLeftChar() const noexcept {
+    return getCharAt(prev());
+}
+
+void Editor::add(char c) noexcept {
+    if (!m_Carets.empty()) {
+        if (isInsertable(c))
+            replaceAtCarets(getCaretRanges(), std::string_view(&c, 1));
+        return;
+    }
+
+    // Typing over a selection is undone in one go.
+    m_History.beginGroup();
+    clearSelection();
+
+    // Insert a character, or an implicit newline that splits the line
+    // at the cursor's position. Make sure it is valid.
+    if (isInsertable(c))
+        moveTo(insertAtCursor(std::string_view(&c, 1)));
+
+    m_History.endGroup();
+}
+
+void Editor::add(const std::string& str) noexcept {
+    // Only copy the string if something has to be filtered out,
+    // pasting a big blob of valid text shouldn't need a second copy of it.
+    std::string filtered;
+    std::string_view text = str;
+
+    if (!std::all_of(str.begin(), str.end(), isInsertable)) {
+        filtered.reserve(str.size());
+        std::copy_if(str.begin(), str.end(), std::back_inserter(filtered), isInsertable);
+        text = filtered;
+    }
+
+    // Pasted at every caret, replacing each of their selections.
+    if (!m_Carets.empty()) {
+        replaceAtCarets(getCaretRanges(), text);
+        return;
+    }
+
+    m_History.beginGroup();
+    clearSelection();
+
+    // A single splice, a single cursor move and therefore a single view update.
+    if (!text.empty())
+        moveTo(insertAtCursor(text));
+
+    m_History.endGroup();
+}
+
+CursorLocation Editor::insertAtCursor(std::string_view str) {
+    size_t offset = m_Document.toOffset(getCursorLocation());
+    size_t lineCount = getLineCount();
+    CursorLocation end = m_Document.insert(getCursorLocation(), str);
+
+    m_History.recordInsert(m_Document, offset, str.size());
+    m_Syntax.onLinesChanged(getCursorLocation().m_Row, lineCount);
+    m_Columns.onLinesChanged(getCursorLocation().m_Row, lineCount, str);
+    onLinesChanged(getCursorLocation().m_Row, lineCount);
+    return end;
+}
+
+void Editor::addTab() noexcept {
+    add(std::string(Config::Get().tabWidth, ' '));
+}
+
+bool Editor::remove() noexcept {
+    // A backspace at every caret, as a single edit.
+    if (!m_Carets.empty()) {
+        replaceAtCarets(getCaretRanges([this]() { return moveTo(prev()); }), {});
+        return true;
+    }
+
+    if(clearSelection()) {
+        return true;
+    }
+
+    // Do nothing if the cursor is on the first character.
+    if (onFirstPos())
+        return false;
+
+    auto [row, col] = getCursorLocation();
+
+    // We're on the start of the line, delete the implicit new line. 
+    if (onStartLine())
+        return removeRange({ row - 1, m_Document.getLineLength(row - 1) }, { row, col });
+
+    // Delete a character normally, however many bytes it takes up.
+    return removeRange(prev(), { row, col });
+}
+
+bool Editor::skipRemove() noexcept {
+    if (!m_Carets.empty()) {
+        replaceAtCarets(getCaretRanges([this]() { return skipCaretLeft(); }), {});
+        return true;
+    }
+
+    if(clearSelection()) {
+        return true;
+    }
+
+    // Save the current cursor position, skip to the left,
+    // and delete all characters in between.
+    CursorLocation initial = getCursorLocation();
+    return skipCaretLeft() && removeRange(getCursorLocation(), initial);
+}
+
+bool Editor::removeRange(CursorLocation begin, CursorLocation end) noexcept {
+    // Ensure the range is actually valid. 
+    if (begin > maxPos() ||
+        end > maxPos() ||
+        begin > end)
+        return false;
+
+    // The history only keeps the erased pieces, so it has to see them before they're gone.
+    m_History.recordErase(m_Document, m_Document.toOffset(begin), m_Document.toOffset(end));
+
+    // The document joins the begin and end lines when the range spans multiple lines.
+    size_t lineCount = getLineCount();
+    m_Document.erase(begin, end);
+    m_Syntax.onLinesChanged(begin.m_Row, lineCount);
+    m_Columns.onLinesChanged(begin.m_Row, lineCount);
+    onLinesChanged(begin.m_Row, lineCount);
+
+    return moveTo(begin);
+}
+
+bool Editor::removeTab() noexcept {
+    if (!m_Carets.empty()) {
+        replaceAtCarets(getCaretRanges([this]() {
+            bool moved = false;
+            for (size_t i = 0; i < Config::Get().tabWidth && getLeftChar() == ' '; i++)
+                moved = moveTo(prev());
+            return moved;
+        }), {});
+        return true;
+    }
+
+    for (size_t i = 0; i <= Config::Get().tabWidth; i++) {
+        if (getLeftChar() == ' ')
+            remove();
+        else
+            return i != 0;
+    }
+
+    return true;
+}
+
+bool Editor::isSelecting() const noexcept {
+    return m_SelectPos != CursorLocation::npos();
+}
+
+void Editor::startSelecting() noexcept {
+    m_SelectPos = getCursorLocation();
+    for (auto& caret : m_Carets)
+        caret.selectPos = caret.location;
+
+    onSelectionChanged();
+}
+
+void Editor::stopSelecting() noexcept {
+    m_SelectPos = CursorLocation::npos();
+    for (auto& caret : m_Carets)
+        caret.selectPos = CursorLocation::npos();
+
+    onSelectionChanged();
+}
+
+bool Editor::clearSelection() noexcept {
+    if(!isSelecting())
+        return false;
+
+    auto [begin, end] = getSelectionRange().value();
+    removeRange(begin, end);
+    stopSelecting();
+    return true;
+}
+
+std::optional<std::string> Editor::getSelection() const noexcept {
+    auto selection = getSelectionRange();
+    if (!selection.has_value())
+        return std::nullopt;
+
+    return m_Document.getText(selection->first, selection->second);
+}
+
+std::optional<std::pair<CursorLocation, CursorLocation>> Editor::getSelectionRange() const noexcept {
+    if (!isSelecting())
+        return std::nullopt;
+
+    return std::make_pair(std::min(m_SelectPos, getCursorLocation()), std::max(m_SelectPos, getCursorLocation()));
+}
+
+std::vector<std::pair<CursorLocation, CursorLocation>> Editor::getSelectionRanges() const {
+    std::vector<std::pair<CursorLocation, CursorLocation>> ret;
+
+    if (auto selection = getSelectionRange())
+        ret.push_back(selection.value());
+
+    for (const auto& caret : m_Carets) {
+        if (caret.selectPos != CursorLocation::npos() && caret.selectPos != caret.location)
+            ret.emplace_back(std::min(caret.selectPos, caret.location), std::max(caret.selectPos, caret.location));
+    }
+
+    // The extra carets are sorted, only the main cursor's selection might be out of place.
+    if (!std::is_sorted(ret.begin(), ret.end()))
+        std::sort(ret.begin(), ret.end());
+
+    return ret;
+}
+
+size_t Editor::getCaretCount() const noexcept {
+    return m_Carets.size() + 1;
+}
+
+const std::vector<Editor::Caret>& Editor::getExtraCarets() const noexcept {
+    return m_Carets;
+}
+
+bool Editor::addCaretAbove() noexcept {
+    CursorLocation top = m_Carets.empty() ? getCursorLocation() : std::min(m_Carets.front().location, getCursorLocation());
+    if (top.m_Row == 0)
+        return false;
+
+    // Same column as the cursor, in characters.
+    auto [cursorRow, cursorCol] = getCursorLocation();
+    size_t row = top.m_Row - 1;
+    m_Carets.push_back({ { row, m_Columns.toByte(row, m_Columns.toColumn(cursorRow, cursorCol)) } });
+
+    mergeCarets();
+    onCaretsChanged();
+    return true;
+}
+
+bool Editor::addCaretBelow() noexcept {
+    CursorLocation bottom = m_Carets.empty() ? getCursorLocation() : std::max(m_Carets.back().location, getCursorLocation());
+    if (bottom.m_Row + 1 >= getLineCount())
+        return false;
+
+    auto [cursorRow, cursorCol] = getCursorLocation();
+    size_t row = bottom.m_Row + 1;
+    m_Carets.push_back({ { row, m_Columns.toByte(row, m_Columns.toColumn(cursorRow, cursorCol)) } });
+
+    mergeCarets();
+    onCaretsChanged();
+    return true;
+}
+
+bool Editor::addNextOccurrence() noexcept {
+    // Nothing selected yet, select the word under the cursor.
+    if (!isSelecting() || getSelectionRange()->first == getSelectionRange()->second) {
+        auto [row, col] = getCursorLocation();
+        auto [begin, end] = m_Words.findWord(row, col);
+
+        auto text = line(row).value_or(std::string_view());
+        if (begin == end || WordBoundaries::classify(text[begin]) != WordBoundaries::CharClass::Word)
+            return false;
+
+        stopSelecting();
+        moveTo({ row, begin });
+        startSelecting();
+        moveTo({ row, end });
+        return true;
+    }
+
+    // Look after the main cursor's selection, which is always the one found last.
+    auto [begin, end] = getSelectionRange().value();
+    std::string query = getSelection().value();
+
+    auto found = DocumentSearch::findNext(m_Document, query, m_Document.toOffset(end));
+    if (!found.has_value())
+        found = DocumentSearch::findNext(m_Document, query, 0);
+
+    CursorLocation foundBegin = m_Document.toLocation(found.value());
+    CursorLocation foundEnd = m_Document.toLocation(found.value() + query.size());
+
+    // Every occurrence is selected once the search comes back around to one that already is.
+    if (foundBegin == begin)
+        return false;
+
+    for (const auto& caret : m_Carets) {
+        if (std::min(caret.location, caret.selectPos) == foundBegin && std::max(caret.location, caret.selectPos) == foundEnd)
+            return false;
+    }
+
+    m_Carets.push_back({ m_CursorLocation, m_SelectPos });
+    m_SelectPos = foundBegin;
+    moveTo(foundEnd);
+
+    mergeCarets();
+    onSelectionChanged();
+    onCaretsChanged();
+    return true;
+}
+
+bool Editor::splitSelectionIntoLines() noexcept {
+    std::vector<Caret> carets;
+    carets.push_back({ m_CursorLocation, m_SelectPos });
+    carets.insert(carets.end(), m_Carets.begin(), m_Carets.end());
+
+    // Count first, so that nothing is split if there would be too many.
+    size_t caretCount = 0;
+    for (const auto& caret : carets) {
+        if (caret.selectPos == CursorLocation::npos())
+            caretCount++;
+        else
+            caretCount += std::max(caret.selectPos, caret.location).m_Row - std::min(caret.selectPos, caret.location).m_Row + 1;
+    }
+
+    if (caretCount == carets.size() || caretCount > maxCarets)
+        return false;
+
+    std::vector<Caret> split;
+    split.reserve(caretCount);
+
+    for (const auto& caret : carets) {
+        if (caret.selectPos == CursorLocation::npos()) {
+            split.push_back(caret);
+            continue;
+        }
+
+        auto begin = std::min(caret.selectPos, caret.location);
+        auto end = std::max(caret.selectPos, caret.location);
+
+        for (size_t row = begin.m_Row; row <= end.m_Row; row++) {
+            CursorLocation lineBegin = (row == begin.m_Row) ? begin : CursorLocation(row, 0);
+            CursorLocation lineEnd = (row == end.m_Row) ? end : CursorLocation(row, m_Document.getLineLength(row));
+
+            // A selection that ends at the start of a line doesn't select anything on it.
+            if (row == end.m_Row && row != begin.m_Row && end.m_Col == 0)
+                break;
+
+            split.push_back({ lineEnd, lineBegin });
+        }
+    }
+
+    // The last line of the main cursor's selection keeps being the main cursor.
+    std::sort(split.begin(), split.end(), [](const Caret& a, const Caret& b) { return a.location < b.location; });
+
+    auto main = std::find_if(split.begin(), split.end(), [this](const Caret& caret) {
+        return caret.location == m_CursorLocation || caret.location == m_SelectPos;
+    });
+    if (main == split.end())
+        main = std::prev(split.end());
+
+    m_SelectPos = main->selectPos;
+    moveTo(main->location);
+
+    split.erase(main);
+    m_Carets = std::move(split);
+
+    mergeCarets();
+    onSelectionChanged();
+    onCaretsChanged();
+    return true;
+}
+
+bool Editor::clearCarets() noexcept {
+    if (m_Carets.empty())
+        return false;
+
+    m_Carets.clear();
+    onCaretsChanged();
+    return true;
+}
+
+Editor::CaretRanges Editor::getCaretRanges() {
+    return getCaretRanges([]() { return false; });
+}
+
+Editor::CaretRanges Editor::toCaretRanges(std::vector<std::pair<CursorLocation, CursorLocation>> locations) const {
+    // The main cursor's range came first, it goes in between the others. Unless moving them changed
+    // their order, the ranges are then sorted, and converted to offsets without sorting them again.
+    auto main = std::upper_bound(locations.begin() + 1, locations.end(), locations.front());
+    std::rotate(locations.begin(), locations.begin() + 1, main);
+
+    std::vector<CursorLocation> ends;
+    ends.reserve(locations.size() * 2);
+    for (const auto& [begin, end] : locations) {
+        ends.push_back(begin);
+        ends.push_back(end);
+    }
+
+    std::vector<size_t> offsets = m_Document.toOffsets(ends);
+
+    CaretRanges ret = { {}, size_t(main - locations.begin()) - 1 };
+    ret.ranges.reserve(locations.size());
+    for (size_t i = 0; i < offsets.size(); i += 2)
+        ret.ranges.emplace_back(offsets[i], offsets[i + 1]);
+
+    return ret;
+}
+
+void Editor::replaceAtCarets(CaretRanges carets, std::string_view str) {
+    auto& ranges = carets.ranges;
+    size_t main = carets.main;
+
+    if (!std::is_sorted(ranges.begin(), ranges.end())) {
+        auto mainRange = ranges[main];
+        std::sort(ranges.begin(), ranges.end());
+        main = std::lower_bound(ranges.begin(), ranges.end(), mainRange) - ranges.begin();
+    }
+
+    // Join the ranges that overlap, e.g. two carets that deleted back to the start of the same word.
+    // Ranges that only touch are kept apart, so two adjacent carets both type a character.
+    size_t joined = 0;
+    size_t joinedMain = 0;
+
+    for (size_t i = 1; i < ranges.size(); i++) {
+        auto& last = ranges[joined];
+
+        if (ranges[i].first < last.second || ranges[i] == last)
+            last.second = std::max(last.second, ranges[i].second);
+        else
+            ranges[++joined] = ranges[i];
+
+        if (i == main)
+            joinedMain = joined;
+    }
+    ranges.resize(std::min(ranges.size(), joined + 1));
+    main = joinedMain;
+
+    // All of them are made by a single replace, which puts a piece pointing at the same text in place of
+    // every range. The pieces it takes out are recorded as they are, so none of them is looked up again.
+    std::vector<std::vector<PieceTable::Piece>> erased;
+    size_t lineCount = getLineCount();
+    PieceTable::Piece piece = m_Document.replace(ranges, str, &erased);
+
+    // Undone in one step. The erases are recorded from the last to the first, and the inserts from the
+    // first to the last, at their new offsets. Played back in that order, it's the same edit.
+    m_History.beginGroup();
+
+    for (size_t i = ranges.size(); i-- > 0;)
+        m_History.recordErase(ranges[i].first, std::move(erased[i]));
+
+    // Every edit moves the ones after it by the same amount, so the carets end up at these offsets, in order.
+    std::vector<size_t> offsets;
+    offsets.reserve(ranges.size());
+
+    size_t removed = 0; // By the edits before the current one.
+    for (size_t i = 0; i < ranges.size(); i++) {
+        size_t begin = ranges[i].first + i * str.size() - removed;
+        m_History.recordInsert(begin, { piece });
+
+        offsets.push_back(begin + str.size());
+        removed += ranges[i].second - ranges[i].first;
+    }
+
+    m_History.endGroup();
+
+    std::vector<CursorLocation> locations = m_Document.toLocations(offsets);
+
+    // Unless a line was split or joined, every edit stayed on the row of its caret,
+    // so the columns of the other rows are still good.
+    bool sameRows = (getLineCount() == lineCount && str.find('\n') == std::string_view::npos);
+    if (sameRows) {
+        for (const auto& location : locations)
+            m_Columns.onLinesChanged(location.m_Row, lineCount, str);
+    }
+    else {
+        m_Columns.clear();
+    }
+
+    // The locations are sorted, and valid, so the carets can be placed as they are.
+    m_Carets.clear();
+    m_Carets.reserve(locations.size() - 1);
+
+    for (size_t i = 0; i < locations.size(); i++) {
+        if (i != main)
+            m_Carets.push_back({ locations[i] });
+    }
+
+    m_SelectPos = CursorLocation::npos();
+    moveTo(locations[main]);
+
+    // Carets that erased up to each other end up in the same place.
+    mergeCarets();
+
+    // A single update of the view, no matter how many carets there are.
+    // Nothing above the first edit changed.
+    m_Syntax.invalidateFrom(m_Document.toLocation(ranges.front().first).m_Row);
+    onDocumentChanged();
+    onSelectionChanged();
+    onCaretsChanged();
+}
+
+void Editor::mergeCarets() {
+    const auto byLocation = [](const Caret& a, const Caret& b) { return a.location < b.location; };
+    if (!std::is_sorted(m_Carets.begin(), m_Carets.end(), byLocation))
+        std::sort(m_Carets.begin(), m_Carets.end(), byLocation);
+
+    CursorLocation main = m_CursorLocation;
+    auto last = std::unique(m_Carets.begin(), m_Carets.end(), [](const Caret& a, const Caret& b) { return a.location == b.location; });
+    last = std::remove_if(m_Carets.begin(), last, [main](const Caret& caret) { return caret.location == main; });
+
+    m_Carets.erase(last, m_Carets.end());
+}
+
+bool Editor::selectWord() noexcept {
+    clearCarets();
+    stopSelecting();
+
+    auto [row, col] = getCursorLocation();
+    auto [begin, end] = m_Words.findWord(row, col);
+
+    if (begin == end)
+        return false;
+
+    moveTo({ row, begin });
+    startSelecting();
+    moveTo({ row, end });
+    return true;
+}
+
+void Editor::selectAll() noexcept {
+    clearCarets();
+    stopSelecting();
+    moveTop();
+    startSelecting();
+    moveBottom();
+}
+
+bool Editor::moveTo(CursorLocation pos) noexcept {
+    onCursorMoved();
+
+    // Cursor is already at the provided pos. 
+    if (pos == getCursorLocation())
+        return false;
+
+    auto [row, col] = pos;
+
+    // Clamp in case of invalid pos.
+    if (row >= getLineCount()) {
+        row = getLineCount() - 1; col = m_Document.getLineLength(row);
+    }
+    if (col > m_Document.getLineLength(row)) {
+        col = m_Document.getLineLength(row);
+    }
+
+    m_CursorLocation = { row, col };
+    return true;
+}
+
+bool Editor::moveUp() noexcept {
+    return forEachCaret([this]() { return moveTo(above()); });
+}
+
+bool Editor::moveDown() noexcept {
+    return forEachCaret([this]() { return moveTo(below()); });
+}
+
+bool Editor::moveLeft() noexcept {
+    return forEachCaret([this]() { return moveTo(prev()); });
+}
+
+bool Editor::moveRight() noexcept {
+    return forEachCaret([this]() { return moveTo(next()); });
+}
+
+void Editor::moveTop() noexcept {
+    forEachCaret([this]() { return moveTo(minPos()); });
+}
+
+void Editor::moveBottom() noexcept {
+    forEachCaret([this]() { return moveTo(maxPos()); });
+}
+
+void Editor::moveStart() noexcept {
+    forEachCaret([this]() { return moveTo(startLinePos()); });
+}
+
+void Editor::moveEnd() noexcept {
+    forEachCaret([this]() { return moveTo(endLinePos()); });
+}
+
+bool Editor::skipLeft() noexcept {
+    return forEachCaret([this]() { return skipCaretLeft(); });
+}
+
+bool Editor::skipRight() noexcept {
+    return forEachCaret([this]() { return skipCaretRight(); });
+}
+
+bool Editor::skipCaretLeft() noexcept {
+    if (onFirstPos())
+        return false;
+
+    // If we're at the start of the line, just move to the left. 
+    if (onStartLine()) {
+        moveTo(prev()); return true;
+    }
+
+    // Skip to the start of the run of whitespace, word characters or punctuation left of the cursor.
+    auto [row, col] = getCursorLocation();
+    return moveTo({ row, m_Words.findLeft(row, col) });
+}
+
+bool Editor::skipCaretRight() noexcept {
+    // We cannot skip if we're at the end.
+    if (onLastPos())
+        return false;
+
+    // If we're at the end of the line, just move to the right. 
+    if (onEndLine()) {
+        moveTo(next()); return true;
+    }
+
+    // Skip to the end of the run right of the cursor.
+    auto [row, col] = getCursorLocation();
+    return moveTo({ row, m_Words.findRight(row, col) });
+}
+
+bool Editor::undo() noexcept {
+    clearCarets();
+    stopSelecting();
+
+    auto offset = m_History.undo(m_Document);
+    if (!offset.has_value())
+        return false;
+
+    // The journal doesn't say which rows it touched.
+    m_Syntax.invalidateFrom(0);
+    m_Columns.clear();
+    onDocumentChanged();
+
+    moveTo(m_Document.toLocation(offset.value()));
+    return true;
+}
+
+bool Editor::redo() noexcept {
+    clearCarets();
+    stopSelecting();
+
+    auto offset = m_History.redo(m_Document);
+    if (!offset.has_value())
+        return false;
+
+    // The journal doesn't say which rows it touched.
+    m_Syntax.invalidateFrom(0);
+    m_Columns.clear();
+    onDocumentChanged();
+
+    moveTo(m_Document.toLocation(offset.value()));
+    return true;
+}
+
+bool Editor::isValidPos(CursorLocation pos) const noexcept {
+    // Only the last line has to be looked at, every location above it is valid.
+    size_t lastRow = m_Document.getLineCount() - 1;
+    return pos.m_Row < lastRow || pos <= maxPos();
+}
+
+CursorLocation Editor::above() const noexcept {
+    if (onFirstLine())
+        return m_CursorLocation;
+
+    auto [row, col] = m_CursorLocation;
+
+    if (row - 1 >= m_Document.getLineCount())
+        return m_CursorLocation;
+
+    return { row - 1, m_Columns.toByte(row - 1, m_Columns.toColumn(row, col)) };
+}
+
+CursorLocation Editor::below() const noexcept {
+    if (onLastLine())
+        return m_CursorLocation;
+
+    auto [row, col] = m_CursorLocation;
+
+    if (row + 1 >= m_Document.getLineCount())
+        return m_CursorLocation;
+
+    return { row + 1, m_Columns.toByte(row + 1, m_Columns.toColumn(row, col)) };
+}
+
+CursorLocation Editor::prev(CursorLocation pos) const noexcept {
+    // Make sure the pos is valid.
+    if (!isValidPos(pos))
+        return minPos();
+
+    // We're on the first possible location.
+    if (onFirstPos())
+        return minPos();
+
+    auto [row, col] = pos;
+
+    // We're at the first char of the line.
+    // Return the location at the end of the previous line.
+    if (col == 0) {
+        if (row - 1 >= m_Document.getLineCount()) // Sanity check. Make sure the line exists.
+            return minPos();
+
+        return { row - 1, m_Document.getLineLength(row - 1) };
+    }
+
+    // Just return the location one char to the left.
+    return { row, m_Columns.prev(row, col) };
+}
+
+CursorLocation Editor::prev() const noexcept {
+    return prev(m_CursorLocation);
+}
+
+CursorLocation Editor::next(CursorLocation pos) const noexcept {
+    // Make sure the pos is valid.
+    if (!isValidPos(pos))
+        return maxPos();
+
+    // We're on the last possible location.
+    if (onLastPos())
+        return maxPos();
+
+    auto [row, col] = pos;
+
+    // Check if we're on the last char of the line.
+    if (row >= m_Document.getLineCount())
+        return maxPos();
+
+    // We're at the first char of the line.
+    // Return the location at the start of the next line.
+    if (col == m_Document.getLineLength(row)) {
+        if (row + 1 >= m_Document.getLineCount()) // Sanity check. Make sure the line exists.
+            return maxPos();
+
+        return { row + 1, 0 };
+    }
+
+    // Just return the location one char to the right.
+    return { row, m_Columns.next(row, col) };
+}
+
+CursorLocation Editor::next() const noexcept {
+    return next(m_CursorLocation);
+}
+
+CursorLocation Editor::minPos() const noexcept {
+    return { 0, 0 };
+}
+
+CursorLocation Editor::maxPos() const noexcept {
+    size_t lastRow = m_Document.getLineCount() - 1;
+
+    return { lastRow, m_Document.getLineLength(lastRow) };
+}
+
+CursorLocation Editor::startLinePos() const noexcept {
+    size_t row = m_CursorLocation.m_Row;
+    return { row, 0 };
+}
+
+CursorLocation Editor::endLinePos() const noexcept {
+    size_t row = m_CursorLocation.m_Row;
+    if (row >= m_Document.getLineCount())
+        return minPos();
+
+    return { row, m_Document.getLineLength(row) };
+}
+
+bool Editor::onFirstLine() const noexcept {
+    return m_CursorLocation.m_Row == 0;
+}
+
+bool Editor::onLastLine() const noexcept {
+    return m_CursorLocation.m_Row == maxPos().m_Row;
+}
+
+bool Editor::onStartLine() const noexcept {
+    return m_CursorLocation.m_Col == 0;
+}
+
+bool Editor::onEndLine() const noexcept {
+    return m_CursorLocation.m_Col == endLinePos().m_Col;
+}
+
+bool Editor::onFirstPos() const noexcept {
+    return onFirstLine() && onStartLine();
+}
+
+bool Editor::onLastPos() const noexcept {
+    return onLastLine() && onEndLine();
+}
+
+void Editor::search(std::string query) {
+    if (query.empty()) {
+        endSearch();
+        return;
+    }
+
+    if (query == getSearchQuery())
+        return;
+
+    // A new search starts where the selection or the cursor is,
+    // a refined one keeps going from where the previous one started.
+    if (getSearchQuery().empty()) {
+        auto selection = getSelectionRange();
+        m_SearchFrom = m_Document.toOffset(selection.has_value() ? selection->first : getCursorLocation());
+    }
+
+    m_Search.start(m_Document, std::move(query), m_SearchFrom);
+    m_SearchStatus = {};
+    m_Recounting = false;
+
+    onSearchChanged();
+}
+
+void Editor::endSearch() noexcept {
+    if (getSearchQuery().empty())
+        return;
+
+    m_Search.cancel();
+    m_SearchStatus = {};
+    m_Recounting = false;
+
+    onSearchChanged();
+}
+
+const std::string& Editor::getSearchQuery() const noexcept {
+    return m_Search.getQuery();
+}
+
+DocumentSearch::Status Editor::getSearchStatus() const {
+    return m_SearchStatus;
+}
+
+bool Editor::isSearchPending() const {
+    return !getSearchQuery().empty() && (m_Recounting || !m_SearchStatus.counted);
+}
+
+void Editor::waitForSearch() {
+    // Picking up the count starts counting again if the document changed since, so it can take a few rounds.
+    updateSearch();
+    while (isSearchPending()) {
+        m_Search.wait();
+        updateSearch();
+    }
+}
+
+bool Editor::findNext() noexcept {
+    const std::string& query = getSearchQuery();
+    if (query.empty())
+        return false;
+
+    // Skip the selected match itself, but not one that starts right at the cursor.
+    auto selection = getSelectionRange();
+    size_t from = selection.has_value() ? m_Document.toOffset(selection->first) + 1 : m_Document.toOffset(getCursorLocation());
+
+    auto found = DocumentSearch::findNext(m_Document, query, from);
+    if (!found.has_value())
+        found = DocumentSearch::findNext(m_Document, query, 0);
+
+    if (!found.has_value())
+        return false;
+
+    // Don't let the background search jump back to the first match afterwards.
+    m_SearchStatus.searched = true;
+
+    selectMatch(found.value());
+    return true;
+}
+
+bool Editor::findPrevious() noexcept {
+    const std::string& query = getSearchQuery();
+    if (query.empty())
+        return false;
+
+    auto selection = getSelectionRange();
+    size_t before = m_Document.toOffset(selection.has_value() ? selection->first : getCursorLocation());
+
+    auto found = DocumentSearch::findPrevious(m_Document, query, before);
+    if (!found.has_value())
+        found = DocumentSearch::findPrevious(m_Document, query, m_Document.getSize());
+
+    if (!found.has_value())
+        return false;
+
+    // Don't let the background search jump back to the first match afterwards.
+    m_SearchStatus.searched = true;
+
+    selectMatch(found.value());
+    return true;
+}
+
+bool Editor::updateSearch() {
+    if (getSearchQuery().empty())
+        return false;
+
+    DocumentSearch::Status status = m_Search.getStatus();
+
+    // While counting again, keep the previous count until the new one is done.
+    if (m_Recounting && !status.counted)
+        return false;
+
+    m_Recounting = false;
+    bool changed = (status != m_SearchStatus);
+
+    // Jump to the first match once, as soon as it's known.
+    if (status.searched && !m_SearchStatus.searched && status.firstMatch.has_value())
+        selectMatch(status.firstMatch.value());
+
+    m_SearchStatus = status;
+
+    // Counting starts over only once the previous count is done,
+    // so that typing doesn't keep restarting it from scratch.
+    if (status.counted && m_Search.getVersion() != m_Document.getVersion()) {
+        m_Search.recount(m_Document);
+        m_Recounting = true;
+    }
+
+    if (changed)
+        onSearchChanged();
+
+    return changed;
+}
+
+std::vector<std::pair<CursorLocation, CursorLocation>> Editor::findMatches(size_t firstRow, size_t lastRow, size_t limit) const {
+    std::vector<std::pair<CursorLocation, CursorLocation>> ret;
+    const std::string& query = getSearchQuery();
+
+    if (query.empty() || firstRow >= lastRow)
+        return ret;
+
+    size_t begin = m_Document.toOffset({ firstRow, 0 });
+    size_t end = m_Document.toOffset({ lastRow - 1, CursorLocation::invalidIndex });
+
+    std::vector<size_t> offsets;
+    DocumentSearch::findAll(m_Document, query, begin, end, limit, offsets);
+
+    ret.reserve(offsets.size());
+    for (size_t offset : offsets)
+        ret.emplace_back(m_Document.toLocation(offset), m_Document.toLocation(offset + query.size()));
+
+    return ret;
+}
+
+std::optional<size_t> Editor::replaceAll(const std::string& pattern, const std::string& format) noexcept {
+    std::vector<PieceTable::Replacement> replacements;
+
+    try {
+        replacements = RegexSearch(pattern).findAll(m_Document, &format);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "[EDITOR]: " << e.what() << std::endl;
+        return std::nullopt;
+    }
+
+    clearCarets();
+    stopSelecting();
+
+    if (replacements.empty())
+        return 0;
+
+    // Keep the cursor next to the same text, by moving it along with every replacement before it.
+    size_t cursor = m_Document.toOffset(getCursorLocation());
+    size_t newCursor = cursor;
+    for (const auto& replacement : replacements) {
+        if (replacement.begin >= cursor)
+            break;
+
+        newCursor = (replacement.end <= cursor) ? newCursor - (replacement.end - replacement.begin) + replacement.text.size() :
+                                                  newCursor - (cursor - replacement.begin);
+    }
+
+    // Only the span between the first and the last replacement changes.
+    size_t spanBegin = replacements.front().begin;
+    size_t spanEnd = replacements.back().end;
+    size_t newSpanEnd = spanEnd;
+    for (const auto& replacement : replacements)
+        newSpanEnd = newSpanEnd - (replacement.end - replacement.begin) + replacement.text.size();
+
+    // The span is recorded as one erase and one insert, so that it's undone in one step,
+    // by pieces, without a copy of either the old or the new text.
+    m_History.beginGroup();
+    m_History.recordErase(m_Document, spanBegin, spanEnd);
+
+    m_Document.replace(replacements);
+
+    m_History.recordInsert(m_Document, spanBegin, newSpanEnd - spanBegin);
+    m_History.endGroup();
+
+    // A single update of the view, no matter how many replacements there were.
+    m_Syntax.invalidateFrom(m_Document.toLocation(spanBegin).m_Row);
+    m_Columns.clear();
+    onDocumentChanged();
+    moveTo(m_Document.toLocation(newCursor));
+
+    return replacements.size();
+}
+
+void Editor::selectMatch(size_t offset) noexcept {
+    clearCarets();
+    stopSelecting();
+    moveTo(m_Document.toLocation(offset));
+    startSelecting();
+    moveTo(m_Document.toLocation(offset + getSearchQuery().size()));
+}
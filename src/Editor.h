@@ -0,0 +1,837 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "ColumnMap.h"
+#include "CursorLocation.hpp"
+#include "DocumentSearch.h"
+#include "PieceTable.h"
+#include "RecoveryJournal.h"
+#include "SyntaxHighlighter.h"
+#include "UndoJournal.h"
+#include "WordBoundaries.h"
+
+/**
+ *  @brief  Class that implements various ways of manipulating
+ *          and moving through a buffer, without drawing any of it.
+ *
+ *          Owns the document, its history, the cursor and the selection.
+ *          Everything that shows them, like TextBox, derives from it
+ *          and is told what changed through the on...() hooks.
+ *
+ *  @note   Doesn't depend on SFML, so it can run without a display.
+ */
+class Editor {
+public:
+    /**
+     * @brief   A cursor besides the main one, with a selection of its own.
+     */
+    struct Caret {
+        CursorLocation location;
+        CursorLocation selectPos = CursorLocation::npos(); // Where its selection started, or CursorLocation::npos().
+    };
+
+    Editor();
+    virtual ~Editor() = default;
+
+    /**
+     * @brief       Replaces the contents of the editor with a file.
+     *
+     * @note        The file is memory mapped and its lines are indexed in the
+     *              background. Until that is done, only the lines found so far
+     *              are shown. Edits never modify the file itself.
+     * @note        Unless crash recovery is turned off, every edit is journaled in the background,
+     *              and the edits a crash cut off are replayed when the file is opened again.
+     *
+     * @param path  The path of the file.
+     *
+     * @returns     True if the file was opened, false otherwise.
+     */
+    bool open(const std::filesystem::path& path) noexcept;
+
+    /**
+     * @returns The location of the cursor.
+     */
+    CursorLocation getCursorLocation() const noexcept;
+
+    /**
+     * @brief   Picks up the lines the background indexer found since the last call.
+     *
+     * @returns True if any lines were added.
+     */
+    bool updateIndex();
+
+    /**
+     * @brief   Blocks until the background indexer is done, then picks up all of its lines.
+     */
+    void waitForIndex();
+
+    /**
+     * @brief   Writes the document to an autosave in the background, if it's due. Never blocks.
+     */
+    void updateAutosave();
+
+    /**
+     * @brief   Checks if an autosave is still to be written, which updateAutosave() does once it's due.
+     */
+    bool hasPendingAutosave() const noexcept;
+
+    /**
+     * @brief   Checks if every line of the opened file is part of the document.
+     */
+    bool isFullyIndexed() const noexcept;
+
+    /**
+     * @brief   Checks if the opened file is valid UTF-8, as far as it has been indexed.
+     *
+     * @note    Bytes that aren't part of a valid character are still shown and edited, one column each.
+     */
+    bool isValidUtf8() const noexcept;
+
+    /**
+     * @brief   Forgets every edit, so that none of them can be undone or redone.
+     */
+    void clearHistory() noexcept;
+
+    /**
+     * @brief       Get the document of the editor.
+     *
+     * @returns     A const-reference to the line-access interface of m_Document.
+     */
+    const Document& getDocument() const noexcept;
+
+    /**
+     * @brief       Get the syntax highlighter of the document.
+     *
+     * @note        The language is picked by the extension of the opened file,
+     *              and the highlighter is kept up to date with every edit.
+     */
+    SyntaxHighlighter& getSyntax() noexcept;
+
+    /**
+     * @brief       Get the map between the bytes and the characters of every line,
+     *              which the cursor moves through.
+     */
+    const ColumnMap& getColumns() const noexcept;
+
+    /**
+     * @brief       Get a line at a specific row.
+     * 
+     * @param row   The row. 
+     * 
+     * @returns     A view of the line, or 'std::nullopt'
+     *              if the provided row is out of range. 
+     *
+     * @note        See Document::line() for how long the view stays valid.
+     */
+    std::optional<std::string_view> line(size_t row) const noexcept;
+
+    /**
+     * @brief   Get the amount of lines.
+     */
+    size_t getLineCount() const noexcept;
+
+    /**
+     * @brief   Get a character at a specific position, even if selecting.
+     *
+     * @param   pos The position of the character. 
+     * 
+     * @returns The character at the provided position cursor 
+                or 'std::nullopt' if the position is invalid. 
+     */
+    std::optional<char> getCharAt(const CursorLocation& pos) const noexcept;
+
+    /**
+     * @brief   Get the character to the right of the cursor, even if selecting.
+     *
+     * @returns The character to the right of the cursor or 'std::nullopt'
+     *          if there is nothing to the right.
+     */
+    std::optional<char> getRightChar() const noexcept;
+
+    /**
+     * @brief   Get the character to the left of the cursor, even if selecting.
+     *
+     * @returns The character to the left of the cursor or 'std::nullopt'
+     *          if there is nothing to the left.
+     */
+    std::optional<char>getLeftChar() const noexcept;
+
+    /**
+     * @brief   Adds a character to the right of the cursor.
+     *
+     * @note    If selecting, the selected text is deleted.
+     * @note    Control characters besides '\n' are rejected. Bytes of UTF-8
+     *          are accepted, add(const std::string&) adds a whole character at once.
+     *
+     * @param   c The character to add.
+     */
+    void add(char c) noexcept;
+
+    /**
+     * @brief   Adds a string to the right of the cursor.
+     *
+     * @note    If selecting, the selected text is deleted.
+     * @note    The whole string is spliced into the document at once,
+     *          and the cursor is moved only once, to the end of it.
+     *          Characters that add(char) would reject are skipped.
+     *
+     * @param   str The string to add.
+     */
+    void add(const std::string& str) noexcept;
+
+    /**
+     * @brief   Adds a tab where the cursor is, by inserting spaces.
+     *
+     * @note    The number of spaces depends on the defined tab width.
+     * @note    Clears selection.
+     */
+    void addTab() noexcept;
+
+    /**
+     * @brief   Removes a character to the left of the cursor.
+     *
+     * @note    If selecting, deletes the selected text.
+     *
+     * @returns True if the removal was successful, false otherwise.
+     */
+    bool remove() noexcept;
+
+    /**
+     * @brief   If the character left of the cursor is alphanumeric,
+     *          removes a sequence of alphanumeric characters, until a non-alphanumeric character is hit.
+     *          Vice-versa for when a non-alphanumeric character is left of the cursor.
+     *
+     * @returns True if the SkipRemove was successful, false otherwise.
+     */
+    bool skipRemove() noexcept;
+
+    /**
+     * @brief   Removes all characters in a range.
+     *
+     * @note    Sets the position of the cursor to begin after removing.
+     * @note    It is required that minPos <= begin < end <= maxPos.
+     *
+     * @param   begin The begin position.
+     * @param   end   The end position.
+     *
+     * @returns True if successful, false if minPos <= begin < end <= maxPos isn't upheld.
+     */
+    bool removeRange(CursorLocation begin, CursorLocation end) noexcept;
+
+    /**
+     * @brief   Removes a tab, by removing leading spaces.
+     *
+     * @note    The number of spaces removed depends on the defined tab width.
+     *
+     * @returns True if at least one space was removed, false otherwise.
+     */
+    bool removeTab() noexcept;
+
+    /**
+     * @brief   Check if text is currently being selected.
+     *
+     * @returns True if selecting, false otherwise.
+     */
+    bool isSelecting() const noexcept;
+
+    /**
+     * @brief   Starts selecting from the current position of the cursor.
+     */
+    void startSelecting() noexcept;
+
+    /**
+     * @brief   Stops selecting entirely.
+     */
+    void stopSelecting() noexcept;
+
+    /**
+     * @brief   Selects the entire contents of the editor.
+     *
+     * @note    Functions identically, even if text is already selected..
+     */
+    void selectAll() noexcept;
+
+    /**
+     * @brief   Selects the word under the cursor, or the run of whitespace
+     *          or punctuation if there is no word on either side of it.
+     *
+     * @note    Drops the other carets.
+     *
+     * @returns True if anything was selected, false on an empty line.
+     */
+    bool selectWord() noexcept;
+
+    /**
+     * @brief   Get the currently selected text.
+     *
+     * @returns The currently selected text, or 'std::nullopt'
+     *          if nothing is selected.
+     */
+    std::optional<std::string> getSelection() const noexcept;
+
+    /**
+     * @brief   Get the bounds of the selected text, in order.
+     *
+     * @returns The begin and end of the selection, or 'std::nullopt'
+     *          if nothing is selected.
+     */
+    std::optional<std::pair<CursorLocation, CursorLocation>> getSelectionRange() const noexcept;
+
+    /**
+     * @brief   Get the bounds of the selection of every caret, the main cursor included.
+     *
+     * @returns The begin and end of every selection, sorted.
+     */
+    std::vector<std::pair<CursorLocation, CursorLocation>> getSelectionRanges() const;
+
+    /**
+     * @brief   Get the amount of carets, the main cursor included.
+     */
+    size_t getCaretCount() const noexcept;
+
+    /**
+     * @brief   Get the carets besides the main cursor, sorted by location.
+     *
+     * @note    Moving, selecting and editing apply to every caret at once.
+     *          Edits at all of them are a single edit, and a single undo step.
+     */
+    const std::vector<Caret>& getExtraCarets() const noexcept;
+
+    /**
+     * @brief   Adds a caret on the line above the topmost one, in the column of the main cursor.
+     *
+     * @returns True if a caret was added, false if the topmost one is on the first line.
+     */
+    bool addCaretAbove() noexcept;
+
+    /**
+     * @brief   Adds a caret on the line below the bottommost one, in the column of the main cursor.
+     *
+     * @returns True if a caret was added, false if the bottommost one is on the last line.
+     */
+    bool addCaretBelow() noexcept;
+
+    /**
+     * @brief   Selects the word under the main cursor if nothing is selected. Otherwise,
+     *          selects the next occurrence of the selected text with a new main cursor,
+     *          and keeps the previous one as an extra caret.
+     *
+     * @note    Wraps around to the start of the document.
+     *
+     * @returns True if anything was selected, false if every occurrence already is.
+     */
+    bool addNextOccurrence() noexcept;
+
+    /**
+     * @brief   Splits every selection over multiple lines into a selection per line,
+     *          each with a caret at its end.
+     *
+     * @note    Does nothing if that would take more than maxCarets carets.
+     *
+     * @returns True if any selection was split.
+     */
+    bool splitSelectionIntoLines() noexcept;
+
+    /**
+     * @brief   Removes every caret besides the main cursor.
+     *
+     * @returns True if there were any.
+     */
+    bool clearCarets() noexcept;
+
+    /**
+     * @brief   Moves the cursor to a position.
+     * 
+     * @note    If the position is invalid, m_Row and m_Col
+     *          will be clamped to the last position.
+     *
+     * @param   row The row to move to.
+     * @param   col The column to move to.
+     *
+     * @returns True if the move was successful, false if the position was invalid.
+     */
+    bool moveTo(CursorLocation pos) noexcept;
+
+    /**
+     * @brief   Tries to move the cursor up.
+     *
+     * @returns True if the cursor was moved up, false if it cannot be moved up.
+     */
+    bool moveUp() noexcept;
+
+    /**
+     * @brief   Tries to move the cursor down.
+     *
+     * @returns True if the cursor was moved down, false if it cannot be moved down.
+     */
+    bool moveDown() noexcept;
+
+    /**
+     * @brief   Tries to move the cursor left.
+     *
+     * @returns True if the cursor was moved left, false if it cannot be moved left.
+     */
+    bool moveLeft() noexcept;
+
+    /**
+     * @brief   Tries to move the cursor right.
+     *
+     * @returns True if the cursor was moved right, false if it cannot be moved right.
+     */
+    bool moveRight() noexcept;
+
+    /**
+     * @brief   Skips to the next-left character of a different class.
+     *
+     * @returns True if the skip was successful, false otherwise.
+     */
+    bool skipLeft() noexcept;
+
+    /**
+     * @brief   Skips to the next-right character of a different class.
+     *
+     * @returns True if the skip was successful, false otherwise.
+     */
+    bool skipRight() noexcept;
+
+    /**
+     * @brief   Moves the cursor to the very start of the text.
+     */
+    void moveTop() noexcept;
+
+    /**
+     * @brief   Moves the cursor to the very end of the text.
+     */
+    void moveBottom() noexcept;
+
+    /**
+     * @brief   Moves the cursor to the start of the line.
+     */
+    void moveStart() noexcept;
+
+    /**
+     * @brief   Moves the cursor to the end of the line.
+     */
+    void moveEnd() noexcept;
+
+    /**
+     * @brief   Reverts the most recent edit.
+     *
+     * @note    Consecutive typing, consecutive backspaces and a single paste
+     *          are each reverted as one edit. Removes selection.
+     *
+     * @returns True if anything was undone, false if there is no history.
+     */
+    bool undo() noexcept;
+
+    /**
+     * @brief   Re-applies the most recently undone edit.
+     *
+     * @note    Any new edit clears what can be redone. Removes selection.
+     *
+     * @returns True if anything was redone, false otherwise.
+     */
+    bool redo() noexcept;
+
+    /**
+     * @brief       Starts looking for @p query, or stops looking if it's empty.
+     *
+     * @note        The first match is looked for in the background, from where the
+     *              cursor was when the search started, and selected once it's found.
+     *              So refining the query while typing keeps searching from the same place.
+     *              Changing the query cancels the search for the previous one.
+     *
+     * @param query The text to look for.
+     */
+    void search(std::string query);
+
+    /**
+     * @brief   Stops looking for the current query. Keeps the selected match selected.
+     */
+    void endSearch() noexcept;
+
+    /**
+     * @brief   Get the query that is being looked for, empty if not searching.
+     */
+    const std::string& getSearchQuery() const noexcept;
+
+    /**
+     * @brief   Get how far the background search for the query got, including the amount of matches.
+     */
+    DocumentSearch::Status getSearchStatus() const;
+
+    /**
+     * @brief   Checks if the background search is still counting matches.
+     */
+    bool isSearchPending() const;
+
+    /**
+     * @brief   Blocks until the background search is done counting matches, then picks up what it found.
+     */
+    void waitForSearch();
+
+    /**
+     * @brief   Selects the first match after the selected one, or after the cursor.
+     *
+     * @note    Wraps around to the start of the document.
+     *
+     * @returns True if a match was selected.
+     */
+    bool findNext() noexcept;
+
+    /**
+     * @brief   Selects the last match before the selected one, or before the cursor.
+     *
+     * @note    Wraps around to the end of the document.
+     *
+     * @returns True if a match was selected.
+     */
+    bool findPrevious() noexcept;
+
+    /**
+     * @brief       Picks up what the background search found since the last call.
+     *              Selects the first match once it's found, and counts again after the document changed.
+     *
+     * @returns     True if anything about the search changed.
+     */
+    bool updateSearch();
+
+    /**
+     * @brief       Get the matches of the query that lie in the rows [firstRow, lastRow).
+     *
+     * @param limit Stops after this many matches.
+     *
+     * @returns     The begin and end of every match, in order.
+     */
+    std::vector<std::pair<CursorLocation, CursorLocation>> findMatches(size_t firstRow, size_t lastRow, size_t limit) const;
+
+    /**
+     * @brief           Replaces every match of a regular expression at once.
+     *
+     * @note            The document is searched on all cores, and every replacement is
+     *                  applied as a single edit, which is undone in one step.
+     * @note            Removes selection. The cursor stays next to the text it was next to.
+     *
+     * @param pattern   The regular expression, see RegexSearch.
+     * @param format    The replacement, where "$&" is the match and "$1" to "$99" are its groups.
+     *
+     * @returns         The amount of replacements made, or 'std::nullopt' if the pattern is invalid.
+     */
+    std::optional<size_t> replaceAll(const std::string& pattern, const std::string& format) noexcept;
+
+protected:
+    /**
+     * @brief                   Called after an edit that started on @p firstRow.
+     *
+     * @note                    If the edit added or removed lines, every row below it moved as well.
+     *
+     * @param lineCountBefore   The amount of lines before the edit.
+     */
+    virtual void onLinesChanged(size_t /*firstRow*/, size_t /*lineCountBefore*/) {}
+
+    /**
+     * @brief   Called after the document changed in a way that
+     *          isn't known row by row, e.g. by undo() and redo().
+     */
+    virtual void onDocumentChanged() {}
+
+    /**
+     * @brief   Called after open() replaced the document.
+     */
+    virtual void onOpened() {}
+
+    /**
+     * @brief   Called whenever the cursor is moved, or was asked to move.
+     */
+    virtual void onCursorMoved() {}
+
+    /**
+     * @brief   Called whenever selecting starts or stops.
+     */
+    virtual void onSelectionChanged() {}
+
+    /**
+     * @brief   Called whenever the query changes, or the background search found something.
+     */
+    virtual void onSearchChanged() {}
+
+    /**
+     * @brief   Called after carets besides the main cursor were added, removed or moved.
+     */
+    virtual void onCaretsChanged() {}
+
+private:
+    // The most carets splitSelectionIntoLines() creates.
+    static constexpr size_t maxCarets = 1000000;
+
+    /**
+     * @brief   Selects the match at @p offset, leaving the cursor at its end.
+     */
+    void selectMatch(size_t offset) noexcept;
+
+    /**
+     * @brief       Runs @p op once for the main cursor, then once for every other caret,
+     *              as if it were the main cursor. Merges carets that ended up in the same place.
+     *
+     * @param op    Moves the main cursor, returns true if it moved.
+     *
+     * @returns     True if any caret moved.
+     */
+    template <typename Op>
+    bool forEachCaret(Op&& op) {
+        bool moved = op();
+        if (m_Carets.empty())
+            return moved;
+
+        // Every caret takes the place of the main cursor in turn, so that op can use everything that moves it.
+        CursorLocation location = m_CursorLocation, selectPos = m_SelectPos;
+
+        for (auto& caret : m_Carets) {
+            m_CursorLocation = caret.location; m_SelectPos = caret.selectPos;
+            moved = op() || moved;
+            caret.location = m_CursorLocation; caret.selectPos = m_SelectPos;
+        }
+
+        m_CursorLocation = location; m_SelectPos = selectPos;
+
+        mergeCarets();
+        onCaretsChanged();
+        return moved;
+    }
+
+    /**
+     * @brief   The byte range every caret edits, see getCaretRanges().
+     */
+    struct CaretRanges {
+        std::vector<std::pair<size_t, size_t>> ranges; // In the order of the carets, sorted unless moving them changed it.
+        size_t main; // The index of the main cursor's range.
+    };
+
+    /**
+     * @brief       Gets the range every caret edits: its selection, or else
+     *              what lies between it and where @p move takes it.
+     *
+     * @note        Moves the carets, they have to be placed again after the edit.
+     * @note        The ends of all of them are converted to offsets at once, see PieceTable::toOffsets().
+     *
+     * @param move  Moves the main cursor.
+     */
+    template <typename Move>
+    CaretRanges getCaretRanges(Move&& move) {
+        std::vector<std::pair<CursorLocation, CursorLocation>> locations;
+        locations.reserve(getCaretCount());
+
+        forEachCaret([&]() {
+            if (auto selection = getSelectionRange()) {
+                locations.push_back(selection.value());
+                return false;
+            }
+
+            CursorLocation from = getCursorLocation();
+            move();
+
+            locations.emplace_back(std::min(from, getCursorLocation()), std::max(from, getCursorLocation()));
+            return false;
+        });
+
+        return toCaretRanges(std::move(locations));
+    }
+
+    /**
+     * @brief   Gets the range every caret edits: its selection, or else an empty range at the caret.
+     */
+    CaretRanges getCaretRanges();
+
+    /**
+     * @brief               Converts the ranges getCaretRanges() collected to offsets.
+     *
+     * @param locations     The range of every caret, starting with the main cursor's.
+     */
+    CaretRanges toCaretRanges(std::vector<std::pair<CursorLocation, CursorLocation>> locations) const;
+
+    /**
+     * @brief           Replaces the range of every caret with @p str, as a single edit.
+     *
+     * @note            The edits are made by a single PieceTable::replace(), and are undone
+     *                  in one step, like replaceAll(). The carets are moved to the end of their
+     *                  replacements afterwards, in one pass. Overlapping ranges are joined,
+     *                  and their carets with them.
+     *
+     * @param carets    The range of every caret, see getCaretRanges().
+     */
+    void replaceAtCarets(CaretRanges carets, std::string_view str);
+
+    /**
+     * @brief   Sorts the extra carets, and removes the ones in the same place as another caret.
+     */
+    void mergeCarets();
+
+    /**
+     * @brief   Warns once the opened file turns out not to be valid UTF-8.
+     *
+     * @note    The file is validated along with indexing it, so it can happen after opening it.
+     */
+    void checkEncoding();
+
+    /**
+     * @brief   Skips the main cursor to the next-left character of a different class.
+     */
+    bool skipCaretLeft() noexcept;
+
+    /**
+     * @brief   Skips the main cursor to the next-right character of a different class.
+     */
+    bool skipCaretRight() noexcept;
+
+    /**
+     * @brief   Clears the selected text.
+     * 
+     * @returns True if anything was cleared at all.
+     */
+    bool clearSelection() noexcept;
+
+    /**
+     * @brief   Inserts a string where the cursor is and records it in the history.
+     *
+     * @note    Doesn't move the cursor.
+     *
+     * @returns The location right after the inserted string.
+     */
+    CursorLocation insertAtCursor(std::string_view str);
+
+    /**
+     * @brief   Location one character to the left of the cursor.
+     *
+     * @note    If the cursor is already at the start of the end,
+     *          the same location is returned.
+     */
+    CursorLocation prev() const noexcept;
+
+    /**
+     * @brief   Location one character to the left of @p pos.
+     *
+     * @note    A character can take up several bytes, see ColumnMap.
+     * @note    When @p pos is at the start of the line, the result is the location
+                of the last character of the previous line.
+     * @note    If @p pos is already at the start of the buffer,
+     *          the same location is returned.
+     */
+    CursorLocation prev(CursorLocation pos) const noexcept;
+
+    /**
+     * @brief   Location one character to the right of the cursor.
+     *
+     * @note    If the cursor is already at the end of the buffer,
+     *          the same location is returned.
+     */
+    CursorLocation next() const noexcept;
+
+    /**
+    * @brief    Location one character to the right of @p pos.
+    *
+    * @note     A character can take up several bytes, see ColumnMap.
+    * @note     When @p pos is at the end of the line, the result is the location
+    *           of the first character of the next line.
+    * @note     If @p pos is already at the end of the buffer,
+    *           the same location is returned.
+    */
+    CursorLocation next(CursorLocation pos) const noexcept;
+
+    /**
+     * @brief   Gets the location directly above the current one.
+     *
+     * @note    Keeps the column in characters, rather than in bytes.
+     * @note    Returns the current location if already on the first line.
+     */
+    CursorLocation above() const noexcept;
+
+    /**
+     * @brief   Gets the location directly below the current one.
+     *
+     * @note    Keeps the column in characters, rather than in bytes.
+     * @note    Returns the current location if already on the last line.
+     */
+    CursorLocation below() const noexcept;
+
+    /**
+     * @brief   Gets the first location of the cursor.
+     *          By convention, this is { 0, 0 }.
+     */
+    CursorLocation minPos() const noexcept;
+
+    /**
+     * @brief   Gets the last valid location in the buffer.
+     */
+    CursorLocation maxPos() const noexcept;
+
+    /**
+     * @brief   Gets the first position of the current line.
+     */
+    CursorLocation startLinePos() const noexcept;
+
+    /**
+     * @brief   Gets the position one past the last character of the current line.
+     */
+    CursorLocation endLinePos() const noexcept;
+
+    /**
+     * @brief   Checks if the cursor is on the first line.
+     */
+    bool onFirstLine() const noexcept;
+
+    /**
+     * @brief   Checks if the cursor is on the last line.
+     */
+    bool onLastLine() const noexcept;
+
+    /**
+     * @brief   Checks if the cursor is at the start of the current line.
+     */
+    bool onStartLine() const noexcept;
+
+    /**
+     * @brief   Checks if the cursor is at the end of the current line.
+     */
+    bool onEndLine() const noexcept;
+
+    /**
+     * @brief   Checks if the cursor is at the very first buffer position.
+     */
+    bool onFirstPos() const noexcept;
+
+    /**
+     * @brief   Checks if the cursor is at the very last buffer position.
+     */
+    bool onLastPos() const noexcept;
+
+    /**
+     * @brief   Tests whether @p pos lies within the buffer bounds.
+     */
+    bool isValidPos(CursorLocation pos) const noexcept;
+
+    PieceTable m_Document; // Contents of the editor.
+    UndoJournal m_History; // Undo and redo history of m_Document.
+    SyntaxHighlighter m_Syntax; // Reads m_Document, so it's declared after it.
+    WordBoundaries m_Words; // Likewise.
+    ColumnMap m_Columns; // Likewise.
+    bool m_ValidUtf8; // Whether the opened file was valid UTF-8 when checkEncoding() last looked.
+    RecoveryJournal m_Recovery; // Listens to m_Document, so it's declared after it and stops journaling first.
+
+    // Declared after m_Document, so its worker stops before the document goes away.
+    DocumentSearch m_Search;
+    DocumentSearch::Status m_SearchStatus; // What updateSearch() saw last.
+    size_t m_SearchFrom; // Where the current search started looking from.
+    bool m_Recounting; // Whether the matches are being counted again, after the document changed.
+
+    CursorLocation m_CursorLocation; // The position of the cursor, in terms of rows and columns.
+    CursorLocation m_SelectPos; // The position of the cursor when selection was started. No selection is indicated by CursorLocation::NPos().
+    std::vector<Caret> m_Carets; // The carets besides the main cursor, sorted by location.
+};
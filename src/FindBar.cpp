@@ -0,0 +1,146 @@
+#include <string>
+#include <utility>
+
+#include "FontManager.hpp"
+#include "GlyphCache.h"
+#include "FindBar.h"
+#include "Utf8.h"
+
+FindBar::FindBar() noexcept :
+                m_Open(false), m_Replacing(false), m_EditingReplacement(false),
+                m_Query(), m_Replacement(), m_Status(), m_Message(), m_Batch() {}
+
+void FindBar::draw(sf::RenderTarget& target, sf::RenderStates states) const {
+    if (m_Open)
+        target.draw(m_Batch, states);
+}
+
+void FindBar::update(double deltaTime) {}
+
+void FindBar::open(std::string query, bool replacing) {
+    m_Open = true;
+    m_Replacing = replacing;
+    m_EditingReplacement = false;
+    m_Query = std::move(query);
+    m_Status = {};
+    m_Message.clear();
+
+    updateBatch();
+}
+
+void FindBar::close() noexcept {
+    m_Open = false;
+    m_Replacing = m_EditingReplacement = false;
+    m_Query.clear(); m_Replacement.clear();
+    m_Status = {};
+    m_Message.clear();
+
+    m_Batch.clear();
+}
+
+bool FindBar::isOpen() const noexcept {
+    return m_Open;
+}
+
+bool FindBar::isReplacing() const noexcept {
+    return m_Replacing;
+}
+
+const std::string& FindBar::getQuery() const noexcept {
+    return m_Query;
+}
+
+const std::string& FindBar::getReplacement() const noexcept {
+    return m_Replacement;
+}
+
+void FindBar::switchField() {
+    if (!m_Replacing)
+        return;
+
+    m_EditingReplacement = !m_EditingReplacement;
+    updateBatch();
+}
+
+bool FindBar::append(uint32_t c) {
+    if (c < ' ' || (c >= 0x7F && c < 0xA0))
+        return false;
+
+    if (!Utf8::encode(c, getField()))
+        return false;
+
+    m_Message.clear();
+    updateBatch();
+    return true;
+}
+
+bool FindBar::erase() {
+    if (getField().empty())
+        return false;
+
+    std::string& field = getField();
+    field.erase(Utf8::prevCluster(field, field.size()));
+    m_Message.clear();
+    updateBatch();
+    return true;
+}
+
+bool FindBar::setStatus(const DocumentSearch::Status& status) {
+    if (status == m_Status)
+        return false;
+
+    m_Status = status;
+    updateBatch();
+    return true;
+}
+
+void FindBar::setMessage(std::string message) {
+    m_Message = std::move(message);
+    updateBatch();
+}
+
+std::string& FindBar::getField() noexcept {
+    return m_EditingReplacement ? m_Replacement : m_Query;
+}
+
+void FindBar::updateBatch() {
+    m_Batch.clear();
+
+    if (!m_Open)
+        return;
+
+    const GlyphCache& glyphs = GlyphCache::get(FontManager::getFont(), m_Theme.fontSize);
+    float rowHeight = m_Theme.fontSize + m_Theme.pad * 2;
+    float height = m_Replacing ? rowHeight * 2 : rowHeight;
+
+    m_Batch.addRect(m_Position, { m_Size.x, height }, m_Theme.backgroundColor);
+    m_Batch.addOutline(m_Position, { m_Size.x, height }, m_Theme.outlineThickness, m_Theme.outlineColor);
+
+    sf::Vector2f textPos = m_Position + sf::Vector2f(m_Theme.pad, m_Theme.pad);
+    float queryWidth = m_Batch.addText(m_Query, textPos, glyphs,
+                                       m_EditingReplacement ? m_Theme.statusColor : m_Theme.textColor);
+
+    if (m_Replacing) {
+        m_Batch.addText(m_Replacement, textPos + sf::Vector2f(0, rowHeight), glyphs,
+                        m_EditingReplacement ? m_Theme.textColor : m_Theme.statusColor);
+    }
+
+    // Replacing doesn't search as the query is typed, so there is only a status once something was replaced.
+    std::string status;
+    if (m_Replacing)
+        status = m_Message;
+    else if (m_Query.empty())
+        return;
+    else if (!m_Status.counted)
+        status = std::to_string(m_Status.count) + " matches so far...";
+    else if (m_Status.count == 0)
+        status = "No results";
+    else
+        status = std::to_string(m_Status.count) + (m_Status.count == 1 ? " match" : " matches");
+
+    m_Batch.addText(status, textPos + sf::Vector2f(queryWidth + m_Theme.pad * 4, 0), glyphs, m_Theme.statusColor);
+}
+
+void FindBar::onTransformChanged(sf::Vector2f oldPos, sf::Vector2f oldSize) {
+    updateBatch();
+}
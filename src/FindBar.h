@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "DocumentSearch.h"
+#include "RenderBatch.h"
+#include "Drawable.hpp"
+#include "Theme.hpp"
+
+/**
+ * @brief   The query of a search and how many matches it has, drawn in a box.
+ *          When replacing, a second field below the query holds the replacement.
+ *
+ * @note    Only shows the search, the owner decides what to do with the query.
+ */
+class FindBar : public Drawable, public Transformable, public Stylable<Theme::FindBarTheme> {
+public:
+    FindBar() noexcept;
+
+    /**
+     * @brief   Draws the box, the query and the status, in a single draw call.
+     *
+     * @note    Draws nothing while closed.
+     */
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+
+    void update(double deltaTime) override;
+
+    /**
+     * @brief           Shows the bar.
+     *
+     * @param query     The query to start out with.
+     * @param replacing Whether to show the replacement field as well.
+     */
+    void open(std::string query, bool replacing = false);
+
+    /**
+     * @brief   Hides the bar and clears the query.
+     */
+    void close() noexcept;
+
+    bool isOpen() const noexcept;
+
+    bool isReplacing() const noexcept;
+
+    const std::string& getQuery() const noexcept;
+
+    const std::string& getReplacement() const noexcept;
+
+    /**
+     * @brief   Moves between the query and the replacement field.
+     *
+     * @note    Does nothing unless replacing.
+     */
+    void switchField();
+
+    /**
+     * @brief   Adds a character to the end of the field being edited, encoded as UTF-8.
+     *
+     * @note    Control characters aren't added.
+     *
+     * @returns True if the query changed.
+     */
+    bool append(uint32_t c);
+
+    /**
+     * @brief   Removes the last character of the field being edited, however many bytes it takes up.
+     *
+     * @returns True if the query changed.
+     */
+    bool erase();
+
+    /**
+     * @brief   Shows how far the search for the query got.
+     *
+     * @returns True if what the bar shows changed.
+     */
+    bool setStatus(const DocumentSearch::Status& status);
+
+    /**
+     * @brief   Shows a message in place of the status while replacing, e.g. how many were replaced.
+     *
+     * @note    Cleared as soon as a field is edited.
+     */
+    void setMessage(std::string message);
+
+private:
+    /**
+     * @brief   Lays out the box, the query and the status again.
+     */
+    void updateBatch();
+
+    void onTransformChanged(sf::Vector2f oldPos, sf::Vector2f oldSize) override;
+
+    // The field being edited, the query or the replacement.
+    std::string& getField() noexcept;
+
+    bool m_Open;
+    bool m_Replacing;
+    bool m_EditingReplacement;
+    std::string m_Query;
+    std::string m_Replacement;
+    DocumentSearch::Status m_Status;
+    std::string m_Message;
+
+    RenderBatch m_Batch;
+};
@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <utility>
+
+#include "GlyphCache.h"
+
+const GlyphCache& GlyphCache::get(const sf::Font& font, uint32_t characterSize) {
+    static std::map<std::pair<const sf::Font*, uint32_t>, std::unique_ptr<GlyphCache>> caches;
+
+    auto& cache = caches[{ &font, characterSize }];
+    if (!cache)
+        cache = std::make_unique<GlyphCache>(font, characterSize);
+
+    return *cache;
+}
+
+GlyphCache::GlyphCache(const sf::Font& font, uint32_t characterSize) :
+                m_Font(font), m_CharacterSize(characterSize), m_Glyphs(), m_Advances(), m_Kerning(), m_Monospace(false) {
+
+    // Same special cases as sf::Text, without letter spacing and bold text.
+    float whitespaceWidth = font.getGlyph(U' ', characterSize, false).advance;
+
+    for (uint32_t c = 0; c < asciiCount; c++) {
+        // Glyphs never move within the atlas once loaded, so they can be copied.
+        m_Glyphs[c] = font.getGlyph(c, characterSize, false);
+
+        if (c == U' ')
+            m_Advances[c] = whitespaceWidth;
+        else if (c == U'\t')
+            m_Advances[c] = whitespaceWidth * 4;
+        else if (c == U'\n')
+            m_Advances[c] = 0;
+        else
+            m_Advances[c] = m_Glyphs[c].advance;
+    }
+
+    // Most fonts that are used for code have no kerning at all,
+    // in which case there is no need to keep a table of zeroes.
+    bool hasKerning = false;
+    std::vector<float> kerning(asciiCount * asciiCount);
+
+    for (uint32_t prev = 0; prev < asciiCount; prev++) {
+        for (uint32_t c = 0; c < asciiCount; c++) {
+            float value = font.getKerning(prev, c, characterSize);
+            kerning[prev * asciiCount + c] = value;
+            hasKerning |= (value != 0);
+        }
+    }
+
+    if (hasKerning)
+        m_Kerning = std::move(kerning);
+
+    m_Monospace = !hasKerning &&
+        std::all_of(m_Advances.begin() + ' ', m_Advances.begin() + '~' + 1,
+                    [this](float advance) { return advance == m_Advances[' ']; });
+}
+
+uint32_t GlyphCache::getCharacterSize() const noexcept {
+    return m_CharacterSize;
+}
+
+const sf::Texture& GlyphCache::getTexture() const {
+    return m_Font.getTexture(m_CharacterSize);
+}
+
+const sf::Glyph& GlyphCache::getGlyph(uint32_t c) const {
+    if (c < asciiCount)
+        return m_Glyphs[c];
+
+    return m_Font.getGlyph(c, m_CharacterSize, false);
+}
+
+bool GlyphCache::isMonospace() const noexcept {
+    return m_Monospace;
+}
+
+float GlyphCache::getMonospaceAdvance() const noexcept {
+    return m_Advances[' '];
+}
+
+float GlyphCache::getAdvance(uint32_t c) const {
+    if (c < asciiCount)
+        return m_Advances[c];
+
+    return m_Font.getGlyph(c, m_CharacterSize, false).advance;
+}
+
+float GlyphCache::getKerning(uint32_t prev, uint32_t c) const {
+    if (prev < asciiCount && c < asciiCount)
+        return m_Kerning.empty() ? 0.f : m_Kerning[prev * asciiCount + c];
+
+    return m_Font.getKerning(prev, c, m_CharacterSize);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <SFML/Graphics.hpp>
+
+/**
+ * @brief   Glyph advances and kerning of a font at a specific character size.
+ *
+ *          Has everything needed to lay out a line exactly like sf::Text does, without
+ *          building an sf::Text for it. The glyphs, advances and kerning of ASCII
+ *          characters are looked up once, other characters are asked from the font
+ *          as needed.
+ *
+ *          If every printable ASCII character has the same advance and there is no
+ *          kerning between them, the font is treated as monospace, and the position
+ *          of a column in a line of such characters is simply column * advance.
+ */
+class GlyphCache {
+public:
+    /**
+     * @brief               Get the cache of a font at a character size, creating it on first use.
+     *
+     * @note                The font has to outlive the cache.
+     */
+    static const GlyphCache& get(const sf::Font& font, uint32_t characterSize);
+
+    GlyphCache(const sf::Font& font, uint32_t characterSize);
+
+    /**
+     * @brief   Get the character size the cache was created for.
+     */
+    uint32_t getCharacterSize() const noexcept;
+
+    /**
+     * @brief   Get the atlas texture the glyphs of this character size are in.
+     */
+    const sf::Texture& getTexture() const;
+
+    /**
+     * @brief   Get the glyph of a character, including its place in the atlas.
+     */
+    const sf::Glyph& getGlyph(uint32_t c) const;
+
+    /**
+     * @brief   Check if the font was found to be monospace.
+     */
+    bool isMonospace() const noexcept;
+
+    /**
+     * @brief   Get the advance of every printable ASCII character of a monospace font.
+     *
+     * @note    Only meaningful if isMonospace() is true.
+     */
+    float getMonospaceAdvance() const noexcept;
+
+    /**
+     * @brief   Get the horizontal advance of a character, including the
+     *          special widths sf::Text uses for spaces and tabs.
+     */
+    float getAdvance(uint32_t c) const;
+
+    /**
+     * @brief   Get the kerning between two consecutive characters.
+     */
+    float getKerning(uint32_t prev, uint32_t c) const;
+
+private:
+    static constexpr size_t asciiCount = 128;
+
+    const sf::Font& m_Font;
+    uint32_t m_CharacterSize;
+
+    std::array<sf::Glyph, asciiCount> m_Glyphs;
+    std::array<float, asciiCount> m_Advances;
+    std::vector<float> m_Kerning; // asciiCount * asciiCount entries, empty if no ASCII pair is kerned.
+
+    bool m_Monospace;
+};
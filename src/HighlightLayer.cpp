@@ -0,0 +1,42 @@
+#include <algorithm>
+
+#include "HighlightLayer.h"
+
+void HighlightLayer::set(Kind kind, std::vector<Range> ranges) {
+    Intervals& intervals = m_Kinds[static_cast<size_t>(kind)];
+
+    ranges.erase(std::remove_if(ranges.begin(), ranges.end(), [](const Range& range) { return range.first >= range.second; }),
+                 ranges.end());
+
+    // Most sources already hand their ranges over in order.
+    if (!std::is_sorted(ranges.begin(), ranges.end()))
+        std::sort(ranges.begin(), ranges.end());
+
+    intervals.ranges = std::move(ranges);
+    intervals.lastRows.resize(intervals.ranges.size());
+    build(intervals, 0, intervals.ranges.size());
+}
+
+void HighlightLayer::clear(Kind kind) noexcept {
+    Intervals& intervals = m_Kinds[static_cast<size_t>(kind)];
+
+    intervals.ranges.clear();
+    intervals.lastRows.clear();
+}
+
+size_t HighlightLayer::size(Kind kind) const noexcept {
+    return m_Kinds[static_cast<size_t>(kind)].ranges.size();
+}
+
+size_t HighlightLayer::build(Intervals& intervals, size_t begin, size_t end) noexcept {
+    if (begin >= end)
+        return 0;
+
+    size_t mid = begin + (end - begin) / 2;
+    size_t lastRow = std::max({ intervals.ranges[mid].second.m_Row,
+                                build(intervals, begin, mid),
+                                build(intervals, mid + 1, end) });
+
+    intervals.lastRows[mid] = lastRow;
+    return lastRow;
+}
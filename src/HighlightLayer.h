@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "CursorLocation.hpp"
+#include "RowRange.hpp"
+
+/**
+ * @brief   The highlighted ranges of a document, from every source at once.
+ *
+ *          Each source keeps its own ranges, so that e.g. the selection can change
+ *          without touching the search matches. The ranges of a source are sorted by
+ *          where they begin, and laid out as an implicit binary search tree over that
+ *          order, where every node knows the last row any range below it reaches.
+ *          Finding the ranges on some rows skips every subtree that ends before them
+ *          or begins after them, so it only costs O(log n + k), for k ranges found.
+ *
+ * @note    Only stores the ranges, Text turns the ones in frame into rectangles.
+ */
+class HighlightLayer {
+public:
+    /**
+     * @brief   Where a range comes from. Drawn in this order, so later sources end up on top.
+     */
+    enum class Kind : uint8_t {
+        Match,      // A match of the search.
+        Diagnostic, // An error or warning about the text.
+        Bracket,    // A bracket and the one it pairs with.
+        Selection,  // The selected text.
+        Count
+    };
+
+    using Range = std::pair<CursorLocation, CursorLocation>;
+
+    /**
+     * @brief           Replaces the ranges of a source.
+     *
+     * @note            Empty ranges are dropped. Ranges may overlap, and don't need to be sorted.
+     */
+    void set(Kind kind, std::vector<Range> ranges);
+
+    /**
+     * @brief   Removes the ranges of a source.
+     */
+    void clear(Kind kind) noexcept;
+
+    size_t size(Kind kind) const noexcept;
+
+    /**
+     * @brief           Calls @p onRange with every range of a source that
+     *                  covers any of the rows, in the order they begin.
+     *
+     * @note            Never looks at the ranges that don't.
+     */
+    template <typename OnRange>
+    void forEachInRows(Kind kind, RowRange rows, OnRange&& onRange) const {
+        if (rows.empty())
+            return;
+
+        const Intervals& intervals = m_Kinds[static_cast<size_t>(kind)];
+        visit(intervals, 0, intervals.ranges.size(), rows, onRange);
+    }
+
+private:
+    struct Intervals {
+        std::vector<Range> ranges;      // Sorted by begin.
+        std::vector<size_t> lastRows;   // The last row reached by the subtree rooted at each range.
+    };
+
+    /**
+     * @brief   Fills in lastRows for the subtree over [begin, end), whose root is its middle.
+     *
+     * @returns The last row reached by the subtree.
+     */
+    static size_t build(Intervals& intervals, size_t begin, size_t end) noexcept;
+
+    template <typename OnRange>
+    static void visit(const Intervals& intervals, size_t begin, size_t end, RowRange rows, OnRange& onRange) {
+        if (begin >= end)
+            return;
+
+        // Nothing below ends on or after the first row.
+        size_t mid = begin + (end - begin) / 2;
+        if (intervals.lastRows[mid] < rows.first)
+            return;
+
+        visit(intervals, begin, mid, rows, onRange);
+
+        // Neither this range nor the ones after it begin before the last row.
+        const auto& range = intervals.ranges[mid];
+        if (range.first.m_Row >= rows.last)
+            return;
+
+        if (range.second.m_Row >= rows.first)
+            onRange(range);
+
+        visit(intervals, mid + 1, end, rows, onRange);
+    }
+
+    std::array<Intervals, static_cast<size_t>(Kind::Count)> m_Kinds;
+};
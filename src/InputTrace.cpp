@@ -0,0 +1,226 @@
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "InputTrace.h"
+
+namespace {
+    constexpr char magic[4] = { 'V', 'T', 'R', 'C' };
+    constexpr uint8_t version = 1;
+
+    // The first byte of every event.
+    enum Type : uint8_t {
+        KeyPressed = 0,
+        TextEntered,
+        MouseWheelScrolled,
+        Resized,
+        MouseButtonPressed
+    };
+
+    // Mouse positions can be negative, outside of the window, so they're zigzag encoded to keep the varint short.
+    uint64_t zigzag(int value) noexcept {
+        return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+    }
+
+    int unzigzag(uint64_t value) noexcept {
+        return static_cast<int>(static_cast<uint32_t>(value >> 1) ^ -static_cast<uint32_t>(value & 1));
+    }
+
+    // The modifiers of a key press, packed into one byte.
+    enum Modifier : uint8_t {
+        Alt     = 1 << 0,
+        Control = 1 << 1,
+        Shift   = 1 << 2,
+        System  = 1 << 3
+    };
+}
+
+namespace InputTrace {
+    Writer::Writer(const std::filesystem::path& path, sf::Vector2u windowSize) :
+                    m_Out(path, std::ios::binary | std::ios::trunc), m_Clock(), m_LastTime(0) {
+        if (!m_Out)
+            throw std::runtime_error("Cannot create '" + path.string() + "'.");
+
+        m_Out.write(magic, sizeof(magic));
+        m_Out.put(static_cast<char>(version));
+        writeVarint(windowSize.x);
+        writeVarint(windowSize.y);
+        m_Out.flush();
+
+        m_Clock.restart();
+    }
+
+    void Writer::record(const sf::Event::KeyPressed& event) {
+        beginEvent(KeyPressed);
+
+        // Unknown keys are -1, so shift everything up by one to keep the varint unsigned.
+        writeVarint(static_cast<uint64_t>(static_cast<int>(event.code) + 1));
+        writeVarint(static_cast<uint64_t>(static_cast<int>(event.scancode) + 1));
+
+        uint8_t modifiers = (event.alt ? Alt : 0) | (event.control ? Control : 0) |
+                            (event.shift ? Shift : 0) | (event.system ? System : 0);
+        m_Out.put(static_cast<char>(modifiers));
+
+        m_Out.flush();
+    }
+
+    void Writer::record(const sf::Event::TextEntered& event) {
+        beginEvent(TextEntered);
+        writeVarint(event.unicode);
+
+        m_Out.flush();
+    }
+
+    void Writer::record(const sf::Event::MouseWheelScrolled& event) {
+        beginEvent(MouseWheelScrolled);
+        m_Out.put(static_cast<char>(event.wheel));
+
+        // Only the sign of the delta matters to the editor, but keep it exact anyway.
+        char delta[sizeof(float)];
+        std::memcpy(delta, &event.delta, sizeof(float));
+        m_Out.write(delta, sizeof(delta));
+
+        m_Out.flush();
+    }
+
+    void Writer::record(const sf::Event::MouseButtonPressed& event) {
+        beginEvent(MouseButtonPressed);
+        m_Out.put(static_cast<char>(event.button));
+        writeVarint(zigzag(event.position.x));
+        writeVarint(zigzag(event.position.y));
+
+        m_Out.flush();
+    }
+
+    void Writer::record(const sf::Event::Resized& event) {
+        beginEvent(Resized);
+        writeVarint(event.size.x);
+        writeVarint(event.size.y);
+
+        m_Out.flush();
+    }
+
+    void Writer::beginEvent(uint8_t type) {
+        uint64_t time = m_Clock.getElapsedTime().asMicroseconds();
+
+        m_Out.put(static_cast<char>(type));
+        writeVarint(time - m_LastTime);
+
+        m_LastTime = time;
+    }
+
+    void Writer::writeVarint(uint64_t value) {
+        // 7 bits at a time, the high bit tells if more bytes follow.
+        while (value >= 0x80) {
+            m_Out.put(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+
+        m_Out.put(static_cast<char>(value));
+    }
+
+    Reader::Reader(const std::filesystem::path& path) :
+                    m_In(path, std::ios::binary), m_WindowSize(), m_Time(0) {
+        if (!m_In)
+            throw std::runtime_error("Cannot open '" + path.string() + "'.");
+
+        char header[sizeof(magic) + 1];
+        if (!m_In.read(header, sizeof(header)) || std::memcmp(header, magic, sizeof(magic)) != 0)
+            throw std::runtime_error("'" + path.string() + "' is not an input trace.");
+
+        if (static_cast<uint8_t>(header[sizeof(magic)]) != version)
+            throw std::runtime_error("'" + path.string() + "' was recorded by an unsupported version.");
+
+        m_WindowSize.x = static_cast<unsigned>(expectVarint());
+        m_WindowSize.y = static_cast<unsigned>(expectVarint());
+    }
+
+    sf::Vector2u Reader::getWindowSize() const noexcept {
+        return m_WindowSize;
+    }
+
+    std::optional<Event> Reader::next() {
+        int type = m_In.get();
+        if (type == std::char_traits<char>::eof())
+            return std::nullopt;
+
+        m_Time += expectVarint();
+
+        switch (type) {
+        case KeyPressed: {
+            sf::Event::KeyPressed event;
+            event.code = static_cast<sf::Keyboard::Key>(static_cast<int>(expectVarint()) - 1);
+            event.scancode = static_cast<sf::Keyboard::Scancode>(static_cast<int>(expectVarint()) - 1);
+
+            int modifiers = m_In.get();
+            if (modifiers == std::char_traits<char>::eof())
+                break;
+
+            event.alt = modifiers & Alt; event.control = modifiers & Control;
+            event.shift = modifiers & Shift; event.system = modifiers & System;
+
+            return Event{ m_Time, event };
+        }
+        case TextEntered: {
+            sf::Event::TextEntered event;
+            event.unicode = static_cast<uint32_t>(expectVarint());
+
+            return Event{ m_Time, event };
+        }
+        case MouseWheelScrolled: {
+            sf::Event::MouseWheelScrolled event;
+            event.wheel = static_cast<sf::Mouse::Wheel>(m_In.get());
+
+            char delta[sizeof(float)];
+            if (!m_In.read(delta, sizeof(delta)))
+                break;
+
+            std::memcpy(&event.delta, delta, sizeof(float));
+            return Event{ m_Time, event };
+        }
+        case Resized: {
+            sf::Event::Resized event;
+            event.size.x = static_cast<unsigned>(expectVarint());
+            event.size.y = static_cast<unsigned>(expectVarint());
+
+            return Event{ m_Time, event };
+        }
+        case MouseButtonPressed: {
+            sf::Event::MouseButtonPressed event;
+            event.button = static_cast<sf::Mouse::Button>(m_In.get());
+            event.position.x = unzigzag(expectVarint());
+            event.position.y = unzigzag(expectVarint());
+
+            return Event{ m_Time, event };
+        }
+        default:
+            throw std::runtime_error("Unknown event type " + std::to_string(type) + " in the input trace.");
+        }
+
+        throw std::runtime_error("The input trace is cut off.");
+    }
+
+    std::optional<uint64_t> Reader::readVarint() {
+        uint64_t value = 0;
+
+        for (int shift = 0; shift < 64; shift += 7) {
+            int byte = m_In.get();
+            if (byte == std::char_traits<char>::eof())
+                return std::nullopt;
+
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+                return value;
+        }
+
+        throw std::runtime_error("A number in the input trace is too long.");
+    }
+
+    uint64_t Reader::expectVarint() {
+        auto value = readVarint();
+        if (!value.has_value())
+            throw std::runtime_error("The input trace is cut off.");
+
+        return value.value();
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+
+#include <SFML/Graphics.hpp>
+
+/**
+ * @brief   The events a TextEditor reacts to, as stored in an input trace.
+ *
+ *          A trace starts with the magic "VTRC", a version byte and the size of
+ *          the window. Every event after that is a type byte, the microseconds
+ *          since the previous event and the fields of the event. Numbers are
+ *          written as LEB128 varints, so most events take 3 to 5 bytes.
+ */
+namespace InputTrace {
+    struct Event {
+        uint64_t time; // Microseconds since the trace started.
+        sf::Event event;
+    };
+
+    /**
+     * @brief   Writes the events handled by the main loop to a trace file.
+     *
+     * @note    Every event is flushed right away, so the trace
+     *          is complete up to the last event, even after a crash.
+     */
+    class Writer {
+    public:
+        /**
+         * @brief               Creates a trace file, replacing any existing one.
+         *
+         * @param windowSize    The size of the window when recording starts.
+         *
+         * @throws              std::runtime_error if the file cannot be created.
+         */
+        Writer(const std::filesystem::path& path, sf::Vector2u windowSize);
+
+        void record(const sf::Event::KeyPressed& event);
+        void record(const sf::Event::TextEntered& event);
+        void record(const sf::Event::MouseWheelScrolled& event);
+        void record(const sf::Event::MouseButtonPressed& event);
+        void record(const sf::Event::Resized& event);
+
+    private:
+        /**
+         * @brief   Writes the type and the time of an event, the fields are written after it.
+         */
+        void beginEvent(uint8_t type);
+
+        void writeVarint(uint64_t value);
+
+        std::ofstream m_Out;
+        sf::Clock m_Clock;
+        uint64_t m_LastTime; // The time of the previous event, in microseconds.
+    };
+
+    /**
+     * @brief   Reads the events of a trace file back, in order.
+     */
+    class Reader {
+    public:
+        /**
+         * @brief   Opens a trace file and reads its header.
+         *
+         * @throws  std::runtime_error if the file cannot be opened or isn't a trace.
+         */
+        explicit Reader(const std::filesystem::path& path);
+
+        /**
+         * @brief   Get the size of the window when the trace was recorded.
+         */
+        sf::Vector2u getWindowSize() const noexcept;
+
+        /**
+         * @brief   Reads the next event.
+         *
+         * @returns The event, or 'std::nullopt' at the end of the trace.
+         *
+         * @throws  std::runtime_error if the trace is cut off or corrupted.
+         */
+        std::optional<Event> next();
+
+    private:
+        std::optional<uint64_t> readVarint();
+        uint64_t expectVarint();
+
+        std::ifstream m_In;
+        sf::Vector2u m_WindowSize;
+        uint64_t m_Time;
+    };
+}
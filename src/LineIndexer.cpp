@@ -0,0 +1,67 @@
+#include <algorithm>
+
+#include "NewlineScanner.h"
+#include "LineIndexer.h"
+#include "Utf8.h"
+
+LineIndexer::LineIndexer(std::string_view text, size_t begin) :
+                m_Text(text), m_Stop(false), m_Mutex(), m_Found(), m_ScannedEnd(begin), m_ValidUtf8(true),
+                m_Worker(&LineIndexer::run, this) {}
+
+LineIndexer::~LineIndexer() {
+    m_Stop = true;
+
+    if (m_Worker.joinable())
+        m_Worker.join();
+}
+
+size_t LineIndexer::take(std::vector<size_t>& out) {
+    std::lock_guard lock(m_Mutex);
+
+    out.insert(out.end(), m_Found.begin(), m_Found.end());
+    m_Found.clear();
+
+    return m_ScannedEnd;
+}
+
+void LineIndexer::wait() {
+    if (m_Worker.joinable())
+        m_Worker.join();
+}
+
+bool LineIndexer::isValidUtf8() {
+    std::lock_guard lock(m_Mutex);
+    return m_ValidUtf8;
+}
+
+void LineIndexer::run() {
+    size_t begin;
+    {
+        std::lock_guard lock(m_Mutex);
+        begin = m_ScannedEnd;
+    }
+
+    std::vector<size_t> found;
+
+    // A character cut off by the end of a chunk is validated along with the next one.
+    size_t validatedEnd = Utf8::findCharacterStart(m_Text, begin);
+    bool valid = true;
+
+    while (begin < m_Text.size() && !m_Stop) {
+        size_t end = std::min(m_Text.size(), begin + chunkSize);
+
+        // Scan without holding the lock, only publishing takes it.
+        found.clear();
+        NewlineScanner::scan(m_Text.substr(begin, end - begin), begin, found);
+
+        size_t validateEnd = Utf8::findCharacterStart(m_Text, end);
+        valid = valid && Utf8::validate(m_Text.substr(validatedEnd, validateEnd - validatedEnd));
+        validatedEnd = validateEnd;
+
+        std::lock_guard lock(m_Mutex);
+        m_Found.insert(m_Found.end(), found.begin(), found.end());
+        m_ScannedEnd = end;
+        m_ValidUtf8 = valid;
+        begin = end;
+    }
+}
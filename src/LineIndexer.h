@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief   Scans a block of text for newlines on a worker thread,
+ *          and checks that it is valid UTF-8 along the way.
+ *
+ *          The worker publishes what it has found after every chunk,
+ *          so the owner can start using the first lines long before
+ *          the whole text has been scanned.
+ */
+class LineIndexer {
+public:
+    /**
+     * @brief       Starts scanning.
+     *
+     * @param text  The text to scan. Must outlive the LineIndexer.
+     * @param begin The offset to start scanning from.
+     */
+    LineIndexer(std::string_view text, size_t begin);
+
+    /**
+     * @brief   Stops the worker, without waiting for it to finish scanning.
+     */
+    ~LineIndexer();
+
+    LineIndexer(const LineIndexer&) = delete;
+    LineIndexer& operator=(const LineIndexer&) = delete;
+
+    /**
+     * @brief       Moves the offsets of every newline found since the last call into @p out.
+     *
+     * @returns     The offset up to which the text has been scanned. Every newline
+     *              before it has been handed out, by this call or an earlier one.
+     */
+    size_t take(std::vector<size_t>& out);
+
+    /**
+     * @brief   Blocks until the whole text has been scanned.
+     */
+    void wait();
+
+    /**
+     * @brief   Checks if the text scanned so far is valid UTF-8.
+     */
+    bool isValidUtf8();
+
+private:
+    // The amount of bytes scanned between two publishes.
+    static constexpr size_t chunkSize = size_t(4) << 20;
+
+    void run();
+
+    std::string_view m_Text;
+    std::atomic<bool> m_Stop;
+
+    std::mutex m_Mutex;
+    std::vector<size_t> m_Found; // Guarded by m_Mutex.
+    size_t m_ScannedEnd;         // Guarded by m_Mutex.
+    bool m_ValidUtf8;            // Guarded by m_Mutex.
+
+    std::thread m_Worker; // Declared last, so it starts after everything else is constructed.
+};
@@ -1,31 +1,39 @@
+#include <algorithm>
+#include <charconv>
+#include <iterator>
+#include <limits>
+
 #include "FontManager.hpp"
+#include "GlyphCache.h"
 #include "LineIndicator.h"
+#include "RowRange.hpp"
 #include "TextBox.h"
 
 LineIndicator::LineIndicator(TextBox* owner, sf::Vector2f pos, sf::Vector2f size) noexcept :
-                                m_Owner(owner), m_Background(), m_LineNumbers() {
+                                m_Owner(owner), m_Batch(), m_Slots(), m_SlotsFontSize(0) {
     setPosition(pos); setSize(size);
-
-    m_Background.setFillColor(m_Theme.backgroundColor);
-    m_Background.setOutlineColor(m_Theme.outlineColor);
-    m_Background.setOutlineThickness(m_Theme.outlineThickness);
 }
 
 void LineIndicator::draw(sf::RenderTarget& target, sf::RenderStates states) const {
-    target.draw(m_Background, states);
-
-    for(const auto& lineNumber : m_LineNumbers)
-        target.draw(lineNumber, states);
+    target.draw(m_Batch, states);
 }
 
 void LineIndicator::update(double deltaTime) {}
 
 void LineIndicator::onTransformChanged(sf::Vector2f oldPos, sf::Vector2f oldSize) {
-    m_Background.setPosition(m_Position);
-    m_Background.setSize(m_Size);
+    // A new size is picked up by the next updateLines().
+    m_Batch.move(m_Position - oldPos);
+}
+
+void LineIndicator::updateWidth() noexcept {
+    if (!m_Owner)
+        return;
+
+    size_t maxDigits = 1;
+    for (size_t n = m_Owner->getDocument().getLineCount(); n >= 10; n /= 10)
+        maxDigits++;
 
-    for (auto& lineNumber : m_LineNumbers)
-        lineNumber.setPosition(m_Position + sf::Vector2f(m_Theme.padLeft, 0));
+    setSize({ m_Theme.padLeft + maxDigits * m_Owner->getTheme().fontSize + m_Theme.padRight, m_Size.y });
 }
 
 void LineIndicator::updateLines() noexcept {
@@ -34,40 +42,46 @@ void LineIndicator::updateLines() noexcept {
 
     // Get the properties for the text. 
     const auto& ownerTheme = m_Owner->getTheme();
-    float lineMargin = ownerTheme.lineMargin;
     uint32_t fontSize = ownerTheme.fontSize;
 
-    m_LineNumbers.clear();
+    m_Batch.clear();
+
+    // Make sure the container is big to fit the line number with the most digits. 
+    updateWidth();
+
+    // We might be scrolled down, so move the background along. It covers the
+    // overscan as well, so that the view can move over it without updating it.
+    float overscan = m_Owner->getOverscan().y;
+    sf::Vector2f backgroundPos = { m_Position.x, m_Position.y + m_Owner->getBandScroll().y - overscan };
+    sf::Vector2f backgroundSize = { m_Size.x, m_Size.y + 2 * overscan };
+    m_Batch.addRect(backgroundPos, backgroundSize, m_Theme.backgroundColor);
+    m_Batch.addOutline(backgroundPos, backgroundSize, m_Theme.outlineThickness, m_Theme.outlineColor);
+
+    const GlyphCache& glyphs = GlyphCache::get(FontManager::getFont(), fontSize);
+
+    // Add the formatted lines, but only the ones that are in frame. 
+    RowRange rows = m_Owner->getVisibleRows();
+
+    // Every row in frame needs a slot of its own. Growing the pool
+    // changes which slot each row maps to, so start over in that case.
+    if (rows.last - rows.first > m_Slots.size() || m_SlotsFontSize != fontSize) {
+        m_Slots.assign(std::max(rows.last - rows.first, m_Slots.size()), Slot());
+        m_SlotsFontSize = fontSize;
+    }
 
-    // We might be scrolled down, so update the background's pos.
-    m_Background.move({ 0, m_Owner->getScroll().y });
+    for (size_t row = rows.first; row < rows.last; row++) {
+        Slot& slot = m_Slots[row % m_Slots.size()];
 
-    // Get the required variables to determine if the text is in frame. 
-    float viewYOffset = m_Owner->getPosition().y + m_Owner->getScroll().y;
-    float currentHeight = m_Size.y;
+        // Retarget the slot, formatting the number on the stack.
+        if (slot.number != row + 1) {
+            char digits[std::numeric_limits<size_t>::digits10 + 1];
+            auto result = std::to_chars(std::begin(digits), std::end(digits), row + 1);
 
-    size_t lineCount = m_Owner->getLineCount();
-    size_t maxDigits = std::to_string(lineCount).size();
+            slot.number = row + 1;
+            slot.glyphs.clear();
+            slot.glyphs.addText(std::string_view(digits, result.ptr - digits), { 0, 0 }, glyphs, m_Theme.textColor);
+        }
 
-    // Make sure the container is big to fit the line number with the most digits. 
-    setSize({ m_Theme.padLeft + maxDigits * fontSize + m_Theme.padRight, m_Size.y });
-    // We might be scrolled down, so update the background's pos.
-    m_Background.setPosition({ m_Position.x, m_Position.y + m_Owner->getScroll().y });
-
-    // Add all formatted lines. 
-    for (size_t line = 1; line <= lineCount; line++) {
-        sf::Vector2 pos = { m_Position.x + m_Theme.padLeft, m_Position.y + (fontSize + lineMargin) * (line - 1) };
-
-        // Do not add any line numbers that are out of frame. 
-        if (pos.y < viewYOffset - currentHeight || pos.y > viewYOffset + currentHeight)
-            continue;
-
-        // Build the text and insert it in m_LineNumbers. 
-        sf::Text lineText(FontManager::getFont());
-        lineText.setString(std::to_string(line));
-        lineText.setPosition(pos);
-        lineText.setFillColor(m_Theme.textColor);
-        lineText.setCharacterSize(fontSize);
-        m_LineNumbers.push_back(lineText);
+        m_Batch.append(slot.glyphs, { m_Position.x + m_Theme.padLeft, m_Position.y + m_Owner->getRowY(row) });
     }
 }
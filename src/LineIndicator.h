@@ -2,6 +2,7 @@
 
 #include <vector>
 
+#include "RenderBatch.h"
 #include "Drawable.hpp"
 #include "Config.hpp"
 #include "Theme.hpp"
@@ -16,12 +17,40 @@ public:
 
 	void update(double deltaTime) override;
 
+	/**
+	 * @brief	Rebuilds the gutter for the rows that are in frame.
+	 *
+	 * @note	Only looks at the rows in frame, and doesn't allocate
+	 *			unless more rows fit in frame than ever before.
+	 */
 	void updateLines() noexcept;
 
+	/**
+	 * @brief	Resizes the gutter to fit the line number with the most digits.
+	 *
+	 * @note	Cheap enough to call whenever the line count might have changed.
+	 */
+	void updateWidth() noexcept;
+
 private:
+	/**
+	 * @brief	A line number, laid out at (0, 0).
+	 *
+	 * @note	Row r always uses slot r % m_Slots.size(). The rows in frame are
+	 *			consecutive and never more than there are slots, so they never
+	 *			share one, and a slot only has to be laid out again when it is
+	 *			retargeted to another row by scrolling.
+	 */
+	struct Slot {
+		size_t number = 0; // 0 if the slot doesn't hold any number yet.
+		RenderBatch glyphs;
+	};
+
 	void onTransformChanged(sf::Vector2f oldPos, sf::Vector2f oldSize) override;
 
 	TextBox* m_Owner;
-	sf::RectangleShape m_Background;
-	std::vector<sf::Text> m_LineNumbers;
+	RenderBatch m_Batch; // The background, its outline and the line numbers, drawn in one call.
+
+	std::vector<Slot> m_Slots;
+	uint32_t m_SlotsFontSize; // The font size the slots were laid out with.
 };
\ No newline at end of file
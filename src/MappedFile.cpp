@@ -0,0 +1,94 @@
+#include <stdexcept>
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::filesystem::path& path) :
+                m_Data(nullptr), m_Size(0), m_File(INVALID_HANDLE_VALUE), m_Mapping(nullptr) {
+    m_File = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                         OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_File == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("Cannot open '" + path.string() + "'.");
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m_File, &size)) {
+        CloseHandle(m_File);
+        throw std::runtime_error("Cannot get the size of '" + path.string() + "'.");
+    }
+
+    m_Size = static_cast<size_t>(size.QuadPart);
+
+    // Empty files cannot be mapped, but there's nothing to map anyway.
+    if (m_Size == 0)
+        return;
+
+    m_Mapping = CreateFileMappingW(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_Mapping)
+        m_Data = static_cast<const char*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+
+    if (!m_Data) {
+        if (m_Mapping) CloseHandle(m_Mapping);
+        CloseHandle(m_File);
+        throw std::runtime_error("Cannot map '" + path.string() + "'.");
+    }
+}
+
+MappedFile::~MappedFile() {
+    if (m_Data) UnmapViewOfFile(m_Data);
+    if (m_Mapping) CloseHandle(m_Mapping);
+    if (m_File != INVALID_HANDLE_VALUE) CloseHandle(m_File);
+}
+
+#else
+
+MappedFile::MappedFile(const std::filesystem::path& path) : m_Data(nullptr), m_Size(0) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Cannot open '" + path.string() + "'.");
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot get the size of '" + path.string() + "'.");
+    }
+
+    m_Size = static_cast<size_t>(info.st_size);
+
+    // Empty files cannot be mapped, but there's nothing to map anyway.
+    if (m_Size == 0) {
+        ::close(fd);
+        return;
+    }
+
+    void* data = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // The mapping keeps its own reference to the file.
+
+    if (data == MAP_FAILED)
+        throw std::runtime_error("Cannot map '" + path.string() + "'.");
+
+    m_Data = static_cast<const char*>(data);
+}
+
+MappedFile::~MappedFile() {
+    if (m_Data)
+        munmap(const_cast<char*>(m_Data), m_Size);
+}
+
+#endif
+
+std::string_view MappedFile::view() const noexcept {
+    return { m_Data, m_Size };
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <filesystem>
+#include <string_view>
+
+/**
+ * @brief   Read-only memory mapping of a whole file.
+ *
+ *          The bytes are paged in by the OS on first access, so mapping
+ *          a file is cheap no matter how big it is.
+ */
+class MappedFile {
+public:
+    /**
+     * @brief       Maps a file into memory.
+     *
+     * @param path  The path of the file.
+     *
+     * @throws      std::runtime_error if the file cannot be opened or mapped.
+     */
+    explicit MappedFile(const std::filesystem::path& path);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief   Get the contents of the file.
+     *
+     * @note    The view stays valid for as long as the MappedFile is alive.
+     */
+    std::string_view view() const noexcept;
+
+private:
+    const char* m_Data;
+    size_t m_Size;
+
+#ifdef _WIN32
+    void* m_File;
+    void* m_Mapping;
+#endif
+};
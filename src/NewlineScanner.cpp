@@ -0,0 +1,88 @@
+#include <cstdint>
+#include <cstring>
+
+#include "NewlineScanner.h"
+#include "Simd.hpp"
+
+namespace {
+    using ScanFunction = void (*)(std::string_view, size_t, std::vector<size_t>&);
+
+#ifdef VISIONARY_X86_SIMD
+    // Appends the offset of every set bit in mask, lowest first.
+    inline void appendMatches(uint64_t mask, size_t offset, std::vector<size_t>& out) {
+        while (mask) {
+            out.push_back(offset + Simd::countTrailingZeros(mask));
+            mask &= mask - 1;
+        }
+    }
+
+    void scanSSE2(std::string_view text, size_t base, std::vector<size_t>& out) {
+        const char* data = text.data();
+        const size_t size = text.size();
+        const __m128i newline = _mm_set1_epi8('\n');
+
+        size_t i = 0;
+        for (; i + 16 <= size; i += 16) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline)));
+            appendMatches(mask, base + i, out);
+        }
+
+        NewlineScanner::scanScalar(text.substr(i), base + i, out);
+    }
+
+    VISIONARY_TARGET_AVX2
+    void scanAVX2(std::string_view text, size_t base, std::vector<size_t>& out) {
+        const char* data = text.data();
+        const size_t size = text.size();
+        const __m256i newline = _mm256_set1_epi8('\n');
+
+        // Two blocks per iteration, so that a single 64-bit mask covers both.
+        size_t i = 0;
+        for (; i + 64 <= size; i += 64) {
+            __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 32));
+
+            uint64_t lowMask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, newline)));
+            uint64_t highMask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, newline)));
+
+            appendMatches(lowMask | (highMask << 32), base + i, out);
+        }
+
+        scanSSE2(text.substr(i), base + i, out);
+    }
+#endif
+
+    // Picks the implementation once, the first time it is needed.
+    const Simd::Implementation<ScanFunction>& getImplementation() noexcept {
+    #ifdef VISIONARY_X86_SIMD
+        static const auto implementation = Simd::pick<ScanFunction>(scanAVX2, scanSSE2);
+    #else
+        static const Simd::Implementation<ScanFunction> implementation = { NewlineScanner::scanScalar, "scalar" };
+    #endif
+
+        return implementation;
+    }
+}
+
+void NewlineScanner::scan(std::string_view text, size_t base, std::vector<size_t>& out) {
+    getImplementation().function(text, base, out);
+}
+
+void NewlineScanner::scanScalar(std::string_view text, size_t base, std::vector<size_t>& out) {
+    const char* data = text.data();
+    const char* end = data + text.size();
+
+    // memchr is the fastest portable way to skip over everything that isn't a newline.
+    for (const char* it = data; it < end; it++) {
+        it = static_cast<const char*>(std::memchr(it, '\n', end - it));
+        if (!it)
+            break;
+
+        out.push_back(base + (it - data));
+    }
+}
+
+const char* NewlineScanner::getInstructionSet() noexcept {
+    return getImplementation().name;
+}
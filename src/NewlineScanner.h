@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief   Finds the offsets of every '\n' in a block of text.
+ *
+ *          On x86-64, the text is compared 16 (SSE2) or 32 (AVX2) bytes at a time,
+ *          depending on what the CPU supports. Everywhere else, a scalar fallback is used.
+ */
+namespace NewlineScanner {
+    /**
+     * @brief       Appends the offset of every '\n' in @p text to @p out,
+     *              using the fastest implementation the CPU supports.
+     *
+     * @param text  The text to scan.
+     * @param base  Added to every offset, for scanning a block of a larger buffer.
+     * @param out   The vector to append the offsets to, in ascending order.
+     */
+    void scan(std::string_view text, size_t base, std::vector<size_t>& out);
+
+    /**
+     * @brief   Same as scan(), but never uses any vector instructions.
+     */
+    void scanScalar(std::string_view text, size_t base, std::vector<size_t>& out);
+
+    /**
+     * @returns The name of the implementation used by scan(), "AVX2", "SSE2" or "scalar".
+     */
+    const char* getInstructionSet() noexcept;
+};
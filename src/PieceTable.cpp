@@ -0,0 +1,1059 @@
+#include <algorithm>
+#include <numeric>
+
+#include "NewlineScanner.h"
+#include "PieceTable.h"
+#include "Utf8.h"
+
+PieceTable::PieceTable(std::string original) :
+                m_Original(), m_Added(), m_OriginalStorage(), m_AddedStorage(std::make_shared<std::string>()), m_Mapping(), m_Indexer(),
+                m_ScannedEnd(0), m_IndexedEnd(0), m_ValidUtf8(true), m_Version(0), m_Listener(nullptr),
+                m_Joined(), m_JoinedUses(0), m_PartScratch(),
+                m_Nodes(), m_FreeNodes(), m_Root(nil), m_Seed(0x9E3779B9u) {
+    load(std::move(original));
+}
+
+void PieceTable::load(std::string original) {
+    reset();
+
+    m_OriginalStorage = std::move(original);
+    m_Original.text = m_OriginalStorage;
+
+    // It's already in memory, so there's nothing to gain from indexing in the background.
+    while (!isFullyIndexed())
+        indexChunk();
+}
+
+void PieceTable::open(const std::filesystem::path& path) {
+    // Map before resetting, so that a failure leaves the document as it was.
+    auto mapping = std::make_unique<MappedFile>(path);
+
+    reset();
+
+    m_Mapping = std::move(mapping);
+    m_Original.text = m_Mapping->view();
+
+    // Index the first chunk right away, so that there's something to show,
+    // and leave the rest to the indexer.
+    // Keep going until there's at least a single line, though.
+    while (getLineCount() == 0)
+        indexChunk();
+
+    if (m_ScannedEnd < m_Original.text.size())
+        m_Indexer = std::make_unique<LineIndexer>(m_Original.text, m_ScannedEnd);
+}
+
+bool PieceTable::updateIndex() {
+    if (!m_Indexer)
+        return false;
+
+    m_ScannedEnd = m_Indexer->take(m_Original.lineFeeds);
+    m_ValidUtf8 = m_ValidUtf8 && m_Indexer->isValidUtf8();
+    bool indexed = appendScanned();
+
+    if (m_ScannedEnd == m_Original.text.size())
+        m_Indexer.reset();
+
+    return indexed;
+}
+
+void PieceTable::waitForIndex() {
+    if (m_Indexer)
+        m_Indexer->wait();
+
+    updateIndex();
+}
+
+bool PieceTable::isFullyIndexed() const noexcept {
+    return m_IndexedEnd == m_Original.text.size();
+}
+
+bool PieceTable::isValidUtf8() const noexcept {
+    return m_ValidUtf8;
+}
+
+size_t PieceTable::getLineCount() const noexcept {
+    // Every newline starts a new line.
+    // Until everything is indexed, the line after the last newline isn't complete yet.
+    return lineFeeds(m_Root) + (isFullyIndexed() ? 1 : 0);
+}
+
+uint64_t PieceTable::getVersion() const noexcept {
+    return m_Version;
+}
+
+size_t PieceTable::getLineLength(size_t row) const noexcept {
+    if (row >= getLineCount())
+        return 0;
+
+    auto [begin, end] = lineBounds(row);
+    return end - begin;
+}
+
+std::optional<std::string_view> PieceTable::line(size_t row) const {
+    if (row >= getLineCount())
+        return std::nullopt;
+
+    auto [begin, end] = lineBounds(row);
+
+    if (auto view = contiguous(begin, end))
+        return view;
+
+    // Rejoin the least recently used slot, unless the row is joined already.
+    JoinedLine* slot = &m_Joined.front();
+    for (auto& joined : m_Joined) {
+        if (joined.row == row) {
+            slot = &joined;
+            break;
+        }
+
+        if (joined.lastUsed < slot->lastUsed)
+            slot = &joined;
+    }
+
+    if (slot->row != row) {
+        slot->text.clear();
+        read(begin, end, slot->text);
+        slot->row = row;
+    }
+
+    slot->lastUsed = ++m_JoinedUses;
+    return std::string_view(slot->text);
+}
+
+std::optional<std::string_view> PieceTable::linePart(size_t row, size_t begin, size_t end) const {
+    if (row >= getLineCount())
+        return std::nullopt;
+
+    auto [lineBegin, lineEnd] = lineBounds(row);
+    size_t length = lineEnd - lineBegin;
+
+    begin = std::min(begin, length);
+    end = std::clamp(end, begin, length);
+
+    if (auto view = contiguous(lineBegin + begin, lineBegin + end))
+        return view;
+
+    for (const auto& joined : m_Joined) {
+        if (joined.row == row)
+            return std::string_view(joined.text).substr(begin, end - begin);
+    }
+
+    m_PartScratch.clear();
+    read(lineBegin + begin, lineBegin + end, m_PartScratch);
+
+    return std::string_view(m_PartScratch);
+}
+
+size_t PieceTable::getSize() const noexcept {
+    return length(m_Root);
+}
+
+char PieceTable::getChar(size_t offset) const noexcept {
+    NodeId node = m_Root;
+
+    while (node != nil) {
+        const Node& n = m_Nodes[node];
+        size_t leftLength = length(n.left);
+
+        if (offset < leftLength) {
+            node = n.left;
+            continue;
+        }
+
+        offset -= leftLength;
+        if (offset < n.piece.length)
+            return buffer(n.piece.buffer).text[n.piece.start + offset];
+
+        offset -= n.piece.length;
+        node = n.right;
+    }
+
+    return '\0';
+}
+
+size_t PieceTable::toOffset(CursorLocation pos) const noexcept {
+    auto [begin, end] = lineBounds(std::min(pos.m_Row, getLineCount() - 1));
+    return begin + std::min(pos.m_Col, end - begin);
+}
+
+CursorLocation PieceTable::toLocation(size_t offset) const noexcept {
+    offset = std::min(offset, lastOffset());
+
+    size_t row = lineFeedsBefore(offset);
+    return { row, offset - lineStart(row) };
+}
+
+std::vector<size_t> PieceTable::toOffsets(const std::vector<CursorLocation>& locations) const {
+    // Go through them in order, so that the lines of all of them are found in a single walk of the tree.
+    std::vector<size_t> order(locations.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+
+    if (!std::is_sorted(locations.begin(), locations.end()))
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return locations[a] < locations[b]; });
+
+    // Like lineStart() and lineEnd(): a line starts after the newline of the one before it, and ends at its own.
+    size_t lastRow = getLineCount() - 1;
+    size_t lastLineFeed = lineFeeds(m_Root);
+
+    std::vector<size_t> rows, starts, ends;
+    rows.reserve(order.size());
+
+    for (size_t i : order) {
+        size_t row = std::min(locations[i].m_Row, lastRow);
+        rows.push_back(row);
+
+        if (row > 0)
+            starts.push_back(row - 1);
+        if (row < lastLineFeed)
+            ends.push_back(row);
+    }
+
+    std::vector<size_t> startOffsets(starts.size()), endOffsets(ends.size());
+    lineFeedOffsets(m_Root, 0, 0, starts.data(), starts.data() + starts.size(), startOffsets.data());
+    lineFeedOffsets(m_Root, 0, 0, ends.data(), ends.data() + ends.size(), endOffsets.data());
+
+    std::vector<size_t> ret(locations.size());
+    auto start = startOffsets.begin(), end = endOffsets.begin();
+
+    for (size_t j = 0; j < order.size(); j++) {
+        size_t begin = (rows[j] > 0) ? *start++ + 1 : 0;
+        size_t lineEnd = (rows[j] < lastLineFeed) ? *end++ : getSize();
+
+        ret[order[j]] = begin + std::min(locations[order[j]].m_Col, lineEnd - begin);
+    }
+
+    return ret;
+}
+
+std::vector<CursorLocation> PieceTable::toLocations(const std::vector<size_t>& offsets) const {
+    std::vector<size_t> order(offsets.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+
+    if (!std::is_sorted(offsets.begin(), offsets.end()))
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return offsets[a] < offsets[b]; });
+
+    std::vector<size_t> sorted;
+    sorted.reserve(order.size());
+    for (size_t i : order)
+        sorted.push_back(std::min(offsets[i], lastOffset()));
+
+    // The row of every offset, then where each of those rows starts.
+    std::vector<size_t> rows(sorted.size()), starts;
+    lineFeedsBefore(m_Root, 0, 0, sorted.data(), sorted.data() + sorted.size(), rows.data());
+
+    for (size_t row : rows) {
+        if (row > 0)
+            starts.push_back(row - 1);
+    }
+
+    std::vector<size_t> startOffsets(starts.size());
+    lineFeedOffsets(m_Root, 0, 0, starts.data(), starts.data() + starts.size(), startOffsets.data());
+
+    std::vector<CursorLocation> ret(offsets.size());
+    auto start = startOffsets.begin();
+
+    for (size_t j = 0; j < order.size(); j++) {
+        size_t begin = (rows[j] > 0) ? *start++ + 1 : 0;
+        ret[order[j]] = { rows[j], sorted[j] - begin };
+    }
+
+    return ret;
+}
+
+CursorLocation PieceTable::insert(CursorLocation pos, std::string_view str) {
+    size_t offset = toOffset(pos);
+
+    if (str.empty())
+        return toLocation(offset);
+
+    // 1. Append the string to the 'Added' buffer.
+    // 2. Cut the tree at the insert offset.
+    // 3. Put a piece pointing at the appended string in between.
+    size_t start = m_AddedStorage->size();
+    size_t firstLineFeed = m_Added.lineFeeds.size();
+
+    appendAdded(str);
+    NewlineScanner::scan(str, start, m_Added.lineFeeds);
+
+    Piece piece = { BufferKind::Added, start, str.size(), m_Added.lineFeeds.size() - firstLineFeed };
+    EditedRows rows = beginEdit(offset, offset);
+
+    NodeId left, right;
+    split(m_Root, offset, left, right);
+
+    // When typing, every character is appended right after the previous one.
+    // append() then grows the previous piece instead of creating a new one,
+    // so that the tree doesn't get a node per keystroke.
+    m_Root = merge(append(left, piece), right);
+    endEdit(rows);
+
+    if (m_Listener)
+        m_Listener->onInserted(offset, piece);
+
+    return toLocation(offset + str.size());
+}
+
+void PieceTable::erase(CursorLocation begin, CursorLocation end) {
+    erase(toOffset(begin), toOffset(end));
+}
+
+void PieceTable::erase(size_t begin, size_t end) {
+    end = std::min(end, getSize());
+
+    if (begin >= end)
+        return;
+
+    EditedRows rows = beginEdit(begin, end);
+
+    // Cut out the middle part and throw it away.
+    NodeId left, middle, right;
+    split(m_Root, begin, left, right);
+    split(right, end - begin, middle, right);
+
+    destroyTree(middle);
+    m_Root = merge(left, right);
+    endEdit(rows);
+
+    if (m_Listener)
+        m_Listener->onErased(begin, end);
+}
+
+void PieceTable::replace(const std::vector<Replacement>& replacements) {
+    if (replacements.empty())
+        return;
+
+    // Append every new text to the 'Added' buffer in one go, and scan it for newlines once.
+    size_t start = m_AddedStorage->size();
+    size_t addedLength = 0;
+    for (const auto& replacement : replacements)
+        addedLength += replacement.text.size();
+
+    for (const auto& replacement : replacements) {
+        appendAdded(replacement.text, addedLength);
+        addedLength -= replacement.text.size();
+    }
+
+    NewlineScanner::scan(m_Added.text.substr(start), start, m_Added.lineFeeds);
+
+    size_t size = getSize();
+    std::vector<Splice> splices;
+    splices.reserve(replacements.size());
+
+    for (const auto& replacement : replacements) {
+        size_t begin = std::min(replacement.begin, size);
+        size_t end = std::max(begin, std::min(replacement.end, size));
+        size_t length = replacement.text.size();
+
+        splices.push_back({ begin, end, { BufferKind::Added, start, length, countLineFeeds(BufferKind::Added, start, start + length) } });
+        start += length;
+    }
+
+    splice(splices, nullptr);
+}
+
+PieceTable::Piece PieceTable::replace(const std::vector<std::pair<size_t, size_t>>& ranges, std::string_view text,
+                                      std::vector<std::vector<Piece>>* erased) {
+    size_t start = m_AddedStorage->size();
+    size_t firstLineFeed = m_Added.lineFeeds.size();
+
+    appendAdded(text);
+    NewlineScanner::scan(text, start, m_Added.lineFeeds);
+
+    Piece piece = { BufferKind::Added, start, text.size(), m_Added.lineFeeds.size() - firstLineFeed };
+
+    size_t size = getSize();
+    std::vector<Splice> splices;
+    splices.reserve(ranges.size());
+
+    for (auto [begin, end] : ranges) {
+        begin = std::min(begin, size);
+        splices.push_back({ begin, std::max(begin, std::min(end, size)), piece });
+    }
+
+    if (erased)
+        erased->clear();
+
+    if (!splices.empty())
+        splice(splices, erased);
+
+    return piece;
+}
+
+void PieceTable::splice(const std::vector<Splice>& splices, std::vector<std::vector<Piece>>* erased) {
+    if (erased)
+        erased->assign(splices.size(), {});
+
+    // Replacing every match in a file touches most of its pieces anyway, so the span in between the
+    // splices is rebuilt once. But after typing at thousands of carets, the span can be made of far more
+    // pieces than there are splices, which are spliced in one by one instead, so that the pieces in between
+    // are never touched.
+    EditedRows rows = beginEdit(splices.front().begin, splices.back().end);
+
+    if (splices.size() * spliceRatio >= m_Nodes.size() - m_FreeNodes.size())
+        rebuildSpan(splices, erased);
+    else
+        spliceEach(splices, erased);
+
+    endEdit(rows);
+
+    if (!m_Listener)
+        return;
+
+    // Going from the last splice to the first keeps the offsets of the ones before it valid.
+    for (auto it = splices.rbegin(); it != splices.rend(); it++) {
+        if (it->begin < it->end)
+            m_Listener->onErased(it->begin, it->end);
+
+        if (it->piece.length > 0)
+            m_Listener->onInserted(it->begin, it->piece);
+    }
+}
+
+void PieceTable::rebuildSpan(const std::vector<Splice>& splices, std::vector<std::vector<Piece>>* erased) {
+    size_t spanBegin = splices.front().begin;
+    size_t spanEnd = splices.back().end;
+
+    NodeId left, middle, right;
+    split(m_Root, spanBegin, left, right);
+    split(right, spanEnd - spanBegin, middle, right);
+
+    // The old pieces of the span, taken out in a single walk.
+    std::vector<Piece> old;
+    collect(middle, 0, 0, length(middle), old);
+    destroyTree(middle);
+
+    // Where the span has been gone through up to, the old piece that's in, and where that piece starts.
+    size_t pos = spanBegin, pieceBegin = spanBegin;
+    auto piece = old.begin();
+
+    // Hands the old text in [pos, end) to 'take', a piece at a time.
+    const auto advance = [&](size_t end, const auto& take) {
+        while (pos < end) {
+            size_t pieceEnd = pieceBegin + piece->length;
+            size_t to = std::min(end, pieceEnd);
+
+            take(slice(*piece, pos - pieceBegin, to - pieceBegin));
+            pos = to;
+
+            if (pos == pieceEnd) {
+                pieceBegin = pieceEnd;
+                piece++;
+            }
+        }
+    };
+
+    // The unchanged gaps in between are kept as pieces, and the new pieces go in place of the old ones.
+    for (size_t i = 0; i < splices.size(); i++) {
+        advance(splices[i].begin, [&](const Piece& gap) { left = append(left, gap); });
+        advance(splices[i].end, [&](const Piece& removed) {
+            if (erased)
+                (*erased)[i].push_back(removed);
+        });
+
+        if (splices[i].piece.length > 0)
+            left = append(left, splices[i].piece);
+    }
+
+    m_Root = merge(left, right);
+}
+
+void PieceTable::spliceEach(const std::vector<Splice>& splices, std::vector<std::vector<Piece>>* erased) {
+    // From the last splice to the first, so that the offsets of the ones still to be made stay valid.
+    for (size_t i = splices.size(); i-- > 0;) {
+        const Splice& current = splices[i];
+
+        NodeId left, middle, right;
+        split(m_Root, current.begin, left, right);
+        split(right, current.end - current.begin, middle, right);
+
+        if (erased)
+            collect(middle, 0, 0, length(middle), (*erased)[i]);
+
+        destroyTree(middle);
+
+        if (current.piece.length > 0)
+            left = append(left, current.piece);
+
+        m_Root = merge(left, right);
+    }
+}
+
+void PieceTable::insert(size_t offset, const std::vector<Piece>& pieces) {
+    if (pieces.empty())
+        return;
+
+    offset = std::min(offset, getSize());
+    EditedRows rows = beginEdit(offset, offset);
+
+    NodeId left, right;
+    split(m_Root, offset, left, right);
+
+    for (const auto& piece : pieces)
+        left = append(left, piece);
+
+    m_Root = merge(left, right);
+    endEdit(rows);
+
+    if (!m_Listener)
+        return;
+
+    for (const auto& piece : pieces) {
+        m_Listener->onInserted(offset, piece);
+        offset += piece.length;
+    }
+}
+
+std::vector<PieceTable::Piece> PieceTable::getPieces(size_t begin, size_t end) const {
+    std::vector<Piece> ret;
+
+    if (begin < end)
+        collect(m_Root, 0, begin, end, ret);
+
+    return ret;
+}
+
+std::string_view PieceTable::view(const Piece& piece) const noexcept {
+    return buffer(piece.buffer).text.substr(piece.start, piece.length);
+}
+
+std::shared_ptr<const std::string> PieceTable::shareAdded() const noexcept {
+    return m_AddedStorage;
+}
+
+std::string PieceTable::getText(CursorLocation begin, CursorLocation end) const {
+    std::string ret;
+    size_t beginOffset = toOffset(begin);
+    size_t endOffset = toOffset(end);
+
+    if (beginOffset < endOffset)
+        read(beginOffset, endOffset, ret);
+
+    return ret;
+}
+
+std::string PieceTable::getText(size_t begin, size_t end) const {
+    std::string ret;
+    end = std::min(end, getSize());
+
+    if (begin < end)
+        read(begin, end, ret);
+
+    return ret;
+}
+
+void PieceTable::setListener(Listener* listener) noexcept {
+    m_Listener = listener;
+}
+
+const PieceTable::Buffer& PieceTable::buffer(BufferKind kind) const noexcept {
+    return (kind == BufferKind::Original) ? m_Original : m_Added;
+}
+
+void PieceTable::appendAdded(std::string_view text, size_t reserve) {
+    size_t size = m_AddedStorage->size();
+    size_t capacity = m_AddedStorage->capacity();
+    reserve = std::max(reserve, text.size());
+
+    if (size + reserve > capacity && m_AddedStorage.use_count() > 1) {
+        // Someone still reads the old storage, so it's left as it is, and the buffer moves.
+        auto grown = std::make_shared<std::string>();
+        grown->reserve(std::max(size + reserve, capacity * 2));
+        grown->append(*m_AddedStorage);
+        m_AddedStorage = std::move(grown);
+    }
+    else if (size + reserve > capacity) {
+        m_AddedStorage->reserve(std::max(size + reserve, capacity * 2));
+    }
+
+    m_AddedStorage->append(text);
+    m_Added.text = *m_AddedStorage;
+}
+
+PieceTable::EditedRows PieceTable::beginEdit(size_t begin, size_t end) const noexcept {
+    return { lineFeedsBefore(begin), lineFeedsBefore(end), lineFeeds(m_Root) };
+}
+
+void PieceTable::endEdit(const EditedRows& rows) noexcept {
+    size_t lineFeedsAfter = lineFeeds(m_Root);
+
+    for (auto& joined : m_Joined) {
+        if (joined.row == CursorLocation::invalidIndex || joined.row < rows.first)
+            continue;
+
+        if (joined.row <= rows.last) {
+            joined.row = CursorLocation::invalidIndex;
+            joined.lastUsed = 0;
+        }
+        else {
+            joined.row = joined.row + lineFeedsAfter - rows.lineFeeds;
+        }
+    }
+
+    m_Version++;
+}
+
+void PieceTable::reset() noexcept {
+    // Stop the indexer first, it's still reading from the original buffer.
+    m_Indexer.reset();
+
+    m_Original = {}; m_Added = {};
+    // Whoever shares the 'Added' buffer keeps the old one.
+    m_OriginalStorage.clear();
+    m_AddedStorage = std::make_shared<std::string>();
+    m_Mapping.reset();
+
+    m_ScannedEnd = 0; m_IndexedEnd = 0;
+    m_ValidUtf8 = true;
+
+    m_Nodes.clear(); m_FreeNodes.clear();
+    m_Root = nil;
+    m_Version++;
+
+    for (auto& joined : m_Joined)
+        joined = {};
+}
+
+bool PieceTable::indexChunk() {
+    std::string_view text = m_Original.text;
+    size_t scanEnd = std::min(text.size(), m_ScannedEnd + indexChunkSize);
+
+    NewlineScanner::scan(text.substr(m_ScannedEnd, scanEnd - m_ScannedEnd), m_ScannedEnd, m_Original.lineFeeds);
+
+    // A character cut off by the end of the chunk is validated along with the next one.
+    size_t validateBegin = Utf8::findCharacterStart(text, m_ScannedEnd);
+    size_t validateEnd = Utf8::findCharacterStart(text, scanEnd);
+    m_ValidUtf8 = m_ValidUtf8 && Utf8::validate(text.substr(validateBegin, validateEnd - validateBegin));
+
+    m_ScannedEnd = scanEnd;
+
+    return appendScanned();
+}
+
+bool PieceTable::appendScanned() {
+    std::string_view text = m_Original.text;
+
+    // Append everything up to and including the last newline found so far.
+    // The rest is an incomplete line, which waits for the next chunk.
+    // Once the whole buffer has been scanned, the rest is the last line.
+    size_t indexedEnd = m_IndexedEnd;
+    if (m_ScannedEnd == text.size())
+        indexedEnd = text.size();
+    else if (!m_Original.lineFeeds.empty())
+        indexedEnd = m_Original.lineFeeds.back() + 1;
+
+    if (indexedEnd == m_IndexedEnd)
+        return false;
+
+    Piece piece = { BufferKind::Original, m_IndexedEnd, indexedEnd - m_IndexedEnd,
+                    countLineFeeds(BufferKind::Original, m_IndexedEnd, indexedEnd) };
+
+    m_Root = append(m_Root, piece);
+    m_IndexedEnd = indexedEnd;
+    m_Version++;
+
+    return true;
+}
+
+size_t PieceTable::lastOffset() const noexcept {
+    size_t size = getSize();
+    return (isFullyIndexed() || size == 0) ? size : size - 1;
+}
+
+size_t PieceTable::countLineFeeds(BufferKind kind, size_t begin, size_t end) const noexcept {
+    const auto& lineFeeds = buffer(kind).lineFeeds;
+
+    return std::lower_bound(lineFeeds.begin(), lineFeeds.end(), end) -
+           std::lower_bound(lineFeeds.begin(), lineFeeds.end(), begin);
+}
+
+size_t PieceTable::lineFeedOffset(size_t n) const noexcept {
+    NodeId node = m_Root;
+    size_t offset = 0;
+
+    while (node != nil) {
+        const Node& current = m_Nodes[node];
+        size_t leftLineFeeds = lineFeeds(current.left);
+
+        if (n < leftLineFeeds) {
+            node = current.left;
+            continue;
+        }
+
+        n -= leftLineFeeds;
+        offset += length(current.left);
+
+        // The newline is inside this piece.
+        // Look it up in the buffer's index, relative to the start of the piece.
+        if (n < current.piece.lineFeeds) {
+            const auto& bufferLineFeeds = buffer(current.piece.buffer).lineFeeds;
+            auto first = std::lower_bound(bufferLineFeeds.begin(), bufferLineFeeds.end(), current.piece.start);
+
+            return offset + *(first + n) - current.piece.start;
+        }
+
+        n -= current.piece.lineFeeds;
+        offset += current.piece.length;
+        node = current.right;
+    }
+
+    return getSize();
+}
+
+size_t PieceTable::lineFeedsBefore(size_t offset) const noexcept {
+    NodeId node = m_Root;
+    size_t count = 0;
+
+    while (node != nil) {
+        const Node& current = m_Nodes[node];
+        size_t leftLength = length(current.left);
+
+        if (offset <= leftLength) {
+            node = current.left;
+            continue;
+        }
+
+        offset -= leftLength;
+        count += lineFeeds(current.left);
+
+        if (offset <= current.piece.length)
+            return count + countLineFeeds(current.piece.buffer, current.piece.start, current.piece.start + offset);
+
+        offset -= current.piece.length;
+        count += current.piece.lineFeeds;
+        node = current.right;
+    }
+
+    return count;
+}
+
+void PieceTable::lineFeedOffsets(NodeId node, size_t nodeOffset, size_t nodeLineFeeds,
+                                 const size_t* first, const size_t* last, size_t* out) const noexcept {
+    if (first == last)
+        return;
+
+    // Past the last newline, like lineFeedOffset().
+    if (node == nil) {
+        std::fill(out, out + (last - first), getSize());
+        return;
+    }
+
+    const Node& current = m_Nodes[node];
+    size_t pieceOffset = nodeOffset + length(current.left);
+    size_t pieceLineFeeds = nodeLineFeeds + lineFeeds(current.left);
+
+    // The newlines before this piece are in the left subtree, the ones after it in the right one.
+    const size_t* inPiece = std::lower_bound(first, last, pieceLineFeeds);
+    const size_t* afterPiece = std::lower_bound(inPiece, last, pieceLineFeeds + current.piece.lineFeeds);
+
+    lineFeedOffsets(current.left, nodeOffset, nodeLineFeeds, first, inPiece, out);
+
+    if (inPiece != afterPiece) {
+        const auto& bufferLineFeeds = buffer(current.piece.buffer).lineFeeds;
+        auto firstInPiece = std::lower_bound(bufferLineFeeds.begin(), bufferLineFeeds.end(), current.piece.start);
+
+        for (const size_t* n = inPiece; n != afterPiece; n++)
+            out[n - first] = pieceOffset + *(firstInPiece + (*n - pieceLineFeeds)) - current.piece.start;
+    }
+
+    lineFeedOffsets(current.right, pieceOffset + current.piece.length, pieceLineFeeds + current.piece.lineFeeds,
+                    afterPiece, last, out + (afterPiece - first));
+}
+
+void PieceTable::lineFeedsBefore(NodeId node, size_t nodeOffset, size_t nodeLineFeeds,
+                                 const size_t* first, const size_t* last, size_t* out) const noexcept {
+    if (first == last)
+        return;
+
+    if (node == nil) {
+        std::fill(out, out + (last - first), nodeLineFeeds);
+        return;
+    }
+
+    const Node& current = m_Nodes[node];
+    size_t pieceOffset = nodeOffset + length(current.left);
+    size_t pieceLineFeeds = nodeLineFeeds + lineFeeds(current.left);
+
+    // Like lineFeedsBefore(), an offset right at the start of a piece is looked up before it.
+    const size_t* inPiece = std::upper_bound(first, last, pieceOffset);
+    const size_t* afterPiece = std::upper_bound(inPiece, last, pieceOffset + current.piece.length);
+
+    lineFeedsBefore(current.left, nodeOffset, nodeLineFeeds, first, inPiece, out);
+
+    for (const size_t* offset = inPiece; offset != afterPiece; offset++) {
+        out[offset - first] = pieceLineFeeds + countLineFeeds(current.piece.buffer, current.piece.start,
+                                                              current.piece.start + (*offset - pieceOffset));
+    }
+
+    lineFeedsBefore(current.right, pieceOffset + current.piece.length, pieceLineFeeds + current.piece.lineFeeds,
+                    afterPiece, last, out + (afterPiece - first));
+}
+
+size_t PieceTable::lineStart(size_t row) const noexcept {
+    // A line starts right after the newline that ends the previous one.
+    return (row == 0) ? 0 : lineFeedOffset(row - 1) + 1;
+}
+
+size_t PieceTable::lineEnd(size_t row) const noexcept {
+    // The last line has no newline, it ends with the document.
+    return (row < lineFeeds(m_Root)) ? lineFeedOffset(row) : getSize();
+}
+
+std::pair<size_t, size_t> PieceTable::lineBounds(size_t row) const noexcept {
+    if (row == 0)
+        return { 0, lineEnd(0) };
+
+    // Like lineFeedOffset(), for the newline before the line.
+    size_t n = row - 1;
+    NodeId node = m_Root;
+    size_t offset = 0;
+
+    while (node != nil) {
+        const Node& current = m_Nodes[node];
+        size_t leftLineFeeds = lineFeeds(current.left);
+
+        if (n < leftLineFeeds) {
+            node = current.left;
+            continue;
+        }
+
+        n -= leftLineFeeds;
+        offset += length(current.left);
+
+        if (n < current.piece.lineFeeds) {
+            const auto& bufferLineFeeds = buffer(current.piece.buffer).lineFeeds;
+            auto lineFeed = std::lower_bound(bufferLineFeeds.begin(), bufferLineFeeds.end(), current.piece.start) + n;
+            size_t begin = offset + *lineFeed - current.piece.start + 1;
+
+            // Unless the line is the last one that starts in this piece, the piece has its newline as well.
+            if (n + 1 < current.piece.lineFeeds)
+                return { begin, offset + *(lineFeed + 1) - current.piece.start };
+
+            return { begin, lineEnd(row) };
+        }
+
+        n -= current.piece.lineFeeds;
+        offset += current.piece.length;
+        node = current.right;
+    }
+
+    return { lineStart(row), lineEnd(row) };
+}
+
+std::optional<std::string_view> PieceTable::contiguous(size_t begin, size_t end) const noexcept {
+    if (begin == end)
+        return std::string_view();
+
+    NodeId node = m_Root;
+
+    while (node != nil) {
+        const Node& current = m_Nodes[node];
+        size_t leftLength = length(current.left);
+
+        if (begin < leftLength) {
+            node = current.left;
+            continue;
+        }
+
+        begin -= leftLength; end -= leftLength;
+
+        if (begin < current.piece.length) {
+            if (end > current.piece.length)
+                return std::nullopt;
+
+            return buffer(current.piece.buffer).text.substr(current.piece.start + begin, end - begin);
+        }
+
+        begin -= current.piece.length; end -= current.piece.length;
+        node = current.right;
+    }
+
+    return std::nullopt;
+}
+
+void PieceTable::read(size_t begin, size_t end, std::string& out) const {
+    out.reserve(out.size() + (end - begin));
+    read(m_Root, 0, begin, end, out);
+}
+
+void PieceTable::read(NodeId node, size_t nodeOffset, size_t begin, size_t end, std::string& out) const {
+    if (node == nil)
+        return;
+
+    const Node& current = m_Nodes[node];
+
+    // Skip any subtree that doesn't overlap [begin, end).
+    if (nodeOffset >= end || nodeOffset + current.subtreeLength <= begin)
+        return;
+
+    size_t pieceOffset = nodeOffset + length(current.left);
+    read(current.left, nodeOffset, begin, end, out);
+
+    size_t from = std::max(begin, pieceOffset);
+    size_t to = std::min(end, pieceOffset + current.piece.length);
+    if (from < to)
+        out.append(buffer(current.piece.buffer).text, current.piece.start + (from - pieceOffset), to - from);
+
+    read(current.right, pieceOffset + current.piece.length, begin, end, out);
+}
+
+void PieceTable::collect(NodeId node, size_t nodeOffset, size_t begin, size_t end, std::vector<Piece>& out) const {
+    if (node == nil)
+        return;
+
+    const Node& current = m_Nodes[node];
+
+    if (nodeOffset >= end || nodeOffset + current.subtreeLength <= begin)
+        return;
+
+    size_t pieceOffset = nodeOffset + length(current.left);
+    collect(current.left, nodeOffset, begin, end, out);
+
+    size_t from = std::max(begin, pieceOffset);
+    size_t to = std::min(end, pieceOffset + current.piece.length);
+    if (from < to)
+        out.push_back(slice(current.piece, from - pieceOffset, to - pieceOffset));
+
+    collect(current.right, pieceOffset + current.piece.length, begin, end, out);
+}
+
+PieceTable::Piece PieceTable::slice(const Piece& piece, size_t begin, size_t end) const noexcept {
+    if (begin == 0 && end == piece.length)
+        return piece;
+
+    size_t start = piece.start + begin;
+    return { piece.buffer, start, end - begin, countLineFeeds(piece.buffer, start, piece.start + end) };
+}
+
+PieceTable::NodeId PieceTable::append(NodeId tree, const Piece& piece) {
+    NodeId last = tree;
+    while (last != nil && m_Nodes[last].right != nil)
+        last = m_Nodes[last].right;
+
+    if (last == nil || m_Nodes[last].piece.buffer != piece.buffer ||
+        m_Nodes[last].piece.start + m_Nodes[last].piece.length != piece.start)
+        return merge(tree, createNode(piece));
+
+    // Every node on the right spine contains the last piece in its subtree.
+    for (NodeId node = tree; node != nil; node = m_Nodes[node].right) {
+        m_Nodes[node].subtreeLength += piece.length;
+        m_Nodes[node].subtreeLineFeeds += piece.lineFeeds;
+    }
+
+    m_Nodes[last].piece.length += piece.length;
+    m_Nodes[last].piece.lineFeeds += piece.lineFeeds;
+    return tree;
+}
+
+PieceTable::NodeId PieceTable::createNode(const Piece& piece) {
+    Node node = { piece, nextPriority(), nil, nil, piece.length, piece.lineFeeds };
+
+    if (!m_FreeNodes.empty()) {
+        NodeId id = m_FreeNodes.back();
+        m_FreeNodes.pop_back();
+        m_Nodes[id] = node;
+        return id;
+    }
+
+    m_Nodes.push_back(node);
+    return static_cast<NodeId>(m_Nodes.size() - 1);
+}
+
+void PieceTable::destroyTree(NodeId node) noexcept {
+    if (node == nil)
+        return;
+
+    // Iterate instead of recursing, the removed tree can be arbitrarily large.
+    size_t first = m_FreeNodes.size();
+    m_FreeNodes.push_back(node);
+
+    for (size_t i = first; i < m_FreeNodes.size(); i++) {
+        const Node& current = m_Nodes[m_FreeNodes[i]];
+        if (current.left != nil) m_FreeNodes.push_back(current.left);
+        if (current.right != nil) m_FreeNodes.push_back(current.right);
+    }
+}
+
+void PieceTable::pull(NodeId node) noexcept {
+    Node& current = m_Nodes[node];
+    current.subtreeLength = length(current.left) + current.piece.length + length(current.right);
+    current.subtreeLineFeeds = lineFeeds(current.left) + current.piece.lineFeeds + lineFeeds(current.right);
+}
+
+size_t PieceTable::length(NodeId node) const noexcept {
+    return (node == nil) ? 0 : m_Nodes[node].subtreeLength;
+}
+
+size_t PieceTable::lineFeeds(NodeId node) const noexcept {
+    return (node == nil) ? 0 : m_Nodes[node].subtreeLineFeeds;
+}
+
+PieceTable::NodeId PieceTable::merge(NodeId a, NodeId b) noexcept {
+    if (a == nil) return b;
+    if (b == nil) return a;
+
+    if (m_Nodes[a].priority > m_Nodes[b].priority) {
+        m_Nodes[a].right = merge(m_Nodes[a].right, b);
+        pull(a);
+        return a;
+    }
+
+    m_Nodes[b].left = merge(a, m_Nodes[b].left);
+    pull(b);
+    return b;
+}
+
+void PieceTable::split(NodeId node, size_t offset, NodeId& left, NodeId& right) {
+    if (node == nil) {
+        left = right = nil;
+        return;
+    }
+
+    // Note: createNode() may grow m_Nodes, so never hold a reference
+    // to a node across a call that can end up creating one.
+    size_t leftLength = length(m_Nodes[node].left);
+    size_t pieceLength = m_Nodes[node].piece.length;
+
+    if (offset <= leftLength) {
+        NodeId a, b;
+        split(m_Nodes[node].left, offset, a, b);
+        m_Nodes[node].left = b;
+        pull(node);
+        left = a; right = node;
+    }
+    else if (offset >= leftLength + pieceLength) {
+        NodeId a, b;
+        split(m_Nodes[node].right, offset - leftLength - pieceLength, a, b);
+        m_Nodes[node].right = a;
+        pull(node);
+        left = node; right = b;
+    }
+    else {
+        // The offset is inside this node's piece. Keep the head here and
+        // move the tail into a new node in front of the right subtree.
+        Piece head = m_Nodes[node].piece;
+        size_t headLength = offset - leftLength;
+        size_t headLineFeeds = countLineFeeds(head.buffer, head.start, head.start + headLength);
+
+        Piece tail = { head.buffer, head.start + headLength, head.length - headLength, head.lineFeeds - headLineFeeds };
+        head.length = headLength; head.lineFeeds = headLineFeeds;
+
+        NodeId tailNode = createNode(tail);
+        NodeId rightSubtree = m_Nodes[node].right;
+
+        m_Nodes[node].piece = head;
+        m_Nodes[node].right = nil;
+        pull(node);
+
+        left = node;
+        right = merge(tailNode, rightSubtree);
+    }
+}
+
+uint32_t PieceTable::nextPriority() noexcept {
+    // xorshift32, good enough to keep the treap balanced.
+    m_Seed ^= m_Seed << 13;
+    m_Seed ^= m_Seed >> 17;
+    m_Seed ^= m_Seed << 5;
+    return m_Seed;
+}
@@ -0,0 +1,544 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "LineIndexer.h"
+#include "MappedFile.h"
+#include "Document.h"
+
+/**
+ * @brief   Document storage engine based on a piece table.
+ *
+ *          The text is never edited in place. The original contents and
+ *          everything that is inserted later live in two append-only buffers,
+ *          and the document itself is a sequence of pieces that point into them.
+ *
+ *          The pieces are kept in a treap (a randomized balanced binary tree),
+ *          where every node also stores the byte length and the newline count
+ *          of its subtree. This makes inserting, erasing and looking up rows
+ *          O(log n), regardless of how large the document is.
+ *
+ *          A file can also be opened directly, in which case its memory mapping
+ *          is the original buffer. Its lines are indexed by a LineIndexer in the
+ *          background: only the lines that have been indexed so far are part of
+ *          the document, and edits only ever touch the 'Added' buffer, never the
+ *          mapping itself.
+ */
+class PieceTable : public Document {
+public:
+    enum class BufferKind : uint8_t { Original, Added };
+
+    /**
+     * @brief   A span of one of the buffers.
+     *
+     * @note    The buffers are append-only, so a piece stays valid until the
+     *          document is replaced by load() or open(), even after it has been
+     *          erased from the document. This is what lets the undo history
+     *          hold on to removed text without copying it.
+     */
+    struct Piece {
+        BufferKind buffer;
+        size_t start, length;
+        size_t lineFeeds; // The amount of newlines in [start, start + length).
+    };
+
+    /**
+     * @brief   Replaces the bytes in [begin, end) with text.
+     */
+    struct Replacement {
+        size_t begin, end;
+        std::string text;
+    };
+
+    /**
+     * @brief   Gets told about every edit, in terms of plain inserts and erases.
+     *
+     * @note    Called right after the edit, on the thread that made it. Lines appended
+     *          by indexing the original buffer aren't edits, and neither are load() and open().
+     */
+    class Listener {
+    public:
+        virtual ~Listener() = default;
+
+        /**
+         * @brief   A piece was inserted at @p offset.
+         */
+        virtual void onInserted(size_t offset, const Piece& piece) = 0;
+
+        /**
+         * @brief   The bytes in [begin, end) were erased.
+         */
+        virtual void onErased(size_t begin, size_t end) = 0;
+    };
+
+    /**
+     * @brief           Creates a piece table.
+     *
+     * @param original  The initial contents of the document.
+     */
+    explicit PieceTable(std::string original = "");
+
+    // The original buffer may point into the table itself.
+    PieceTable(const PieceTable&) = delete;
+    PieceTable& operator=(const PieceTable&) = delete;
+
+    /**
+     * @brief           Replaces the document with a string. All of it is indexed right away.
+     *
+     * @param original  The new contents of the document.
+     */
+    void load(std::string original);
+
+    /**
+     * @brief       Replaces the document with the contents of a file.
+     *
+     * @note        The file is mapped, not copied. Only its first chunk is
+     *              indexed right away, the rest is indexed in the background.
+     *              See updateIndex().
+     * @note        The document is left untouched if the file cannot be opened.
+     *
+     * @param path  The path of the file.
+     *
+     * @throws      std::runtime_error if the file cannot be opened or mapped.
+     */
+    void open(const std::filesystem::path& path);
+
+    /**
+     * @brief       Appends every line the background indexer has found
+     *              since the last call to the document. Never blocks.
+     *
+     * @returns     True if any new lines became part of the document.
+     */
+    bool updateIndex();
+
+    /**
+     * @brief       Blocks until the whole original buffer is part of the document.
+     */
+    void waitForIndex();
+
+    /**
+     * @brief   Checks if the whole original buffer is part of the document.
+     */
+    bool isFullyIndexed() const noexcept;
+
+    /**
+     * @brief   Checks if the original buffer is valid UTF-8, as far as it has been indexed.
+     *
+     * @note    It's validated along with scanning it for newlines. Text added by edits isn't checked.
+     */
+    bool isValidUtf8() const noexcept;
+
+    size_t getLineCount() const noexcept override;
+
+    size_t getLineLength(size_t row) const noexcept override;
+
+    /**
+     * @note        Lines that lie within a single piece point straight into its buffer.
+     *              Lines made of several pieces are joined, and the last few joined rows
+     *              are kept until an edit touches them. Lines appended by indexing don't.
+     */
+    std::optional<std::string_view> line(size_t row) const override;
+
+    /**
+     * @note        Only joins the part itself if it's made of several pieces, and the line isn't joined already.
+     */
+    std::optional<std::string_view> linePart(size_t row, size_t begin, size_t end) const override;
+
+    uint64_t getVersion() const noexcept override;
+
+    /**
+     * @brief   Get the total size of the document in bytes, including newlines.
+     */
+    size_t getSize() const noexcept;
+
+    /**
+     * @brief           Get the byte at a specific offset.
+     *
+     * @note            It is required that offset < getSize().
+     */
+    char getChar(size_t offset) const noexcept;
+
+    /**
+     * @brief       Converts a location to a byte offset.
+     *
+     * @note        Out-of-range rows and columns are clamped.
+     */
+    size_t toOffset(CursorLocation pos) const noexcept;
+
+    /**
+     * @brief       Converts a byte offset to a location.
+     *
+     * @note        Offsets past the end are clamped to the end of the document.
+     */
+    CursorLocation toLocation(size_t offset) const noexcept;
+
+    /**
+     * @brief       Converts many locations to byte offsets at once, like toOffset().
+     *
+     * @note        They're converted in order, in a single walk of the tree, rather than a walk each.
+     *              Locations that are sorted already, like those of carets, aren't sorted again.
+     *
+     * @returns     The offset of every location, in the same order.
+     */
+    std::vector<size_t> toOffsets(const std::vector<CursorLocation>& locations) const;
+
+    /**
+     * @brief       Likewise, converts many byte offsets to locations at once, like toLocation().
+     */
+    std::vector<CursorLocation> toLocations(const std::vector<size_t>& offsets) const;
+
+    /**
+     * @brief       Inserts a string at a location.
+     *
+     * @param pos   The location to insert at.
+     * @param str   The string to insert. May contain newlines.
+     *
+     * @returns     The location right after the inserted text.
+     */
+    CursorLocation insert(CursorLocation pos, std::string_view str);
+
+    /**
+     * @brief       Removes all characters in a range.
+     *
+     * @note        It is required that begin <= end.
+     */
+    void erase(CursorLocation begin, CursorLocation end);
+
+    /**
+     * @brief       Removes all bytes in [begin, end).
+     *
+     * @note        Offsets past the end are clamped.
+     */
+    void erase(size_t begin, size_t end);
+
+    /**
+     * @brief               Applies many replacements as a single edit.
+     *
+     * @note                All of the new text is appended to the 'Added' buffer at once. The part of
+     *                      the tree between the first and the last replacement is rebuilt once, unless
+     *                      it's made of many more pieces than there are replacements, in which case
+     *                      each one is spliced in on its own, see spliceEach().
+     * @note                The unchanged text in between is kept as pieces, not copied.
+     *
+     * @param replacements  Sorted by offset and not overlapping, in terms of the document before the edit.
+     */
+    void replace(const std::vector<Replacement>& replacements);
+
+    /**
+     * @brief           Replaces the bytes in every range with the same text, as a single edit.
+     *
+     * @note            The text is appended to the 'Added' buffer only once, and every range gets a piece
+     *                  of its own that points at it. So typing at many carets grows a single piece at each
+     *                  of them, rather than adding a piece per caret per keystroke. Otherwise, see replace().
+     *
+     * @param ranges    The [begin, end) of every range. Sorted and not overlapping, in terms of the document before the edit.
+     * @param erased    If given, receives the pieces every range was made of, in the same order,
+     *                  as they're taken out of the tree. See UndoJournal::recordErase().
+     *
+     * @returns         The piece put in place of every range. Its length is 0 if @p text is empty.
+     */
+    Piece replace(const std::vector<std::pair<size_t, size_t>>& ranges, std::string_view text,
+                  std::vector<std::vector<Piece>>* erased = nullptr);
+
+    /**
+     * @brief       Inserts previously obtained pieces at an offset, without copying any text.
+     *
+     * @param offset    The offset to insert at.
+     * @param pieces    The pieces to insert, see getPieces().
+     */
+    void insert(size_t offset, const std::vector<Piece>& pieces);
+
+    /**
+     * @brief       Get the pieces that make up the bytes in [begin, end).
+     *              Pieces that straddle either end are cut to fit.
+     */
+    std::vector<Piece> getPieces(size_t begin, size_t end) const;
+
+    /**
+     * @brief       Get the text a piece points to.
+     *
+     * @note        Text in the 'Added' buffer moves whenever that buffer grows,
+     *              so the view is only valid until the next insert.
+     */
+    std::string_view view(const Piece& piece) const noexcept;
+
+    /**
+     * @brief       Shares the 'Added' buffer, e.g. with a worker that searches the document.
+     *
+     * @note        The buffer is append-only, so the bytes it holds right now never change. While it's
+     *              shared, it's moved to new storage when it has to grow, instead of being reallocated,
+     *              so the shared one stays valid and can be read from another thread, without a copy.
+     */
+    std::shared_ptr<const std::string> shareAdded() const noexcept;
+
+    /**
+     * @brief       Get the text in a range, joined with '\n'.
+     *
+     * @note        It is required that begin <= end.
+     */
+    std::string getText(CursorLocation begin, CursorLocation end) const;
+
+    /**
+     * @brief       Get the bytes in [begin, end).
+     *
+     * @note        Offsets past the end are clamped.
+     */
+    std::string getText(size_t begin, size_t end) const;
+
+    /**
+     * @brief           Sets who gets told about edits, replacing the previous listener.
+     *
+     * @param listener  The listener, or nullptr for none. Must outlive the PieceTable, or be unset first.
+     */
+    void setListener(Listener* listener) noexcept;
+
+private:
+    using NodeId = int32_t;
+    static constexpr NodeId nil = -1;
+
+    // replace() splices the replacements in one by one once the document is made of this
+    // many times as many pieces as there are replacements, see spliceEach().
+    static constexpr size_t spliceRatio = 8;
+
+    // The amount of bytes indexed right away when opening a file.
+    static constexpr size_t indexChunkSize = size_t(1) << 20;
+
+    /**
+     * @brief   An append-only buffer, with the offsets of every newline in it.
+     *
+     * @note    The text points into m_OriginalStorage, m_Mapping or *m_AddedStorage.
+     */
+    struct Buffer {
+        std::string_view text;
+        std::vector<size_t> lineFeeds;
+    };
+
+    struct Node {
+        Piece piece;
+        uint32_t priority;
+        NodeId left, right;
+        size_t subtreeLength, subtreeLineFeeds;
+    };
+
+    const Buffer& buffer(BufferKind kind) const noexcept;
+
+    /**
+     * @brief   Appends text to the 'Added' buffer, see shareAdded().
+     *
+     * @param reserve   The amount of bytes to make room for, if more is appended right after.
+     */
+    void appendAdded(std::string_view text, size_t reserve = 0);
+
+    /**
+     * @brief   The rows an edit touches, as they were before it.
+     */
+    struct EditedRows {
+        size_t first, last;
+        size_t lineFeeds; // The amount of newlines in the document.
+    };
+
+    /**
+     * @brief   Gets the rows an edit of the bytes in [begin, end) touches. Called right before the edit.
+     */
+    EditedRows beginEdit(size_t begin, size_t end) const noexcept;
+
+    /**
+     * @brief   Forgets the joined lines of the rows an edit touched, and moves the ones
+     *          below them along with the lines added or removed. Called right after the edit.
+     */
+    void endEdit(const EditedRows& rows) noexcept;
+
+    /**
+     * @brief   A replacement whose new text has been appended to the 'Added' buffer already.
+     */
+    struct Splice {
+        size_t begin, end;
+        Piece piece; // Its length is 0 if nothing is inserted.
+    };
+
+    /**
+     * @brief               Puts the pieces of a replace() in place of the old text, as a single edit.
+     *                      See replace() for how, and for @p erased.
+     *
+     * @param splices       Sorted and not overlapping, clamped to the document.
+     */
+    void splice(const std::vector<Splice>& splices, std::vector<std::vector<Piece>>* erased);
+
+    /**
+     * @brief               Puts the pieces in place of the old text, by rebuilding the
+     *                      tree between the first and the last splice once.
+     */
+    void rebuildSpan(const std::vector<Splice>& splices, std::vector<std::vector<Piece>>* erased);
+
+    /**
+     * @brief               Likewise, but splices them into the tree one by one,
+     *                      in O(log n) each, without touching the pieces in between.
+     */
+    void spliceEach(const std::vector<Splice>& splices, std::vector<std::vector<Piece>>* erased);
+
+    /**
+     * @brief   Clears the document, the buffers and the tree.
+     */
+    void reset() noexcept;
+
+    /**
+     * @brief   Scans the next chunk of the original buffer for newlines
+     *          on the calling thread, then calls appendScanned().
+     *
+     * @returns True if any new lines became part of the document.
+     */
+    bool indexChunk();
+
+    /**
+     * @brief   Appends every complete line that has been scanned, but isn't part of the
+     *          document yet. Once the whole buffer has been scanned, this includes the last line.
+     *
+     * @returns True if any new lines became part of the document.
+     */
+    bool appendScanned();
+
+    /**
+     * @brief   Get the offset past the last character of the last line.
+     *
+     * @note    While lazily indexing, the document ends in the newline of its
+     *          last known line, which isn't part of any line itself.
+     */
+    size_t lastOffset() const noexcept;
+
+    /**
+     * @brief   Counts the newlines of a buffer in [begin, end).
+     */
+    size_t countLineFeeds(BufferKind kind, size_t begin, size_t end) const noexcept;
+
+    /**
+     * @brief   Get the document offset of the n-th (0-based) newline.
+     */
+    size_t lineFeedOffset(size_t n) const noexcept;
+
+    /**
+     * @brief   Get the amount of newlines in [0, offset).
+     */
+    size_t lineFeedsBefore(size_t offset) const noexcept;
+
+    /**
+     * @brief               Get the document offset of the n-th newline, for every n in the sorted [first, last),
+     *                      in a single walk of @p node.
+     *
+     * @param nodeOffset    The document offset @p node starts at.
+     * @param nodeLineFeeds The amount of newlines before @p node.
+     * @param out           Receives the offset of every newline, in the same order.
+     */
+    void lineFeedOffsets(NodeId node, size_t nodeOffset, size_t nodeLineFeeds,
+                         const size_t* first, const size_t* last, size_t* out) const noexcept;
+
+    /**
+     * @brief               Likewise, get the amount of newlines before every offset in the sorted [first, last).
+     */
+    void lineFeedsBefore(NodeId node, size_t nodeOffset, size_t nodeLineFeeds,
+                         const size_t* first, const size_t* last, size_t* out) const noexcept;
+
+    size_t lineStart(size_t row) const noexcept;
+    size_t lineEnd(size_t row) const noexcept;
+
+    /**
+     * @brief   Get the offsets of the start and the end of a line.
+     *
+     * @note    Both ends of a line are usually in the same piece, in which case they're found in a single walk.
+     */
+    std::pair<size_t, size_t> lineBounds(size_t row) const noexcept;
+
+    /**
+     * @brief   Get a view of the document bytes in [begin, end),
+     *          if they all lie within a single piece.
+     */
+    std::optional<std::string_view> contiguous(size_t begin, size_t end) const noexcept;
+
+    /**
+     * @brief   Appends the document bytes in [begin, end) to @p out.
+     */
+    void read(size_t begin, size_t end, std::string& out) const;
+    void read(NodeId node, size_t nodeOffset, size_t begin, size_t end, std::string& out) const;
+
+    /**
+     * @brief   Appends the pieces in [begin, end) to @p out.
+     */
+    void collect(NodeId node, size_t nodeOffset, size_t begin, size_t end, std::vector<Piece>& out) const;
+
+    /**
+     * @brief   Get the part of a piece in [begin, end), relative to the start of the piece.
+     */
+    Piece slice(const Piece& piece, size_t begin, size_t end) const noexcept;
+
+    /**
+     * @brief   Appends a piece to the end of a tree. If the piece directly
+     *          continues the last one, that piece is grown instead.
+     *
+     * @returns The new root of the tree.
+     */
+    NodeId append(NodeId tree, const Piece& piece);
+
+    NodeId createNode(const Piece& piece);
+    void destroyTree(NodeId node) noexcept;
+    void pull(NodeId node) noexcept;
+
+    size_t length(NodeId node) const noexcept;
+    size_t lineFeeds(NodeId node) const noexcept;
+
+    /**
+     * @brief   Merges two trees, where every piece of @p a comes before every piece of @p b.
+     */
+    NodeId merge(NodeId a, NodeId b) noexcept;
+
+    /**
+     * @brief   Splits a tree into the first @p offset bytes and the rest.
+     *          A piece that straddles @p offset is cut in two.
+     */
+    void split(NodeId node, size_t offset, NodeId& left, NodeId& right);
+
+    uint32_t nextPriority() noexcept;
+
+    Buffer m_Original, m_Added;
+    std::string m_OriginalStorage;
+    std::shared_ptr<std::string> m_AddedStorage; // Shared by shareAdded().
+    std::unique_ptr<MappedFile> m_Mapping;
+    std::unique_ptr<LineIndexer> m_Indexer; // Declared after m_Mapping, so it stops before the mapping goes away.
+
+    // How far the original buffer has been scanned for newlines,
+    // and how much of it has been appended to the document.
+    size_t m_ScannedEnd, m_IndexedEnd;
+    bool m_ValidUtf8; // Whether the original buffer is valid UTF-8, up to m_ScannedEnd.
+
+    // Incremented on every change to the document.
+    uint64_t m_Version;
+
+    Listener* m_Listener;
+
+    /**
+     * @brief   A line that spans multiple pieces, joined by line().
+     */
+    struct JoinedLine {
+        size_t row = CursorLocation::invalidIndex;
+        std::string text;
+        uint64_t lastUsed = 0;
+    };
+
+    // The amount of joined lines kept at a time, so that a few callers reading different rows don't rejoin each other's.
+    static constexpr size_t maxJoinedLines = 4;
+
+    // The least recently used one is reused for the next row.
+    mutable std::array<JoinedLine, maxJoinedLines> m_Joined;
+    mutable uint64_t m_JoinedUses;
+    mutable std::string m_PartScratch; // Parts of lines that span multiple pieces are joined here by linePart().
+
+    std::vector<Node> m_Nodes;
+    std::vector<NodeId> m_FreeNodes;
+    NodeId m_Root;
+    uint32_t m_Seed;
+};
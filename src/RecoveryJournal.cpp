@@ -0,0 +1,674 @@
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <optional>
+#include <sstream>
+
+#include "RecoveryJournal.h"
+
+#ifdef _WIN32
+    #include <io.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+namespace {
+    // The first bytes of every journal.
+    constexpr char magic[8] = { 'V', 'S', 'N', 'J', 'R', 'N', 'L', '1' };
+
+    // A record is its kind, the buffer of its piece, three numbers and the size of its added text,
+    // followed by the added text and a checksum of all of it.
+    constexpr size_t recordHeaderSize = 2 + 4 * sizeof(uint64_t);
+
+    // Paths longer than this are taken for a broken header.
+    constexpr uint64_t maxPathSize = 1 << 16;
+
+    // FNV-1a, to tell a record that was only partly written from an intact one.
+    uint32_t checksum(std::string_view bytes, uint32_t hash = 2166136261u) noexcept {
+        for (char c : bytes) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 16777619u;
+        }
+
+        return hash;
+    }
+
+    // The journal is only ever read back on the same machine, so numbers are written as they are.
+    template <typename T>
+    void put(std::string& out, T value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template <typename T>
+    bool get(std::string_view& in, T& value) noexcept {
+        if (in.size() < sizeof(value))
+            return false;
+
+        std::memcpy(&value, in.data(), sizeof(value));
+        in.remove_prefix(sizeof(value));
+        return true;
+    }
+
+    bool readExactly(std::FILE* file, std::string& out, size_t size) {
+        out.resize(size);
+        return size == 0 || std::fread(out.data(), 1, size, file) == size;
+    }
+
+    bool writeRecord(std::FILE* file, uint8_t kind, uint8_t buffer, uint64_t a, uint64_t b, uint64_t c,
+                     std::string_view added) {
+        std::string header;
+        header.reserve(recordHeaderSize);
+        put(header, kind); put(header, buffer);
+        put(header, a); put(header, b); put(header, c);
+        put(header, static_cast<uint64_t>(added.size()));
+
+        uint32_t sum = checksum(added, checksum(header));
+
+        return std::fwrite(header.data(), 1, header.size(), file) == header.size() &&
+               std::fwrite(added.data(), 1, added.size(), file) == added.size() &&
+               std::fwrite(&sum, sizeof(sum), 1, file) == 1;
+    }
+
+    // Flushes a file all the way to the disk, not just to the OS.
+    bool syncFile(std::FILE* file) noexcept {
+        if (std::fflush(file) != 0)
+            return false;
+
+#ifdef _WIN32
+        return _commit(_fileno(file)) == 0;
+#else
+        return fsync(fileno(file)) == 0;
+#endif
+    }
+
+    // Makes a rename in a directory durable. Windows has no equivalent, and doesn't need it.
+    void syncDirectory(const std::filesystem::path& directory) noexcept {
+#ifndef _WIN32
+        int fd = ::open(directory.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            fsync(fd);
+            ::close(fd);
+        }
+#else
+        (void)directory;
+#endif
+    }
+
+    int64_t getWriteTime(const std::filesystem::path& path) noexcept {
+        std::error_code error;
+        auto time = std::filesystem::last_write_time(path, error);
+        return error ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
+    }
+
+    std::filesystem::path toAbsolute(const std::filesystem::path& path) {
+        std::error_code error;
+        auto absolute = std::filesystem::absolute(path, error);
+        return (error ? path : absolute).lexically_normal();
+    }
+
+    std::FILE* openFile(const std::filesystem::path& path, const char* mode) {
+        return std::fopen(path.string().c_str(), mode);
+    }
+}
+
+RecoveryJournal::RecoveryJournal(std::filesystem::path directory, std::chrono::seconds autosaveInterval) :
+                m_Directory(toAbsolute(directory)), m_AutosaveInterval(autosaveInterval),
+                m_Document(nullptr), m_Path(), m_Key(), m_JournalPath(), m_SourcePath(), m_Source(), m_SourceTime(0),
+                m_Forwarded(0), m_Edited(false), m_LastCheckpoint(), m_Pushed(0),
+                m_Mirror(), m_File(nullptr), m_Generation(0), m_NeedsCheckpoint(false), m_Failed(false), m_Popped(0),
+                m_Queue(), m_Stop(false), m_Idle(true), m_Mutex(), m_Wake(), m_Written(), m_FlushTarget(0), m_WrittenCount(0),
+                m_Writer() {}
+
+RecoveryJournal::~RecoveryJournal() {
+    close();
+}
+
+bool RecoveryJournal::open(const std::filesystem::path& path, PieceTable& document) {
+    // Map before closing, so that a failure leaves the current session as it was.
+    auto mapping = std::make_unique<MappedFile>(path);
+
+    close();
+
+    m_Path = toAbsolute(path).string();
+
+    // Named after the file as well, so that it's easy to tell which file a journal belongs to.
+    std::ostringstream key;
+    key << std::hex << std::setw(16) << std::setfill('0') << std::hash<std::string>{}(m_Path) << '-' << path.filename().string();
+    m_Key = key.str();
+    m_JournalPath = m_Directory / (m_Key + ".journal");
+
+    Header header;
+    std::unique_ptr<MappedFile> base;
+    bool recovered = false;
+
+    if (std::FILE* file = openFile(m_JournalPath, "rb")) {
+        if (readHeader(file, header))
+            recovered = replay(file, header, document, base);
+
+        std::fclose(file);
+    }
+
+    if (recovered) {
+        std::cerr << "[RECOVERY]: Recovered the unsaved edits to '" << m_Path << "'." << std::endl;
+        start(document, std::move(base), getBasePath(header), header.generation, true);
+        return true;
+    }
+
+    document.open(path);
+    start(document, std::move(mapping), m_Path, 0, false);
+    return false;
+}
+
+void RecoveryJournal::close() noexcept {
+    if (!m_Document)
+        return;
+
+    m_Document->setListener(nullptr);
+    m_Document = nullptr;
+    stop();
+
+    // The session ended cleanly, so there's nothing to recover.
+    std::error_code error;
+    std::filesystem::remove(m_JournalPath, error);
+    removeAutosaves({});
+
+    m_Source.reset();
+}
+
+void RecoveryJournal::update() {
+    if (!m_Document || !m_Edited || !m_Document->isFullyIndexed())
+        return;
+
+    if (std::chrono::steady_clock::now() - m_LastCheckpoint >= m_AutosaveInterval)
+        checkpoint();
+}
+
+bool RecoveryJournal::isEdited() const noexcept {
+    return m_Document && m_Edited;
+}
+
+void RecoveryJournal::checkpoint() {
+    if (!m_Document)
+        return;
+
+    Record record{ Record::Kind::Checkpoint };
+    record.pieces = m_Document->getPieces(0, m_Document->getSize());
+
+    size_t addedEnd = 0;
+    for (const auto& piece : record.pieces) {
+        if (piece.buffer == PieceTable::BufferKind::Added)
+            addedEnd = std::max(addedEnd, piece.start + piece.length);
+    }
+
+    forward(record, addedEnd);
+    push(std::move(record));
+
+    m_Edited = false;
+    m_LastCheckpoint = std::chrono::steady_clock::now();
+}
+
+void RecoveryJournal::flush() {
+    if (!m_Writer.joinable())
+        return;
+
+    std::unique_lock lock(m_Mutex);
+    m_FlushTarget = std::max(m_FlushTarget, m_Pushed);
+    m_Wake.notify_all();
+
+    m_Written.wait(lock, [&] { return m_WrittenCount >= m_FlushTarget || m_Stop; });
+}
+
+void RecoveryJournal::onInserted(size_t offset, const PieceTable::Piece& piece) {
+    Record record{ Record::Kind::Insert, offset };
+    record.piece = piece;
+
+    if (piece.buffer == PieceTable::BufferKind::Added)
+        forward(record, piece.start + piece.length);
+
+    push(std::move(record));
+    m_Edited = true;
+}
+
+void RecoveryJournal::onErased(size_t begin, size_t end) {
+    push({ Record::Kind::Erase, begin, end });
+    m_Edited = true;
+}
+
+bool RecoveryJournal::readHeader(std::FILE* file, Header& header) const {
+    std::string bytes;
+    if (!readExactly(file, bytes, sizeof(magic) + 6 * sizeof(uint64_t)) ||
+        std::memcmp(bytes.data(), magic, sizeof(magic)) != 0)
+        return false;
+
+    std::string_view in(bytes);
+    in.remove_prefix(sizeof(magic));
+
+    uint64_t pathSize = 0, sourcePathSize = 0;
+    get(in, header.generation); get(in, header.sourceSize); get(in, header.sourceTime);
+    get(in, header.baseSize); get(in, pathSize); get(in, sourcePathSize);
+
+    if (pathSize > maxPathSize || sourcePathSize > maxPathSize)
+        return false;
+
+    uint32_t sum = checksum(std::string_view(bytes).substr(sizeof(magic)));
+    uint32_t expected;
+
+    if (!readExactly(file, header.path, pathSize) || !readExactly(file, header.sourcePath, sourcePathSize) ||
+        std::fread(&expected, sizeof(expected), 1, file) != 1)
+        return false;
+
+    sum = checksum(header.sourcePath, checksum(header.path, sum));
+
+    // Another file whose path hashes the same is as good as no journal at all.
+    return sum == expected && header.path == m_Path;
+}
+
+bool RecoveryJournal::replay(std::FILE* file, const Header& header, PieceTable& document, std::unique_ptr<MappedFile>& base) {
+    // Read every intact record first, so that a journal without any edits doesn't need the file to be indexed.
+    std::vector<Record> records;
+    bool edited = false;
+
+    std::error_code error;
+    uint64_t remaining = std::filesystem::file_size(m_JournalPath, error);
+    if (error)
+        return false;
+
+    std::string bytes;
+    while (readExactly(file, bytes, recordHeaderSize)) {
+        std::string_view in(bytes);
+        uint8_t kind = 0, buffer = 0;
+        uint64_t a = 0, b = 0, c = 0, addedSize = 0;
+        get(in, kind); get(in, buffer); get(in, a); get(in, b); get(in, c); get(in, addedSize);
+
+        // The end of a record that was cut off may claim to be anything.
+        if (kind > static_cast<uint8_t>(Record::Kind::Erase) || buffer > 1 || addedSize > remaining)
+            break;
+
+        Record record{ static_cast<Record::Kind>(kind), a, b };
+        record.piece = { static_cast<PieceTable::BufferKind>(buffer), b, c, 0 };
+
+        uint32_t expected;
+        if (!readExactly(file, record.added, addedSize) || std::fread(&expected, sizeof(expected), 1, file) != 1 ||
+            checksum(record.added, checksum(bytes)) != expected)
+            break;
+
+        edited = edited || record.kind != Record::Kind::Append;
+        records.push_back(std::move(record));
+    }
+
+    if (header.generation == 0 && !edited)
+        return false;
+
+    // The source has to be as it was, or the pieces that point into it point to something else.
+    std::unique_ptr<MappedFile> source;
+    try {
+        source = std::make_unique<MappedFile>(header.sourcePath);
+    }
+    catch (const std::exception&) {}
+
+    if (!source || source->view().size() != header.sourceSize || getWriteTime(header.sourcePath) != header.sourceTime) {
+        if (header.generation == 0) {
+            std::cerr << "[RECOVERY]: '" << m_Path << "' changed since its unsaved edits were journaled, they can't be recovered." << std::endl;
+            return false;
+        }
+
+        // The autosave still has everything up to the last checkpoint.
+        source.reset();
+    }
+
+    std::filesystem::path basePath = getBasePath(header);
+    try {
+        base = std::make_unique<MappedFile>(basePath);
+        document.open(basePath);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "[RECOVERY]: " << e.what() << std::endl;
+        return false;
+    }
+
+    document.waitForIndex();
+    if (document.getSize() != header.baseSize) {
+        std::cerr << "[RECOVERY]: '" << basePath.string() << "' is incomplete, the unsaved edits to '" << m_Path << "' can't be recovered." << std::endl;
+        return false;
+    }
+
+    std::string mirror;
+    for (const auto& record : records) {
+        mirror.append(record.added);
+        size_t size = document.getSize();
+
+        if (record.kind == Record::Kind::Insert) {
+            std::string_view text;
+            if (record.piece.buffer == PieceTable::BufferKind::Added)
+                text = mirror;
+            else if (source)
+                text = source->view();
+
+            if (record.offset > size || record.piece.start > text.size() || record.piece.length > text.size() - record.piece.start) {
+                std::cerr << "[RECOVERY]: The journal of '" << m_Path << "' is damaged, only some of its edits were recovered." << std::endl;
+                break;
+            }
+
+            document.insert(document.toLocation(record.offset), text.substr(record.piece.start, record.piece.length));
+        }
+        else if (record.kind == Record::Kind::Erase) {
+            if (record.offset > record.end || record.end > size) {
+                std::cerr << "[RECOVERY]: The journal of '" << m_Path << "' is damaged, only some of its edits were recovered." << std::endl;
+                break;
+            }
+
+            document.erase(static_cast<size_t>(record.offset), static_cast<size_t>(record.end));
+        }
+    }
+
+    return true;
+}
+
+void RecoveryJournal::start(PieceTable& document, std::unique_ptr<MappedFile> source, const std::filesystem::path& sourcePath,
+                            uint64_t generation, bool recovered) {
+    m_Document = &document;
+    m_Source = std::move(source);
+    m_SourcePath = sourcePath;
+    m_SourceTime = getWriteTime(sourcePath);
+
+    m_Forwarded = 0;
+    m_Edited = false;
+    m_LastCheckpoint = std::chrono::steady_clock::now();
+    m_Pushed = 0;
+
+    m_Mirror.clear();
+    m_File = nullptr;
+    m_Generation = generation;
+    m_NeedsCheckpoint = recovered;
+    m_Failed = false;
+    m_Popped = 0;
+
+    m_Stop = false;
+    m_Idle = true;
+    m_FlushTarget = 0;
+    m_WrittenCount = 0;
+
+    document.setListener(this);
+
+    // The recovered edits only live in memory until they are written to an autosave.
+    if (recovered)
+        checkpoint();
+
+    m_Writer = std::thread(&RecoveryJournal::run, this);
+}
+
+void RecoveryJournal::stop() noexcept {
+    {
+        std::lock_guard lock(m_Mutex);
+        m_Stop = true;
+    }
+
+    m_Wake.notify_all();
+    m_Written.notify_all();
+
+    if (m_Writer.joinable())
+        m_Writer.join();
+
+    // Nothing consumes the queue anymore, so this thread can.
+    while (m_Queue.pop()) {}
+
+    if (m_File) {
+        std::fclose(m_File);
+        m_File = nullptr;
+    }
+}
+
+void RecoveryJournal::forward(Record& record, size_t end) {
+    if (end <= m_Forwarded)
+        return;
+
+    record.added.append(m_Document->view({ PieceTable::BufferKind::Added, m_Forwarded, end - m_Forwarded, 0 }));
+    m_Forwarded = end;
+}
+
+void RecoveryJournal::push(Record record) {
+    // Never waits. Only the first record after the writer drained the queue wakes it,
+    // the ones after that are picked up along with it.
+    m_Queue.push(std::move(record));
+    m_Pushed++;
+
+    if (m_Idle.exchange(false)) {
+        // Taking the lock makes sure the writer either sees the flag, or already waits for the notification.
+        { std::lock_guard lock(m_Mutex); }
+        m_Wake.notify_all();
+    }
+}
+
+void RecoveryJournal::run() {
+    while (true) {
+        {
+            std::unique_lock lock(m_Mutex);
+            const auto flushing = [&] { return m_Stop || m_FlushTarget > m_WrittenCount; };
+
+            // Sleep for as long as nothing is pushed, then let the rest of the batch gather.
+            m_Wake.wait(lock, [&] { return flushing() || !m_Idle; });
+            m_Wake.wait_for(lock, syncInterval, flushing);
+        }
+
+        if (m_Stop)
+            return;
+
+        // Set before draining, so that a record pushed while draining wakes the writer again.
+        m_Idle = true;
+        drain();
+
+        {
+            std::lock_guard lock(m_Mutex);
+            m_WrittenCount = m_Popped;
+        }
+
+        m_Written.notify_all();
+    }
+}
+
+void RecoveryJournal::drain() {
+    bool written = false;
+
+    while (!m_Stop) {
+        std::optional<Record> record = m_Queue.pop();
+        if (!record)
+            break;
+
+        m_Popped++;
+
+        if (record->kind == Record::Kind::Checkpoint) {
+            m_Mirror.append(record->added);
+
+            // The new journal is synced as soon as it's written.
+            if (writeCheckpoint(record->pieces)) {
+                m_NeedsCheckpoint = false;
+                written = false;
+            }
+
+            continue;
+        }
+
+        write(*record);
+        written = written || m_File;
+    }
+
+    // One sync for the whole batch.
+    if (written && m_File && !syncFile(m_File))
+        fail("Cannot sync '" + m_JournalPath.string() + "'.");
+}
+
+void RecoveryJournal::write(const Record& record) {
+    // A journal that starts from the source itself is only created once something is edited.
+    if (!m_File && !m_NeedsCheckpoint && !writeJournal(0, m_Source->view().size()))
+        m_NeedsCheckpoint = true;
+
+    m_Mirror.append(record.added);
+
+    if (!m_File)
+        return;
+
+    if (!writeRecord(m_File, static_cast<uint8_t>(record.kind), static_cast<uint8_t>(record.piece.buffer),
+                     record.offset, record.kind == Record::Kind::Erase ? record.end : record.piece.start,
+                     record.piece.length, record.added)) {
+        fail("Cannot write to '" + m_JournalPath.string() + "', edits are not journaled until the next autosave.");
+
+        // Whatever was cut off is ignored by replay, but nothing may come after it.
+        std::fclose(m_File);
+        m_File = nullptr;
+        m_NeedsCheckpoint = true;
+    }
+}
+
+bool RecoveryJournal::writeCheckpoint(const std::vector<PieceTable::Piece>& pieces) {
+    std::error_code error;
+    std::filesystem::create_directories(m_Directory, error);
+
+    uint64_t generation = m_Generation + 1;
+    std::filesystem::path path = getAutosavePath(generation);
+    std::filesystem::path temporary = path;
+    temporary += ".tmp";
+
+    std::FILE* file = openFile(temporary, "wb");
+    if (!file) {
+        fail("Cannot create '" + temporary.string() + "'.");
+        return false;
+    }
+
+    // Copied a chunk at a time, straight from where the pieces point to.
+    std::string_view source = m_Source->view();
+    uint64_t size = 0;
+    bool ok = true;
+
+    for (const auto& piece : pieces) {
+        std::string_view text = (piece.buffer == PieceTable::BufferKind::Original) ? source : std::string_view(m_Mirror);
+        if (piece.start > text.size() || piece.length > text.size() - piece.start) {
+            ok = false;
+            break;
+        }
+
+        text = text.substr(piece.start, piece.length);
+        for (size_t pos = 0; pos < text.size() && ok; pos += autosaveChunkSize) {
+            size_t length = std::min(autosaveChunkSize, text.size() - pos);
+            ok = !m_Stop && std::fwrite(text.data() + pos, 1, length, file) == length;
+        }
+
+        if (!ok)
+            break;
+
+        size += piece.length;
+    }
+
+    ok = syncFile(file) && ok;
+    std::fclose(file);
+
+    if (ok)
+        std::filesystem::rename(temporary, path, error);
+
+    if (!ok || error) {
+        std::filesystem::remove(temporary, error);
+
+        if (!m_Stop)
+            fail("Cannot write '" + path.string() + "'.");
+
+        return false;
+    }
+
+    if (!writeJournal(generation, size))
+        return false;
+
+    removeAutosaves({ path, m_SourcePath });
+    return true;
+}
+
+bool RecoveryJournal::writeJournal(uint64_t generation, uint64_t baseSize) {
+    std::error_code error;
+    std::filesystem::create_directories(m_Directory, error);
+
+    std::filesystem::path temporary = m_JournalPath;
+    temporary += ".tmp";
+
+    std::FILE* file = openFile(temporary, "wb");
+    if (!file) {
+        fail("Cannot create '" + temporary.string() + "'.");
+        return false;
+    }
+
+    std::string sourcePath = m_SourcePath.string();
+
+    std::string header(magic, sizeof(magic));
+    put(header, generation); put(header, static_cast<uint64_t>(m_Source->view().size())); put(header, m_SourceTime);
+    put(header, baseSize); put(header, static_cast<uint64_t>(m_Path.size())); put(header, static_cast<uint64_t>(sourcePath.size()));
+    header.append(m_Path);
+    header.append(sourcePath);
+    put(header, checksum(std::string_view(header).substr(sizeof(magic))));
+
+    // Everything added so far, which the records after it may point into.
+    bool ok = std::fwrite(header.data(), 1, header.size(), file) == header.size() &&
+              writeRecord(file, static_cast<uint8_t>(Record::Kind::Append), 0, 0, 0, 0, m_Mirror) &&
+              syncFile(file);
+    std::fclose(file);
+
+    if (!ok) {
+        std::filesystem::remove(temporary, error);
+        fail("Cannot write '" + temporary.string() + "'.");
+        return false;
+    }
+
+    // The current journal stays as it is until the new one is complete.
+    if (m_File) {
+        std::fclose(m_File);
+        m_File = nullptr;
+    }
+
+    std::filesystem::rename(temporary, m_JournalPath, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        fail("Cannot replace '" + m_JournalPath.string() + "'.");
+        m_NeedsCheckpoint = true;
+        return false;
+    }
+
+    syncDirectory(m_Directory);
+
+    m_File = openFile(m_JournalPath, "ab");
+    m_Generation = generation;
+    m_NeedsCheckpoint = (m_File == nullptr);
+
+    return m_File != nullptr;
+}
+
+void RecoveryJournal::removeAutosaves(const std::vector<std::filesystem::path>& keep) const noexcept {
+    std::error_code error;
+    std::string prefix = m_Key + ".";
+
+    for (std::filesystem::directory_iterator it(m_Directory, error), end; !error && it != end; it.increment(error)) {
+        std::filesystem::path path = it->path();
+        std::string name = path.filename().string();
+
+        if (name.compare(0, prefix.size(), prefix) != 0 || name == m_JournalPath.filename().string() ||
+            std::find(keep.begin(), keep.end(), path) != keep.end())
+            continue;
+
+        std::error_code removeError;
+        std::filesystem::remove(path, removeError);
+    }
+}
+
+void RecoveryJournal::fail(const std::string& error) {
+    if (m_Failed)
+        return;
+
+    std::cerr << "[RECOVERY]: " << error << std::endl;
+    m_Failed = true;
+}
+
+std::filesystem::path RecoveryJournal::getAutosavePath(uint64_t generation) const {
+    return m_Directory / (m_Key + "." + std::to_string(generation) + ".autosave");
+}
+
+std::filesystem::path RecoveryJournal::getBasePath(const Header& header) const {
+    return (header.generation == 0) ? std::filesystem::path(header.sourcePath) : getAutosavePath(header.generation);
+}
@@ -0,0 +1,263 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "MappedFile.h"
+#include "PieceTable.h"
+#include "SpscQueue.hpp"
+
+/**
+ * @brief   Keeps the edits made to an opened file on disk, so that they survive a crash.
+ *
+ *          Every edit is journaled as a small record: where a piece was inserted or
+ *          which bytes were erased, along with whatever text was added for it. The UI
+ *          thread only pushes the records into a lock-free queue. A writer thread sleeps until
+ *          the first record of a batch arrives, lets the rest gather for 'syncInterval', then
+ *          appends them to the journal and syncs it once for the whole batch.
+ *
+ *          Every now and then the whole document is written to an autosave, and the
+ *          journal starts over from it, so that it doesn't grow forever. All the UI thread
+ *          does for that is take the pieces of the document. The writer copies their text
+ *          to the autosave, straight from the mapped file and its own copy of the 'Added'
+ *          buffer, so even a 1 GB document never holds up a frame.
+ *
+ *          When a file that has a journal is opened again, the journal is replayed on top
+ *          of the file, or of the autosave it started from. A clean close() removes the
+ *          journal, along with any autosaves.
+ *
+ * @note    The opened file itself is never written to.
+ * @note    Replay stops at the first record that was only partly written, or doesn't make
+ *          sense, e.g. because the file changed in the meantime.
+ */
+class RecoveryJournal : public PieceTable::Listener {
+public:
+    /**
+     * @param directory         Where the journals and autosaves are kept. Created when first needed.
+     * @param autosaveInterval  How often the document is written to an autosave, while it's being edited.
+     */
+    RecoveryJournal(std::filesystem::path directory, std::chrono::seconds autosaveInterval);
+
+    /**
+     * @brief   Stops journaling, see close().
+     */
+    ~RecoveryJournal();
+
+    RecoveryJournal(const RecoveryJournal&) = delete;
+    RecoveryJournal& operator=(const RecoveryJournal&) = delete;
+
+    /**
+     * @brief           Opens a file into a document, replays its journal if it has one,
+     *                  and journals every edit made to the document from then on.
+     *
+     * @note            Replaying waits for the whole file to be indexed. Otherwise,
+     *                  the document is opened just like PieceTable::open() does.
+     * @note            Closes the previous session first, see close().
+     *
+     * @param path      The path of the file.
+     * @param document  The document to open the file into. Must outlive the session.
+     *
+     * @returns         True if edits from an earlier session were recovered.
+     *
+     * @throws          std::runtime_error if the file cannot be opened or mapped,
+     *                  in which case the previous session goes on.
+     */
+    bool open(const std::filesystem::path& path, PieceTable& document);
+
+    /**
+     * @brief   Stops journaling and removes the journal and the autosaves of the current file.
+     *
+     * @note    Doesn't wait for the writer to finish what it was doing,
+     *          nothing of it is needed once the session ended.
+     */
+    void close() noexcept;
+
+    /**
+     * @brief   Writes the document to an autosave if it was edited, and 'autosaveInterval'
+     *          has passed since the last time. Meant to be called every frame.
+     *
+     * @note    Waits until the document is fully indexed, the autosave has to hold all of it.
+     */
+    void update();
+
+    /**
+     * @brief   Checks if the document was edited since the last autosave, so that update() still has one to write.
+     */
+    bool isEdited() const noexcept;
+
+    /**
+     * @brief   Writes the document to an autosave in the background, right away.
+     *
+     * @note    Only takes the pieces of the document, O(pieces), none of its text is copied here.
+     * @note    It is required that the document is fully indexed.
+     */
+    void checkpoint();
+
+    /**
+     * @brief   Blocks until everything journaled so far is written and synced to disk.
+     */
+    void flush();
+
+    void onInserted(size_t offset, const PieceTable::Piece& piece) override;
+    void onErased(size_t begin, size_t end) override;
+
+private:
+    // How long the writer lets records gather after the first one, before it writes and syncs them.
+    static constexpr std::chrono::milliseconds syncInterval{ 250 };
+
+    // The amount of bytes written to an autosave at a time, between checking if it should stop.
+    static constexpr size_t autosaveChunkSize = size_t(4) << 20;
+
+    /**
+     * @brief   What the UI thread hands to the writer.
+     */
+    struct Record {
+        enum class Kind : uint8_t { Append, Insert, Erase, Checkpoint };
+
+        Record(Kind kind, uint64_t offset = 0, uint64_t end = 0) : kind(kind), offset(offset), end(end) {}
+
+        Kind kind;
+        uint64_t offset, end;                   // Where a piece was inserted, or the erased bytes [offset, end).
+        PieceTable::Piece piece{};              // The inserted piece. Original pieces point into the source.
+        std::string added;                      // What was appended to the 'Added' buffer since the previous record.
+        std::vector<PieceTable::Piece> pieces;  // Every piece of the document, for a checkpoint.
+    };
+
+    /**
+     * @brief   What the header of a journal says.
+     */
+    struct Header {
+        uint64_t generation = 0;        // How many autosaves came before it. 0 if the journal starts from the source itself.
+        uint64_t sourceSize = 0;        // The size of the source when the session started.
+        int64_t sourceTime = 0;         // Likewise, its last write time.
+        uint64_t baseSize = 0;          // The size of the autosave the journal starts from.
+        std::string path;               // The absolute path of the file the journal belongs to.
+        std::string sourcePath;         // The file the original buffer of the document was opened from.
+    };
+
+    /**
+     * @brief   Reads the header of a journal.
+     *
+     * @returns True if it's the journal of the opened file, and its header is intact.
+     */
+    bool readHeader(std::FILE* file, Header& header) const;
+
+    /**
+     * @brief           Opens the file a journal starts from into @p document,
+     *                  and applies every intact record of the journal to it.
+     *
+     * @param base      Receives a mapping of the file the journal starts from, for the writer.
+     *
+     * @returns         True if anything was recovered.
+     */
+    bool replay(std::FILE* file, const Header& header, PieceTable& document, std::unique_ptr<MappedFile>& base);
+
+    /**
+     * @brief           Starts a session for @p document.
+     *
+     * @param source    A mapping of the file the original buffer of the document was opened from.
+     * @param recovered Whether the document holds recovered edits, which are written to an autosave right away.
+     */
+    void start(PieceTable& document, std::unique_ptr<MappedFile> source, const std::filesystem::path& sourcePath,
+               uint64_t generation, bool recovered);
+
+    /**
+     * @brief   Stops the writer and throws away whatever it didn't get to.
+     */
+    void stop() noexcept;
+
+    /**
+     * @brief   Hands the bytes of the 'Added' buffer up to @p end, that the writer doesn't have yet, to a record.
+     */
+    void forward(Record& record, size_t end);
+
+    void push(Record record);
+
+    // The rest runs on the writer.
+
+    void run();
+
+    /**
+     * @brief   Writes every queued record, then syncs the journal once.
+     */
+    void drain();
+
+    void write(const Record& record);
+
+    /**
+     * @brief   Writes the document to a new autosave, and starts a new journal from it.
+     *
+     * @returns True if both were written.
+     */
+    bool writeCheckpoint(const std::vector<PieceTable::Piece>& pieces);
+
+    /**
+     * @brief   Writes a new journal to a temporary file and moves it over the current one.
+     */
+    bool writeJournal(uint64_t generation, uint64_t baseSize);
+
+    /**
+     * @brief   Removes the autosaves of the current file, other than the ones in use.
+     */
+    void removeAutosaves(const std::vector<std::filesystem::path>& keep) const noexcept;
+
+    /**
+     * @brief   Logs an error, only once per session.
+     */
+    void fail(const std::string& error);
+
+    std::filesystem::path getAutosavePath(uint64_t generation) const;
+
+    /**
+     * @brief   Gets the file a journal starts from, i.e. its source or its latest autosave.
+     */
+    std::filesystem::path getBasePath(const Header& header) const;
+
+    std::filesystem::path m_Directory;
+    std::chrono::seconds m_AutosaveInterval;
+
+    // The current session, set up by start().
+    PieceTable* m_Document;
+    std::string m_Path;                         // The absolute path of the opened file.
+    std::string m_Key;                          // What the files of the session are named after.
+    std::filesystem::path m_JournalPath;
+    std::filesystem::path m_SourcePath;
+    std::unique_ptr<MappedFile> m_Source;       // The source of the original buffer, mapped again for the writer.
+    int64_t m_SourceTime;
+
+    // Only touched by the UI thread.
+    size_t m_Forwarded;                         // How much of the 'Added' buffer was handed to the writer.
+    bool m_Edited;                              // Whether the document changed since the last checkpoint.
+    std::chrono::steady_clock::time_point m_LastCheckpoint;
+    uint64_t m_Pushed;                          // The amount of records pushed.
+
+    // Only touched by the writer, while it runs.
+    std::string m_Mirror;                       // A copy of the 'Added' buffer, as far as it was forwarded.
+    std::FILE* m_File;                          // The journal, or nullptr until it's needed.
+    uint64_t m_Generation;
+    bool m_NeedsCheckpoint;                     // Whether records are dropped until the next checkpoint, because there's no journal they'd fit in.
+    bool m_Failed;                              // Whether an error was logged already.
+    uint64_t m_Popped;
+
+    SpscQueue<Record> m_Queue;
+    std::atomic<bool> m_Stop;
+    std::atomic<bool> m_Idle;                   // Whether the writer drained the queue since the last push, so the next one has to wake it.
+
+    std::mutex m_Mutex;
+    std::condition_variable m_Wake;             // Wakes the writer, to write, stop or flush.
+    std::condition_variable m_Written;          // Tells flush() that m_WrittenCount went up.
+    uint64_t m_FlushTarget;                     // Guarded by m_Mutex.
+    uint64_t m_WrittenCount;                    // Guarded by m_Mutex.
+
+    std::thread m_Writer; // Declared last, so it's stopped before anything it uses goes away.
+};
@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <thread>
+
+#include "RegexSearch.h"
+
+RegexSearch::RegexSearch(const std::string& pattern, bool ignoreCase) :
+                m_Regex(pattern, std::regex::ECMAScript | std::regex::multiline | std::regex::optimize |
+                                 (ignoreCase ? std::regex::icase : std::regex::flag_type(0))) {}
+
+std::vector<PieceTable::Replacement> RegexSearch::findAll(const PieceTable& document, const std::string* format) const {
+    const size_t size = document.getSize();
+    const size_t chunks = (size + chunkSize - 1) / chunkSize;
+
+    // Every chunk gets its own results, so the workers never have to share anything but the next chunk index.
+    std::vector<std::vector<PieceTable::Replacement>> results(chunks);
+    std::atomic<size_t> nextChunk(0);
+
+    // The regex engine can throw while matching, e.g. when a pattern backtracks too much.
+    std::mutex errorMutex;
+    std::exception_ptr error;
+
+    const auto work = [&]() {
+        try {
+            for (size_t i; (i = nextChunk++) < chunks;) {
+                size_t begin = i * chunkSize;
+                findInRange(document, begin, std::min(size, begin + chunkSize), format, results[i]);
+            }
+        }
+        catch (...) {
+            std::lock_guard lock(errorMutex);
+            if (!error)
+                error = std::current_exception();
+
+            nextChunk = chunks;
+        }
+    };
+
+    // The calling thread takes chunks as well.
+    size_t threadCount = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), chunks);
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threadCount; i++)
+        workers.emplace_back(work);
+
+    work();
+    for (auto& worker : workers)
+        worker.join();
+
+    if (error)
+        std::rethrow_exception(error);
+
+    // Merge the chunks in order. If a match ran into the next chunk, the first
+    // matches of that chunk overlap it, so search it again from where the match ended.
+    std::vector<PieceTable::Replacement> ret;
+    size_t matchCount = 0;
+    for (const auto& result : results)
+        matchCount += result.size();
+    ret.reserve(matchCount);
+
+    for (size_t i = 0; i < chunks; i++) {
+        auto& result = results[i];
+        size_t lastEnd = ret.empty() ? 0 : ret.back().end;
+        size_t chunkEnd = std::min(size, (i + 1) * chunkSize);
+
+        if (!result.empty() && result.front().begin < lastEnd) {
+            result.clear();
+
+            if (lastEnd < chunkEnd)
+                findInRange(document, lastEnd, chunkEnd, format, result);
+        }
+
+        std::move(result.begin(), result.end(), std::back_inserter(ret));
+    }
+
+    return ret;
+}
+
+void RegexSearch::findInRange(const PieceTable& document, size_t begin, size_t end, const std::string* format,
+                              std::vector<PieceTable::Replacement>& out) const {
+    const size_t size = document.getSize();
+    const size_t found = out.size();
+
+    // The byte before the range lets '^' and '\b' see what comes before it.
+    const size_t contextBegin = (begin > 0) ? begin - 1 : 0;
+
+    // Copy more and more of the text after the range, until no match runs into its end.
+    for (size_t extra = lookahead;; extra *= 4) {
+        size_t contextEnd = (size - end > extra) ? end + extra : size;
+        bool cutOff = (contextEnd < size);
+
+        std::string text = document.getText(contextBegin, contextEnd);
+        const char* first = text.data() + (begin - contextBegin);
+        const char* last = text.data() + text.size();
+
+        auto flags = std::regex_constants::match_default;
+        if (begin > 0)
+            flags |= std::regex_constants::match_prev_avail;
+
+        // Unless it's the end of the document, the end of the copy isn't the end of a line or a word.
+        if (cutOff)
+            flags |= std::regex_constants::match_not_eol | std::regex_constants::match_not_eow;
+
+        bool ranPast = false;
+        for (std::cregex_iterator it(first, last, m_Regex, flags), stop; it != stop; ++it) {
+            const auto& match = *it;
+            size_t offset = begin + (match[0].first - first);
+
+            // The matches after this one belong to the next range.
+            if (offset >= end)
+                break;
+
+            // The match might go on past what was copied.
+            if (cutOff && match[0].second == last) {
+                ranPast = true;
+                break;
+            }
+
+            out.push_back({ offset, offset + static_cast<size_t>(match.length(0)),
+                            format ? match.format(*format) : std::string() });
+        }
+
+        if (!ranPast)
+            return;
+
+        out.erase(out.begin() + found, out.end());
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "PieceTable.h"
+
+/**
+ * @brief   Finds every match of a regular expression in a PieceTable, on all cores.
+ *
+ *          The document is split into chunks, which a pool of worker threads
+ *          takes from one at a time. Each worker copies its chunk out of the pieces,
+ *          together with the byte before it, so that anchors and word boundaries
+ *          see the text around it, and a bit of the text after it.
+ *
+ *          A match that starts in one chunk may end in the next. A worker that
+ *          finds a match running into the end of what it copied searches its
+ *          chunk again with more text after it. When the results are merged, a
+ *          chunk whose first match overlaps the last match of the chunk before it
+ *          is searched again from the end of that match, like a single pass would.
+ *
+ * @note    Patterns use the ECMAScript grammar, where '^' and '$' match at every line.
+ */
+class RegexSearch {
+public:
+    /**
+     * @brief           Compiles a pattern.
+     *
+     * @param pattern   The regular expression.
+     * @param ignoreCase Whether letters match regardless of their case.
+     *
+     * @throws          std::regex_error if the pattern is invalid.
+     */
+    explicit RegexSearch(const std::string& pattern, bool ignoreCase = false);
+
+    /**
+     * @brief           Finds every match in the document, without any overlapping.
+     *
+     * @note            Blocks until every chunk has been searched.
+     *
+     * @param format    If not null, the text of every replacement is formatted from it,
+     *                  where "$&" is the match and "$1" to "$99" are its groups.
+     *
+     * @returns         The range of every match and its replacement, sorted by offset.
+     *                  Can be passed straight to PieceTable::replace().
+     */
+    std::vector<PieceTable::Replacement> findAll(const PieceTable& document, const std::string* format = nullptr) const;
+
+private:
+    // The amount of bytes a worker searches at a time.
+    static constexpr size_t chunkSize = size_t(4) << 20;
+
+    // The amount of bytes after a chunk that is copied along with it at first.
+    static constexpr size_t lookahead = size_t(4) << 10;
+
+    /**
+     * @brief   Finds the matches that start in [begin, end), in a single pass.
+     */
+    void findInRange(const PieceTable& document, size_t begin, size_t end, const std::string* format,
+                     std::vector<PieceTable::Replacement>& out) const;
+
+    std::regex m_Regex;
+};
@@ -0,0 +1,114 @@
+#include "RenderBatch.h"
+#include "Utf8.h"
+
+namespace {
+    // Center of the 2x2 white square at the top-left corner of every font atlas page.
+    constexpr sf::Vector2f whitePixel = { 1.f, 1.f };
+}
+
+RenderBatch::RenderBatch() : m_Vertices(sf::PrimitiveType::Triangles), m_Texture(nullptr) {}
+
+void RenderBatch::draw(sf::RenderTarget& target, sf::RenderStates states) const {
+    if (m_Vertices.getVertexCount() == 0)
+        return;
+
+    states.texture = m_Texture;
+    target.draw(m_Vertices, states);
+}
+
+void RenderBatch::clear() noexcept {
+    m_Vertices.clear();
+}
+
+size_t RenderBatch::getVertexCount() const noexcept {
+    return m_Vertices.getVertexCount();
+}
+
+void RenderBatch::move(sf::Vector2f delta) noexcept {
+    for (size_t i = 0; i < m_Vertices.getVertexCount(); i++)
+        m_Vertices[i].position += delta;
+}
+
+void RenderBatch::append(const RenderBatch& other, sf::Vector2f offset) {
+    if (other.m_Texture)
+        m_Texture = other.m_Texture;
+
+    for (size_t i = 0; i < other.m_Vertices.getVertexCount(); i++) {
+        sf::Vertex vertex = other.m_Vertices[i];
+        vertex.position += offset;
+        m_Vertices.append(vertex);
+    }
+}
+
+void RenderBatch::addQuad(sf::Vector2f topLeft, sf::Vector2f bottomRight, sf::Vector2f uvTopLeft, sf::Vector2f uvBottomRight, sf::Color color) {
+    // Two triangles, in the same winding as sf::Text.
+    m_Vertices.append({ topLeft, color, uvTopLeft });
+    m_Vertices.append({ { bottomRight.x, topLeft.y }, color, { uvBottomRight.x, uvTopLeft.y } });
+    m_Vertices.append({ { topLeft.x, bottomRight.y }, color, { uvTopLeft.x, uvBottomRight.y } });
+    m_Vertices.append({ { topLeft.x, bottomRight.y }, color, { uvTopLeft.x, uvBottomRight.y } });
+    m_Vertices.append({ { bottomRight.x, topLeft.y }, color, { uvBottomRight.x, uvTopLeft.y } });
+    m_Vertices.append({ bottomRight, color, uvBottomRight });
+}
+
+void RenderBatch::addRect(sf::Vector2f pos, sf::Vector2f size, sf::Color color) {
+    addQuad(pos, pos + size, whitePixel, whitePixel, color);
+}
+
+void RenderBatch::addOutline(sf::Vector2f pos, sf::Vector2f size, float thickness, sf::Color color) {
+    if (thickness == 0)
+        return;
+
+    // The outer and inner edges of the outline.
+    sf::Vector2f outer = (thickness > 0) ? pos - sf::Vector2f(thickness, thickness) : pos;
+    sf::Vector2f outerSize = (thickness > 0) ? size + sf::Vector2f(thickness, thickness) * 2.f : size;
+    float width = (thickness > 0) ? thickness : -thickness;
+
+    // Top and bottom span the whole width, left and right fill the gap between them.
+    addRect(outer, { outerSize.x, width }, color);
+    addRect({ outer.x, outer.y + outerSize.y - width }, { outerSize.x, width }, color);
+    addRect({ outer.x, outer.y + width }, { width, outerSize.y - width * 2 }, color);
+    addRect({ outer.x + outerSize.x - width, outer.y + width }, { width, outerSize.y - width * 2 }, color);
+}
+
+float RenderBatch::addText(std::string_view str, sf::Vector2f pos, const GlyphCache& glyphs, sf::Color color) {
+    m_Texture = &glyphs.getTexture();
+
+    // sf::Text puts the baseline one character size below the top.
+    float x = 0, y = static_cast<float>(glyphs.getCharacterSize());
+    uint32_t prev = 0;
+
+    // Decoded like the editor does, so that a byte outside of a valid character is a single U+FFFD.
+    for (size_t i = 0; i < str.size();) {
+        uint32_t c;
+        i = Utf8::decode(str, i, c);
+
+        // Like sf::Text, carriage returns aren't drawn at all.
+        if (c == U'\r')
+            continue;
+
+        x += glyphs.getKerning(prev, c);
+        prev = c;
+
+        // Whitespace only moves the pen.
+        if (c == U' ' || c == U'\t' || c == U'\n') {
+            x += glyphs.getAdvance(c);
+            continue;
+        }
+
+        // The glyph's bounds are relative to the pen on the baseline.
+        // Pad by a pixel like sf::Text, so that smooth fonts aren't cut off.
+        const sf::Glyph& glyph = glyphs.getGlyph(c);
+        const sf::Vector2f padding = { 1.f, 1.f };
+        const sf::Vector2f pen = pos + sf::Vector2f(x, y);
+
+        sf::Vector2f uvTopLeft = sf::Vector2f(glyph.textureRect.position) - padding;
+        sf::Vector2f uvBottomRight = sf::Vector2f(glyph.textureRect.position + glyph.textureRect.size) + padding;
+
+        addQuad(pen + glyph.bounds.position - padding, pen + glyph.bounds.position + glyph.bounds.size + padding,
+                uvTopLeft, uvBottomRight, color);
+
+        x += glyph.advance;
+    }
+
+    return x;
+}
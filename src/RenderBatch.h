@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+#include <SFML/Graphics.hpp>
+
+#include "GlyphCache.h"
+
+/**
+ * @brief   A list of quads that is drawn with a single draw call.
+ *
+ *          Text is written as one quad per glyph, textured from the font's atlas,
+ *          the same way sf::Text lays it out. Solid rectangles sample the white
+ *          square SFML reserves in the corner of every atlas page, so they can be
+ *          mixed freely with text without switching textures.
+ *
+ * @note    Quads are drawn in the order they were added.
+ * @note    All text in a batch has to use the same font and character size.
+ */
+class RenderBatch : public sf::Drawable {
+public:
+    RenderBatch();
+
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+
+    /**
+     * @brief   Removes every quad, but keeps the memory for the next frame.
+     */
+    void clear() noexcept;
+
+    /**
+     * @brief   Get the amount of vertices in the batch.
+     */
+    size_t getVertexCount() const noexcept;
+
+    /**
+     * @brief   Moves every quad in the batch.
+     */
+    void move(sf::Vector2f delta) noexcept;
+
+    /**
+     * @brief   Adds every quad of another batch, moved by @p offset.
+     */
+    void append(const RenderBatch& other, sf::Vector2f offset);
+
+    /**
+     * @brief   Adds a solid rectangle.
+     */
+    void addRect(sf::Vector2f pos, sf::Vector2f size, sf::Color color);
+
+    /**
+     * @brief           Adds an outline around a rectangle, like sf::RectangleShape draws it.
+     *
+     * @param thickness The thickness of the outline. Positive values grow
+     *                  outwards, negative values grow into the rectangle.
+     */
+    void addOutline(sf::Vector2f pos, sf::Vector2f size, float thickness, sf::Color color);
+
+    /**
+     * @brief           Adds a line of text, laid out like an sf::Text at @p pos.
+     *
+     * @param str       The text, encoded in UTF-8. Should not contain newlines.
+     * @param glyphs    The font and character size to draw with.
+     *
+     * @returns         The x position past the last character, relative to @p pos.
+     */
+    float addText(std::string_view str, sf::Vector2f pos, const GlyphCache& glyphs, sf::Color color);
+
+private:
+    void addQuad(sf::Vector2f topLeft, sf::Vector2f bottomRight, sf::Vector2f uvTopLeft, sf::Vector2f uvBottomRight, sf::Color color);
+
+    sf::VertexArray m_Vertices;
+    const sf::Texture* m_Texture; // The atlas of the text in the batch, if any.
+};
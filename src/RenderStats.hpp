@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <iostream>
+
+#include <SFML/Graphics.hpp>
+
+/**
+ * @brief   Counts how often the main loop wakes up and draws, and how much
+ *          CPU time the process uses meanwhile, to see what an idle window costs.
+ *
+ * @note    Prints a line every few seconds when enabled, does nothing otherwise.
+ */
+class RenderStats {
+public:
+    explicit RenderStats(bool enabled) noexcept :
+                m_Enabled(enabled), m_Clock(), m_CpuStart(std::clock()), m_Wakeups(0), m_Frames(0) {}
+
+    void onWakeup() noexcept {
+        m_Wakeups++;
+    }
+
+    void onFrame() noexcept {
+        m_Frames++;
+    }
+
+    /**
+     * @brief   Prints and resets the stats, once every reportInterval seconds.
+     *
+     * @note    The CPU time includes every thread, e.g. the line indexer.
+     */
+    void report() {
+        float elapsed = m_Clock.getElapsedTime().asSeconds();
+        if (!m_Enabled || elapsed < reportInterval)
+            return;
+
+        double cpuSeconds = static_cast<double>(std::clock() - m_CpuStart) / CLOCKS_PER_SEC;
+
+        std::cout << "[RENDER]: " << m_Wakeups / elapsed << " wakeups/s, "
+                  << m_Frames / elapsed << " frames/s, "
+                  << cpuSeconds / elapsed * 100 << "% CPU" << std::endl;
+
+        m_Clock.restart();
+        m_CpuStart = std::clock();
+        m_Wakeups = 0; m_Frames = 0;
+    }
+
+private:
+    static constexpr float reportInterval = 5.f; // In seconds.
+
+    bool m_Enabled;
+    sf::Clock m_Clock;
+    std::clock_t m_CpuStart;
+    uint64_t m_Wakeups, m_Frames;
+};
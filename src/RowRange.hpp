@@ -0,0 +1,46 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+/**
+ * @brief   A range of rows [first, last), e.g. the rows that are in frame.
+ */
+struct RowRange {
+    size_t first = 0, last = 0;
+
+    constexpr bool empty() const noexcept {
+        return first >= last;
+    }
+
+    constexpr bool contains(size_t row) const noexcept {
+        return row >= first && row < last;
+    }
+
+    /**
+     * @brief           Computes which rows have their top edge within [minY, maxY],
+     *                  without looking at any of the rows outside of it.
+     *
+     * @param top       The y position of the first row.
+     * @param lineHeight The distance between the tops of two consecutive rows.
+     * @param lineCount The amount of rows.
+     */
+    static RowRange fromBounds(float top, float lineHeight, float minY, float maxY, size_t lineCount) noexcept {
+        if (lineCount == 0 || lineHeight <= 0 || maxY < top || minY > maxY)
+            return {};
+
+        // Clamp in floating point first, so that a huge scroll can't overflow the conversion.
+        float first = std::max(0.f, std::ceil((minY - top) / lineHeight));
+        float last = std::floor((maxY - top) / lineHeight) + 1;
+
+        if (first >= static_cast<float>(lineCount))
+            return {};
+
+        RowRange range;
+        range.first = static_cast<size_t>(first);
+        range.last = (last >= static_cast<float>(lineCount)) ? lineCount : static_cast<size_t>(last);
+
+        return range;
+    }
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+
+// SSE2 is part of x86-64, so it can always be used there.
+#if defined(__x86_64__) || defined(_M_X64)
+    #define VISIONARY_X86_SIMD
+    #include <immintrin.h>
+
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #endif
+#endif
+
+// Lets AVX2 code be compiled without building the whole program with -mavx2.
+// It is only ever called after checking that the CPU supports it.
+#if defined(VISIONARY_X86_SIMD) && (defined(__GNUC__) || defined(__clang__))
+    #define VISIONARY_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+    #define VISIONARY_TARGET_AVX2
+#endif
+
+/**
+ * @brief   What the SIMD code of NewlineScanner, SubstringSearch and Utf8 shares:
+ *          picking the implementation the CPU supports, and working with the masks.
+ */
+namespace Simd {
+    /**
+     * @brief   One implementation of a function, along with the instruction set it uses.
+     */
+    template <typename Function>
+    struct Implementation {
+        Function function;
+        const char* name;
+    };
+
+#ifdef VISIONARY_X86_SIMD
+    /**
+     * @brief   Gets the index of the lowest set bit of @p mask, which mustn't be 0.
+     */
+    inline unsigned countTrailingZeros(uint64_t mask) noexcept {
+    #ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, mask);
+        return static_cast<unsigned>(index);
+    #else
+        return static_cast<unsigned>(__builtin_ctzll(mask));
+    #endif
+    }
+
+    inline bool supportsAVX2() noexcept {
+    #ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+
+        // The CPU has to support AVX, and the OS has to save the YMM registers.
+        __cpuid(info, 1);
+        bool osSavesYmm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && ((_xgetbv(0) & 0x6) == 0x6);
+        if (!osSavesYmm)
+            return false;
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+    #else
+        return __builtin_cpu_supports("avx2");
+    #endif
+    }
+
+    /**
+     * @brief   Picks @p avx2 if the CPU supports it, and @p sse2 otherwise.
+     *
+     * @note    Checks the CPU on every call, so keep what it returns.
+     */
+    template <typename Function>
+    Implementation<Function> pick(Function avx2, Function sse2) noexcept {
+        if (supportsAVX2())
+            return { avx2, "AVX2" };
+
+        return { sse2, "SSE2" };
+    }
+#endif
+}
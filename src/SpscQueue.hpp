@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+/**
+ * @brief   An unbounded queue between exactly one producer thread and one consumer thread.
+ *
+ *          Neither side ever takes a lock or waits for the other. The items are kept in a
+ *          linked list that always starts with a stub node: the producer only touches the
+ *          last node, the consumer only the first one, and they meet through the 'next'
+ *          pointer of a node, which is published with release and read with acquire.
+ *
+ * @note    push() must only ever be called from one thread, and pop() from one other thread.
+ */
+template <typename T>
+class SpscQueue {
+public:
+    SpscQueue() : m_Head(new Node()), m_Tail(m_Head) {}
+
+    ~SpscQueue() {
+        while (m_Head) {
+            Node* next = m_Head->next.load(std::memory_order_relaxed);
+            delete m_Head;
+            m_Head = next;
+        }
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    /**
+     * @brief   Adds an item to the back of the queue. Called by the producer only.
+     */
+    void push(T value) {
+        Node* node = new Node{ std::move(value) };
+        m_Tail->next.store(node, std::memory_order_release);
+        m_Tail = node;
+    }
+
+    /**
+     * @brief   Takes the item at the front of the queue. Called by the consumer only.
+     *
+     * @returns The item, or 'std::nullopt' if the queue is empty.
+     */
+    std::optional<T> pop() {
+        Node* next = m_Head->next.load(std::memory_order_acquire);
+        if (!next)
+            return std::nullopt;
+
+        // The node after the stub holds the item, and becomes the new stub.
+        std::optional<T> ret(std::move(next->value));
+        next->value.reset();
+        delete m_Head;
+        m_Head = next;
+
+        return ret;
+    }
+
+private:
+    struct Node {
+        std::optional<T> value; // Empty in the stub.
+        std::atomic<Node*> next{ nullptr };
+    };
+
+    Node* m_Head; // The stub, owned by the consumer.
+    Node* m_Tail; // The last node, owned by the producer.
+};
@@ -0,0 +1,119 @@
+#include <cstdint>
+#include <cstring>
+
+#include "SubstringSearch.h"
+#include "Simd.hpp"
+
+namespace {
+    using FindFunction = size_t (*)(std::string_view, std::string_view, size_t) noexcept;
+
+    constexpr size_t npos = std::string_view::npos;
+
+#ifdef VISIONARY_X86_SIMD
+    // Checks every candidate in mask, lowest first, and returns the first real match.
+    inline size_t verifyCandidates(uint32_t mask, const char* data, size_t offset, std::string_view needle) noexcept {
+        while (mask) {
+            size_t candidate = offset + Simd::countTrailingZeros(mask);
+            if (std::memcmp(data + candidate, needle.data(), needle.size()) == 0)
+                return candidate;
+
+            mask &= mask - 1;
+        }
+
+        return npos;
+    }
+
+    size_t findSSE2(std::string_view text, std::string_view needle, size_t pos) noexcept {
+        if (needle.empty() || pos > text.size() || needle.size() > text.size() - pos)
+            return SubstringSearch::findScalar(text, needle, pos);
+
+        const char* data = text.data();
+        const size_t last = needle.size() - 1;
+        const size_t candidates = text.size() - last; // The amount of offsets a match can start at.
+        const __m128i first = _mm_set1_epi8(needle.front());
+        const __m128i final = _mm_set1_epi8(needle.back());
+
+        // The second load is shifted by the length of the needle, so that a set bit
+        // means both the first and the last byte of the needle are in place.
+        size_t i = pos;
+        for (; i + 16 <= candidates; i += 16) {
+            __m128i begin = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            __m128i end = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + last));
+            __m128i both = _mm_and_si128(_mm_cmpeq_epi8(begin, first), _mm_cmpeq_epi8(end, final));
+
+            size_t found = verifyCandidates(static_cast<uint32_t>(_mm_movemask_epi8(both)), data, i, needle);
+            if (found != npos)
+                return found;
+        }
+
+        return SubstringSearch::findScalar(text, needle, i);
+    }
+
+    VISIONARY_TARGET_AVX2
+    size_t findAVX2(std::string_view text, std::string_view needle, size_t pos) noexcept {
+        if (needle.empty() || pos > text.size() || needle.size() > text.size() - pos)
+            return SubstringSearch::findScalar(text, needle, pos);
+
+        const char* data = text.data();
+        const size_t last = needle.size() - 1;
+        const size_t candidates = text.size() - last;
+        const __m256i first = _mm256_set1_epi8(needle.front());
+        const __m256i final = _mm256_set1_epi8(needle.back());
+
+        size_t i = pos;
+        for (; i + 32 <= candidates; i += 32) {
+            __m256i begin = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            __m256i end = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + last));
+            __m256i both = _mm256_and_si256(_mm256_cmpeq_epi8(begin, first), _mm256_cmpeq_epi8(end, final));
+
+            size_t found = verifyCandidates(static_cast<uint32_t>(_mm256_movemask_epi8(both)), data, i, needle);
+            if (found != npos)
+                return found;
+        }
+
+        return findSSE2(text, needle, i);
+    }
+#endif
+
+    // Picks the implementation once, the first time it is needed.
+    const Simd::Implementation<FindFunction>& getImplementation() noexcept {
+    #ifdef VISIONARY_X86_SIMD
+        static const auto implementation = Simd::pick<FindFunction>(findAVX2, findSSE2);
+    #else
+        static const Simd::Implementation<FindFunction> implementation = { SubstringSearch::findScalar, "scalar" };
+    #endif
+
+        return implementation;
+    }
+}
+
+size_t SubstringSearch::find(std::string_view text, std::string_view needle, size_t pos) noexcept {
+    return getImplementation().function(text, needle, pos);
+}
+
+size_t SubstringSearch::findScalar(std::string_view text, std::string_view needle, size_t pos) noexcept {
+    if (pos > text.size() || needle.size() > text.size() - pos)
+        return npos;
+
+    if (needle.empty())
+        return pos;
+
+    const char* data = text.data();
+    const char* end = data + (text.size() - needle.size()) + 1; // Past the last offset a match can start at.
+
+    // memchr is the fastest portable way to skip to the next candidate.
+    for (const char* it = data + pos; it < end; it++) {
+        it = static_cast<const char*>(std::memchr(it, needle.front(), end - it));
+        if (!it)
+            break;
+
+        if (std::memcmp(it, needle.data(), needle.size()) == 0)
+            return it - data;
+    }
+
+    return npos;
+}
+
+const char* SubstringSearch::getInstructionSet() noexcept {
+    return getImplementation().name;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string_view>
+
+/**
+ * @brief   Finds occurrences of a string in a block of text.
+ *
+ *          On x86-64, the first and the last byte of the needle are broadcast
+ *          and compared against 16 (SSE2) or 32 (AVX2) candidate positions at a time.
+ *          Only the positions where both match are verified with memcmp,
+ *          so most of the text is never looked at byte by byte.
+ *          Everywhere else, a scalar fallback is used.
+ */
+namespace SubstringSearch {
+    /**
+     * @brief           Finds the first occurrence of @p needle in @p text that starts at or after @p pos,
+     *                  using the fastest implementation the CPU supports.
+     *
+     * @returns         The offset of the occurrence in @p text, or 'std::string_view::npos' if there is none.
+     *
+     * @note            An empty needle is found at @p pos, as long as @p pos is within the text.
+     */
+    size_t find(std::string_view text, std::string_view needle, size_t pos = 0) noexcept;
+
+    /**
+     * @brief   Same as find(), but never uses any vector instructions.
+     */
+    size_t findScalar(std::string_view text, std::string_view needle, size_t pos = 0) noexcept;
+
+    /**
+     * @returns The name of the implementation used by find(), "AVX2", "SSE2" or "scalar".
+     */
+    const char* getInstructionSet() noexcept;
+};
@@ -0,0 +1,489 @@
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <string>
+
+#include "SyntaxHighlighter.h"
+
+namespace {
+    using Language = SyntaxHighlighter::Language;
+    using Token = SyntaxHighlighter::Token;
+    using Span = SyntaxHighlighter::Span;
+    using State = SyntaxHighlighter::State;
+
+    // What the C++ lexer carries over from one line to the next.
+    enum CppState : State {
+        Normal = SyntaxHighlighter::initialState,
+        BlockComment,       // Inside a /* */ comment.
+        StringContinued,    // Inside a string whose line ended with a backslash.
+        DirectiveContinued, // Inside a preprocessor directive whose line ended with a backslash.
+    };
+
+    // Sorted, so that they can be binary searched.
+    constexpr std::array<std::string_view, 66> cppKeywords = {
+        "alignas", "alignof", "break", "case", "catch", "class", "co_await", "co_return",
+        "co_yield", "concept", "const", "const_cast", "consteval", "constexpr", "constinit",
+        "continue", "decltype", "default", "delete", "do", "dynamic_cast", "else", "enum",
+        "explicit", "export", "extern", "false", "final", "for", "friend", "goto", "if", "inline",
+        "mutable", "namespace", "new", "noexcept", "nullptr", "operator", "override", "private",
+        "protected", "public", "register", "reinterpret_cast", "requires", "return", "sizeof",
+        "static", "static_assert", "static_cast", "struct", "switch", "template", "this",
+        "thread_local", "throw", "true", "try", "typedef", "typename", "union", "using", "virtual",
+        "volatile", "while"
+    };
+
+    constexpr std::array<std::string_view, 17> cppTypes = {
+        "auto", "bool", "char", "char16_t", "char32_t", "char8_t", "double", "float", "int", "long",
+        "ptrdiff_t", "short", "signed", "size_t", "unsigned", "void", "wchar_t"
+    };
+
+    constexpr std::array<std::string_view, 3> jsonLiterals = { "false", "null", "true" };
+
+    struct LogLevel {
+        std::string_view word;
+        Token token;
+    };
+
+    // Sorted by word.
+    constexpr std::array<LogLevel, 13> logLevels = { {
+        { "CRITICAL", Token::Error }, { "DEBUG", Token::Info }, { "ERR", Token::Error }, { "ERROR", Token::Error },
+        { "FAIL", Token::Error }, { "FAILED", Token::Error }, { "FATAL", Token::Error }, { "INFO", Token::Info },
+        { "NOTICE", Token::Info }, { "TRACE", Token::Info }, { "WARN", Token::Warning }, { "WARNING", Token::Warning },
+        { "WARNINGS", Token::Warning }
+    } };
+
+    template <size_t N>
+    bool contains(const std::array<std::string_view, N>& words, std::string_view word) noexcept {
+        return std::binary_search(words.begin(), words.end(), word);
+    }
+
+    bool isDigit(char c) noexcept {
+        return c >= '0' && c <= '9';
+    }
+
+    bool isIdentifierStart(char c) noexcept {
+        return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
+    }
+
+    bool isIdentifier(char c) noexcept {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+    }
+
+    bool endsWithBackslash(std::string_view line) noexcept {
+        return !line.empty() && line.back() == '\\';
+    }
+
+    // Adds spans to the output, if there is one.
+    struct Emitter {
+        std::vector<Span>* spans;
+
+        void operator()(size_t begin, size_t end, Token token) const {
+            if (spans && begin < end)
+                spans->push_back({ begin, end, token });
+        }
+    };
+
+    /**
+     * @returns The column past the closing quote of a string whose contents start at @p from,
+     *          or std::string_view::npos if the line ends before it.
+     */
+    size_t findStringEnd(std::string_view line, size_t from, char quote) noexcept {
+        for (size_t i = from; i < line.size(); i++) {
+            if (line[i] == '\\')
+                i++;
+            else if (line[i] == quote)
+                return i + 1;
+        }
+
+        return std::string_view::npos;
+    }
+
+    /**
+     * @returns The column past a number that starts at @p begin, e.g. "0x1F", "1'000" or "1.5e-3f".
+     */
+    size_t skipNumber(std::string_view line, size_t begin) noexcept {
+        size_t i = begin + 1;
+
+        while (i < line.size()) {
+            char c = line[i];
+            char prev = line[i - 1];
+
+            bool exponentSign = (c == '+' || c == '-') && (prev == 'e' || prev == 'E' || prev == 'p' || prev == 'P');
+            if (!isIdentifier(c) && c != '.' && c != '\'' && !exponentSign)
+                break;
+
+            i++;
+        }
+
+        return i;
+    }
+
+    size_t skipIdentifier(std::string_view line, size_t begin) noexcept {
+        size_t i = begin;
+        while (i < line.size() && isIdentifier(line[i]))
+            i++;
+
+        return i;
+    }
+
+    State lexCpp(std::string_view line, State state, const Emitter& emit) {
+        size_t i = 0;
+
+        // Finish what the previous line started.
+        if (state == BlockComment) {
+            size_t end = line.find("*/");
+            if (end == std::string_view::npos) {
+                emit(0, line.size(), Token::Comment);
+                return BlockComment;
+            }
+
+            emit(0, end + 2, Token::Comment);
+            i = end + 2;
+        }
+        else if (state == StringContinued) {
+            size_t end = findStringEnd(line, 0, '"');
+            if (end == std::string_view::npos) {
+                emit(0, line.size(), Token::String);
+                return endsWithBackslash(line) ? StringContinued : Normal;
+            }
+
+            emit(0, end, Token::String);
+            i = end;
+        }
+        else if (state == DirectiveContinued) {
+            emit(0, line.size(), Token::Preprocessor);
+            return endsWithBackslash(line) ? DirectiveContinued : Normal;
+        }
+
+        while (i < line.size()) {
+            char c = line[i];
+            char next = (i + 1 < line.size()) ? line[i + 1] : '\0';
+
+            if (c == ' ' || c == '\t') {
+                i++;
+            }
+            else if (c == '/' && next == '/') {
+                emit(i, line.size(), Token::Comment);
+                return Normal;
+            }
+            else if (c == '/' && next == '*') {
+                size_t end = line.find("*/", i + 2);
+                if (end == std::string_view::npos) {
+                    emit(i, line.size(), Token::Comment);
+                    return BlockComment;
+                }
+
+                emit(i, end + 2, Token::Comment);
+                i = end + 2;
+            }
+            else if (c == '#' && line.find_first_not_of(" \t") == i) {
+                // The directive runs up to a comment, or on to the next line after a backslash.
+                size_t end = std::min(line.find("//", i), line.find("/*", i));
+                if (end == std::string_view::npos) {
+                    emit(i, line.size(), Token::Preprocessor);
+                    return endsWithBackslash(line) ? DirectiveContinued : Normal;
+                }
+
+                emit(i, end, Token::Preprocessor);
+                i = end;
+            }
+            else if (c == '"' || c == '\'') {
+                size_t end = findStringEnd(line, i + 1, c);
+                if (end == std::string_view::npos) {
+                    emit(i, line.size(), Token::String);
+                    return (c == '"' && endsWithBackslash(line)) ? StringContinued : Normal;
+                }
+
+                emit(i, end, Token::String);
+                i = end;
+            }
+            else if (isDigit(c) || (c == '.' && isDigit(next))) {
+                size_t end = skipNumber(line, i);
+                emit(i, end, Token::Number);
+                i = end;
+            }
+            else if (isIdentifierStart(c)) {
+                size_t end = skipIdentifier(line, i);
+                std::string_view word = line.substr(i, end - i);
+
+                if (contains(cppKeywords, word))
+                    emit(i, end, Token::Keyword);
+                else if (contains(cppTypes, word) || (word.size() > 2 && word.substr(word.size() - 2) == "_t"))
+                    emit(i, end, Token::Type);
+
+                i = end;
+            }
+            else {
+                i++;
+            }
+        }
+
+        return Normal;
+    }
+
+    State lexJson(std::string_view line, const Emitter& emit) {
+        size_t i = 0;
+
+        while (i < line.size()) {
+            char c = line[i];
+
+            if (c == '"') {
+                size_t end = findStringEnd(line, i + 1, '"');
+                end = (end == std::string_view::npos) ? line.size() : end;
+
+                // A string followed by a colon is the key of an object.
+                size_t next = line.find_first_not_of(" \t", end);
+                emit(i, end, (next != std::string_view::npos && line[next] == ':') ? Token::Key : Token::String);
+                i = end;
+            }
+            else if (isDigit(c) || (c == '-' && i + 1 < line.size() && isDigit(line[i + 1]))) {
+                size_t end = skipNumber(line, i);
+                emit(i, end, Token::Number);
+                i = end;
+            }
+            else if (isIdentifierStart(c)) {
+                size_t end = skipIdentifier(line, i);
+                if (contains(jsonLiterals, line.substr(i, end - i)))
+                    emit(i, end, Token::Keyword);
+
+                i = end;
+            }
+            else {
+                i++;
+            }
+        }
+
+        // Strings can't span lines, there's nothing to carry over.
+        return Normal;
+    }
+
+    /**
+     * @returns The column past a timestamp at the start of a log line, e.g.
+     *          "2024-05-01 12:00:00.123" or "[12:00:00]", or 0 if there is none.
+     */
+    size_t skipTimestamp(std::string_view line) noexcept {
+        size_t i = (!line.empty() && line[0] == '[') ? 1 : 0;
+        if (i >= line.size() || !isDigit(line[i]))
+            return 0;
+
+        size_t end = i;
+        bool separated = false;
+
+        for (; i < line.size(); i++) {
+            char c = line[i];
+            if (c == ':' || c == '-' || c == '/')
+                separated = true;
+            else if (!isDigit(c) && c != '.' && c != ',' && c != 'T' && c != 'Z' && c != '+' && c != ' ')
+                break;
+
+            // Trailing spaces aren't part of it.
+            if (c != ' ')
+                end = i + 1;
+        }
+
+        if (!separated)
+            return 0;
+
+        if (line[0] == '[')
+            return (end < line.size() && line[end] == ']') ? end + 1 : 0;
+
+        return end;
+    }
+
+    State lexLog(std::string_view line, const Emitter& emit) {
+        size_t i = skipTimestamp(line);
+        emit(0, i, Token::Timestamp);
+
+        while (i < line.size()) {
+            char c = line[i];
+
+            if (c == '"') {
+                size_t end = findStringEnd(line, i + 1, '"');
+                end = (end == std::string_view::npos) ? line.size() : end;
+
+                emit(i, end, Token::String);
+                i = end;
+            }
+            else if (isDigit(c)) {
+                size_t end = skipNumber(line, i);
+                emit(i, end, Token::Number);
+                i = end;
+            }
+            else if (isIdentifierStart(c)) {
+                size_t end = skipIdentifier(line, i);
+
+                // Levels are matched regardless of case, e.g. "Error" and "ERROR".
+                std::string_view word = line.substr(i, end - i);
+                char upper[8];
+
+                if (word.size() <= sizeof(upper)) {
+                    for (size_t j = 0; j < word.size(); j++)
+                        upper[j] = static_cast<char>(std::toupper(static_cast<unsigned char>(word[j])));
+
+                    std::string_view key(upper, word.size());
+                    auto level = std::lower_bound(logLevels.begin(), logLevels.end(), key,
+                                                  [](const LogLevel& level, std::string_view key) { return level.word < key; });
+
+                    if (level != logLevels.end() && level->word == key)
+                        emit(i, end, level->token);
+                }
+
+                i = end;
+            }
+            else {
+                i++;
+            }
+        }
+
+        return Normal;
+    }
+}
+
+SyntaxHighlighter::SyntaxHighlighter(const Document& document) :
+    m_Document(document), m_Language(Language::Plain), m_States(), m_Dirty(), m_LinesLexed(0) {}
+
+SyntaxHighlighter::Language SyntaxHighlighter::detect(const std::filesystem::path& path) {
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+
+    static constexpr std::array<std::string_view, 10> cppExtensions = {
+        ".c", ".cc", ".cpp", ".cxx", ".h", ".hh", ".hpp", ".hxx", ".inl", ".ipp"
+    };
+
+    if (std::find(cppExtensions.begin(), cppExtensions.end(), extension) != cppExtensions.end())
+        return Language::Cpp;
+    if (extension == ".json")
+        return Language::Json;
+    if (extension == ".log")
+        return Language::Log;
+
+    return Language::Plain;
+}
+
+void SyntaxHighlighter::setLanguage(Language language) noexcept {
+    m_Language = language;
+    m_States.clear();
+    m_Dirty = {};
+}
+
+SyntaxHighlighter::Language SyntaxHighlighter::getLanguage() const noexcept {
+    return m_Language;
+}
+
+void SyntaxHighlighter::onLinesChanged(size_t firstRow, size_t lineCountBefore) {
+    // Nothing was lexed there yet.
+    if (firstRow >= m_States.size())
+        return;
+
+    size_t lineCount = m_Document.getLineCount();
+    size_t last = firstRow + 1;
+
+    // The states of the rows below the edit move along with them, the
+    // new rows get the state of the edited one until they're lexed.
+    if (lineCount > lineCountBefore) {
+        size_t added = lineCount - lineCountBefore;
+        m_States.insert(m_States.begin() + firstRow + 1, added, m_States[firstRow]);
+        last += added;
+    }
+    else if (lineCount < lineCountBefore) {
+        auto begin = m_States.begin() + firstRow + 1;
+        size_t removed = std::min(lineCountBefore - lineCount, static_cast<size_t>(m_States.end() - begin));
+        m_States.erase(begin, begin + removed);
+    }
+
+    if (m_Dirty.empty()) {
+        m_Dirty = { firstRow, last };
+        return;
+    }
+
+    // The rows that were edited before moved along as well.
+    if (m_Dirty.last > firstRow + 1)
+        m_Dirty.last = std::max(m_Dirty.last + lineCount - lineCountBefore, firstRow + 1);
+
+    m_Dirty = { std::min(m_Dirty.first, firstRow), std::max(m_Dirty.last, last) };
+}
+
+void SyntaxHighlighter::invalidateFrom(size_t firstRow) noexcept {
+    if (firstRow < m_States.size())
+        m_States.resize(firstRow);
+
+    if (!m_Dirty.empty() && m_Dirty.first >= m_States.size())
+        m_Dirty = {};
+}
+
+void SyntaxHighlighter::lexUpTo(size_t lastRow) {
+    if (m_Language == Language::Plain)
+        return;
+
+    lastRow = std::min(lastRow, m_Document.getLineCount());
+
+    const auto startState = [this](size_t row) { return (row == 0) ? initialState : m_States[row - 1]; };
+
+    // Lex the edited rows again, until a row past them ends in the same state as it
+    // did before. Every row below that one starts the same way, so it didn't change.
+    if (!m_Dirty.empty()) {
+        for (size_t row = m_Dirty.first; row < m_States.size(); row++) {
+            // Not needed yet, the rest is lexed again later.
+            if (row >= lastRow) {
+                m_Dirty.first = row;
+                return;
+            }
+
+            State before = m_States[row];
+            m_States[row] = lexRow(row, startState(row));
+
+            if (row + 1 >= m_Dirty.last && m_States[row] == before)
+                break;
+        }
+
+        m_Dirty = {};
+    }
+
+    // Lex the rows that never were.
+    while (m_States.size() < lastRow)
+        m_States.push_back(lexRow(m_States.size(), startState(m_States.size())));
+}
+
+bool SyntaxHighlighter::lexAhead(size_t maxLines) {
+    if (m_Language == Language::Plain)
+        return false;
+
+    size_t lineCount = m_Document.getLineCount();
+    lexUpTo(std::min(m_States.size() + maxLines, lineCount));
+
+    return !m_Dirty.empty() || m_States.size() < lineCount;
+}
+
+SyntaxHighlighter::State SyntaxHighlighter::getStartState(size_t row) {
+    if (m_Language == Language::Plain || row == 0)
+        return initialState;
+
+    lexUpTo(row);
+    return (row - 1 < m_States.size()) ? m_States[row - 1] : initialState;
+}
+
+SyntaxHighlighter::State SyntaxHighlighter::lex(std::string_view line, State state, std::vector<Span>& spans) const {
+    spans.clear();
+    return lexLine(line, state, &spans);
+}
+
+uint64_t SyntaxHighlighter::getLinesLexed() const noexcept {
+    return m_LinesLexed;
+}
+
+SyntaxHighlighter::State SyntaxHighlighter::lexRow(size_t row, State state) {
+    m_LinesLexed++;
+    return lexLine(m_Document.line(row).value_or(std::string_view()), state, nullptr);
+}
+
+SyntaxHighlighter::State SyntaxHighlighter::lexLine(std::string_view line, State state, std::vector<Span>* spans) const {
+    Emitter emit{ spans };
+
+    switch (m_Language) {
+    case Language::Cpp:     return lexCpp(line, state, emit);
+    case Language::Json:    return lexJson(line, emit);
+    case Language::Log:     return lexLog(line, emit);
+    default:                return initialState;
+    }
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+#include "Document.h"
+#include "RowRange.hpp"
+
+/**
+ * @brief   Splits the lines of a document into colored spans, e.g. keywords and comments.
+ *
+ *          The lexer only carries a small state from one line to the next, like being
+ *          inside a block comment. That state is stored at the end of every line that was
+ *          lexed, so any line can be lexed on its own, starting from the state of the one
+ *          above it. After an edit, only the lines from the edited one onwards are lexed
+ *          again, and only until their end states match the stored ones again.
+ *
+ *          Lines are lexed lazily, up to the last one that is needed, so the first
+ *          screen is highlighted without looking at the rest of the document.
+ *
+ * @note    Doesn't store any spans, those are produced again whenever a line is laid out.
+ */
+class SyntaxHighlighter {
+public:
+    enum class Language : uint8_t {
+        Plain,  // No highlighting.
+        Cpp,    // C and C++.
+        Json,
+        Log,    // Timestamps, log levels, strings and numbers.
+    };
+
+    /**
+     * @brief   What a span of text is, which decides its color.
+     */
+    enum class Token : uint8_t {
+        Text,           // Anything else, drawn in the regular text color.
+        Keyword,
+        Type,
+        Number,
+        String,
+        Comment,
+        Preprocessor,
+        Key,            // The key of a JSON object.
+        Timestamp,
+        Error,
+        Warning,
+        Info,
+        Count
+    };
+
+    /**
+     * @brief   A span of a line, [begin, end) in columns.
+     */
+    struct Span {
+        size_t begin, end;
+        Token token;
+    };
+
+    /**
+     * @brief   What the lexer carries from the end of one line to the start of the next.
+     */
+    using State = uint8_t;
+
+    static constexpr State initialState = 0;
+
+    /**
+     * @param document  The document to highlight. Must outlive the SyntaxHighlighter.
+     */
+    explicit SyntaxHighlighter(const Document& document);
+
+    /**
+     * @brief   Picks a language by the extension of a file.
+     */
+    static Language detect(const std::filesystem::path& path);
+
+    /**
+     * @brief   Switches to another language, and forgets every stored state.
+     */
+    void setLanguage(Language language) noexcept;
+
+    Language getLanguage() const noexcept;
+
+    /**
+     * @brief                   Adjusts the stored states to an edit that started on @p firstRow.
+     *
+     * @note                    If the edit added or removed lines, the states of the rows below
+     *                          it move along, so that they can still be compared after the edit.
+     *
+     * @param lineCountBefore   The amount of lines before the edit.
+     */
+    void onLinesChanged(size_t firstRow, size_t lineCountBefore);
+
+    /**
+     * @brief   Forgets the stored states from @p firstRow onwards, e.g. after
+     *          an edit that isn't known row by row. They are lexed again lazily.
+     */
+    void invalidateFrom(size_t firstRow) noexcept;
+
+    /**
+     * @brief   Makes sure the states of the rows [0, lastRow) are up to date.
+     *
+     * @note    Only lexes the rows that were edited, until the states converge,
+     *          and the rows that were never lexed before.
+     */
+    void lexUpTo(size_t lastRow);
+
+    /**
+     * @brief   Lexes up to @p maxLines more rows that were never lexed,
+     *          so that jumping far down the document later is cheap.
+     *
+     * @returns True if there are rows left to lex.
+     */
+    bool lexAhead(size_t maxLines);
+
+    /**
+     * @brief   Gets the state at the start of a row, lexing the rows above it if needed.
+     */
+    State getStartState(size_t row);
+
+    /**
+     * @brief       Splits a line into spans.
+     *
+     * @param state The state at the start of the line, see getStartState().
+     * @param spans Overwritten with the spans of the line, in order. Columns
+     *              that aren't covered by any span are Token::Text.
+     *
+     * @returns     The state at the end of the line.
+     */
+    State lex(std::string_view line, State state, std::vector<Span>& spans) const;
+
+    /**
+     * @brief   Get how many lines were lexed to find their states so far.
+     *
+     * @note    Only ever goes up. Compare two snapshots to see what an edit cost.
+     */
+    uint64_t getLinesLexed() const noexcept;
+
+private:
+    /**
+     * @brief   Lexes a row of the document, only to find its end state.
+     */
+    State lexRow(size_t row, State state);
+
+    /**
+     * @brief   Lexes a line, only adding spans to @p spans if it isn't nullptr.
+     */
+    State lexLine(std::string_view line, State state, std::vector<Span>* spans) const;
+
+    const Document& m_Document;
+    Language m_Language;
+
+    std::vector<State> m_States;    // The state at the end of every row that was lexed, from the first one on.
+    RowRange m_Dirty;               // Lexing resumes at 'first', and doesn't stop before 'last', even if the states match.
+    uint64_t m_LinesLexed;
+};
@@ -1,19 +1,26 @@
+#include <algorithm>
+#include <iterator>
+#include <limits>
 #include <optional>
+#include <tuple>
+#include <utility>
 
 #include "FontManager.hpp"
+#include "GlyphCache.h"
 #include "TextBox.h"
 #include "Text.h"
+#include "Utf8.h"
 
-Text::Text(TextBox* owner) : m_Owner(owner), m_Text(), m_Highlights() {
+Text::Text(TextBox* owner) : m_Owner(owner), m_TextBatch(), m_HighlightBatch(), m_Highlights(),
+                              m_LineCache(), m_LineCacheFontSize(0), m_LineCacheColor(), m_LinesLaidOut(0), m_Spans(),
+                              m_Wrap(false), m_VisualRows(), m_WrapWidth(0), m_WrapFontSize(0), m_WrapPoints(), m_WrapScratch(),
+                              m_LineOffsets(), m_LineOffsetsFontSize(0) {
     updateText();
 }
 
 void Text::draw(sf::RenderTarget& target, sf::RenderStates states) const {
-    for (const auto& highlight : m_Highlights)
-        target.draw(highlight, states);
-
-    for (const auto& font : m_Text)
-        target.draw(font, states);
+    target.draw(m_HighlightBatch, states);
+    target.draw(m_TextBatch, states);
 }
 
 void Text::update(double deltaTime) {}
@@ -21,18 +28,310 @@ void Text::update(double deltaTime) {}
 void Text::onTransformChanged(sf::Vector2f oldPos, sf::Vector2f oldSize) {
     sf::Vector2f deltaPos = m_Position - oldPos;
 
-    for (size_t i = 0; i < m_Text.size(); i++)
-        m_Text[i].move(deltaPos);
+    m_TextBatch.move(deltaPos);
+}
+
+RowRange Text::getVisibleRows() const noexcept {
+    const auto& ownerTheme = m_Owner->getTheme();
+    float lineHeight = ownerTheme.lineMargin + ownerTheme.fontSize;
+
+    // Anything within the overscan of the view the rows were last laid out around is considered in frame,
+    // so that scrolling within it only moves the view. See TextBox::updateBand().
+    float viewYOffset = m_Owner->getPosition().y + m_Owner->getBandScroll().y;
+    float overscan = m_Owner->getOverscan().y;
+    float minY = viewYOffset - overscan, maxY = viewYOffset + m_Size.y + overscan;
+    size_t lineCount = m_Owner->getDocument().getLineCount();
+
+    if (!m_Wrap)
+        return RowRange::fromBounds(m_Position.y, lineHeight, minY, maxY, lineCount);
+
+    // The visual rows in frame, and the rows they belong to.
+    RowRange visual = RowRange::fromBounds(m_Position.y, lineHeight, minY, maxY, m_VisualRows.getVisualRowCount());
+    if (visual.empty())
+        return {};
+
+    size_t first = m_VisualRows.fromVisualRow(visual.first).first;
+    size_t last = m_VisualRows.fromVisualRow(visual.last - 1).first + 1;
+
+    return { std::min(first, lineCount), std::min(last, lineCount) };
+}
+
+std::pair<float, float> Text::getVisibleX() const noexcept {
+    // Like getVisibleRows(), but sideways. The text starts to the right of the gutter.
+    float viewX = m_Owner->getPosition().x + m_Owner->getBandScroll().x - m_Position.x;
+    float overscan = m_Owner->getOverscan().x;
+
+    return { viewX - overscan, viewX + m_Size.x + overscan };
+}
+
+Text::Slice Text::getSlice(size_t row) const {
+    size_t length = m_Owner->getDocument().getLineLength(row);
+    if (length < minSlicedLength)
+        return { 0, length, { 0, 0 } };
+
+    const auto& ownerTheme = m_Owner->getTheme();
+    float lineHeight = ownerTheme.lineMargin + ownerTheme.fontSize;
+
+    // Only the visual rows in frame, each of which starts at a wrap point.
+    if (m_Wrap) {
+        const auto& wrapPoints = getWrapPoints(row);
+        const auto segmentStart = [&](size_t segment) {
+            return (segment == 0) ? 0 : (segment <= wrapPoints.size()) ? wrapPoints[segment - 1] : length;
+        };
+
+        float viewY = m_Owner->getPosition().y + m_Owner->getBandScroll().y;
+        float overscan = m_Owner->getOverscan().y;
+        RowRange segments = RowRange::fromBounds(m_Position.y + getRowY(row), lineHeight, viewY - overscan,
+                                                 viewY + m_Size.y + overscan, wrapPoints.size() + 1);
+
+        return { segmentStart(segments.first), segmentStart(segments.last), { 0, lineHeight * segments.first } };
+    }
+
+    auto [left, right] = getVisibleX();
+    const GlyphCache& glyphs = GlyphCache::get(FontManager::getFont(), ownerTheme.fontSize);
+
+    if (hasUniformColumns(row, glyphs)) {
+        float advance = glyphs.getMonospaceAdvance();
+        size_t begin = std::min(static_cast<size_t>(std::max(left, 0.f) / advance), length);
+        size_t end = std::min(static_cast<size_t>(std::max(right, 0.f) / advance) + 1, length);
+
+        return { begin, std::max(begin, end), { begin * advance, 0 } };
+    }
+
+    // Otherwise, cut at the checkpoints on either side of the view, which are at the start of a character.
+    auto line = m_Owner->getDocument().line(row).value_or(std::string_view());
+    const auto& checkpoints = measureLine(row, line, glyphs, CursorLocation::invalidIndex, right).checkpoints;
+    const auto byX = [](float x, const Checkpoint& checkpoint) { return x < checkpoint.x; };
+
+    auto first = std::upper_bound(checkpoints.begin(), checkpoints.end(), left, byX);
+    auto last = std::upper_bound(first, checkpoints.end(), right, byX);
+    if (first != checkpoints.begin())
+        --first;
+
+    return { first->col, (last != checkpoints.end()) ? last->col : length, { first->x, 0 } };
 }
 
-sf::Text Text::buildText(const std::string& str, uint32_t fontSize, sf::Vector2f pos, const sf::Color& color) const noexcept {
-    sf::Text text(FontManager::getFont());
-    text.setString(str);
-    text.setPosition(pos);
-    text.setFillColor(color);
-    text.setCharacterSize(fontSize);
+void Text::setWrap(bool wrap) {
+    if (wrap == m_Wrap || !m_Owner)
+        return;
+
+    m_Wrap = wrap;
+    m_VisualRows.reset(wrap ? m_Owner->getDocument().getLineCount() : 0);
+    m_WrapWidth = getWrapWidth(); m_WrapFontSize = m_Owner->getTheme().fontSize;
+    m_WrapPoints.clear();
+
+    // The cached lines were laid out on a single visual row each, or the other way around.
+    m_LineCache.clear();
+}
+
+bool Text::isWrapping() const noexcept {
+    return m_Wrap;
+}
+
+void Text::onLinesChanged(size_t firstRow, size_t lineCountBefore) {
+    size_t lineCount = m_Owner->getDocument().getLineCount();
+
+    // If lines were added or removed, the cached rows below the edit aren't the same rows anymore.
+    const auto forget = [&](auto& cache) {
+        if (lineCount == lineCountBefore) {
+            cache.erase(firstRow);
+            return;
+        }
+
+        for (auto it = cache.begin(); it != cache.end();)
+            it = (it->first >= firstRow) ? cache.erase(it) : std::next(it);
+    };
+
+    forget(m_LineOffsets);
+
+    // The laid out rows below the edit only moved, the edited ones are laid out again.
+    if (lineCount == lineCountBefore) {
+        m_LineCache.erase(firstRow);
+    }
+    else {
+        size_t removed = (lineCountBefore > lineCount) ? lineCountBefore - lineCount : 0;
+        std::unordered_map<size_t, CachedLine> moved;
+
+        for (auto it = m_LineCache.begin(); it != m_LineCache.end();) {
+            if (it->first < firstRow) {
+                ++it;
+                continue;
+            }
+
+            if (it->first > firstRow + removed)
+                moved.emplace(it->first + lineCount - lineCountBefore, std::move(it->second));
+
+            it = m_LineCache.erase(it);
+        }
+
+        m_LineCache.merge(moved);
+    }
+
+    if (!m_Wrap)
+        return;
+
+    m_VisualRows.onLinesChanged(firstRow, lineCountBefore, lineCount);
+    forget(m_WrapPoints);
+}
+
+void Text::onDocumentChanged() {
+    m_LineOffsets.clear();
+    m_LineCache.clear();
+
+    if (!m_Wrap)
+        return;
+
+    // Keep the counts as estimates if the rows are still there, so that nothing jumps around until they're wrapped again.
+    size_t lineCount = m_Owner->getDocument().getLineCount();
+    if (m_VisualRows.getRowCount() == lineCount)
+        m_VisualRows.invalidate();
+    else
+        m_VisualRows.reset(lineCount);
+
+    m_WrapPoints.clear();
+}
+
+bool Text::wrapVisibleRows() {
+    if (!m_Wrap)
+        return false;
+
+    checkWrapWidth();
+
+    // Wrapping a row in frame can push the rows below it out of frame and pull others
+    // in, since they're all estimated to take up a single visual row until they're wrapped.
+    bool moved = false, stale = true;
+    while (stale) {
+        stale = false;
+        RowRange rows = getVisibleRows();
+
+        for (size_t row = rows.first; row < rows.last; row++) {
+            if (!m_VisualRows.isWrapped(row)) {
+                moved |= m_VisualRows.set(row, static_cast<uint32_t>(getWrapPoints(row).size() + 1));
+                stale = true;
+            }
+        }
+    }
+
+    return moved;
+}
+
+bool Text::wrapRow(size_t row) {
+    if (!m_Wrap)
+        return false;
+
+    checkWrapWidth();
+
+    if (row >= m_VisualRows.getRowCount() || m_VisualRows.isWrapped(row))
+        return false;
+
+    return m_VisualRows.set(row, static_cast<uint32_t>(getWrapPoints(row).size() + 1));
+}
+
+bool Text::wrapAhead(size_t maxLines) {
+    if (!m_Wrap)
+        return false;
+
+    checkWrapWidth();
+
+    const Document& document = m_Owner->getDocument();
+    const GlyphCache& glyphs = GlyphCache::get(FontManager::getFont(), m_WrapFontSize);
+    bool moved = false;
+
+    // These rows are only counted, their wrap points are found again if they come into frame.
+    for (size_t row = m_VisualRows.findStale(0); row < m_VisualRows.getRowCount() && maxLines > 0; row = m_VisualRows.findStale(row + 1), maxLines--) {
+        computeWrapPoints(document.line(row).value_or(std::string_view()), glyphs, m_WrapScratch);
+        moved |= m_VisualRows.set(row, static_cast<uint32_t>(m_WrapScratch.size() + 1));
+    }
+
+    return moved;
+}
+
+float Text::getRowY(size_t row) const noexcept {
+    const auto& ownerTheme = m_Owner->getTheme();
+    float lineHeight = ownerTheme.lineMargin + ownerTheme.fontSize;
+
+    return lineHeight * (m_Wrap ? m_VisualRows.toVisualRow(row) : row);
+}
+
+uint64_t Text::getVisualRowCount() const noexcept {
+    return m_Wrap ? m_VisualRows.getVisualRowCount() : m_Owner->getDocument().getLineCount();
+}
+
+float Text::getWrapWidth() const noexcept {
+    // The text starts to the right of the gutter, but ends where the TextBox does.
+    return std::max(m_Size.x - (m_Position.x - m_Owner->getPosition().x), 0.f);
+}
+
+void Text::checkWrapWidth() {
+    float width = getWrapWidth();
+    uint32_t fontSize = m_Owner->getTheme().fontSize;
+
+    if (width == m_WrapWidth && fontSize == m_WrapFontSize)
+        return;
+
+    m_WrapWidth = width; m_WrapFontSize = fontSize;
+
+    // The counts are kept as estimates until the rows are wrapped again, the rows in frame first.
+    m_VisualRows.invalidate();
+    m_WrapPoints.clear();
+    m_LineCache.clear();
+}
+
+const std::vector<size_t>& Text::getWrapPoints(size_t row) const {
+    static const std::vector<size_t> none;
+    if (!m_Wrap)
+        return none;
+
+    if (m_WrapPoints.size() >= maxCachedLines)
+        m_WrapPoints.clear();
+
+    auto [it, inserted] = m_WrapPoints.try_emplace(row);
+    if (inserted) {
+        const GlyphCache& glyphs = GlyphCache::get(FontManager::getFont(), m_WrapFontSize);
+        computeWrapPoints(m_Owner->getDocument().line(row).value_or(std::string_view()), glyphs, it->second);
+    }
+
+    return it->second;
+}
+
+void Text::computeWrapPoints(std::string_view line, const GlyphCache& glyphs, std::vector<size_t>& out) const {
+    out.clear();
+
+    // Nothing fits before the TextBox has a size.
+    if (m_WrapWidth <= 0)
+        return;
+
+    float x = 0;                // Relative to the start of the current visual row.
+    float breakX = 0;           // The x position at lastBreak.
+    size_t rowStart = 0;        // The column the current visual row starts at.
+    size_t lastBreak = 0;       // The column after the last whitespace on the current visual row, if past rowStart.
+    uint32_t prev = 0;
+
+    for (size_t col = 0; col < line.size();) {
+        uint32_t c;
+        size_t next = Utf8::decode(line, col, c);
+        bool space = (c == ' ' || c == '\t');
+        float advance = glyphs.getKerning(prev, c) + glyphs.getAdvance(c);
+
+        // Every visual row gets at least one character, no matter how narrow the text is.
+        if (x + advance > m_WrapWidth && col > rowStart && !space) {
+            size_t breakCol = (lastBreak > rowStart) ? lastBreak : col;
+            x = (breakCol == col) ? 0 : x - breakX;
+
+            out.push_back(breakCol);
+            rowStart = breakCol;
+        }
+
+        x += advance;
+        prev = c;
+
+        if (space) {
+            lastBreak = next;
+            breakX = x;
+        }
 
-    return text;
+        col = next;
+    }
 }
 
 void Text::updateText() {
@@ -40,31 +339,105 @@ void Text::updateText() {
         return;
 
     const auto& ownerTheme = m_Owner->getTheme();
-    float lineMargin = ownerTheme.lineMargin;
     uint32_t fontSize = ownerTheme.fontSize;
     const sf::Color& textColor = ownerTheme.textColor;
 
-    // Get the required variables to determine if the text is in frame. 
-    float viewYOffset = m_Owner->getPosition().y + m_Owner->getScroll().y;
-    float currentHeight = m_Size.y;
-    const auto& buffer = m_Owner->getBuffer();
+    const Document& document = m_Owner->getDocument();
+    const GlyphCache& glyphs = GlyphCache::get(FontManager::getFont(), fontSize);
+    RowRange rows = getVisibleRows();
 
-    // Clearing and rebuilding the text each time updateText is called
-    // might seem inefficient, but we're only rebuilding at most a few 
-    // dozen or so objects, so it won't be too inefficent. 
-    m_Text.clear();
+    // Only the rows above the last one in frame have to be lexed to color it.
+    SyntaxHighlighter& syntax = m_Owner->getSyntax();
+    syntax.lexUpTo(rows.last);
 
-    for (size_t i = 0; i < buffer.size(); i++) {
-        sf::Vector2 pos = { m_Position.x, m_Position.y + (lineMargin + fontSize) * i };
+    // Cached lines are only good for the font size and color they were laid out with.
+    if (m_LineCacheFontSize != fontSize || m_LineCacheColor != textColor) {
+        m_LineCache.clear();
+        m_LineCacheFontSize = fontSize; m_LineCacheColor = textColor;
+    }
 
-        // Do not add any text that is out of frame. 
-        if (pos.y < viewYOffset - currentHeight || pos.y > viewYOffset + currentHeight)
-            continue;
-        
-        const auto& line = buffer[i];
+    // Forget the lines that went out of frame.
+    for (auto it = m_LineCache.begin(); it != m_LineCache.end();)
+        it = rows.contains(it->first) ? std::next(it) : m_LineCache.erase(it);
+
+    // The batch keeps its memory between calls, so rebuilding
+    // it from the cached lines doesn't allocate.
+    m_TextBatch.clear();
+
+    for (size_t row = rows.first; row < rows.last; row++) {
+        auto [it, inserted] = m_LineCache.try_emplace(row);
+        CachedLine& cached = it->second;
+
+        // An edit above the line can change its colors without changing its contents, e.g. opening a comment.
+        SyntaxHighlighter::State state = syntax.getStartState(row);
+
+        Slice slice = getSlice(row);
+        bool moved = inserted || cached.sliceBegin != slice.begin || cached.sliceEnd != slice.end;
+
+        // Edited rows are gone from the cache, see onLinesChanged(), so the rest only has to be
+        // laid out again if the view moved over another part of it, or its colors changed.
+        if (moved || cached.state != state) {
+            // Only the part of the line that is lexed or laid out is read, see layOutLine().
+            size_t lineBegin = (slice.begin < maxLexedLength) ? 0 : slice.begin;
+            auto line = document.linePart(row, lineBegin, slice.end).value_or(std::string_view());
+
+            cached.glyphs.clear();
+            layOutLine(cached.glyphs, line, lineBegin, state, slice, getWrapPoints(row), glyphs);
+            cached.sliceBegin = slice.begin; cached.sliceEnd = slice.end;
+            cached.state = state;
+
+            m_LinesLaidOut++;
+        }
+
+        m_TextBatch.append(cached.glyphs, { m_Position.x, m_Position.y + getRowY(row) });
+    }
+}
+
+void Text::layOutLine(RenderBatch& batch, std::string_view line, size_t lineBegin, SyntaxHighlighter::State state, const Slice& slice,
+                      const std::vector<size_t>& wrapPoints, const GlyphCache& glyphs) {
+    const auto& ownerTheme = m_Owner->getTheme();
+    const sf::Color& textColor = ownerTheme.textColor;
+    float lineHeight = ownerTheme.lineMargin + ownerTheme.fontSize;
+
+    // The colors of the slice only depend on the line before its end. The
+    // slices that are lexed start before 'maxLexedLength', so they have all of it.
+    size_t lexedLength = std::min(slice.end, maxLexedLength);
+    if (slice.begin < lexedLength)
+        m_Owner->getSyntax().lex(line.substr(0, lexedLength), state, m_Spans);
+    else
+        m_Spans.clear();
+
+    float x = slice.origin.x, y = slice.origin.y;
+    size_t col = slice.begin;
+    auto wrap = std::upper_bound(wrapPoints.begin(), wrapPoints.end(), col);
+
+    // Adds the text up to 'end' in a color, moving to the next visual row at every wrap point on the way.
+    const auto addUntil = [&](size_t end, const sf::Color& color) {
+        end = std::min(end, slice.end);
 
-        m_Text.emplace_back(buildText(line, fontSize, pos, textColor));
+        while (col < end) {
+            if (wrap != wrapPoints.end() && *wrap == col) {
+                x = 0; y += lineHeight;
+                ++wrap;
+            }
+
+            size_t pieceEnd = (wrap != wrapPoints.end()) ? std::min(end, *wrap) : end;
+            x += batch.addText(line.substr(col - lineBegin, pieceEnd - col), { x, y }, glyphs, color);
+            col = pieceEnd;
+        }
+    };
+
+    // The text in between the spans is drawn in the regular color.
+    for (const auto& span : m_Spans) {
+        addUntil(span.begin, textColor);
+        addUntil(span.end, getTokenColor(span.token));
     }
+
+    addUntil(slice.end, textColor);
+}
+
+uint64_t Text::getLinesLaidOut() const noexcept {
+    return m_LinesLaidOut;
 }
 
 sf::Vector2f Text::findCharacterPos(CursorLocation pos) const {
@@ -72,55 +445,220 @@ sf::Vector2f Text::findCharacterPos(CursorLocation pos) const {
         return m_Position;
     
     const auto& ownerTheme = m_Owner->getTheme();
-    float lineMargin = ownerTheme.lineMargin;
+    float lineHeight = ownerTheme.lineMargin + ownerTheme.fontSize;
     uint32_t fontSize = ownerTheme.fontSize;
-    const sf::Color& textColor = ownerTheme.textColor;
 
+    // The line might not be rendered, so work out where it would be.
+    if (pos.m_Row >= m_Owner->getDocument().getLineCount())
+        return m_Position;
+
+    // A column at a wrap point is at the start of the next visual row.
+    const auto& wrapPoints = getWrapPoints(pos.m_Row);
+    size_t segment = std::upper_bound(wrapPoints.begin(), wrapPoints.end(), pos.m_Col) - wrapPoints.begin();
+    float segmentX = (segment > 0) ? findCharacterX({ pos.m_Row, wrapPoints[segment - 1] }, fontSize) : 0;
+
+    return { m_Position.x + findCharacterX(pos, fontSize) - segmentX,
+             m_Position.y + getRowY(pos.m_Row) + lineHeight * segment };
+}
+
+CursorLocation Text::findLocation(sf::Vector2f pos) const {
+    if (!m_Owner)
+        return { 0, 0 };
+
+    const auto& ownerTheme = m_Owner->getTheme();
+    float lineHeight = ownerTheme.lineMargin + ownerTheme.fontSize;
+    uint32_t fontSize = ownerTheme.fontSize;
+
+    const Document& document = m_Owner->getDocument();
+    uint64_t visualRow = static_cast<uint64_t>(std::max(pos.y - m_Position.y, 0.f) / lineHeight);
+
+    size_t row = 0, segment = 0;
+    if (m_Wrap)
+        std::tie(row, segment) = m_VisualRows.fromVisualRow(visualRow);
+    else
+        row = static_cast<size_t>(std::min<uint64_t>(visualRow, document.getLineCount() - 1));
+
+    // Only look at the columns on the visual row. Past the end of
+    // a wrapped one is the column right before the next one starts.
+    const auto& wrapPoints = getWrapPoints(row);
+    segment = std::min(segment, wrapPoints.size());
+
+    size_t low = (segment > 0) ? wrapPoints[segment - 1] : 0;
+    size_t high = (segment < wrapPoints.size()) ? wrapPoints[segment] - 1 : document.getLineLength(row);
+    size_t first = low, last = high;
+    float x = pos.x - m_Position.x + ((segment > 0) ? findCharacterX({ row, low }, fontSize) : 0);
+
+    // Unless every column is equally wide, only search in between the checkpoints around the
+    // position, so that clicking on a long line doesn't measure any of it past the click.
+    const GlyphCache& glyphs = GlyphCache::get(FontManager::getFont(), fontSize);
+    if (!hasUniformColumns(row, glyphs)) {
+        auto line = document.line(row).value_or(std::string_view());
+        const auto& checkpoints = measureLine(row, line, glyphs, high, x).checkpoints;
+
+        auto after = std::upper_bound(checkpoints.begin(), checkpoints.end(), x,
+                                      [](float x, const Checkpoint& checkpoint) { return x < checkpoint.x; });
+        if (after != checkpoints.begin())
+            low = std::clamp(std::prev(after)->col, low, high);
+        if (after != checkpoints.end())
+            high = std::clamp(after->col, low, high);
+    }
+
+    // Columns only ever get further to the right, so search for the
+    // first one past the position, then pick the closer of it and the one before.
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+
+        if (findCharacterX({ row, mid }, fontSize) < x)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    // The search went by byte, the cursor has to end up between two characters.
+    const ColumnMap& columns = m_Owner->getColumns();
+    size_t after = columns.snap(row, low);
+    if (after < low && columns.next(row, after) <= last)
+        after = columns.next(row, after);
+
+    size_t before = columns.prev(row, after);
+    if (after > first && before >= first && x - findCharacterX({ row, before }, fontSize) < findCharacterX({ row, after }, fontSize) - x)
+        after = before;
+
+    return { row, after };
+}
+
+float Text::findCharacterX(CursorLocation pos, uint32_t fontSize) const {
     auto [row, col] = pos;
 
-    // 'Simulate' the text, because it might not actually exist yet.
-    auto line = m_Owner->line(row);
-    if (!line.has_value())
-        return m_Position;
-       
-    // Create a new text object and place it where it would be, if it existed. 
-    sf::Vector2 strPos = { m_Position.x, m_Position.y + (lineMargin + fontSize) * row };
-    return buildText(line.value(), fontSize,strPos, sf::Color::Black).findCharacterPos(col);
+    // The start of a line is always at 0, no need to look at it.
+    if (col == 0)
+        return 0;
+
+    const Document& document = m_Owner->getDocument();
+    const GlyphCache& glyphs = GlyphCache::get(FontManager::getFont(), fontSize);
+
+    if (hasUniformColumns(row, glyphs))
+        return std::min(col, document.getLineLength(row)) * glyphs.getMonospaceAdvance();
+
+    // Out-of-range columns get the position past the last character, like sf::Text.
+    auto line = document.line(row).value_or(std::string_view());
+    col = std::min(col, line.size());
+
+    // The checkpoint at or before the column. The one for its interval can be a few bytes
+    // past it, if the character it's in started in the interval before.
+    const auto& checkpoints = measureLine(row, line, glyphs, col, std::numeric_limits<float>::infinity()).checkpoints;
+    size_t index = col / offsetInterval;
+    Checkpoint pen = (checkpoints[index].col <= col) ? checkpoints[index] : checkpoints[index - 1];
+
+    // A column within a character is placed after it, like sf::Text::findCharacterPos() does.
+    for (size_t pos = pen.col; pos < col;) {
+        uint32_t c;
+        pos = Utf8::decode(line, pos, c);
+
+        pen.x += glyphs.getKerning(pen.prev, c) + glyphs.getAdvance(c);
+        pen.prev = c;
+    }
+
+    return pen.x;
 }
 
-void Text::clearHighlight() noexcept {
-    m_Highlights.clear();
+bool Text::hasUniformColumns(size_t row, const GlyphCache& glyphs) const {
+    // Whether the line is printable ASCII is cached, so this doesn't even look at the line.
+    return glyphs.isMonospace() && m_Owner->getColumns().isPrintableAscii(row);
 }
 
-void Text::highlight(CursorLocation begin, CursorLocation end) noexcept {
-    clearHighlight();
+const Text::LineOffsets& Text::measureLine(size_t row, std::string_view line, const GlyphCache& glyphs, size_t col, float x) const {
+    uint32_t fontSize = glyphs.getCharacterSize();
+    if (m_LineOffsetsFontSize != fontSize || m_LineOffsets.size() >= maxCachedLines) {
+        m_LineOffsets.clear();
+        m_LineOffsetsFontSize = fontSize;
+    }
+
+    LineOffsets& offsets = m_LineOffsets[row];
+    auto& [checkpoints, measured] = offsets;
+    size_t lastIndex = std::min(col, line.size()) / offsetInterval;
+
+    while (checkpoints.size() <= lastIndex && (checkpoints.empty() || checkpoints.back().x <= x)) {
+        // The first character boundary of the next interval.
+        if (measured.col >= checkpoints.size() * offsetInterval) {
+            checkpoints.push_back(measured);
+            continue;
+        }
+
+        uint32_t c;
+        size_t next = Utf8::decode(line, measured.col, c);
+        measured = { next, measured.x + glyphs.getKerning(measured.prev, c) + glyphs.getAdvance(c), c };
+    }
 
-    if (!m_Owner || begin >= end)
+    return offsets;
+}
+
+void Text::setHighlights(HighlightLayer::Kind kind, std::vector<HighlightLayer::Range> ranges) {
+    m_Highlights.set(kind, std::move(ranges));
+}
+
+void Text::clearHighlights(HighlightLayer::Kind kind) noexcept {
+    m_Highlights.clear(kind);
+}
+
+void Text::updateHighlights() {
+    m_HighlightBatch.clear();
+
+    if (!m_Owner)
         return;
 
+    RowRange visible = getVisibleRows();
+
+    for (size_t i = 0; i < static_cast<size_t>(HighlightLayer::Kind::Count); i++) {
+        auto kind = static_cast<HighlightLayer::Kind>(i);
+        const sf::Color& color = getHighlightColor(kind);
+
+        m_Highlights.forEachInRows(kind, visible, [&](const HighlightLayer::Range& range) {
+            addHighlight(m_HighlightBatch, range.first, range.second, color, visible);
+        });
+    }
+}
+
+const sf::Color& Text::getHighlightColor(HighlightLayer::Kind kind) const noexcept {
     const auto& ownerTheme = m_Owner->getTheme();
-    uint32_t fontSize = ownerTheme.fontSize;
-    const auto& highlightColor = ownerTheme.selectedTextColor;
 
-    float yCenter = m_Owner->getPosition().y + m_Owner->getScroll().y;
-    float currentHeight = m_Size.y;
+    switch (kind) {
+    case HighlightLayer::Kind::Match:       return ownerTheme.matchHighlightColor;
+    case HighlightLayer::Kind::Diagnostic:  return ownerTheme.diagnosticHighlightColor;
+    case HighlightLayer::Kind::Bracket:     return ownerTheme.bracketHighlightColor;
+    default:                                return ownerTheme.selectedTextColor;
+    }
+}
+
+const sf::Color& Text::getTokenColor(SyntaxHighlighter::Token token) const noexcept {
+    const auto& ownerTheme = m_Owner->getTheme();
+
+    switch (token) {
+    case SyntaxHighlighter::Token::Keyword:         return ownerTheme.keywordColor;
+    case SyntaxHighlighter::Token::Type:            return ownerTheme.typeColor;
+    case SyntaxHighlighter::Token::Number:          return ownerTheme.numberColor;
+    case SyntaxHighlighter::Token::String:          return ownerTheme.stringColor;
+    case SyntaxHighlighter::Token::Comment:         return ownerTheme.commentColor;
+    case SyntaxHighlighter::Token::Preprocessor:    return ownerTheme.preprocessorColor;
+    case SyntaxHighlighter::Token::Key:             return ownerTheme.keyColor;
+    case SyntaxHighlighter::Token::Timestamp:       return ownerTheme.timestampColor;
+    case SyntaxHighlighter::Token::Error:           return ownerTheme.errorColor;
+    case SyntaxHighlighter::Token::Warning:         return ownerTheme.warningColor;
+    case SyntaxHighlighter::Token::Info:            return ownerTheme.infoColor;
+    default:                                        return ownerTheme.textColor;
+    }
+}
 
+void Text::addHighlight(RenderBatch& batch, CursorLocation begin, CursorLocation end,
+                        const sf::Color& color, RowRange visible) const {
     auto [beginRow, beginCol]   = begin;
     auto [endRow, endCol]       = end;
 
-    // Helper to get a highligt for single-line positions. 
-    static const auto getHighlight = 
-        [fontSize, highlightColor](sf::Vector2f startPos, sf::Vector2f endPos) -> sf::RectangleShape {
-        sf::RectangleShape shape({ endPos.x - startPos.x, static_cast<float>(fontSize) });
-        shape.setPosition(startPos);
-        shape.setFillColor(highlightColor);
-        return shape;
-    };
-
     if (beginRow == endRow) {
         // Case 1. Same line.
         // Only highlight the characters in between beginCol and endCol.
-        m_Highlights.push_back(getHighlight(findCharacterPos(begin), findCharacterPos(end)));
+        if (visible.contains(beginRow))
+            addRowHighlight(batch, beginRow, beginCol, endCol, color);
     }
     else {
         // Case 2. Different lines.
@@ -131,23 +669,55 @@ void Text::highlight(CursorLocation begin, CursorLocation end) noexcept {
         // 1. 
         // We use invalidIndex, as any out-of-bounds index gets the
         // position of the last character in the line. 
-        m_Highlights.push_back(getHighlight(findCharacterPos(begin),
-                                              findCharacterPos({begin.m_Row, CursorLocation::invalidIndex })));
+        if (visible.contains(beginRow))
+            addRowHighlight(batch, beginRow, beginCol, CursorLocation::invalidIndex, color);
 
         // 2.
-        m_Highlights.push_back(getHighlight(findCharacterPos({end.m_Row, 0}),
-                                              findCharacterPos(end)));
+        if (visible.contains(endRow))
+            addRowHighlight(batch, endRow, 0, endCol, color);
 
         // 3. 
-        for (size_t i = beginRow + 1; i < endRow; i++) {
-            // Make sure the highlight is in frame.
-            // TODO: What about culling 1. and 2.?
-            float highlightY = m_Position.y + fontSize * i;
-            if (highlightY < yCenter - currentHeight || highlightY > yCenter + currentHeight)
-                continue;
+        // Only the rows that are both in between and in frame.
+        size_t first = std::max(beginRow + 1, visible.first);
+        size_t last = std::min(endRow, visible.last);
 
-            m_Highlights.push_back(getHighlight(findCharacterPos({i, 0}),
-                                                  findCharacterPos({i, CursorLocation::invalidIndex})));
-        }
+        for (size_t i = first; i < last; i++)
+            addRowHighlight(batch, i, 0, CursorLocation::invalidIndex, color);
     }
-}
\ No newline at end of file
+}
+
+void Text::addRowHighlight(RenderBatch& batch, size_t row, size_t beginCol, size_t endCol, const sf::Color& color) const {
+    const auto& ownerTheme = m_Owner->getTheme();
+    float lineHeight = ownerTheme.lineMargin + ownerTheme.fontSize;
+    uint32_t fontSize = ownerTheme.fontSize;
+
+    // The line might not be rendered, like in findCharacterPos().
+    if (row >= m_Owner->getDocument().getLineCount())
+        return;
+
+    // Only the part of the row that can be in frame, like the text on it.
+    Slice slice = getSlice(row);
+    beginCol = std::max(beginCol, slice.begin);
+    endCol = std::min(endCol, slice.end);
+    if (beginCol > endCol)
+        return;
+
+    const auto& wrapPoints = getWrapPoints(row);
+    float y = m_Position.y + getRowY(row);
+
+    // One rectangle for every visual row the columns are on.
+    size_t segment = std::upper_bound(wrapPoints.begin(), wrapPoints.end(), beginCol) - wrapPoints.begin();
+    for (; segment <= wrapPoints.size(); segment++) {
+        size_t segmentBegin = (segment > 0) ? wrapPoints[segment - 1] : 0;
+        size_t segmentEnd = (segment < wrapPoints.size()) ? wrapPoints[segment] : CursorLocation::invalidIndex;
+
+        if (segmentBegin >= endCol && segmentBegin > beginCol)
+            break;
+
+        float segmentX = (segment > 0) ? findCharacterX({ row, segmentBegin }, fontSize) : 0;
+        float beginX = findCharacterX({ row, std::max(beginCol, segmentBegin) }, fontSize) - segmentX;
+        float endX = findCharacterX({ row, std::min(endCol, segmentEnd) }, fontSize) - segmentX;
+
+        batch.addRect({ m_Position.x + beginX, y + lineHeight * segment }, { endX - beginX, static_cast<float>(fontSize) }, color);
+    }
+}
@@ -2,9 +2,16 @@
 
 #include <unordered_map>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include "CursorLocation.hpp"
+#include "HighlightLayer.h"
+#include "RenderBatch.h"
+#include "RowRange.hpp"
+#include "SyntaxHighlighter.h"
+#include "VisualRows.h"
 #include "Drawable.hpp"
 #include "Config.hpp"
 
@@ -24,6 +31,8 @@ public:
 
     /**
      * @brief   Draw any text and highlights that have been created.
+     *
+     * @note    Takes two draw calls, no matter how much text or how many highlights there are.
      */
     void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
 
@@ -31,13 +40,77 @@ public:
     
     /**
      * @brief   When called, updates the text to be
-     *          rendered, by sourcing it from m_Owner->GetBuffer().
-     *          It then creates a new sf::Text object for each line
-     *          and saves it to m_Text. 
+     *          rendered, by sourcing it from m_Owner->getDocument().
+     *          It then writes the glyphs of each line to m_TextBatch.
      *          
-     * @note    Does not create text objects that are out-of-frame.
+     * @note    Only looks at the rows that are in frame.
+     * @note    Lines that weren't edited since the last call, and still start in the
+     *          same lexer state, are reused from m_LineCache instead of laid out again.
+     * @note    The rows in frame are lexed before anything below them.
+     * @note    Lines longer than a few screens are only laid out within the owner's
+     *          overscan to either side of the view, see getSlice(). A screen of a
+     *          single huge line costs about as much as a screen of short ones.
      */
     void updateText();
+
+    /**
+     * @brief   Turns wrapping long lines at the width of the text on or off.
+     *
+     * @note    Rows are wrapped lazily, see wrapVisibleRows() and wrapAhead().
+     */
+    void setWrap(bool wrap);
+
+    bool isWrapping() const noexcept;
+
+    /**
+     * @brief                   Lays out and re-wraps only the rows changed by an edit that started on @p firstRow.
+     *
+     * @note                    The laid out rows below the edit are kept, they only moved.
+     *
+     * @param lineCountBefore   The amount of lines before the edit.
+     */
+    void onLinesChanged(size_t firstRow, size_t lineCountBefore);
+
+    /**
+     * @brief   Lays out and re-wraps every row, since it isn't known which ones changed.
+     */
+    void onDocumentChanged();
+
+    /**
+     * @brief   Wraps the rows in frame that aren't wrapped yet, or were wrapped at another width.
+     *
+     * @returns True if any row now takes up a different amount of visual rows, which moves the rows below it.
+     */
+    bool wrapVisibleRows();
+
+    /**
+     * @brief   Wraps a single row, e.g. the one the cursor is on, even if it isn't in frame.
+     *
+     * @returns True if the row now takes up a different amount of visual rows.
+     */
+    bool wrapRow(size_t row);
+
+    /**
+     * @brief   Wraps up to @p maxLines more rows that aren't wrapped yet, from the top down.
+     *
+     * @returns True if any row now takes up a different amount of visual rows.
+     */
+    bool wrapAhead(size_t maxLines);
+
+    /**
+     * @brief   Get the y position of the top of a row, relative to the top of the text.
+     */
+    float getRowY(size_t row) const noexcept;
+
+    /**
+     * @brief   Get the amount of rows on screen, which is the amount of lines unless they're wrapped.
+     */
+    uint64_t getVisualRowCount() const noexcept;
+
+    /**
+     * @brief   Get how many lines updateText() has laid out so far.
+     */
+    uint64_t getLinesLaidOut() const noexcept;
     
     /**
      * @brief           Gets the position of a character at 
@@ -54,31 +127,218 @@ public:
     sf::Vector2f findCharacterPos(CursorLocation pos) const;
 
     /**
-     * @brief   Clears all highlights.
+     * @brief           Gets the location closest to a position, the opposite of findCharacterPos().
+     *
+     * @note            Positions above or below the text get the first or last line.
+     *
+     * @param   pos     The position, in the same coordinates as findCharacterPos().
      */
-    void clearHighlight() noexcept;
-    
+    CursorLocation findLocation(sf::Vector2f pos) const;
+
+    /**
+     * @brief           Replaces the highlighted ranges of a source.
+     *
+     * @note            Takes effect on the next updateHighlights().
+     *
+     * @param ranges    The begin and end of every range, in any order.
+     */
+    void setHighlights(HighlightLayer::Kind kind, std::vector<HighlightLayer::Range> ranges);
+
+    /**
+     * @brief   Removes the highlighted ranges of a source.
+     *
+     * @note    Takes effect on the next updateHighlights().
+     */
+    void clearHighlights(HighlightLayer::Kind kind) noexcept;
+
     /**
-     * @brief           Highlights all text in a range by drawing 
-     *                  sf::RectangleShapes below the highlighted text.
-     *                  These RectangleShapes are stored in m_Highlights.
+     * @brief   Draws rectangles below the highlighted text of every source
+     *          into m_HighlightBatch, each source in a color of its own.
      *
-     * @note            Does not create highlights that are out-of-frame.
-     * @note            It is required that minPos <= begin < end <= maxPos.
+     * @note    Only the rows that are in frame are looked at, so a range
+     *          over millions of rows costs no more than one on a single row.
+     */
+    void updateHighlights();
+
+    /**
+     * @brief   Get the rows that are in frame, given the scroll the owner's rows were last laid out around.
      *
-     * @param   begin   The begin position.
-     * @param   end     The end position.
+     * @note    Includes the owner's overscan above and below the view.
      */
-    void highlight(CursorLocation begin, CursorLocation end) noexcept;
+    RowRange getVisibleRows() const noexcept;
 private:
     /**
-     * @brief   When called, updates the position of all sf::Text objects in m_Text.               
+     * @brief   When called, updates the position of all glyphs in m_TextBatch.
      */
     void onTransformChanged(sf::Vector2f oldPos, sf::Vector2f oldSize) override;
-    
-    sf::Text buildText(const std::string& str, uint32_t fontSize, sf::Vector2f pos, const sf::Color& color) const noexcept;
+
+    /**
+     * @brief           Adds rectangles below the text in [begin, end) to @p batch,
+     *                  but only on the rows in @p visible.
+     */
+    void addHighlight(RenderBatch& batch, CursorLocation begin, CursorLocation end,
+                      const sf::Color& color, RowRange visible) const;
+
+    /**
+     * @brief   Gets the color the ranges of a source are highlighted in.
+     */
+    const sf::Color& getHighlightColor(HighlightLayer::Kind kind) const noexcept;
+
+    /**
+     * @brief   Gets the color text of a syntax token is drawn in.
+     */
+    const sf::Color& getTokenColor(SyntaxHighlighter::Token token) const noexcept;
+
+    /**
+     * @brief   The part of a line that is laid out, see getSlice().
+     */
+    struct Slice {
+        size_t begin, end;      // Columns, both at the start of a character.
+        sf::Vector2f origin;    // Where 'begin' goes, relative to the start of the line.
+    };
+
+    /**
+     * @brief   Gets the part of a row that can be in frame, given the scroll the owner's rows were last laid out around.
+     *
+     * @note    Short lines are always whole. Longer ones are cut around the view and
+     *          its overscan to either side, or when wrapping, to the visual rows in frame.
+     */
+    Slice getSlice(size_t row) const;
+
+    /**
+     * @brief   Get the x positions that are in frame, relative to the start of a line.
+     *
+     * @note    Includes the owner's overscan to either side of the view.
+     */
+    std::pair<float, float> getVisibleX() const noexcept;
+
+    /**
+     * @brief   Writes the glyphs of a slice of a line to @p batch, each span in the color of its token.
+     *          A new visual row is started at every column in @p wrapPoints.
+     *
+     * @note    Only the line up to the end of the slice is lexed, and no further than 'maxLexedLength'.
+     *
+     * @param line      The line from @p lineBegin up to the end of the slice.
+     * @param lineBegin The column @p line starts at. 0 unless the slice starts past
+     *                  'maxLexedLength', lexing needs everything before the slice.
+     */
+    void layOutLine(RenderBatch& batch, std::string_view line, size_t lineBegin, SyntaxHighlighter::State state, const Slice& slice,
+                    const std::vector<size_t>& wrapPoints, const GlyphCache& glyphs);
+
+    /**
+     * @brief   Adds rectangles below the columns [beginCol, endCol) of a row, one per visual row it spans.
+     */
+    void addRowHighlight(RenderBatch& batch, size_t row, size_t beginCol, size_t endCol, const sf::Color& color) const;
+
+    /**
+     * @brief   Get the width lines are wrapped at.
+     */
+    float getWrapWidth() const noexcept;
+
+    /**
+     * @brief   Forgets every wrapped row if the wrap width or the font size changed since they were wrapped.
+     */
+    void checkWrapWidth();
+
+    /**
+     * @brief   Gets the columns a row is wrapped at, wrapping it if it isn't cached.
+     *
+     * @note    Always empty when not wrapping.
+     */
+    const std::vector<size_t>& getWrapPoints(size_t row) const;
+
+    /**
+     * @brief   Finds the columns a line is wrapped at, where each visual row after the first starts.
+     *
+     * @note    Breaks after the last whitespace that fits, or right before the first character
+     *          that doesn't fit if there is none. Whitespace is allowed to hang past the width.
+     */
+    void computeWrapPoints(std::string_view line, const GlyphCache& glyphs, std::vector<size_t>& out) const;
+
+    /**
+     * @brief           Gets the x position of a column, relative to the start of its line.
+     *
+     * @note            With a monospace font, lines of printable ASCII are never looked at,
+     *                  see hasUniformColumns(). Other lines are measured up to the column
+     *                  once, see measureLine(), and walked from the checkpoint before it.
+     */
+    float findCharacterX(CursorLocation pos, uint32_t fontSize) const;
+
+    /**
+     * @brief   Checks if every column of a row is equally wide, i.e. a line of printable ASCII in a monospace font.
+     */
+    bool hasUniformColumns(size_t row, const GlyphCache& glyphs) const;
+
+    /**
+     * @brief   The pen position at a character boundary, which measuring a line can resume from.
+     */
+    struct Checkpoint {
+        size_t col;
+        float x;
+        uint32_t prev; // The character before 'col', which the one at it is kerned against.
+    };
+
+    /**
+     * @brief   The x positions of a line, as far as it was measured.
+     */
+    struct LineOffsets {
+        std::vector<Checkpoint> checkpoints;    // The first character boundary at or after every 'offsetInterval'th column.
+        Checkpoint measured = { 0, 0, 0 };      // Where measuring stopped.
+    };
+
+    /**
+     * @brief           Gets the offsets of a row, measuring it further if needed, until they
+     *                  cover @p col or there is a checkpoint past @p x, whichever comes first.
+     *
+     * @note            Only ever measures from where the last call stopped, until the row is
+     *                  edited or the font size changes. A view far into a long line measures
+     *                  everything before it once, and a view at its start never looks past it.
+     */
+    const LineOffsets& measureLine(size_t row, std::string_view line, const GlyphCache& glyphs, size_t col, float x) const;
+
+    // Lines measured by measureLine() are cached, up to this many at a time.
+    static constexpr size_t maxCachedLines = 4096;
+
+    // The columns between two checkpoints of a measured line, which have to be walked one character at a time.
+    static constexpr size_t offsetInterval = 256;
+
+    // Lines shorter than this are always laid out whole, cutting them up doesn't pay off.
+    static constexpr size_t minSlicedLength = 4096;
+
+    // Past this column, a line is drawn without syntax colors, so that a view far into a huge line
+    // doesn't lex everything before it every time it's laid out. See layOutLine().
+    static constexpr size_t maxLexedLength = size_t(1) << 20;
 
     TextBox* m_Owner;
-    std::vector<sf::Text> m_Text; 
-    std::vector<sf::RectangleShape> m_Highlights;
+    RenderBatch m_TextBatch, m_HighlightBatch;
+    HighlightLayer m_Highlights;
+
+    /**
+     * @brief   The glyphs of a line, laid out at (0, 0).
+     */
+    struct CachedLine {
+        RenderBatch glyphs;
+        size_t sliceBegin, sliceEnd; // The part of the line that was laid out, see getSlice().
+        SyntaxHighlighter::State state; // The lexer state the line started in, which changes its colors.
+    };
+
+    // The lines that were in frame during the last updateText(), by row.
+    std::unordered_map<size_t, CachedLine> m_LineCache;
+    uint32_t m_LineCacheFontSize;
+    sf::Color m_LineCacheColor;
+    uint64_t m_LinesLaidOut;
+    std::vector<SyntaxHighlighter::Span> m_Spans; // The spans of the line being laid out, reused for every line.
+
+    bool m_Wrap;
+    VisualRows m_VisualRows; // The visual rows of every row, only kept up to date while wrapping.
+    float m_WrapWidth; // The width the rows in m_VisualRows and m_WrapPoints were wrapped at.
+    uint32_t m_WrapFontSize;
+
+    // The columns recently used rows are wrapped at, by row.
+    mutable std::unordered_map<size_t, std::vector<size_t>> m_WrapPoints;
+    std::vector<size_t> m_WrapScratch; // The wrap points of rows that are only counted, reused for every row.
+
+    // The measured x positions of recently used lines, by row.
+    mutable std::unordered_map<size_t, LineOffsets> m_LineOffsets;
+    mutable uint32_t m_LineOffsetsFontSize;
 };
\ No newline at end of file
@@ -1,19 +1,25 @@
 #include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <utility>
 
 #include "TextBox.h"
 
 TextBox::TextBox(sf::Vector2f pos, sf::Vector2f size) :
-                    m_Buffer({ "" }), m_SelectPos(CursorLocation::npos()),
-                    m_Cursor(this), m_Text(this), m_LineIndicator(this),
-                    m_Background(size), m_LineHighlight(), m_Scroll(0.f, 0.f), 
-                    m_ShouldUpdateView(true), m_ShouldUpdateScroll(true) {
+                    Editor(), m_Cursor(this), m_Text(this), m_LineIndicator(this),
+                    m_Background(size), m_LineHighlight(), m_Scroll(0.f, 0.f),
+                    m_ScrollTarget(0.f), m_BandScroll(0.f, 0.f), m_Damage(), m_Counters(), m_ShouldRedraw(true) {
 
     setPosition(pos); setSize(size);
+    m_Text.setWrap(Config::Get().wordWrap);
 
     m_Background.setFillColor(m_Theme.backgroundColor);
     m_LineHighlight.setFillColor(m_Theme.lineHighlightColor);
 
     add(Config::Get().defaultText);
+
+    // The default text isn't something the user can undo.
+    clearHistory();
 }
 
 void TextBox::draw(sf::RenderTarget& target, sf::RenderStates states) const {
@@ -22,7 +28,8 @@ void TextBox::draw(sf::RenderTarget& target, sf::RenderStates states) const {
 
     sf::View textBoxView(m_Size / 2.0f, m_Size);
     textBoxView.setViewport({ {m_Position.x / windowSize.x, m_Position.y / windowSize.y}, {m_Size.x / windowSize.x, m_Size.y / windowSize.y} });
-    textBoxView.move(m_Position + m_Scroll);
+    // Glyphs drawn between pixels come out blurry, which a smooth scroll would do half of the time.
+    textBoxView.move(m_Position + sf::Vector2f(std::round(m_Scroll.x), std::round(m_Scroll.y)));
 
     target.setView(textBoxView);
 
@@ -38,506 +45,372 @@ void TextBox::draw(sf::RenderTarget& target, sf::RenderStates states) const {
 void TextBox::update(double deltaTime) noexcept {
     m_Cursor.update(deltaTime);
     m_Text.update(deltaTime); 
+    updateScroll(deltaTime);
 
-    updateView();
-    updateScroll();
-}
+    // Pick up the lines the background indexer found since the last frame,
+    // and whatever the background search found, e.g. a new match count.
+    updateIndex();
+    updateSearch();
+    updateAutosave();
 
-void TextBox::updateElements() {
-    m_Text.updateText();
-    m_LineIndicator.updateLines();
+    // Lex a bit further down every frame, so that jumping there later doesn't have to.
+    // It doesn't change anything in frame, so it isn't pending work either.
+    getSyntax().lexAhead(lexAheadLines);
 
-    if (isSelecting())
-        m_Text.highlight(std::min(m_SelectPos, getCursorLocation()), std::max(m_SelectPos, getCursorLocation()));
-    else
-        m_Text.clearHighlight(); // Prevent highlight from drawing after we've stopped selecting. 
+    // Likewise for wrapping, so that the rows stop moving around sooner.
+    updateWrap(wrapAheadLines);
 
-    // Set the position of the text. 
-    // Add the padding and the LineIndicator's text, so that it isn't covered.
-    m_Text.setPosition(m_Position + sf::Vector2f(m_Theme.lineIndicatorPad + m_LineIndicator.getSize().x, 0));
-}
-
-void TextBox::onTransformChanged(sf::Vector2f oldPos, sf::Vector2f oldSize) {
     updateElements();
-
-    // LineIndicator carries the position of the TextBox. 
-    m_LineIndicator.setPosition(m_Position);
-
-    m_Text.setSize(m_Size);
-    m_Background.setSize(m_Size);
-
-    // Make sure LineIndicator and LineHighlight fill the width and height respectively. 
-    m_LineIndicator.setSize({ m_LineIndicator.getSize().x, m_Size.y });
-    m_LineHighlight.setSize({ m_Size.x, static_cast<float>(m_Theme.fontSize) });
-
-    m_ShouldUpdateView = true; m_ShouldUpdateScroll = true;
 }
 
-void TextBox::updateView() {
-    if (!m_ShouldUpdateView)
-        return;
-
-    sf::Vector2f newCursorPos = m_Text.findCharacterPos(m_Cursor.current());
-    m_Cursor.setPosition(newCursorPos);
+void TextBox::onLinesChanged(size_t firstRow, size_t lineCountBefore) {
+    size_t lineCount = getLineCount();
+    m_Text.onLinesChanged(firstRow, lineCountBefore);
 
-    // Only ensure the cursor's visibility if a scroll update isn't already queued.
-    // This prevents the cursor visibility from overriding the scroll update. 
-    if (!m_ShouldUpdateScroll)
-        ensureCursorVisibility();
+    m_Damage.add(Damage::Lines);
+    if (lineCount != lineCountBefore)
+        m_Damage.add(Damage::Gutter);
 
-    updateElements();
-
-    // Prevent the background and highlight from going out of frame.  
-    m_LineHighlight.setPosition({ m_Position.x + m_Scroll.x, newCursorPos.y });
-    m_Background.setPosition(m_Position + m_Scroll);
-
-    m_ShouldUpdateView = false;
-}
-
-void TextBox::updateScroll() {
-    if (!m_ShouldUpdateScroll)
+    // Lines appended by indexing are below everything that was there, the cursor included.
+    if (firstRow >= lineCountBefore)
         return;
 
-    updateElements();
-
-    // We only care about the background when updating.
-    // The view itself is moved after it is created in Draw().
-    m_Background.setPosition(m_Position + m_Scroll);
-
-    m_ShouldUpdateScroll = false;
-}
-
-void TextBox::scrollUp() noexcept {
-    uint32_t fontSize = m_Theme.fontSize;
-    if (m_Scroll.y > fontSize)
-        m_Scroll.y -= fontSize;
-    else
-        m_Scroll.y = 0;
-
-    m_ShouldUpdateScroll = true;
-}
-
-void TextBox::scrollDown() noexcept {
-    uint32_t fontSize = m_Theme.fontSize;
-    float limit = fontSize * (getLineCount() - 1);
-    if (m_Scroll.y < limit)
-        m_Scroll.y += fontSize;
-    else
-        m_Scroll.y = limit;
-
-    m_ShouldUpdateScroll = true;
+    // The text under the cursor and the selection might have changed along with the lines.
+    m_Damage.add(Damage::Caret);
+    if (isSelecting())
+        m_Damage.add(Damage::Selection);
 }
 
-void TextBox::ensureCursorVisibility() noexcept {
-    auto [cursorX, cursorY] = m_Cursor.getPosition();
-    auto [cursorWidth, cursorHeight] = m_Cursor.getSize();
-    auto [textBoxX, textBoxY] = m_Position;
-    auto [textBoxWidth, textBoxHeight] = m_Size;
-    auto [lineIndicatorWidth, lineIndicatorHeight] = m_LineIndicator.getSize();
-    auto lineIndicatorPad = m_Theme.lineIndicatorPad;
-    auto& [scrollX, scrollY] = m_Scroll;
-
-    if (cursorY + cursorHeight - textBoxHeight > scrollY) {
-        scrollY = cursorY - textBoxHeight + cursorHeight;
-    }
-    if (cursorY - textBoxY < scrollY) {
-        scrollY = cursorY - textBoxY;
-    }
-
-    if (cursorX + cursorWidth - textBoxWidth > scrollX) {
-        scrollX = cursorX + cursorWidth - textBoxWidth;
-    }
-    if (cursorX - textBoxX - lineIndicatorWidth - lineIndicatorPad < scrollX) {
-        scrollX = cursorX - textBoxX - lineIndicatorWidth - lineIndicatorPad;
-    }
+void TextBox::onDocumentChanged() {
+    // It isn't known which rows changed, so every row in frame is laid out again.
+    m_Text.onDocumentChanged();
+    m_Damage.add(Damage::Lines | Damage::Gutter | Damage::Caret);
 }
 
-const std::vector<std::string>& TextBox::getBuffer() const noexcept {
-    return m_Buffer;
+void TextBox::onOpened() {
+    // The old scroll means nothing in the new document.
+    m_Scroll = { 0.f, 0.f };
+    m_ScrollTarget = 0.f;
+    m_Text.onDocumentChanged();
+    m_Damage.add(Damage::All);
 }
 
-sf::Vector2f TextBox::getScroll() const noexcept {
-    return m_Scroll;
+void TextBox::onCursorMoved() {
+    // Moving while selecting changes what is selected.
+    m_Damage.add(isSelecting() ? Damage::Caret | Damage::Selection : Damage::Caret);
 }
 
-std::optional<std::string> TextBox::line(size_t row) const noexcept {
-    if (row >= m_Buffer.size())
-        return std::nullopt;
-
-    return m_Buffer.at(row);
+void TextBox::onSelectionChanged() {
+    m_Damage.add(Damage::Selection);
 }
 
-CursorLocation TextBox::getCursorLocation() const noexcept {
-    return m_Cursor.current();
+void TextBox::onSearchChanged() {
+    m_Damage.add(Damage::Matches);
 }
 
-size_t TextBox::getLineCount() const noexcept {
-    return m_Buffer.size();
+void TextBox::onCaretsChanged() {
+    // Every caret has its own selection.
+    m_Damage.add(Damage::Caret | Damage::Selection);
 }
 
-std::optional<char> TextBox::getCharAt(const CursorLocation& pos) const noexcept {
-    auto [row, col] = pos;
+void TextBox::updateCaret() {
+    m_Counters.caretUpdates++;
 
-    // Make sure the position is within bounds.
-    // Check if the row isn't bigger than lineCount
-    // and the column isn't bigger than the line's size.
-    if (row >= getLineCount() || col >= m_Buffer.at(row).size())
-        return std::nullopt;
+    sf::Vector2f newCursorPos = m_Text.findCharacterPos(getCursorLocation());
+    m_Cursor.setPosition(newCursorPos);
 
-    return m_Buffer.at(row).at(col);
-}
+    // Only ensure the cursor's visibility if a scroll update isn't already queued.
+    // This prevents the cursor visibility from overriding the scroll update. 
+    if (!m_Damage.has(Damage::Scroll | Damage::View))
+        ensureCursorVisibility();
 
-std::optional<char> TextBox::getRightChar() const noexcept {
-    return getCharAt(getCursorLocation());
+    // Prevent the highlight from going out of frame.  
+    m_LineHighlight.setPosition({ m_Position.x + m_Scroll.x, newCursorPos.y });
 }
 
-std::optional<char> TextBox::getLeftChar() const noexcept {
-    return getCharAt(m_Cursor.prev());
-}
+void TextBox::updateCarets() {
+    const auto& carets = getExtraCarets();
+    RowRange visible = m_Text.getVisibleRows();
 
-void TextBox::add(char c) noexcept {
-    clearSelection();
+    // The carets are sorted, so the ones in frame are next to each other.
+    auto first = std::lower_bound(carets.begin(), carets.end(), visible.first,
+                                  [](const Caret& caret, size_t row) { return caret.location.m_Row < row; });
 
-    auto [row, col] = getCursorLocation();
-    auto& line = m_Buffer[row];
+    std::vector<sf::Vector2f> positions;
+    for (auto it = first; it != carets.end() && it->location.m_Row < visible.last; it++)
+        positions.push_back(m_Text.findCharacterPos(it->location));
 
-    // Insert an implicit newline.
-    if (c == '\n') {
-        // 1. Split the line at the cursor's position. 
-        // 3. Insert a new line and append the tail.
-        // 4. Move to the start of this new line. 
-        std::string tail = std::string(line.begin() + col, line.end());
-        line.erase(line.begin() + col, line.end()); // Erase the tail, so it isn't duplicated.
+    m_Cursor.setCarets(std::move(positions));
+}
 
-        m_Buffer.insert(m_Buffer.begin() + row + 1, {tail});
+void TextBox::updateWrap(size_t aheadLines) {
+    if (!m_Text.isWrapping())
+        return;
 
-        moveTo({ row + 1, 0 });
+    // Rows above the top of the view can take up more or fewer visual rows once they're
+    // wrapped. The view follows the row at its top, so that what's in frame stays in place.
+    size_t anchor = m_Text.findLocation(m_Position + m_Scroll).m_Row;
+    float anchorY = m_Text.getRowY(anchor);
 
-        return;
-    }
+    bool moved = m_Text.wrapVisibleRows();
+    moved |= m_Text.wrapRow(getCursorLocation().m_Row);
+    if (aheadLines > 0)
+        moved |= m_Text.wrapAhead(aheadLines);
 
-    // Insert a character normally, make sure it is valid.
-    if (!std::isprint(c))
+    if (!moved)
         return;
 
-    line.insert(line.begin() + col, c);
-    moveRight();
+    // A smooth scroll that is underway moves along with it.
+    float deltaY = m_Text.getRowY(anchor) - anchorY;
+    m_Scroll.y = std::max(m_Scroll.y + deltaY, 0.f);
+    m_ScrollTarget = std::max(m_ScrollTarget + deltaY, 0.f);
+    m_Damage.add(Damage::Scroll | Damage::View | Damage::Caret | Damage::Selection);
 }
 
-void TextBox::add(const std::string& str) noexcept {
-    for(const char c : str)
-        add(c);
-}
+void TextBox::updateElements() {
+    if (m_Damage.flags == Damage::None)
+        return;
 
-void TextBox::addTab() noexcept {
-    for(size_t i = 0; i < Config::Get().tabWidth; i++)
-        add(' ');
-}
+    m_Counters.updates++;
+    m_ShouldRedraw = true;
 
-bool TextBox::remove() noexcept {
-    if(clearSelection()) {
-        return true;
+    // The width of the gutter decides where the text, and therefore the cursor, goes.
+    // Add the padding and the LineIndicator's text, so that it isn't covered.
+    if (m_Damage.has(Damage::Gutter)) {
+        m_LineIndicator.updateWidth();
+
+        sf::Vector2f textPos = m_Position + sf::Vector2f(m_Theme.lineIndicatorPad + m_LineIndicator.getSize().x, 0);
+        if (textPos != m_Text.getPosition()) {
+            m_Text.setPosition(textPos);
+            m_Damage.add(Damage::Caret | Damage::Selection);
+        }
     }
 
-    // Do nothing if the cursor is on the first character.
-    if (m_Cursor.onFirstPos())
-        return false;
+    // Decide which rows are in frame before wrapping them.
+    updateBand();
 
-    auto [row, col] = getCursorLocation();
+    // The rows in frame have to be wrapped before anything is placed on them.
+    // It goes after the gutter, which decides the width they're wrapped at.
+    updateWrap(0);
 
-    // We're on the start of the line, delete the implicit new line. 
-    if (m_Cursor.onStartLine())
-        return removeRange({ row - 1, m_Buffer[row - 1].size() }, { row, col });
+    // Keeping the cursor in frame might scroll, so this goes before anything that depends on the scroll.
+    if (m_Damage.has(Damage::Caret))
+        updateCaret();
 
-    // Delete a character normally.
-    // -1 because we're deleting the character left of the cursor. 
-    return removeRange({ row, col - 1 }, { row, col });
-}
+    // That might have scrolled out of the overscan as well.
+    updateBand();
 
-bool TextBox::skipRemove() noexcept {
-    if(clearSelection()) {
-        return true;
+    if (!m_Damage.has(Damage::Scroll) && m_Damage.has(Damage::View))
+        m_Counters.viewMoves++;
+
+    if (m_Damage.has(Damage::Gutter | Damage::Scroll)) {
+        m_Counters.gutterUpdates++;
+        m_LineIndicator.updateLines();
     }
 
-    // Save the current cursor position, skip to the left,
-    // and delete all characters in between.
-    CursorLocation initial = getCursorLocation();
-    return skipLeft() && removeRange(getCursorLocation(), initial);
-}
+    // Rows that weren't edited and were already in frame are reused as they are.
+    if (m_Damage.has(Damage::Lines | Damage::Scroll)) {
+        m_Counters.textUpdates++;
+        m_Text.updateText();
+    }
 
-bool TextBox::removeRange(CursorLocation begin, CursorLocation end) noexcept {
-    // Ensure the range is actually valid. 
-    if (begin > m_Cursor.maxPos() ||
-        end > m_Cursor.maxPos() ||
-        begin > end)
-        return false;
+    // The other carets are culled, so scrolling moves them too.
+    if (m_Damage.has(Damage::Caret | Damage::Scroll))
+        updateCarets();
 
-    auto [beginRow, beginCol] = begin;
-    auto [endRow, endCol] = end;
+    // Empty when nothing is selected, which prevents the highlight from drawing after we've stopped selecting.
+    if (m_Damage.has(Damage::Selection))
+        m_Text.setHighlights(HighlightLayer::Kind::Selection, getSelectionRanges());
 
-    // First Case: On the same line.
-    if (beginRow == endRow) {
-        auto& line = m_Buffer[beginRow];
-        line.erase(line.begin() + beginCol, line.begin() + endCol);
+    // Only the matches in frame are looked for, edits can move them around as well.
+    if (m_Damage.has(Damage::Matches | Damage::Lines | Damage::Scroll)) {
+        RowRange visible = m_Text.getVisibleRows();
+        m_Text.setHighlights(HighlightLayer::Kind::Match, findMatches(visible.first, visible.last, maxVisibleMatches));
     }
-    // Second Case: Different lines.
-    else {
-        // 1. Split the endLine at endCol.
-        // 2. Delete everything between (beginRow, beginCol) and (endRow, endCol).
-        // 3. Append the tail to beginLine.
-
-        auto& beginLine = m_Buffer[beginRow];
-        auto& endLine = m_Buffer[endRow];
-
-        std::string tail = std::string(endLine.begin() + endCol, endLine.end());
 
-        endLine.erase(endLine.begin() + endCol, endLine.end());
-        beginLine.erase(beginLine.begin() + beginCol, beginLine.end());
+    // Highlights are culled, so scrolling moves them too.
+    if (m_Damage.has(Damage::Selection | Damage::Matches | Damage::Lines | Damage::Scroll)) {
+        m_Counters.highlightUpdates++;
+        m_Text.updateHighlights();
+    }
 
-        // Everything in between.
-        m_Buffer.erase(m_Buffer.begin() + beginRow + 1, m_Buffer.begin() + endRow + 1);
- 
-        beginLine.append(tail);
+    // Prevent the background and highlight from going out of frame.  
+    // The view itself is moved after it is created in Draw().
+    if (m_Damage.has(Damage::View)) {
+        m_Background.setPosition(m_Position + m_Scroll);
+        m_LineHighlight.setPosition({ m_Position.x + m_Scroll.x, m_LineHighlight.getPosition().y });
     }
 
-    return moveTo(begin);
+    m_Damage.clear();
 }
 
-bool TextBox::removeTab() noexcept {
-    for (size_t i = 0; i <= Config::Get().tabWidth; i++) {
-        if (getLeftChar() == ' ')
-            remove();
-        else
-            return i != 0;
-    }
+void TextBox::onTransformChanged(sf::Vector2f oldPos, sf::Vector2f oldSize) {
+    // LineIndicator carries the position of the TextBox. 
+    m_LineIndicator.setPosition(m_Position);
 
-    return true;
-}
+    m_Text.setSize(m_Size);
+    m_Background.setSize(m_Size);
 
-bool TextBox::isSelecting() const noexcept {
-    return m_SelectPos != CursorLocation::npos();
+    // Make sure LineIndicator and LineHighlight fill the width and height respectively. 
+    m_LineIndicator.setSize({ m_LineIndicator.getSize().x, m_Size.y });
+    m_LineHighlight.setSize({ m_Size.x, static_cast<float>(m_Theme.fontSize) });
+
+    m_Damage.add(Damage::All);
 }
 
-void TextBox::startSelecting() noexcept {
-    m_SelectPos = getCursorLocation();
-    m_ShouldUpdateView = true;
+void TextBox::scrollUp() noexcept {
+    scrollBy(-static_cast<float>(m_Theme.fontSize));
 }
 
-void TextBox::stopSelecting() noexcept {
-    m_SelectPos = CursorLocation::npos();
-    m_ShouldUpdateView = true;
+void TextBox::scrollDown() noexcept {
+    scrollBy(static_cast<float>(m_Theme.fontSize));
 }
 
-bool TextBox::clearSelection() noexcept {
-    if(!isSelecting())
-        return false;
+void TextBox::scrollBy(float deltaY) noexcept {
+    uint32_t fontSize = m_Theme.fontSize;
+    float limit = fontSize * static_cast<float>(std::max<uint64_t>(m_Text.getVisualRowCount(), 1) - 1);
+    m_ScrollTarget = std::clamp(m_ScrollTarget + deltaY, 0.f, limit);
 
-    // TODO: I use this in 3 places, maybe make it a function?
-    removeRange(std::min(m_SelectPos, getCursorLocation()), std::max(m_SelectPos, getCursorLocation()));
-    stopSelecting();
-    return true;
+    if (!Config::Get().smoothScrolling) {
+        m_Scroll.y = m_ScrollTarget;
+        m_Damage.add(Damage::View);
+    }
 }
 
-std::optional<std::string> TextBox::getSelection() const noexcept {
-    if(!isSelecting())
-        return std::nullopt;
+void TextBox::updateScroll(double deltaTime) noexcept {
+    if (m_Scroll.y == m_ScrollTarget)
+        return;
 
-    auto [beginRow, beginCol] = std::min(m_SelectPos, getCursorLocation());
-    auto [endRow, endCol] = std::max(m_SelectPos, getCursorLocation());
+    // Close the same share of the distance in the same amount of time, however many frames that takes.
+    float distance = m_ScrollTarget - m_Scroll.y;
+    float step = distance * static_cast<float>(1.0 - std::exp(-scrollSmoothing * deltaTime));
 
-    // TODO: I have this similar same line / different line pattern in 4 different places.
-    // Maybe think of a way to reduce code repetition. 
-    
-    // First Case: On the same line.
-    if (beginRow == endRow) {
-        auto& line = m_Buffer[beginRow];
-        return std::string(line.begin() + beginCol, line.begin() + endCol);
-    }
-    // Second Case: Different lines.
-    else {
-        // 1. Split the beginLine at beginCol and append it to ret.
-        // 2. Append everything between (beginRow, beginCol) and (endRow, endCol).
-        // 3. Split the endLine at endCol and append it to ret.
+    // Snap once less than half a pixel is left, the view is rounded to whole pixels anyway.
+    if (std::abs(distance - step) < 0.5f)
+        m_Scroll.y = m_ScrollTarget;
+    else
+        m_Scroll.y += step;
 
-        // Build the string.
-        std::string ret = "";
-        auto& beginLine = m_Buffer[beginRow];
-        auto& endLine = m_Buffer[endRow];
+    m_Damage.add(Damage::View);
+}
 
-        ret += std::string(beginLine.begin() + beginCol, beginLine.end()) + '\n';
+void TextBox::updateBand() noexcept {
+    float lineHeight = m_Theme.lineMargin + m_Theme.fontSize;
+    sf::Vector2f overscan = getOverscan();
 
-        for (size_t i = beginRow + 1; i < endRow; i++) {
-            ret += m_Buffer.at(i) + '\n';
-        }
+    // The row partially in frame at the top has to start within the overscan, as does the one at the bottom.
+    // Long lines are only laid out within the overscan to either side, see Text::updateText().
+    bool inBand = m_Scroll.y >= m_BandScroll.y - overscan.y + lineHeight && m_Scroll.y <= m_BandScroll.y + overscan.y &&
+                  std::abs(m_Scroll.x - m_BandScroll.x) <= overscan.x;
 
-        ret += std::string(endLine.begin(), endLine.begin() + endCol);
-        return ret;
-    }
-}
+    if (m_Damage.has(Damage::View) && !inBand)
+        m_Damage.add(Damage::Scroll);
 
-void TextBox::selectAll() noexcept {
-    stopSelecting();
-    moveTop();
-    startSelecting();
-    moveBottom();
-    m_ShouldUpdateView = true;
+    if (m_Damage.has(Damage::Scroll))
+        m_BandScroll = m_Scroll;
 }
 
-bool TextBox::moveTo(CursorLocation pos) noexcept {
-    m_ShouldUpdateView = true;
-
-    // Cursor is already at the provided pos. 
-    if (pos == getCursorLocation())
-        return false;
+void TextBox::ensureCursorVisibility() noexcept {
+    auto [cursorX, cursorY] = m_Cursor.getPosition();
+    auto [cursorWidth, cursorHeight] = m_Cursor.getSize();
+    auto [textBoxX, textBoxY] = m_Position;
+    auto [textBoxWidth, textBoxHeight] = m_Size;
+    auto [lineIndicatorWidth, lineIndicatorHeight] = m_LineIndicator.getSize();
+    auto lineIndicatorPad = m_Theme.lineIndicatorPad;
+    auto& [scrollX, scrollY] = m_Scroll;
+    sf::Vector2f oldScroll = m_Scroll;
 
-    auto [row, col] = pos;
+    if (cursorY + cursorHeight - textBoxHeight > scrollY) {
+        scrollY = cursorY - textBoxHeight + cursorHeight;
+    }
+    if (cursorY - textBoxY < scrollY) {
+        scrollY = cursorY - textBoxY;
+    }
 
-    // Clamp in case of invalid pos.
-    if (row >= m_Buffer.size()) {
-        row = m_Buffer.back().size(); col = m_Buffer.size() - 1;
+    // Wrapped lines never go past the right edge.
+    if (m_Text.isWrapping()) {
+        scrollX = 0;
+    }
+    else if (cursorX + cursorWidth - textBoxWidth > scrollX) {
+        scrollX = cursorX + cursorWidth - textBoxWidth;
     }
-    if (col > m_Buffer[row].size()) {
-        col = m_Buffer[row].size();
+    if (cursorX - textBoxX - lineIndicatorWidth - lineIndicatorPad < scrollX) {
+        scrollX = cursorX - textBoxX - lineIndicatorWidth - lineIndicatorPad;
     }
 
-    return m_Cursor.moveTo({ row, col });
+    // Jumping to the cursor stops a smooth scroll that is underway.
+    if (m_Scroll != oldScroll) {
+        m_ScrollTarget = m_Scroll.y;
+        m_Damage.add(Damage::View);
+    }
 }
 
-bool TextBox::moveUp() noexcept {
-   return moveTo(m_Cursor.above());
-}
+void TextBox::setWrap(bool wrap) {
+    m_Text.setWrap(wrap);
 
-bool TextBox::moveDown() noexcept {
-    return moveTo(m_Cursor.below());
+    m_Scroll.x = 0;
+    m_Damage.add(Damage::All);
 }
 
-bool TextBox::moveLeft() noexcept {
-    return moveTo(m_Cursor.prev());
+bool TextBox::isWrapping() const noexcept {
+    return m_Text.isWrapping();
 }
 
-bool TextBox::moveRight() noexcept {
-    return moveTo(m_Cursor.next());
+RowRange TextBox::getVisibleRows() const noexcept {
+    return m_Text.getVisibleRows();
 }
 
-void TextBox::moveTop() noexcept {
-    moveTo(m_Cursor.minPos());
+float TextBox::getRowY(size_t row) const noexcept {
+    return m_Text.getRowY(row);
 }
 
-void TextBox::moveBottom() noexcept {
-    moveTo(m_Cursor.maxPos());
+CursorLocation TextBox::findLocation(sf::Vector2f point) const {
+    // The view is moved by the position and the scroll, see draw().
+    return m_Text.findLocation(m_Position + m_Scroll + point);
 }
 
-void TextBox::moveStart() noexcept {
-    moveTo(m_Cursor.startLinePos());
+sf::Vector2f TextBox::getScroll() const noexcept {
+    return m_Scroll;
 }
 
-void TextBox::moveEnd() noexcept {
-    moveTo(m_Cursor.endLinePos());
+sf::Vector2f TextBox::getBandScroll() const noexcept {
+    return m_BandScroll;
 }
 
-bool TextBox::skipLeft() noexcept {
-    if (m_Cursor.onFirstPos())
-        return false;
-
-    // If we're at the start of the line, just move to the left. 
-    if (m_Cursor.onStartLine()) {
-        moveLeft(); return true;
-    }
-
-    char leftChar = getLeftChar().value(); // Must have a value, as we're not on firstPos.
-
-    // Get the closest chars of each class. 
-    auto nextLeftSpace = findFirstLeft(isspace);
-    auto nextLeftAlnum = findFirstLeft(isalnum);
-    auto nextLeftPunct = findFirstLeft(ispunct);
-
-    // A char can be one of three classes.
-    // 1. Whitespace: '\n', '\t', ' ', etc.
-    // 2. Alphanumeric: 'A', '3', 'h', etc.
-    // 3. Punctuation: '*', '.', '+', etc.
-    // In any case, just skip to the closest character that isn't of the leftChar's class. 
-    // If one was found beyond the confines of the line, skip to the startPos. 
-    auto found =    (isspace(leftChar)) ? std::max({ nextLeftAlnum, nextLeftPunct, m_Cursor.startLinePos() }) :
-                    (isalnum(leftChar)) ? std::max({ nextLeftSpace, nextLeftPunct, m_Cursor.startLinePos() }) :
-                    (ispunct(leftChar)) ? std::max({ nextLeftSpace, nextLeftAlnum, m_Cursor.startLinePos() }) :
-                    m_Cursor.minPos();
-
-    return moveTo(found);
+sf::Vector2f TextBox::getOverscan() const noexcept {
+    // At least a row, so that the row partially in frame at the top is always laid out.
+    // Sideways, a screen to either side, which is as far as following the cursor usually goes at once.
+    float lineHeight = m_Theme.lineMargin + m_Theme.fontSize;
+    return { m_Size.x, static_cast<float>(std::max<uint32_t>(Config::Get().overscanLines, 1)) * lineHeight };
 }
 
-bool TextBox::skipRight() noexcept {
-    // We cannot skip if we're at the end.
-    if (m_Cursor.onLastPos())
-        return false;
+RenderCounters TextBox::getRenderCounters() const noexcept {
+    RenderCounters counters = m_Counters;
+    counters.linesLaidOut = m_Text.getLinesLaidOut();
 
-    // If we're at the end of the line, just move to the right. 
-    if (m_Cursor.onEndLine()) {
-        moveRight(); return true;
-    }
-
-    char rightChar = getRightChar().value(); // Must have a value, as we're not on lastPos. 
-
-    // Get the closest chars of each class. 
-    auto nextRightSpace = findFirstRight(isspace);
-    auto nextRightAlnum = findFirstRight(isalnum);
-    auto nextRightPunct = findFirstRight(ispunct);
-
-    // A char can be one of three classes.
-    // 1. Whitespace: '\n', '\t', ' ', etc.
-    // 2. Alphanumeric: 'A', '3', 'h', etc.
-    // 3. Punctuation: '*', '.', '+', etc.
-    // In any case, just skip to the closest character that isn't of the rightChar's class. 
-    // If one was found beyond the confines of the line, skip to the endPos. 
-    auto found = (isspace(rightChar)) ? std::min({ nextRightAlnum, nextRightPunct, m_Cursor.endLinePos() }) :
-                 (isalnum(rightChar)) ? std::min({ nextRightSpace, nextRightPunct, m_Cursor.endLinePos() }) :
-                 (ispunct(rightChar)) ? std::min({ nextRightSpace, nextRightAlnum, m_Cursor.endLinePos() }) :
-                 m_Cursor.maxPos();
-
-    return moveTo(found);
+    return counters;
 }
 
-CursorLocation TextBox::findFirstLeft(const std::function<bool(char)>& pred) const {
-    // Move one position back each iteration and check
-    // if the character at that position matches the predicate. 
-    for (CursorLocation current = m_Cursor.prev();; current = m_Cursor.prev(current)) {
-        auto c = getCharAt(current);
-
-        if (!c.has_value()) // Sanity check. Make sure it has a value. 
-            continue;
-
-        if (pred(c.value())) // +1, because we want to move to the *right* of the found character. 
-            return current + CursorLocation(0, 1);
-
-        if (current == m_Cursor.minPos())
-            break;
-    }
-
-    return m_Cursor.minPos();
+bool TextBox::consumeRedraw() noexcept {
+    return std::exchange(m_ShouldRedraw, false);
 }
 
-CursorLocation TextBox::findFirstRight(const std::function<bool(char)>& pred) const {
-    // Move one position forward each iteration and check
-    // if the character at that position matches the predicate. 
-    for (CursorLocation current = m_Cursor.next(); current < m_Cursor.maxPos(); current = m_Cursor.next(current)) {
-        auto c = getCharAt(current);
-
-        if (!c.has_value()) // Sanity check. Make sure it has a value. 
-            continue;
-
-        if (pred(c.value()))
-            return current;
-    }
-
-    return m_Cursor.maxPos();
+bool TextBox::hasPendingWork() const noexcept {
+    // The indexer keeps finding lines and the search keeps counting matches, which update() picks up.
+    // A smooth scroll keeps moving the view until it arrives, and an autosave is only written once it's due.
+    return !isFullyIndexed() || isSearchPending() || m_Scroll.y != m_ScrollTarget || hasPendingAutosave();
 }
 
 void TextBox::paste() noexcept {
-    add(sf::Clipboard::getString());
+    // Converting to std::string directly would go through the locale, and lose anything outside of it.
+    auto utf8 = sf::Clipboard::getString().toUtf8();
+    add(std::string(utf8.begin(), utf8.end()));
 }
 
 void TextBox::copy() const noexcept {
     auto selection = getSelection();
 
     if(selection.has_value())
-        sf::Clipboard::setString(static_cast<std::string>(selection.value()));
-}
\ No newline at end of file
+        sf::Clipboard::setString(sf::String::fromUtf8(selection->begin(), selection->end()));
+}
+
@@ -1,22 +1,23 @@
 #pragma once
 
 #include <optional>
-#include <functional>
+#include <string>
 
 #include "LineIndicator.h"
+#include "Editor.h"
+#include "Damage.hpp"
 #include "Config.hpp"
 #include "Theme.hpp"
 #include "Cursor.h"
 #include "Text.h"
 
 /**
- *  @brief  Class that implements various ways of manipulating
- *          and moving through a buffer.
+ *  @brief  Class that draws an Editor's buffer, with a cursor,
+ *          line numbers and highlights, and lets it be scrolled.
  *
- *          Also handles drawing the contents of the buffer, among
- *          various other things.
+ *  @note   The editing itself is done by the Editor it derives from.
  */
-class TextBox : public Drawable, public Transformable, public Stylable<Theme::TextBoxTheme> {
+class TextBox : public Editor, public Drawable, public Transformable, public Stylable<Theme::TextBoxTheme> {
 public:
     /**
      * @brief       Creates a TextBox object.
@@ -29,6 +30,9 @@ public:
     /**
      * @brief   Draw the elements of the TextBox.
      *
+     * @note    The text, highlights, line numbers and cursor are batched,
+     *          so the amount of draw calls doesn't depend on the amount of text.
+     *
      * @param   window The window to draw to.
      */
     void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
@@ -40,317 +44,177 @@ public:
      */
     void update(double deltaTime) noexcept override;
 
-    /**
-     * @returns The location of the cursor.
-     */
-    CursorLocation getCursorLocation() const noexcept;
-
     /**
      * @returns The scroll of the TextBox.
      */
     sf::Vector2f getScroll() const noexcept;
 
     /**
-     * @brief       Get the buffer of the TextBox.
-     *
-     * @returns     A const-reference to the m_Buffer vector.
-     */
-    const std::vector<std::string>& getBuffer() const noexcept;
-
-    /**
-     * @brief       Get a line at a specific row.
-     * 
-     * @param row   The row. 
-     * 
-     * @returns     A const-string-reference to the line
-     *              or 'std::nullopt' if the provided row
-     *              is out of range. 
-     */
-    std::optional<std::string> line(size_t row) const noexcept;
-
-    /**
-     * @brief   Get the amount of lines.
-     */
-    size_t getLineCount() const noexcept;
-
-    /**
-     * @brief   Get a character at a specific position, even if selecting.
+     * @returns The scroll the rows in frame were last laid out around.
      *
-     * @param   pos The position of the character. 
-     * 
-     * @returns The character at the provided position cursor 
-                or 'std::nullopt' if the position is invalid. 
+     * @note    Lags behind getScroll() while the view moves within the overscan.
      */
-    std::optional<char> getCharAt(const CursorLocation& pos) const noexcept;
+    sf::Vector2f getBandScroll() const noexcept;
 
     /**
-     * @brief   Get the character to the right of the cursor, even if selecting.
-     *
-     * @returns The character to the right of the cursor or 'std::nullopt'
-     *          if there is nothing to the right.
+     * @returns How far to either side of the view long lines are laid out, and how far above and below it rows are, in pixels.
      */
-    std::optional<char> getRightChar() const noexcept;
+    sf::Vector2f getOverscan() const noexcept;
 
     /**
-     * @brief   Get the character to the left of the cursor, even if selecting.
-     *
-     * @returns The character to the left of the cursor or 'std::nullopt'
-     *          if there is nothing to the left.
+     * @returns How much work updating the elements of the TextBox has taken so far.
      */
-    std::optional<char>getLeftChar() const noexcept;
+    RenderCounters getRenderCounters() const noexcept;
 
     /**
-     * @brief   Adds a character to the right of the cursor.
-     *
-     * @note    If selecting, the selected text is deleted.
+     * @brief   Checks if anything changed since the last call, and forgets about it.
      *
-     * @param   c The character to add.
+     * @note    Call after update(). Nothing has to be drawn again if this returns false.
      */
-    void add(char c) noexcept;
+    bool consumeRedraw() noexcept;
 
     /**
-     * @brief   Adds a string to the right of the cursor.
-     *
-     * @note    If selecting, the selected text is deleted.
-     *
-     * @param   str The string to add.
+     * @brief   Checks if work is still running in the background that
+     *          can change what is shown, without any input, or that update() has yet to do.
      */
-    void add(const std::string& str) noexcept;
+    bool hasPendingWork() const noexcept;
 
     /**
-     * @brief   Adds a tab where the cursor is, by inserting spaces.
+     * @brief   Turns wrapping long lines at the width of the TextBox on or off.
      *
-     * @note    The number of spaces depends on the defined tab width.
-     * @note    Clears selection.
+     * @note    Nothing scrolls sideways while wrapping.
      */
-    void addTab() noexcept;
+    void setWrap(bool wrap);
 
-    /**
-     * @brief   Removes a character to the left of the cursor.
-     *
-     * @note    If selecting, deletes the selected text.
-     *
-     * @returns True if the removal was successful, false otherwise.
-     */
-    bool remove() noexcept;
+    bool isWrapping() const noexcept;
 
     /**
-     * @brief   If the character left of the cursor is alphanumeric,
-     *          removes a sequence of alphanumeric characters, until a non-alphanumeric character is hit.
-     *          Vice-versa for when a non-alphanumeric character is left of the cursor.
-     *
-     * @returns True if the SkipRemove was successful, false otherwise.
+     * @brief   Get the rows that are in frame, i.e. laid out around the view, overscan included.
      */
-    bool skipRemove() noexcept;
+    RowRange getVisibleRows() const noexcept;
 
     /**
-     * @brief   Removes all characters in a range.
+     * @brief   Get the y position of the top of a row, relative to the top of the TextBox.
      *
-     * @note    Sets the position of the cursor to begin after removing.
-     * @note    It is required that minPos <= begin < end <= maxPos.
-     *
-     * @param   begin The begin position.
-     * @param   end   The end position.
-     *
-     * @returns True if successful, false if minPos <= begin < end <= maxPos isn't upheld.
+     * @note    Rows that wrap take up more than one line, which moves every row below them.
      */
-    bool removeRange(CursorLocation begin, CursorLocation end) noexcept;
+    float getRowY(size_t row) const noexcept;
 
     /**
-     * @brief   Removes a tab, by removing leading spaces.
-     *
-     * @note    The number of spaces removed depends on the defined tab width.
+     * @brief           Gets the location of the character closest to a point, e.g. for a click.
      *
-     * @returns True if at least one space was removed, false otherwise.
+     * @param point     The point, relative to the top left corner of the TextBox on screen.
      */
-    bool removeTab() noexcept;
+    CursorLocation findLocation(sf::Vector2f point) const;
 
     /**
-     * @brief   Check if text is currently being selected.
+     * @brief   Moves the view up.
      *
-     * @returns True if selecting, false otherwise.
-     */
-    bool isSelecting() const noexcept;
-
-    /**
-     * @brief   Starts selecting from the current position of the cursor.
-     */
-    void startSelecting() noexcept;
-
-    /**
-     * @brief   Stops selecting entirely.
+     * @note    Glides there over the next frames if smooth scrolling is on.
      */
-    void stopSelecting() noexcept;
+    void scrollUp() noexcept;
 
     /**
-     * @brief   Selects the entire contents of the TextBox.
+     * @brief   Moves the view down.
      *
-     * @note    Functions identically, even if text is already selected..
+     * @note    Glides there over the next frames if smooth scrolling is on.
      */
-    void selectAll() noexcept;
+    void scrollDown() noexcept;
 
     /**
-     * @brief   Get the currently selected text.
+     * @brief   Pastes the contents of the clipboard where the cursor's current position is.
      *
-     * @returns The currently selected text, or 'std::nullopt'
-     *          if nothing is selected.
+     * @note    Removes selection.
      */
-    std::optional<std::string> getSelection() const noexcept;
+    void paste() noexcept;
 
     /**
-     * @brief   Moves the cursor to a position.
-     * 
-     * @note    If the position is invalid, m_Row and m_Col
-     *          will be clamped to the last position.
-     *
-     * @param   row The row to move to.
-     * @param   col The column to move to.
+     * @brief   Sets the contents of the clipboard to the currently selected text.
      *
-     * @returns True if the move was successful, false if the position was invalid.
+     * @note    Does nothing if no text is selected.
      */
-    bool moveTo(CursorLocation pos) noexcept;
+    void copy() const noexcept;
 
+private:
     /**
-     * @brief   Tries to move the cursor up.
+     * @brief   Ensure the cursor is visible and 
      *
-     * @returns True if the cursor was moved up, false if it cannot be moved up.
+     * @note    Does nothing if no text is selected.
      */
-    bool moveUp() noexcept;
+    void ensureCursorVisibility() noexcept;
 
     /**
-     * @brief   Tries to move the cursor down.
-     *
-     * @returns True if the cursor was moved down, false if it cannot be moved down.
+     * @brief   Moves where the view scrolls to by @p deltaY, within the document.
      */
-    bool moveDown() noexcept;
+    void scrollBy(float deltaY) noexcept;
 
     /**
-     * @brief   Tries to move the cursor left.
-     *
-     * @returns True if the cursor was moved left, false if it cannot be moved left.
+     * @brief   Moves the view towards where it scrolls to, at a speed that doesn't depend on the frame rate.
      */
-    bool moveLeft() noexcept;
+    void updateScroll(double deltaTime) noexcept;
 
     /**
-     * @brief   Tries to move the cursor right.
-     *
-     * @returns True if the cursor was moved right, false if it cannot be moved right.
+     * @brief   Lays the rows out around the view again if it moved out of the overscan,
+     *          or if they have to be anyway. Otherwise the view moves over them as they are.
      */
-    bool moveRight() noexcept;
+    void updateBand() noexcept;
 
     /**
-     * @brief   Skips to the next-left character of a different class.
+     * @brief   Damages the rows changed by an edit that started on @p firstRow.
      *
-     * @returns True if the skip was successful, false otherwise.
-     */
-    bool skipLeft() noexcept;
-
-    /**
-     * @brief   Skips to the next-right character of a different class.
+     * @note    If the edit added or removed lines, every row
+     *          below it moved, so those are damaged as well.
      *
-     * @returns True if the skip was successful, false otherwise.
-     */
-    bool skipRight() noexcept;
-
-    /**
-     * @brief   Moves the cursor to the very start of the text.
-     */
-    void moveTop() noexcept;
-
-    /**
-     * @brief   Moves the cursor to the very end of the text.
+     * @param   lineCountBefore The amount of lines before the edit.
      */
-    void moveBottom() noexcept;
+    void onLinesChanged(size_t firstRow, size_t lineCountBefore) override;
 
     /**
-     * @brief   Moves the cursor to the start of the line.
+     * @brief   Damages every row, since it isn't known which ones changed.
      */
-    void moveStart() noexcept;
+    void onDocumentChanged() override;
 
     /**
-     * @brief   Moves the cursor to the end of the line.
+     * @brief   Scrolls back to the top and damages everything.
      */
-    void moveEnd() noexcept;
+    void onOpened() override;
 
-    /**
-     * @brief   Moves the view up.
-     */
-    void scrollUp() noexcept;
-
-    /**
-     * @brief   Moves the view down.
-     */
-    void scrollDown() noexcept;
-
-    /**
-     * @brief   Pastes the contents of the clipboard where the cursor's current position is.
-     *
-     * @note    Removes selection.
-     */
-    void paste() noexcept;
+    void onCursorMoved() override;
 
-    /**
-     * @brief   Sets the contents of the clipboard to the currently selected text.
-     *
-     * @note    Does nothing if no text is selected.
-     */
-    void copy() const noexcept;
+    void onSelectionChanged() override;
 
-private:
-    /**
-     * @brief   Ensure the cursor is visible and 
-     *
-     * @note    Does nothing if no text is selected.
-     */
-    void ensureCursorVisibility() noexcept;
+    void onSearchChanged() override;
 
-    /**
-     * @brief   Clears the selected text.
-     * 
-     * @returns True if anything was cleared at all.
-     */
-    bool clearSelection() noexcept;
+    void onCaretsChanged() override;
 
     /**
-     * @brief       Scan left from the current cursor position (exclusive) until a character
-     *              satisfies the supplied predicate.
-     *
-     * @param pred  Unary predicate 'bool(char)' that returns 'true'
-     *              for a matching character.
-     * @return      Index of the first matching character, or 'm_Cursor.MinPos()'
-     *              if none is found.
+     * @brief   Moves the cursor and the line highlight to the cursor's location,
+     *          and scrolls to keep it in frame, unless a scroll is already queued.
      */
-    CursorLocation findFirstLeft(const std::function<bool(char)>& pred) const;
+    void updateCaret();
 
     /**
-     * @brief       Scan right from the current cursor position (exclusive) until a character
-     *              satisfies the supplied predicate.
+     * @brief   Places the carets besides the main one.
      *
-     * @param pred  Unary predicate 'bool(char)' that returns 'true'
-     *              for a matching character.
-     * @return      Index of the first matching character, or 'CursorPos::MaxPos()'
-     *              if none is found.
+     * @note    Only the ones in frame are looked at, so thousands
+     *          of carets cost no more than a screenful of them.
      */
-    CursorLocation findFirstRight(const std::function<bool(char)>& pred) const;
+    void updateCarets();
 
     /**
-     * @brief   If m_ShouldUpdateView is true, updates the position
-     *          of various elements in the TextBox.
+     * @brief               Wraps the rows in frame and the cursor's row if they aren't wrapped yet,
+     *                      and up to @p aheadLines more, then damages whatever moved.
      *
-     * @note    Sets m_ShouldUpdateView to false after updating.
-     * @note    Should be called before UpdateScroll.
+     * @note                Keeps the row at the top of the view in place.
      */
-    void updateView();
+    void updateWrap(size_t aheadLines);
 
     /**
-     * @brief   If m_ShouldUpdateScroll is true, updates the scroll
-     *          of various elements in the TextBox.
+     * @brief   Repairs the damage in m_Damage, by only updating
+     *          the elements that are affected by it.
      *
-     * @note    Sets m_ShouldUpdateScroll to false after updating.
-     * @note    Should be called after UpdateView.
+     * @note    Clears m_Damage after updating.
      */
-    void updateScroll();
-
     void updateElements();
 
     /**
@@ -359,17 +223,30 @@ private:
      */
     void onTransformChanged(sf::Vector2f oldPos, sf::Vector2f oldSize) override;
 
-    Cursor m_Cursor; // The TextBox's cursor. Also manages the position of the cursor, in terms of rows and columns. 
+    Cursor m_Cursor; // The TextBox's cursor. The Editor keeps track of its location, this only draws it.
     Text m_Text;
 
     LineIndicator m_LineIndicator;
     sf::RectangleShape m_Background, m_LineHighlight;
-    CursorLocation m_SelectPos; // The position of the cursor when selection was started. No selection is indicated by CursorLocation::NPos().
     sf::View m_View; // The view that displays the TextBox. 
     sf::Vector2f m_Scroll; // The scroll of the TextBox. 
+    float m_ScrollTarget; // Where m_Scroll.y glides to.
+    sf::Vector2f m_BandScroll; // The m_Scroll the rows in frame were laid out around.
+
+    // Matches beyond this many in frame aren't highlighted, e.g. on a single huge line.
+    static constexpr size_t maxVisibleMatches = 4096;
+
+    // The rows below the ones in frame that are lexed every frame, in the background.
+    static constexpr size_t lexAheadLines = 10000;
+
+    // The rows that are wrapped every frame in the background, while wrapping.
+    static constexpr size_t wrapAheadLines = 5000;
 
-    // When true, the view or scroll will be updated. 
-    bool m_ShouldUpdateView, m_ShouldUpdateScroll; 
+    // How quickly a smooth scroll closes the distance to its target, per second.
+    static constexpr double scrollSmoothing = 20.0;
 
-    std::vector<std::string> m_Buffer; // Buffer of the TextBox. 
+    // What has to be updated before the next draw, and how much work that took so far.
+    Damage m_Damage;
+    RenderCounters m_Counters;
+    bool m_ShouldRedraw; // Whether anything was damaged since the last consumeRedraw().
 };
\ No newline at end of file
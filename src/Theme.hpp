@@ -67,6 +67,34 @@ namespace Theme {
         sf::Color backgroundColor = { 25, 25, 25 };
         sf::Color lineHighlightColor = { 70, 70, 70, 70 };
         sf::Color selectedTextColor = { 80, 165, 245, 70 };
+        sf::Color matchHighlightColor = { 230, 170, 40, 80 };
+        sf::Color diagnosticHighlightColor = { 220, 50, 50, 70 };
+        sf::Color bracketHighlightColor = { 150, 150, 150, 60 };
+
+        // The colors of the syntax highlighting. Anything else uses textColor.
+        sf::Color keywordColor = { 200, 120, 220 };
+        sf::Color typeColor = { 80, 170, 230 };
+        sf::Color numberColor = { 180, 210, 150 };
+        sf::Color stringColor = { 210, 150, 110 };
+        sf::Color commentColor = { 100, 140, 90 };
+        sf::Color preprocessorColor = { 150, 150, 150 };
+        sf::Color keyColor = { 150, 200, 250 };
+        sf::Color timestampColor = { 120, 150, 170 };
+        sf::Color errorColor = { 240, 90, 90 };
+        sf::Color warningColor = { 230, 190, 70 };
+        sf::Color infoColor = { 100, 190, 140 };
+    };
+
+    struct FindBarTheme {
+        uint32_t fontSize = 18;
+        float width = 420.0f;
+        float pad = 6.0f;
+        float outlineThickness = 1.0f;
+
+        sf::Color textColor = { 200, 200, 200 };
+        sf::Color statusColor = { 135, 135, 135 };
+        sf::Color backgroundColor = { 40, 40, 40 };
+        sf::Color outlineColor = { 80, 165, 245 };
     };
 
     struct TextEditorTheme {
@@ -84,24 +112,33 @@ namespace Theme {
         LineIndicatorTheme lineIndicator;
         TextBoxTheme textBox;
         TextEditorTheme textEditor;
+        FindBarTheme findBar;
     };
 
-    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(CursorTheme, cursorWidth, outlineThickness,
+    // Missing keys keep their defaults, so that older theme files still load.
+    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(CursorTheme, cursorWidth, outlineThickness,
         cursorColor, outlineColor)
 
-    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(LineIndicatorTheme,
+    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(LineIndicatorTheme,
         padLeft, padRight, outlineThickness,
         textColor, backgroundColor, outlineColor)
 
-    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(TextBoxTheme,
+    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(TextBoxTheme,
         fontSize, lineIndicatorPad, lineMargin,
-        textColor, backgroundColor, lineHighlightColor, selectedTextColor)
+        textColor, backgroundColor, lineHighlightColor, selectedTextColor, matchHighlightColor,
+        diagnosticHighlightColor, bracketHighlightColor,
+        keywordColor, typeColor, numberColor, stringColor, commentColor, preprocessorColor,
+        keyColor, timestampColor, errorColor, warningColor, infoColor)
 
-    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(TextEditorTheme, offset, pad)
+    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(TextEditorTheme, offset, pad)
 
-    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(AllThemes,
+    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(FindBarTheme,
+        fontSize, width, pad, outlineThickness,
+        textColor, statusColor, backgroundColor, outlineColor)
+
+    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(AllThemes,
             fontName, windowWidth, windowHeight, scale,
-            cursor, lineIndicator, textBox)
+            cursor, lineIndicator, textBox, findBar)
 
     template <typename T> 
     inline T& Get() noexcept;
@@ -157,6 +194,11 @@ namespace Theme {
     inline TextEditorTheme& Get<TextEditorTheme>() noexcept {
         return Get<AllThemes>().textEditor;
     }
+
+    template<>
+    inline FindBarTheme& Get<FindBarTheme>() noexcept {
+        return Get<AllThemes>().findBar;
+    }
 };
 
 template <typename T>
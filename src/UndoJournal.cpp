@@ -0,0 +1,344 @@
+#include <algorithm>
+#include <iostream>
+
+#include "UndoJournal.h"
+
+namespace {
+    // Appends a piece to a list, growing the last piece if the new one directly continues it.
+    void appendPiece(std::vector<PieceTable::Piece>& pieces, const PieceTable::Piece& piece) {
+        if (!pieces.empty()) {
+            auto& last = pieces.back();
+
+            if (last.buffer == piece.buffer && last.start + last.length == piece.start) {
+                last.length += piece.length;
+                last.lineFeeds += piece.lineFeeds;
+                return;
+            }
+        }
+
+        pieces.push_back(piece);
+    }
+
+    size_t countLineFeeds(const std::vector<PieceTable::Piece>& pieces) noexcept {
+        size_t count = 0;
+        for (const auto& piece : pieces)
+            count += piece.lineFeeds;
+
+        return count;
+    }
+
+    // fseek() and ftell() take a long, which is only 32 bits on Windows.
+    int seek(std::FILE* file, int64_t offset) noexcept {
+#ifdef _WIN32
+        return _fseeki64(file, offset, SEEK_SET);
+#else
+        return fseeko(file, static_cast<off_t>(offset), SEEK_SET);
+#endif
+    }
+
+    int64_t tell(std::FILE* file) noexcept {
+#ifdef _WIN32
+        return _ftelli64(file);
+#else
+        return static_cast<int64_t>(ftello(file));
+#endif
+    }
+}
+
+UndoJournal::UndoJournal(size_t memoryBudget) :
+                m_Undo(), m_Redo(), m_MemoryBudget(memoryBudget), m_MemoryUsage(0),
+                m_NextGroup(0), m_CurrentGroup(0), m_GroupDepth(0), m_GroupSize(0), m_Boundary(false),
+                m_SpillFile(nullptr), m_SpillEnd(0), m_SpillCount(0) {}
+
+UndoJournal::~UndoJournal() {
+    if (m_SpillFile)
+        std::fclose(m_SpillFile);
+}
+
+void UndoJournal::recordInsert(const PieceTable& document, size_t offset, size_t length) {
+    if (length == 0)
+        return;
+
+    record({ Kind::Insert, 0, offset, length, document.getPieces(offset, offset + length) });
+}
+
+void UndoJournal::recordErase(const PieceTable& document, size_t begin, size_t end) {
+    if (begin >= end)
+        return;
+
+    record({ Kind::Erase, 0, begin, end - begin, document.getPieces(begin, end) });
+}
+
+void UndoJournal::recordInsert(size_t offset, std::vector<PieceTable::Piece> pieces) {
+    size_t length = 0;
+    for (const auto& piece : pieces)
+        length += piece.length;
+
+    if (length > 0)
+        record({ Kind::Insert, 0, offset, length, std::move(pieces) });
+}
+
+void UndoJournal::recordErase(size_t offset, std::vector<PieceTable::Piece> pieces) {
+    size_t length = 0;
+    for (const auto& piece : pieces)
+        length += piece.length;
+
+    if (length > 0)
+        record({ Kind::Erase, 0, offset, length, std::move(pieces) });
+}
+
+void UndoJournal::beginGroup() noexcept {
+    if (m_GroupDepth++ == 0) {
+        m_CurrentGroup = m_NextGroup++;
+        m_GroupSize = 0;
+    }
+}
+
+void UndoJournal::endGroup() noexcept {
+    if (m_GroupDepth == 0 || --m_GroupDepth > 0 || m_GroupSize == 0)
+        return;
+
+    // A group of several entries is a step of its own. A group of a single one,
+    // like a typed character, continues the run before it like any other entry.
+    if (m_GroupSize > 1) {
+        m_Boundary = true;
+        return;
+    }
+
+    if (!m_Boundary && m_Undo.size() > 1) {
+        Entry entry = std::move(m_Undo.back());
+        m_Undo.pop_back();
+        m_MemoryUsage -= memoryOf(entry);
+
+        if (!tryMerge(entry)) {
+            m_MemoryUsage += memoryOf(entry);
+            m_Undo.push_back(std::move(entry));
+        }
+    }
+
+    m_Boundary = false;
+}
+
+std::optional<size_t> UndoJournal::undo(PieceTable& document) {
+    if (m_Undo.empty())
+        restoreSpilled();
+
+    if (m_Undo.empty())
+        return std::nullopt;
+
+    // Typing after an undo starts a new step, instead of growing the one before it.
+    m_Boundary = true;
+
+    // Undo the entries of the last group, newest first.
+    uint64_t group = m_Undo.back().group;
+    size_t cursor = 0;
+
+    while (true) {
+        if (m_Undo.empty())
+            restoreSpilled();
+
+        if (m_Undo.empty() || m_Undo.back().group != group)
+            break;
+
+        Entry entry = std::move(m_Undo.back());
+        m_Undo.pop_back();
+        m_MemoryUsage -= memoryOf(entry);
+
+        cursor = apply(document, entry, true);
+        m_Redo.push_back(std::move(entry));
+    }
+
+    return cursor;
+}
+
+std::optional<size_t> UndoJournal::redo(PieceTable& document) {
+    if (m_Redo.empty())
+        return std::nullopt;
+
+    m_Boundary = true;
+
+    // Undo pushed the entries of a group newest first, so they come back oldest first.
+    uint64_t group = m_Redo.back().group;
+    size_t cursor = 0;
+
+    while (!m_Redo.empty() && m_Redo.back().group == group) {
+        Entry entry = std::move(m_Redo.back());
+        m_Redo.pop_back();
+
+        cursor = apply(document, entry, false);
+
+        m_MemoryUsage += memoryOf(entry);
+        m_Undo.push_back(std::move(entry));
+    }
+
+    enforceBudget();
+    return cursor;
+}
+
+void UndoJournal::clear() noexcept {
+    m_Undo.clear(); m_Redo.clear();
+    m_MemoryUsage = 0;
+    m_Boundary = false;
+
+    // The file is reused, so it's enough to forget what's in it.
+    m_SpillEnd = 0; m_SpillCount = 0;
+}
+
+size_t UndoJournal::getMemoryUsage() const noexcept {
+    return m_MemoryUsage;
+}
+
+size_t UndoJournal::memoryOf(const Entry& entry) noexcept {
+    return sizeof(Entry) + entry.pieces.capacity() * sizeof(PieceTable::Piece);
+}
+
+void UndoJournal::record(Entry entry) {
+    m_Redo.clear();
+
+    // Entries of a group are merged once it ends, if at all, see endGroup().
+    bool merge = !m_Boundary && m_GroupDepth == 0;
+
+    if (m_GroupDepth > 0) {
+        entry.group = m_CurrentGroup;
+        m_GroupSize++;
+    }
+    else {
+        entry.group = m_NextGroup++;
+        m_Boundary = false;
+    }
+
+    if (!merge || !tryMerge(entry)) {
+        m_MemoryUsage += memoryOf(entry);
+        m_Undo.push_back(std::move(entry));
+    }
+
+    enforceBudget();
+}
+
+bool UndoJournal::tryMerge(Entry& entry) {
+    if (m_Undo.empty())
+        return false;
+
+    Entry& last = m_Undo.back();
+
+    // Only single characters are merged, and a newline always starts a new entry.
+    if (entry.kind != last.kind || entry.length != 1 ||
+        countLineFeeds(entry.pieces) != 0 || countLineFeeds(last.pieces) != 0)
+        return false;
+
+    m_MemoryUsage -= memoryOf(last);
+
+    // Typing: the character goes right after the previous ones.
+    if (entry.kind == Kind::Insert && last.offset + last.length == entry.offset) {
+        for (const auto& piece : entry.pieces)
+            appendPiece(last.pieces, piece);
+
+        last.length += entry.length;
+    }
+    // Backspace: the character is right before the previous ones.
+    else if (entry.kind == Kind::Erase && entry.offset + entry.length == last.offset) {
+        for (const auto& piece : last.pieces)
+            appendPiece(entry.pieces, piece);
+
+        last.pieces = std::move(entry.pieces);
+        last.offset = entry.offset;
+        last.length += entry.length;
+    }
+    else {
+        m_MemoryUsage += memoryOf(last);
+        return false;
+    }
+
+    m_MemoryUsage += memoryOf(last);
+    return true;
+}
+
+size_t UndoJournal::apply(PieceTable& document, const Entry& entry, bool reverse) {
+    // Undoing an insert is an erase and vice versa.
+    bool insert = (entry.kind == Kind::Insert) != reverse;
+
+    if (insert) {
+        document.insert(entry.offset, entry.pieces);
+        return entry.offset + entry.length;
+    }
+
+    document.erase(entry.offset, entry.offset + entry.length);
+    return entry.offset;
+}
+
+void UndoJournal::enforceBudget() {
+    // Always keep the newest entry in memory, it's the one that merges.
+    while (m_MemoryUsage > m_MemoryBudget && m_Undo.size() > 1) {
+        if (!m_SpillFile)
+            m_SpillFile = std::tmpfile();
+
+        if (m_SpillFile)
+            writeEntry(m_Undo.front());
+        else
+            std::cerr << "[UNDO]: Cannot create a temporary file, dropping the oldest history." << std::endl;
+
+        m_MemoryUsage -= memoryOf(m_Undo.front());
+        m_Undo.pop_front();
+    }
+}
+
+void UndoJournal::restoreSpilled() {
+    // Read back until half of the budget is used, so that
+    // undoing one step at a time doesn't hit the file every time.
+    while (m_SpillCount > 0 && (m_Undo.empty() || m_MemoryUsage < m_MemoryBudget / 2)) {
+        Entry entry;
+        if (!readEntry(entry)) {
+            std::cerr << "[UNDO]: Cannot read the history back, dropping the rest of it." << std::endl;
+            m_SpillEnd = 0; m_SpillCount = 0;
+            return;
+        }
+
+        m_MemoryUsage += memoryOf(entry);
+        m_Undo.push_front(std::move(entry));
+    }
+}
+
+void UndoJournal::writeEntry(const Entry& entry) {
+    uint8_t kind = static_cast<uint8_t>(entry.kind);
+    uint64_t header[] = { entry.group, entry.offset, entry.length, entry.pieces.size() };
+    uint64_t size = sizeof(kind) + sizeof(header) + entry.pieces.size() * sizeof(PieceTable::Piece);
+
+    // The file only lives as long as this process, so the pieces can be written as they are.
+    seek(m_SpillFile, m_SpillEnd);
+    std::fwrite(&kind, sizeof(kind), 1, m_SpillFile);
+    std::fwrite(header, sizeof(header), 1, m_SpillFile);
+    std::fwrite(entry.pieces.data(), sizeof(PieceTable::Piece), entry.pieces.size(), m_SpillFile);
+    std::fwrite(&size, sizeof(size), 1, m_SpillFile);
+
+    m_SpillEnd = tell(m_SpillFile);
+    m_SpillCount++;
+}
+
+bool UndoJournal::readEntry(Entry& entry) {
+    uint64_t size;
+    if (seek(m_SpillFile, m_SpillEnd - static_cast<int64_t>(sizeof(size))) != 0 ||
+        std::fread(&size, sizeof(size), 1, m_SpillFile) != 1)
+        return false;
+
+    int64_t begin = m_SpillEnd - static_cast<int64_t>(sizeof(size) + size);
+
+    uint8_t kind;
+    uint64_t header[4];
+    if (seek(m_SpillFile, begin) != 0 ||
+        std::fread(&kind, sizeof(kind), 1, m_SpillFile) != 1 ||
+        std::fread(header, sizeof(header), 1, m_SpillFile) != 1)
+        return false;
+
+    entry.kind = static_cast<Kind>(kind);
+    entry.group = header[0];
+    entry.offset = static_cast<size_t>(header[1]);
+    entry.length = static_cast<size_t>(header[2]);
+    entry.pieces.resize(static_cast<size_t>(header[3]));
+
+    if (std::fread(entry.pieces.data(), sizeof(PieceTable::Piece), entry.pieces.size(), m_SpillFile) != entry.pieces.size())
+        return false;
+
+    m_SpillEnd = begin;
+    m_SpillCount--;
+    return true;
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <optional>
+#include <vector>
+
+#include "PieceTable.h"
+
+/**
+ * @brief   Undo and redo history of a PieceTable.
+ *
+ *          Every entry is an insertion or a removal at an offset, described by the
+ *          pieces that were inserted or removed rather than by their text. The piece
+ *          table's buffers are append-only, so those pieces stay valid, and undoing
+ *          the removal of a huge selection needs no copy of it.
+ *
+ *          Consecutive typing and consecutive backspaces are merged into one entry,
+ *          unless a group, an undo or a redo came in between.
+ *          Entries recorded between beginGroup() and endGroup() are undone together.
+ *
+ *          Once the history takes up more memory than its budget, the oldest
+ *          entries are moved to a temporary file, and read back when undone.
+ */
+class UndoJournal {
+public:
+    /**
+     * @brief               Creates an empty history.
+     *
+     * @param memoryBudget  The amount of memory, in bytes, the undo entries may take up.
+     */
+    explicit UndoJournal(size_t memoryBudget);
+
+    ~UndoJournal();
+
+    UndoJournal(const UndoJournal&) = delete;
+    UndoJournal& operator=(const UndoJournal&) = delete;
+
+    /**
+     * @brief           Records that [offset, offset + length) was just inserted.
+     *
+     * @note            Clears the redo history.
+     */
+    void recordInsert(const PieceTable& document, size_t offset, size_t length);
+
+    /**
+     * @brief           Records that [begin, end) is about to be removed.
+     *
+     * @note            Has to be called before the removal, while the pieces are still in the document.
+     * @note            Clears the redo history.
+     */
+    void recordErase(const PieceTable& document, size_t begin, size_t end);
+
+    /**
+     * @brief           Records that @p pieces were just inserted at @p offset, e.g. as told by PieceTable::replace().
+     *
+     * @note            Doesn't look up anything in the document. Clears the redo history.
+     */
+    void recordInsert(size_t offset, std::vector<PieceTable::Piece> pieces);
+
+    /**
+     * @brief           Records that @p pieces were just removed from @p offset, e.g. as told by PieceTable::replace().
+     *
+     * @note            Unlike recordErase(const PieceTable&, ...), it can be called after the removal.
+     *                  It still has to be recorded in the order the edits were made in.
+     */
+    void recordErase(size_t offset, std::vector<PieceTable::Piece> pieces);
+
+    /**
+     * @brief   Starts a group. Everything recorded until the matching
+     *          endGroup() call is undone and redone as a single step.
+     *
+     * @note    Groups can be nested, only the outermost one counts.
+     */
+    void beginGroup() noexcept;
+
+    /**
+     * @brief   Ends a group started by beginGroup().
+     */
+    void endGroup() noexcept;
+
+    /**
+     * @brief           Reverts the most recent step.
+     *
+     * @returns         The offset the cursor should be moved to, or
+     *                  'std::nullopt' if there was nothing to undo.
+     */
+    std::optional<size_t> undo(PieceTable& document);
+
+    /**
+     * @brief           Re-applies the most recently undone step.
+     *
+     * @returns         The offset the cursor should be moved to, or
+     *                  'std::nullopt' if there was nothing to redo.
+     */
+    std::optional<size_t> redo(PieceTable& document);
+
+    /**
+     * @brief   Forgets the whole history.
+     *
+     * @note    Has to be called whenever the document is replaced,
+     *          as the recorded pieces point into its buffers.
+     */
+    void clear() noexcept;
+
+    /**
+     * @brief   Get the amount of memory taken up by the undo entries, in bytes.
+     */
+    size_t getMemoryUsage() const noexcept;
+
+private:
+    enum class Kind : uint8_t { Insert, Erase };
+
+    struct Entry {
+        Kind kind;
+        uint64_t group;
+        size_t offset, length;
+        std::vector<PieceTable::Piece> pieces;
+    };
+
+    static size_t memoryOf(const Entry& entry) noexcept;
+
+    /**
+     * @brief   Adds an entry to the undo history, merging it into the
+     *          previous one if it continues the same run of typing or backspaces.
+     */
+    void record(Entry entry);
+
+    /**
+     * @brief   Merges @p entry into the last undo entry, if possible.
+     *
+     * @returns True if it was merged.
+     */
+    bool tryMerge(Entry& entry);
+
+    /**
+     * @brief   Applies an entry to the document, either forwards or in reverse.
+     *
+     * @returns The offset the cursor should be moved to.
+     */
+    static size_t apply(PieceTable& document, const Entry& entry, bool reverse);
+
+    /**
+     * @brief   Moves the oldest entries to the temporary file until the budget is met.
+     */
+    void enforceBudget();
+
+    /**
+     * @brief   Reads the most recently spilled entries back into memory.
+     */
+    void restoreSpilled();
+
+    void writeEntry(const Entry& entry);
+    bool readEntry(Entry& entry);
+
+    std::deque<Entry> m_Undo;
+    std::vector<Entry> m_Redo;
+
+    size_t m_MemoryBudget, m_MemoryUsage;
+
+    uint64_t m_NextGroup, m_CurrentGroup;
+    uint32_t m_GroupDepth;
+    size_t m_GroupSize; // The amount of entries recorded in the current group.
+    bool m_Boundary; // Whether the next entry starts a new step, e.g. after a group of several entries, undo() or redo().
+
+    // Spilled entries are stacked in the file, oldest first.
+    // Every entry is followed by its size, so the stack can be read from the top.
+    std::FILE* m_SpillFile;
+    int64_t m_SpillEnd;
+    size_t m_SpillCount;
+};
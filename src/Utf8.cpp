@@ -0,0 +1,424 @@
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+#include "Utf8.h"
+#include "Simd.hpp"
+
+namespace {
+    using ValidateFunction = bool (*)(std::string_view) noexcept;
+
+    constexpr uint32_t zeroWidthJoiner = 0x200D;
+
+    /**
+     * @brief   Gets the length of the sequence at @p data, or 0 if it isn't valid.
+     *
+     * @note    The ranges of the second byte are the ones in table 3-7 of the Unicode standard,
+     *          which rule out overlong encodings, surrogates and anything past U+10FFFF.
+     */
+    inline size_t sequenceLength(const unsigned char* data, size_t size) noexcept {
+        unsigned char lead = data[0];
+        if (lead < 0x80)
+            return 1;
+
+        size_t length;
+        unsigned char low = 0x80, high = 0xBF;
+
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            length = 2;
+        }
+        else if (lead >= 0xE0 && lead <= 0xEF) {
+            length = 3;
+            if (lead == 0xE0) low = 0xA0;
+            if (lead == 0xED) high = 0x9F;
+        }
+        else if (lead >= 0xF0 && lead <= 0xF4) {
+            length = 4;
+            if (lead == 0xF0) low = 0x90;
+            if (lead == 0xF4) high = 0x8F;
+        }
+        else {
+            return 0;
+        }
+
+        if (size < length || data[1] < low || data[1] > high)
+            return 0;
+
+        for (size_t i = 2; i < length; i++) {
+            if ((data[i] & 0xC0) != 0x80)
+                return 0;
+        }
+
+        return length;
+    }
+
+    // Gets the start of the character that ends right before pos, which is a single byte if that isn't a valid sequence.
+    inline size_t prevCodePoint(std::string_view text, size_t pos) noexcept {
+        size_t start = pos - 1;
+        while (start > 0 && pos - start < 4 && Utf8::isContinuation(text[start]))
+            start--;
+
+        const auto* data = reinterpret_cast<const unsigned char*>(text.data());
+        return (sequenceLength(data + start, text.size() - start) == pos - start) ? start : pos - 1;
+    }
+
+#ifdef VISIONARY_X86_SIMD
+    // Validates from a character boundary until past the end of a block, one character at a time.
+    // A character at the end of the block can reach into the next one, the new offset is returned.
+    inline size_t stepThrough(const unsigned char* data, size_t size, size_t i, size_t end) noexcept {
+        while (i < end) {
+            size_t length = sequenceLength(data + i, size - i);
+            if (length == 0)
+                return 0;
+
+            i += length;
+        }
+
+        return i;
+    }
+
+    bool validateSSE2(std::string_view text) noexcept {
+        const auto* data = reinterpret_cast<const unsigned char*>(text.data());
+        const size_t size = text.size();
+
+        // SSE2 can't look anything up in a table, so only the ASCII is skipped in bulk.
+        size_t i = 0;
+        while (i + 64 <= size) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 16));
+            __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 32));
+            __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 48));
+
+            if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d))) == 0) {
+                i += 64;
+                continue;
+            }
+
+            i = stepThrough(data, size, i, i + 64);
+            if (i == 0)
+                return false;
+        }
+
+        return Utf8::validateScalar(text.substr(i));
+    }
+
+    // What can go wrong between two consecutive bytes, one bit each. The tables below
+    // tell which of them each nibble allows, and a pair is invalid if all three agree.
+    // From "Validating UTF-8 In Less Than One Instruction Per Byte", Keiser and Lemire.
+    constexpr uint8_t tooShort = 1 << 0;    // A lead byte followed by ASCII or another lead byte.
+    constexpr uint8_t tooLong = 1 << 1;     // ASCII followed by a continuation byte.
+    constexpr uint8_t overlong3 = 1 << 2;   // 11100000 100xxxxx
+    constexpr uint8_t tooLarge = 1 << 3;    // 11110100 1001xxxx and above.
+    constexpr uint8_t surrogate = 1 << 4;   // 11101101 101xxxxx
+    constexpr uint8_t overlong2 = 1 << 5;   // 1100000x 10xxxxxx
+    constexpr uint8_t tooLarge1000 = 1 << 6;// 11110101 1000xxxx and above.
+    constexpr uint8_t overlong4 = 1 << 6;   // 11110000 1000xxxx
+    constexpr uint8_t twoConts = 1 << 7;    // Two continuation bytes, only valid within a 3 or 4 byte sequence.
+    constexpr uint8_t carry = tooShort | tooLong | twoConts;
+
+    VISIONARY_TARGET_AVX2
+    inline __m256i table(uint8_t a0, uint8_t a1, uint8_t a2, uint8_t a3, uint8_t a4, uint8_t a5, uint8_t a6, uint8_t a7,
+                         uint8_t a8, uint8_t a9, uint8_t a10, uint8_t a11, uint8_t a12, uint8_t a13, uint8_t a14, uint8_t a15) noexcept {
+        // Looking up shuffles within each 128-bit lane, so both lanes get the table.
+        return _mm256_setr_epi8(a0, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15,
+                                a0, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15);
+    }
+
+    VISIONARY_TARGET_AVX2
+    inline __m256i highNibbles(__m256i v) noexcept {
+        return _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0F));
+    }
+
+    // The bytes of input shifted right by 'N', with the last ones of prev shifted in.
+    template <int N>
+    VISIONARY_TARGET_AVX2
+    inline __m256i shiftIn(__m256i input, __m256i prev) noexcept {
+        return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev, input, 0x21), 16 - N);
+    }
+
+    /**
+     * @brief   Validates a block of 32 bytes that follows 'prev', adding any errors to 'error'.
+     *
+     * @note    Any sequence cut off at the end of the block is caught by the next one.
+     */
+    VISIONARY_TARGET_AVX2
+    inline void checkBlock(__m256i input, __m256i prev, __m256i& error) noexcept {
+        const __m256i byte1HighTable = table(
+            tooLong, tooLong, tooLong, tooLong, tooLong, tooLong, tooLong, tooLong,     // 0xxxxxxx
+            twoConts, twoConts, twoConts, twoConts,                                     // 10xxxxxx
+            tooShort | overlong2,                                                       // 1100xxxx
+            tooShort,                                                                   // 1101xxxx
+            tooShort | overlong3 | surrogate,                                           // 1110xxxx
+            tooShort | tooLarge | tooLarge1000 | overlong4);                            // 1111xxxx
+
+        const __m256i byte1LowTable = table(
+            carry | overlong3 | overlong2 | overlong4,                                  // xxxx0000
+            carry | overlong2,                                                          // xxxx0001
+            carry, carry,                                                               // xxxx001x
+            carry | tooLarge,                                                           // xxxx0100
+            carry | tooLarge | tooLarge1000,                                            // xxxx0101
+            carry | tooLarge | tooLarge1000, carry | tooLarge | tooLarge1000,           // xxxx011x
+            carry | tooLarge | tooLarge1000, carry | tooLarge | tooLarge1000,           // xxxx1xxx
+            carry | tooLarge | tooLarge1000, carry | tooLarge | tooLarge1000,
+            carry | tooLarge | tooLarge1000,
+            carry | tooLarge | tooLarge1000 | surrogate,                                // xxxx1101
+            carry | tooLarge | tooLarge1000, carry | tooLarge | tooLarge1000);
+
+        const __m256i byte2HighTable = table(
+            tooShort, tooShort, tooShort, tooShort, tooShort, tooShort, tooShort, tooShort,     // 0xxxxxxx
+            tooLong | overlong2 | twoConts | overlong3 | tooLarge1000 | overlong4,              // 1000xxxx
+            tooLong | overlong2 | twoConts | overlong3 | tooLarge,                              // 1001xxxx
+            tooLong | overlong2 | twoConts | surrogate | tooLarge,                              // 101xxxxx
+            tooLong | overlong2 | twoConts | surrogate | tooLarge,
+            tooShort, tooShort, tooShort, tooShort);                                            // 11xxxxxx
+
+        __m256i prev1 = shiftIn<1>(input, prev);
+
+        __m256i special = _mm256_and_si256(
+            _mm256_and_si256(_mm256_shuffle_epi8(byte1HighTable, highNibbles(prev1)),
+                             _mm256_shuffle_epi8(byte1LowTable, _mm256_and_si256(prev1, _mm256_set1_epi8(0x0F)))),
+            _mm256_shuffle_epi8(byte2HighTable, highNibbles(input)));
+
+        // Two continuation bytes in a row are only valid as the third or fourth byte of a sequence.
+        __m256i isThird = _mm256_subs_epu8(shiftIn<2>(input, prev), _mm256_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+        __m256i isFourth = _mm256_subs_epu8(shiftIn<3>(input, prev), _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+        __m256i mustBeContinuation = _mm256_and_si256(_mm256_or_si256(isThird, isFourth), _mm256_set1_epi8(static_cast<char>(0x80)));
+
+        error = _mm256_or_si256(error, _mm256_xor_si256(mustBeContinuation, special));
+    }
+
+    // Non-zero where the last bytes of a block start a sequence that doesn't fit in it.
+    VISIONARY_TARGET_AVX2
+    inline __m256i findIncomplete(__m256i input) noexcept {
+        const __m256i max = _mm256_setr_epi8(
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            static_cast<char>(0xF0 - 1), static_cast<char>(0xE0 - 1), static_cast<char>(0xC0 - 1));
+
+        return _mm256_subs_epu8(input, max);
+    }
+
+    VISIONARY_TARGET_AVX2
+    bool validateAVX2(std::string_view text) noexcept {
+        const char* data = text.data();
+        const size_t size = text.size();
+
+        __m256i error = _mm256_setzero_si256();
+        __m256i prev = _mm256_setzero_si256();
+        __m256i incomplete = _mm256_setzero_si256();
+
+        // Two blocks per iteration, so that ASCII is skipped 64 bytes at a time.
+        size_t i = 0;
+        for (; i + 64 <= size; i += 64) {
+            __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 32));
+
+            if (_mm256_movemask_epi8(_mm256_or_si256(low, high)) == 0) {
+                // ASCII can't finish a sequence that the previous block started.
+                error = _mm256_or_si256(error, incomplete);
+                incomplete = _mm256_setzero_si256();
+                prev = high;
+                continue;
+            }
+
+            checkBlock(low, prev, error);
+            checkBlock(high, low, error);
+            incomplete = findIncomplete(high);
+            prev = high;
+        }
+
+        // The rest is padded with zeroes, which are ASCII, so a sequence cut off by the end is still caught.
+        for (; i < size; i += 32) {
+            alignas(32) char buffer[32] = {};
+            std::memcpy(buffer, data + i, std::min<size_t>(32, size - i));
+            __m256i input = _mm256_load_si256(reinterpret_cast<const __m256i*>(buffer));
+
+            checkBlock(input, prev, error);
+            incomplete = findIncomplete(input);
+            prev = input;
+        }
+
+        error = _mm256_or_si256(error, incomplete);
+        return _mm256_testz_si256(error, error) != 0;
+    }
+#endif
+
+    // Picks the implementation once, the first time it is needed.
+    const Simd::Implementation<ValidateFunction>& getImplementation() noexcept {
+    #ifdef VISIONARY_X86_SIMD
+        static const auto implementation = Simd::pick<ValidateFunction>(validateAVX2, validateSSE2);
+    #else
+        static const Simd::Implementation<ValidateFunction> implementation = { Utf8::validateScalar, "scalar" };
+    #endif
+
+        return implementation;
+    }
+}
+
+bool Utf8::validate(std::string_view text) noexcept {
+    return getImplementation().function(text);
+}
+
+bool Utf8::validateScalar(std::string_view text) noexcept {
+    const auto* data = reinterpret_cast<const unsigned char*>(text.data());
+    const size_t size = text.size();
+
+    size_t i = 0;
+    while (i < size) {
+        // Eight bytes of ASCII at a time.
+        if (i + 8 <= size) {
+            uint64_t word;
+            std::memcpy(&word, data + i, sizeof(word));
+
+            if ((word & 0x8080808080808080ull) == 0) {
+                i += 8;
+                continue;
+            }
+        }
+
+        size_t length = sequenceLength(data + i, size - i);
+        if (length == 0)
+            return false;
+
+        i += length;
+    }
+
+    return true;
+}
+
+const char* Utf8::getInstructionSet() noexcept {
+    return getImplementation().name;
+}
+
+size_t Utf8::decode(std::string_view text, size_t pos, uint32_t& c) noexcept {
+    const auto* data = reinterpret_cast<const unsigned char*>(text.data()) + pos;
+    size_t length = sequenceLength(data, text.size() - pos);
+
+    switch (length) {
+    case 1:  c = data[0]; break;
+    case 2:  c = ((data[0] & 0x1Fu) << 6) | (data[1] & 0x3Fu); break;
+    case 3:  c = ((data[0] & 0x0Fu) << 12) | ((data[1] & 0x3Fu) << 6) | (data[2] & 0x3Fu); break;
+    case 4:  c = ((data[0] & 0x07u) << 18) | ((data[1] & 0x3Fu) << 12) | ((data[2] & 0x3Fu) << 6) | (data[3] & 0x3Fu); break;
+    default: c = replacement; length = 1; break;
+    }
+
+    return pos + length;
+}
+
+bool Utf8::encode(uint32_t c, std::string& out) {
+    if (c < 0x80) {
+        out.push_back(static_cast<char>(c));
+    }
+    else if (c < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (c >> 6)));
+        out.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+    }
+    else if (c < 0x10000) {
+        if (c >= 0xD800 && c <= 0xDFFF)
+            return false;
+
+        out.push_back(static_cast<char>(0xE0 | (c >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+    }
+    else if (c <= 0x10FFFF) {
+        out.push_back(static_cast<char>(0xF0 | (c >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((c >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+    }
+    else {
+        return false;
+    }
+
+    return true;
+}
+
+size_t Utf8::findCharacterStart(std::string_view text, size_t pos) noexcept {
+    if (pos >= text.size())
+        return text.size();
+
+    size_t start = pos;
+    while (start > 0 && pos - start < 3 && isContinuation(text[start]))
+        start--;
+
+    return start;
+}
+
+bool Utf8::isExtender(uint32_t c) noexcept {
+    // Sorted, so that a code point can be looked up with a binary search.
+    static constexpr std::pair<uint32_t, uint32_t> ranges[] = {
+        { 0x0300, 0x036F },     // Combining diacritical marks.
+        { 0x0483, 0x0489 },     // Cyrillic.
+        { 0x0591, 0x05BD },     // Hebrew.
+        { 0x0610, 0x061A },     // Arabic.
+        { 0x064B, 0x065F },
+        { 0x0900, 0x0903 },     // Devanagari.
+        { 0x093A, 0x094F },
+        { 0x1AB0, 0x1AFF },     // Combining diacritical marks extended.
+        { 0x1DC0, 0x1DFF },     // Combining diacritical marks supplement.
+        { 0x200C, 0x200D },     // Zero width (non-)joiner.
+        { 0x20D0, 0x20FF },     // Combining marks for symbols.
+        { 0xFE00, 0xFE0F },     // Variation selectors.
+        { 0xFE20, 0xFE2F },     // Combining half marks.
+        { 0x1F3FB, 0x1F3FF },   // Skin tones.
+        { 0xE0020, 0xE007F },   // Tags, e.g. in subdivision flags.
+        { 0xE0100, 0xE01EF },   // Variation selectors supplement.
+    };
+
+    if (c < ranges[0].first)
+        return false;
+
+    auto it = std::upper_bound(std::begin(ranges), std::end(ranges), c,
+                               [](uint32_t value, const auto& range) { return value < range.first; });
+
+    return c <= std::prev(it)->second;
+}
+
+size_t Utf8::nextCluster(std::string_view text, size_t pos) noexcept {
+    if (pos >= text.size())
+        return text.size();
+
+    uint32_t c;
+    size_t next = decode(text, pos, c);
+
+    // ASCII never belongs to the character before it.
+    while (next < text.size() && !(static_cast<unsigned char>(text[next]) < 0x80)) {
+        uint32_t following;
+        size_t after = decode(text, next, following);
+
+        if (!isExtender(following) && c != zeroWidthJoiner)
+            break;
+
+        c = following;
+        next = after;
+    }
+
+    return next;
+}
+
+size_t Utf8::prevCluster(std::string_view text, size_t pos) noexcept {
+    pos = std::min(pos, text.size());
+    if (pos == 0)
+        return 0;
+
+    size_t start = prevCodePoint(text, pos);
+    uint32_t c;
+    decode(text, start, c);
+
+    // Keep going back while the character belongs to the one before it.
+    while (start > 0) {
+        size_t before = prevCodePoint(text, start);
+        uint32_t b;
+        decode(text, before, b);
+
+        if (!isExtender(c) && b != zeroWidthJoiner)
+            break;
+
+        start = before;
+        c = b;
+    }
+
+    return start;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief   Validates, decodes and steps through UTF-8 text.
+ *
+ *          Validation follows the Unicode standard: overlong encodings, surrogates
+ *          and code points past U+10FFFF are all rejected. On x86-64, 64 bytes of
+ *          ASCII are skipped at a time, and with AVX2 every other byte is checked
+ *          32 at a time as well, by looking its nibbles up in small tables.
+ *          Everywhere else, a scalar fallback is used.
+ *
+ *          Columns are bytes throughout the editor. A byte that isn't part of a
+ *          valid sequence counts as a character of its own, shown as U+FFFD.
+ */
+namespace Utf8 {
+    // What a byte that isn't part of a valid sequence decodes to.
+    constexpr uint32_t replacement = 0xFFFD;
+
+    /**
+     * @brief   Checks if @p text is valid UTF-8, using the fastest implementation the CPU supports.
+     */
+    bool validate(std::string_view text) noexcept;
+
+    /**
+     * @brief   Same as validate(), but never uses any vector instructions.
+     */
+    bool validateScalar(std::string_view text) noexcept;
+
+    /**
+     * @returns The name of the implementation used by validate(), "AVX2", "SSE2" or "scalar".
+     */
+    const char* getInstructionSet() noexcept;
+
+    /**
+     * @brief   Checks if a byte continues a sequence, i.e. is 10xxxxxx.
+     */
+    constexpr bool isContinuation(char c) noexcept {
+        return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+    }
+
+    /**
+     * @brief       Decodes the character at @p pos.
+     *
+     * @param c     Receives the code point, or 'replacement' if the bytes at @p pos aren't a valid sequence.
+     *
+     * @returns     The offset right after the character. A byte that isn't part of a valid sequence is skipped on its own.
+     */
+    size_t decode(std::string_view text, size_t pos, uint32_t& c) noexcept;
+
+    /**
+     * @brief       Appends the UTF-8 encoding of @p c to @p out.
+     *
+     * @returns     False, without appending anything, for surrogates and values past U+10FFFF.
+     */
+    bool encode(uint32_t c, std::string& out);
+
+    /**
+     * @brief   Gets the start of the character @p pos is in, e.g. to cut a block of text between two characters.
+     *
+     * @note    Looks back at most three bytes.
+     */
+    size_t findCharacterStart(std::string_view text, size_t pos) noexcept;
+
+    /**
+     * @brief   Checks if a code point belongs to the one before it, like an accent or an emoji modifier.
+     *
+     * @note    Not the full grapheme cluster rules, but it keeps combining marks, variation
+     *          selectors, skin tones and sequences joined by U+200D together.
+     */
+    bool isExtender(uint32_t c) noexcept;
+
+    /**
+     * @brief   Gets the offset right after the character that starts at @p pos, along with anything that belongs to it.
+     *
+     * @note    O(1) when the next byte is ASCII.
+     *
+     * @returns The offset, or the size of the text if @p pos is at its end.
+     */
+    size_t nextCluster(std::string_view text, size_t pos) noexcept;
+
+    /**
+     * @brief   Gets the start of the character before @p pos, along with anything it belongs to.
+     *
+     * @note    O(1) when the previous two bytes are ASCII.
+     *
+     * @returns The offset, or 0 if @p pos is at the start of the text.
+     */
+    size_t prevCluster(std::string_view text, size_t pos) noexcept;
+};
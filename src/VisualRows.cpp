@@ -0,0 +1,367 @@
+#include <algorithm>
+
+#include "VisualRows.h"
+
+namespace {
+    // The lowest set bit of a Fenwick tree index, which is how many entries its node covers.
+    constexpr size_t lowBit(size_t i) noexcept {
+        return i & (~i + 1);
+    }
+
+    // Turns the entries in tree[1..], which start out as the values themselves, into a Fenwick tree over them. O(n).
+    void build(std::vector<uint64_t>& tree) noexcept {
+        size_t size = tree.size() - 1;
+
+        // Every node adds itself to its parent, in order, so that each is complete before it's added.
+        for (size_t i = 1; i <= size; i++) {
+            if (i + lowBit(i) <= size)
+                tree[i + lowBit(i)] += tree[i];
+        }
+    }
+
+    // The sum of the first 'count' entries.
+    uint64_t prefixSum(const std::vector<uint64_t>& tree, size_t count) noexcept {
+        uint64_t sum = 0;
+        for (size_t i = count; i > 0; i -= lowBit(i))
+            sum += tree[i];
+
+        return sum;
+    }
+
+    // Unsigned arithmetic wraps around, so adding a negative delta works out.
+    void add(std::vector<uint64_t>& tree, size_t index, uint64_t delta) noexcept {
+        for (size_t i = index + 1; i < tree.size(); i += lowBit(i))
+            tree[i] += delta;
+    }
+
+    // Finds the entry that 'value' falls into, and leaves how far into it in 'value'. If given 'other', a tree over
+    // other values of the same entries, adds up the ones before the entry into 'otherSum' along the way.
+    size_t descend(const std::vector<uint64_t>& tree, uint64_t& value,
+                   const std::vector<uint64_t>* other = nullptr, uint64_t* otherSum = nullptr) noexcept {
+        size_t size = tree.size() - 1;
+
+        // Walk down the tree, skipping every node that ends before the value.
+        // The nodes skipped are exactly the ones that add up to the entries before it.
+        size_t index = 0;
+        size_t step = 1;
+        while (step * 2 <= size)
+            step *= 2;
+
+        for (; step > 0; step /= 2) {
+            if (index + step <= size && tree[index + step] <= value) {
+                index += step;
+                value -= tree[index];
+                if (other)
+                    *otherSum += (*other)[index];
+            }
+        }
+
+        return index;
+    }
+}
+
+VisualRows::VisualRows() : m_Blocks(), m_BlockRows(1, 0), m_BlockVisualRows(1, 0), m_RowCount(0), m_VisualRowCount(0), m_FirstStale(0) {}
+
+void VisualRows::reset(size_t rowCount) {
+    m_Blocks.clear();
+    m_Blocks.reserve((rowCount + blockSize - 1) / blockSize);
+
+    for (size_t row = 0; row < rowCount; row += blockSize) {
+        Block& block = m_Blocks.emplace_back();
+        block.counts.assign(std::min(blockSize, rowCount - row), 1);
+        block.wrapped.assign(block.counts.size(), 0);
+        rebuild(block);
+    }
+
+    m_FirstStale = 0;
+    rebuildBlocks();
+}
+
+void VisualRows::onLinesChanged(size_t firstRow, size_t lineCountBefore, size_t lineCount) {
+    // The rows below the edit move along with it, the new
+    // rows start out with the count of the edited one.
+    if (firstRow < m_RowCount) {
+        auto [b, i] = locate(firstRow);
+        Block& block = m_Blocks[b];
+        uint32_t count = block.counts[i];
+
+        if (block.wrapped[i]) {
+            block.wrapped[i] = 0;
+            block.stale++;
+        }
+
+        if (lineCount > lineCountBefore)
+            insertRows(firstRow + 1, lineCount - lineCountBefore, count);
+        else if (lineCount < lineCountBefore)
+            eraseRows(firstRow + 1, std::min(lineCountBefore - lineCount, m_RowCount - firstRow - 1));
+    }
+
+    // Lines found by the indexer are appended without an edit.
+    if (m_RowCount < lineCount)
+        insertRows(m_RowCount, lineCount - m_RowCount, 1);
+    else if (m_RowCount > lineCount)
+        eraseRows(lineCount, m_RowCount - lineCount);
+
+    m_FirstStale = std::min(m_FirstStale, firstRow);
+}
+
+void VisualRows::invalidate() noexcept {
+    for (auto& block : m_Blocks) {
+        std::fill(block.wrapped.begin(), block.wrapped.end(), 0);
+        block.stale = block.wrapped.size();
+    }
+
+    m_FirstStale = 0;
+}
+
+bool VisualRows::isWrapped(size_t row) const noexcept {
+    if (row >= m_RowCount)
+        return false;
+
+    auto [b, i] = locate(row);
+    return m_Blocks[b].wrapped[i];
+}
+
+size_t VisualRows::findStale(size_t row) noexcept {
+    // Rows are mostly wrapped from the top down, so remember where the stale ones start.
+    m_FirstStale = findStaleFrom(m_FirstStale);
+
+    return row <= m_FirstStale ? m_FirstStale : findStaleFrom(row);
+}
+
+bool VisualRows::set(size_t row, uint32_t count) {
+    if (row >= m_RowCount)
+        return false;
+
+    auto [b, i] = locate(row);
+    Block& block = m_Blocks[b];
+
+    count = std::max<uint32_t>(count, 1);
+    if (!block.wrapped[i]) {
+        block.wrapped[i] = 1;
+        block.stale--;
+    }
+
+    if (block.counts[i] == count)
+        return false;
+
+    uint64_t delta = static_cast<uint64_t>(count) - block.counts[i];
+    block.counts[i] = count;
+    block.visualRows += delta;
+    m_VisualRowCount += delta;
+
+    add(block.tree, i, delta);
+    add(m_BlockVisualRows, b, delta);
+
+    return true;
+}
+
+size_t VisualRows::getRowCount() const noexcept {
+    return m_RowCount;
+}
+
+uint64_t VisualRows::getVisualRowCount() const noexcept {
+    return m_VisualRowCount;
+}
+
+uint64_t VisualRows::toVisualRow(size_t row) const noexcept {
+    if (row >= m_RowCount)
+        return m_VisualRowCount;
+
+    uint64_t i = row, visualRow = 0;
+    size_t b = descend(m_BlockRows, i, &m_BlockVisualRows, &visualRow);
+
+    return visualRow + prefixSum(m_Blocks[b].tree, i);
+}
+
+std::pair<size_t, uint32_t> VisualRows::fromVisualRow(uint64_t visualRow) const noexcept {
+    if (m_RowCount == 0)
+        return { 0, 0 };
+
+    if (visualRow >= m_VisualRowCount)
+        return { m_RowCount - 1, m_Blocks.back().counts.back() - 1 };
+
+    uint64_t row = 0;
+    size_t b = descend(m_BlockVisualRows, visualRow, &m_BlockRows, &row);
+    size_t i = descend(m_Blocks[b].tree, visualRow);
+
+    return { static_cast<size_t>(row) + i, static_cast<uint32_t>(visualRow) };
+}
+
+void VisualRows::rebuild(Block& block) {
+    size_t size = block.counts.size();
+
+    block.tree.resize(size + 1);
+    for (size_t i = 0; i < size; i++)
+        block.tree[i + 1] = block.counts[i];
+
+    build(block.tree);
+
+    block.visualRows = prefixSum(block.tree, size);
+    block.stale = std::count(block.wrapped.begin(), block.wrapped.end(), 0);
+}
+
+void VisualRows::rebuildBlocks() {
+    m_BlockRows.assign(m_Blocks.size() + 1, 0);
+    m_BlockVisualRows.assign(m_Blocks.size() + 1, 0);
+
+    m_RowCount = 0;
+    m_VisualRowCount = 0;
+
+    for (size_t b = 0; b < m_Blocks.size(); b++) {
+        m_BlockRows[b + 1] = m_Blocks[b].counts.size();
+        m_BlockVisualRows[b + 1] = m_Blocks[b].visualRows;
+
+        m_RowCount += m_Blocks[b].counts.size();
+        m_VisualRowCount += m_Blocks[b].visualRows;
+    }
+
+    build(m_BlockRows);
+    build(m_BlockVisualRows);
+}
+
+std::pair<size_t, size_t> VisualRows::locate(size_t row) const noexcept {
+    uint64_t index = row;
+    size_t b = descend(m_BlockRows, index);
+
+    return { b, static_cast<size_t>(index) };
+}
+
+size_t VisualRows::findStaleFrom(size_t row) const noexcept {
+    if (row >= m_RowCount)
+        return m_RowCount;
+
+    auto [b, i] = locate(row);
+
+    for (; b < m_Blocks.size(); b++, i = 0) {
+        const Block& block = m_Blocks[b];
+
+        if (block.stale > 0) {
+            auto stale = std::find(block.wrapped.begin() + i, block.wrapped.end(), 0);
+            if (stale != block.wrapped.end())
+                return row + (stale - (block.wrapped.begin() + i));
+        }
+
+        row += block.counts.size() - i;
+    }
+
+    return m_RowCount;
+}
+
+void VisualRows::insertRows(size_t row, size_t count, uint32_t visualRows) {
+    if (count == 0)
+        return;
+
+    if (m_Blocks.empty()) {
+        m_Blocks.emplace_back();
+        rebuildBlocks();
+    }
+
+    // Rows appended at the end go into the last block.
+    auto [b, i] = (row < m_RowCount) ? locate(row) : std::pair(m_Blocks.size() - 1, m_Blocks.back().counts.size());
+    Block& block = m_Blocks[b];
+
+    block.counts.insert(block.counts.begin() + i, count, visualRows);
+    block.wrapped.insert(block.wrapped.begin() + i, count, 0);
+
+    if (block.counts.size() >= 2 * blockSize) {
+        split(b);
+        rebuildBlocks();
+        return;
+    }
+
+    uint64_t visualRowsBefore = block.visualRows;
+    rebuild(block);
+
+    m_RowCount += count;
+    m_VisualRowCount += block.visualRows - visualRowsBefore;
+    add(m_BlockRows, b, count);
+    add(m_BlockVisualRows, b, block.visualRows - visualRowsBefore);
+}
+
+void VisualRows::eraseRows(size_t row, size_t count) {
+    if (count == 0)
+        return;
+
+    auto [first, i] = locate(row);
+
+    // The first block may lose the rows at its end, the ones after it all of their rows up to the last one.
+    size_t b = first;
+    for (size_t left = count; left > 0; b++, i = 0) {
+        Block& block = m_Blocks[b];
+        size_t erased = std::min(left, block.counts.size() - i);
+
+        block.counts.erase(block.counts.begin() + i, block.counts.begin() + i + erased);
+        block.wrapped.erase(block.wrapped.begin() + i, block.wrapped.begin() + i + erased);
+        left -= erased;
+    }
+
+    // Within a single block that stays big enough, only that block and the path above it change.
+    size_t last = b - 1;
+    if (first == last && (m_Blocks[first].counts.size() >= blockSize / 2 || m_Blocks.size() == 1) && !m_Blocks[first].counts.empty()) {
+        Block& block = m_Blocks[first];
+        uint64_t visualRowsBefore = block.visualRows;
+        rebuild(block);
+
+        m_RowCount -= count;
+        m_VisualRowCount -= visualRowsBefore - block.visualRows;
+        add(m_BlockRows, first, 0 - static_cast<uint64_t>(count));
+        add(m_BlockVisualRows, first, block.visualRows - visualRowsBefore);
+        return;
+    }
+
+    // Drop the blocks that were emptied, and merge what's left of the first and the last one into a single block.
+    Block& block = m_Blocks[first];
+    if (first != last) {
+        Block& lastBlock = m_Blocks[last];
+        block.counts.insert(block.counts.end(), lastBlock.counts.begin(), lastBlock.counts.end());
+        block.wrapped.insert(block.wrapped.end(), lastBlock.wrapped.begin(), lastBlock.wrapped.end());
+        m_Blocks.erase(m_Blocks.begin() + first + 1, m_Blocks.begin() + last + 1);
+    }
+
+    // A block that's too small takes in the next one, and splits again if that makes it too big.
+    if (m_Blocks[first].counts.size() < blockSize / 2 && first + 1 < m_Blocks.size()) {
+        Block& next = m_Blocks[first + 1];
+        m_Blocks[first].counts.insert(m_Blocks[first].counts.end(), next.counts.begin(), next.counts.end());
+        m_Blocks[first].wrapped.insert(m_Blocks[first].wrapped.end(), next.wrapped.begin(), next.wrapped.end());
+        m_Blocks.erase(m_Blocks.begin() + first + 1);
+    }
+
+    if (m_Blocks[first].counts.empty())
+        m_Blocks.erase(m_Blocks.begin() + first);
+    else if (m_Blocks[first].counts.size() >= 2 * blockSize)
+        split(first);
+    else
+        rebuild(m_Blocks[first]);
+
+    rebuildBlocks();
+}
+
+void VisualRows::split(size_t block) {
+    std::vector<Block> parts;
+    {
+        const Block& whole = m_Blocks[block];
+        size_t size = whole.counts.size();
+
+        for (size_t begin = blockSize; begin < size; ) {
+            // The last part takes the rest, so that none of them is smaller than blockSize.
+            size_t end = (size - begin < 2 * blockSize) ? size : begin + blockSize;
+
+            Block& part = parts.emplace_back();
+            part.counts.assign(whole.counts.begin() + begin, whole.counts.begin() + end);
+            part.wrapped.assign(whole.wrapped.begin() + begin, whole.wrapped.begin() + end);
+            rebuild(part);
+
+            begin = end;
+        }
+    }
+
+    Block& first = m_Blocks[block];
+    first.counts.resize(blockSize);
+    first.wrapped.resize(blockSize);
+    first.counts.shrink_to_fit();
+    first.wrapped.shrink_to_fit();
+    rebuild(first);
+
+    m_Blocks.insert(m_Blocks.begin() + block + 1, std::make_move_iterator(parts.begin()), std::make_move_iterator(parts.end()));
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief   Maps the rows of a document to the rows they take up on screen, when long lines are wrapped.
+ *
+ *          Every row takes up one or more visual rows. The counts are kept in blocks of consecutive
+ *          rows, each with a Fenwick tree over its rows, under two Fenwick trees over the blocks: one
+ *          for their rows and one for their visual rows. Finding the first visual row of a row, the
+ *          row a visual row belongs to, and changing the count of a row are all O(log n). Inserting
+ *          or removing rows only rebuilds the block they're in, O(blockSize), unless the block has to
+ *          be split or merged, which rebuilds the trees over the blocks as well, O(n / blockSize).
+ *
+ *          A row that wasn't wrapped yet, or whose wrapping is out of date, is stale. Stale
+ *          rows keep their last count as an estimate until they are wrapped again, so that
+ *          the rows around them don't jump around in the meantime.
+ */
+class VisualRows {
+public:
+    VisualRows();
+
+    /**
+     * @brief   Starts over with @p rowCount stale rows of one visual row each.
+     */
+    void reset(size_t rowCount);
+
+    /**
+     * @brief                   Adjusts the rows to an edit that started on @p firstRow.
+     *
+     * @note                    The rows below the edit move along with it and keep their counts.
+     *                          The edited rows become stale.
+     *
+     * @param lineCountBefore   The amount of lines before the edit.
+     * @param lineCount         The amount of lines after the edit.
+     */
+    void onLinesChanged(size_t firstRow, size_t lineCountBefore, size_t lineCount);
+
+    /**
+     * @brief   Makes every row stale, e.g. after the width lines are wrapped at changed.
+     */
+    void invalidate() noexcept;
+
+    /**
+     * @brief   Checks if the count of a row is up to date.
+     */
+    bool isWrapped(size_t row) const noexcept;
+
+    /**
+     * @brief   Gets the first stale row from @p row onwards.
+     *
+     * @returns The row, or getRowCount() if there is none.
+     */
+    size_t findStale(size_t row) noexcept;
+
+    /**
+     * @brief   Sets the amount of visual rows a row takes up, and marks it as up to date.
+     *
+     * @returns True if the count changed, which moves every row below it.
+     */
+    bool set(size_t row, uint32_t count);
+
+    size_t getRowCount() const noexcept;
+
+    /**
+     * @brief   Get the amount of visual rows taken up by every row together.
+     */
+    uint64_t getVisualRowCount() const noexcept;
+
+    /**
+     * @brief   Gets the first visual row of a row.
+     *
+     * @note    Rows past the last one get getVisualRowCount().
+     */
+    uint64_t toVisualRow(size_t row) const noexcept;
+
+    /**
+     * @brief   Gets the row a visual row belongs to.
+     *
+     * @note    Visual rows past the last one belong to the last visual row of the last row.
+     *
+     * @returns The row, and which of its visual rows it is.
+     */
+    std::pair<size_t, uint32_t> fromVisualRow(uint64_t visualRow) const noexcept;
+
+private:
+    // The rows a block starts out with. It's split once it has twice as many, and merged into the next one below half.
+    static constexpr size_t blockSize = 1024;
+
+    struct Block {
+        std::vector<uint32_t> counts;   // The visual rows of every row.
+        std::vector<uint8_t> wrapped;   // Whether the count of every row is up to date. Bytes, so that inserting rows is a plain move.
+        std::vector<uint64_t> tree;     // The Fenwick tree over counts, 1-based.
+        uint64_t visualRows = 0;        // All of counts together.
+        size_t stale = 0;               // The amount of rows that aren't wrapped.
+    };
+
+    /**
+     * @brief   Recomputes the tree and the totals of a block, after rows were inserted into it or removed from it.
+     */
+    static void rebuild(Block& block);
+
+    /**
+     * @brief   Recomputes the trees over the blocks, after blocks were added or removed.
+     */
+    void rebuildBlocks();
+
+    /**
+     * @brief   Finds a row, which has to be below getRowCount().
+     *
+     * @returns The block it's in, and where in the block.
+     */
+    std::pair<size_t, size_t> locate(size_t row) const noexcept;
+
+    /**
+     * @brief   Gets the first stale row from @p row onwards, skipping the blocks without any.
+     */
+    size_t findStaleFrom(size_t row) const noexcept;
+
+    /**
+     * @brief   Inserts @p count stale rows of @p visualRows each before @p row, which can be getRowCount().
+     */
+    void insertRows(size_t row, size_t count, uint32_t visualRows);
+
+    /**
+     * @brief   Removes @p count rows, starting at @p row.
+     */
+    void eraseRows(size_t row, size_t count);
+
+    /**
+     * @brief   Splits a block into blocks of blockSize rows, the last one taking the rest.
+     *
+     * @note    Leaves the trees over the blocks out of date, see rebuildBlocks().
+     */
+    void split(size_t block);
+
+    std::vector<Block> m_Blocks;                // None of them empty.
+    std::vector<uint64_t> m_BlockRows;          // The Fenwick tree over the amount of rows of every block, 1-based.
+    std::vector<uint64_t> m_BlockVisualRows;    // The Fenwick tree over the visual rows of every block, 1-based.
+    size_t m_RowCount;
+    uint64_t m_VisualRowCount;
+    size_t m_FirstStale;                        // No row above this one is stale.
+};
@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <array>
+#include <iterator>
+
+#include "WordBoundaries.h"
+
+namespace {
+    using CharClass = WordBoundaries::CharClass;
+
+    constexpr std::array<CharClass, 256> makeClasses() noexcept {
+        std::array<CharClass, 256> table{};
+
+        for (size_t c = 0; c < table.size(); c++) {
+            if (c == ' ' || (c >= '\t' && c <= '\r'))
+                table[c] = CharClass::Space;
+            else if ((c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_' || c >= 0x80)
+                table[c] = CharClass::Word;
+            else if (c > ' ' && c < 0x7F)
+                table[c] = CharClass::Punct;
+            else
+                table[c] = CharClass::Other;
+        }
+
+        return table;
+    }
+
+    // Built at compile time, so classifying a byte is a single lookup.
+    constexpr std::array<CharClass, 256> classes = makeClasses();
+
+    static_assert(classes['\t'] == CharClass::Space && classes['_'] == CharClass::Word &&
+                  classes['*'] == CharClass::Punct && classes['\0'] == CharClass::Other);
+}
+
+WordBoundaries::WordBoundaries(const Document& document) : m_Document(document), m_Runs(), m_Version(document.getVersion()) {}
+
+WordBoundaries::CharClass WordBoundaries::classify(char c) noexcept {
+    return classes[static_cast<unsigned char>(c)];
+}
+
+size_t WordBoundaries::findLeft(size_t row, size_t col) {
+    if (col == 0)
+        return 0;
+
+    const auto& starts = getRuns(row).starts;
+
+    // The last run that starts before the column. starts.front() is always 0, so there is one.
+    return *std::prev(std::lower_bound(starts.begin(), starts.end(), col));
+}
+
+size_t WordBoundaries::findRight(size_t row, size_t col) {
+    const auto& starts = getRuns(row).starts;
+
+    // The first run that starts after the column, or the end of the line.
+    auto it = std::upper_bound(starts.begin(), starts.end(), col);
+    return (it != starts.end()) ? *it : starts.back();
+}
+
+std::pair<size_t, size_t> WordBoundaries::findWord(size_t row, size_t col) {
+    const auto& [starts, runClasses] = getRuns(row);
+    size_t length = starts.back();
+
+    if (length == 0)
+        return { 0, 0 };
+
+    col = std::min(col, length);
+
+    // The run right of the column, and the one left of it. They're the same one inside of a run.
+    size_t right = (col < length) ? std::upper_bound(starts.begin(), starts.end(), col) - starts.begin() - 1 : runClasses.size();
+    size_t left = (col > 0) ? std::lower_bound(starts.begin(), starts.end(), col) - starts.begin() - 1 : runClasses.size();
+
+    size_t run = (right < runClasses.size() && runClasses[right] == CharClass::Word) ? right :
+                 (left < runClasses.size() && runClasses[left] == CharClass::Word) ? left :
+                 (right < runClasses.size()) ? right : left;
+
+    return { starts[run], starts[run + 1] };
+}
+
+const WordBoundaries::Runs& WordBoundaries::getRuns(size_t row) {
+    if (m_Version != m_Document.getVersion() || m_Runs.size() >= maxCachedLines) {
+        m_Runs.clear();
+        m_Version = m_Document.getVersion();
+    }
+
+    auto [it, inserted] = m_Runs.try_emplace(row);
+    if (!inserted)
+        return it->second;
+
+    auto& [starts, runClasses] = it->second;
+    auto line = m_Document.line(row).value_or(std::string_view());
+
+    // A single pass, starting a new run wherever the class changes.
+    for (size_t col = 0; col < line.size(); col++) {
+        CharClass charClass = classify(line[col]);
+
+        if (runClasses.empty() || runClasses.back() != charClass) {
+            starts.push_back(col);
+            runClasses.push_back(charClass);
+        }
+    }
+
+    starts.push_back(line.size());
+    return it->second;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Document.h"
+
+/**
+ * @brief   Finds where words start and end, for skipping and selecting by word.
+ *
+ *          Every byte falls into one class: whitespace, word characters or
+ *          punctuation. A line is split into runs of the same class in a single
+ *          pass, and the columns where the runs start are cached per line until
+ *          the document changes. Skipping a word is then a binary search.
+ *
+ * @note    Never looks past the line it is asked about.
+ */
+class WordBoundaries {
+public:
+    enum class CharClass : uint8_t {
+        Space,  // ' ', '\t', etc.
+        Word,   // Letters, digits, '_' and anything outside of ASCII, like the bytes of UTF-8.
+        Punct,  // '*', '.', '+', etc.
+        Other,  // Control characters.
+    };
+
+    /**
+     * @param document  The document to look at. Must outlive the WordBoundaries.
+     */
+    explicit WordBoundaries(const Document& document);
+
+    /**
+     * @brief   Gets the class of a byte.
+     */
+    static CharClass classify(char c) noexcept;
+
+    /**
+     * @brief   Gets the start of the run left of @p col, e.g. the start of the word the column is in or after.
+     *
+     * @returns The column, or 0 if @p col is at the start of the line.
+     */
+    size_t findLeft(size_t row, size_t col);
+
+    /**
+     * @brief   Gets the end of the run right of @p col, e.g. the end of the word the column is in or before.
+     *
+     * @returns The column, or the length of the line if @p col is at its end.
+     */
+    size_t findRight(size_t row, size_t col);
+
+    /**
+     * @brief   Gets the run under @p col, as [begin, end) in columns.
+     *
+     * @note    Prefers a word on either side of the column, so that
+     *          a column right after a word still gets that word.
+     *
+     * @returns The run, or an empty one on an empty line.
+     */
+    std::pair<size_t, size_t> findWord(size_t row, size_t col);
+
+private:
+    /**
+     * @brief   The runs of a line.
+     */
+    struct Runs {
+        std::vector<size_t> starts;         // The column every run starts at, followed by the length of the line.
+        std::vector<CharClass> classes;     // The class of every run.
+    };
+
+    /**
+     * @brief   Gets the runs of a row.
+     *
+     * @note    Splits the line the first time it's asked for after the document changed.
+     */
+    const Runs& getRuns(size_t row);
+
+    // Lines split by getRuns() are cached, up to this many at a time.
+    static constexpr size_t maxCachedLines = 4096;
+
+    const Document& m_Document;
+
+    std::unordered_map<size_t, Runs> m_Runs; // By row.
+    uint64_t m_Version; // The version of the document m_Runs was split from.
+};
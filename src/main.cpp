@@ -1,14 +1,37 @@
 #include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <optional>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 #include <nlohmann/json.hpp>
 
+#include "FindBar.h"
+#include "InputTrace.h"
+#include "RenderStats.hpp"
 #include "TextBox.h"
+#include "Utf8.h"
+
+// Combines lambdas into one visitor, e.g. to pass every event handler to sf::Event::visit.
+template <typename... Handlers>
+struct Overloaded : Handlers... {
+    using Handlers::operator()...;
+};
+
+template <typename... Handlers>
+Overloaded(Handlers...) -> Overloaded<Handlers...>;
 
 class TextEditor : public Drawable, public Transformable, public Stylable<Theme::TextEditorTheme> {
 public:
-    TextEditor(sf::Vector2f pos, sf::Vector2f size) : m_Lines()  {
+    TextEditor(sf::Vector2f pos, sf::Vector2f size) : m_Lines(), m_FindBar(), m_ShouldRedraw(true),
+                                                       m_LastClickTime(-doubleClickTime), m_LastClickLocation(CursorLocation::npos()) {
         m_Lines.setPosition(m_Theme.offset);
         setPosition(pos); setSize(size);
     }
@@ -24,12 +47,38 @@ public:
         target.setView(textEditorView);
 
         target.draw(m_Lines, states);
+        target.draw(m_FindBar, states);
 
         target.setView(oldView);
     }
 
+    bool open(const std::filesystem::path& path) noexcept {
+        return m_Lines.open(path);
+    }
+
     void update(double deltaTime) noexcept override {
         m_Lines.update(deltaTime);
+
+        if (m_FindBar.isOpen() && !m_FindBar.isReplacing() && m_FindBar.setStatus(m_Lines.getSearchStatus()))
+            m_ShouldRedraw = true;
+    }
+
+    bool consumeRedraw() noexcept {
+        // Both have to be reset, so don't short-circuit.
+        bool linesChanged = m_Lines.consumeRedraw();
+        return std::exchange(m_ShouldRedraw, false) || linesChanged;
+    }
+
+    bool hasPendingWork() const noexcept {
+        return m_Lines.hasPendingWork();
+    }
+
+    /**
+     * @brief   Blocks until the file is indexed and the matches of the search are counted.
+     */
+    void waitForBackgroundWork() {
+        m_Lines.waitForIndex();
+        m_Lines.waitForSearch();
     }
 
     void onMouseWheelScroll(const sf::Event::MouseWheelScrolled mouseWheelEvent) noexcept {
@@ -40,12 +89,45 @@ public:
             m_Lines.scrollUp();
     }
 
+    /**
+     * @brief       Moves the cursor to where the left mouse button was pressed.
+     *              A second press at the same location soon after selects the word there.
+     *
+     * @param time  When the button was pressed, in seconds.
+     */
+    void onMouseButtonPressed(const sf::Event::MouseButtonPressed& mouseButtonEvent, double time) noexcept {
+        if (mouseButtonEvent.button != sf::Mouse::Button::Left)
+            return;
+
+        // The TextBox sets its own view, placed by its position in the window.
+        sf::Vector2f point = sf::Vector2f(mouseButtonEvent.position) - m_Lines.getPosition();
+        CursorLocation location = m_Lines.findLocation(point);
+
+        bool doubleClick = time - m_LastClickTime < doubleClickTime && location == m_LastClickLocation;
+
+        m_Lines.clearCarets();
+        m_Lines.stopSelecting();
+        m_Lines.moveTo(location);
+
+        if (doubleClick)
+            m_Lines.selectWord();
+
+        // A third press starts over, instead of being the second click of another double click.
+        m_LastClickTime = doubleClick ? -doubleClickTime : time;
+        m_LastClickLocation = location;
+    }
+
     void onKeyPressed(const sf::Event::KeyPressed& keyPressedEvent) noexcept {
         auto key = keyPressedEvent.code;
 		bool controlPressed = keyPressedEvent.control;
 		bool shiftPressed = keyPressedEvent.shift;
         bool altPressed = keyPressedEvent.alt;
 
+        // While the find bar is open, it takes the keys that edit the query.
+        // Everything else, like moving around, still goes to the text.
+        if (onFindKeyPressed(keyPressedEvent))
+            return;
+
         if(key == sf::Keyboard::Key::Enter)
             m_Lines.add('\n');
 
@@ -73,10 +155,20 @@ public:
         if (key == sf::Keyboard::Key::End)
             (!controlPressed) ? m_Lines.moveEnd() : m_Lines.moveBottom();
 
+        // Ctrl+Alt adds a caret instead of moving.
         if (key == sf::Keyboard::Key::Up)
-            m_Lines.moveUp();
+            (controlPressed && altPressed) ? m_Lines.addCaretAbove() : m_Lines.moveUp();
         if (key == sf::Keyboard::Key::Down)
-            m_Lines.moveDown();
+            (controlPressed && altPressed) ? m_Lines.addCaretBelow() : m_Lines.moveDown();
+
+        if (controlPressed && key == sf::Keyboard::Key::D)
+            m_Lines.addNextOccurrence();
+
+        if (altPressed && shiftPressed && key == sf::Keyboard::Key::I)
+            m_Lines.splitSelectionIntoLines();
+
+        if (altPressed && key == sf::Keyboard::Key::Z)
+            m_Lines.setWrap(!m_Lines.isWrapping());
 
         if (controlPressed && key == sf::Keyboard::Key::A)
             m_Lines.selectAll();
@@ -87,31 +179,228 @@ public:
         if(controlPressed && key == sf::Keyboard::Key::V)
             m_Lines.paste();
 
+        if(controlPressed && key == sf::Keyboard::Key::Z)
+            (!shiftPressed) ? m_Lines.undo() : m_Lines.redo();
+
+        if(controlPressed && key == sf::Keyboard::Key::Y)
+            m_Lines.redo();
+
         if(key == sf::Keyboard::Key::LShift) {
             (!m_Lines.isSelecting()) ? m_Lines.startSelecting() : m_Lines.stopSelecting();
         }
 
-        if(key == sf::Keyboard::Key::Escape && m_Lines.isSelecting())
+        // Escape drops the other carets first, and the selection after that.
+        if(key == sf::Keyboard::Key::Escape && !m_Lines.clearCarets() && m_Lines.isSelecting())
             m_Lines.stopSelecting();
     }
 
     void onTextEntered(const sf::Event::TextEntered& textEnteredEvent) noexcept {
         uint32_t unicode = textEnteredEvent.unicode;
-		if (unicode >= 127 || unicode < 32)
-			return;
 
-        m_Lines.add(static_cast<char>(unicode));
+        // Control characters are handled as key presses instead, anything else is typed as UTF-8.
+        if (unicode < 32 || (unicode >= 127 && unicode < 160))
+            return;
+
+        if (m_FindBar.isOpen()) {
+            if (m_FindBar.append(unicode))
+                onFindQueryChanged();
+            return;
+        }
+
+        std::string text;
+        if (Utf8::encode(unicode, text))
+            m_Lines.add(text);
     }
 
 private:
+    /**
+     * @brief   Handles the keys of the find bar.
+     *
+     * @returns True if the key was handled, and shouldn't reach the text.
+     */
+    bool onFindKeyPressed(const sf::Event::KeyPressed& keyPressedEvent) noexcept {
+        auto key = keyPressedEvent.code;
+        bool controlPressed = keyPressedEvent.control;
+        bool shiftPressed = keyPressedEvent.shift;
+
+        // Start out with the selected text, as long as it's on a single line.
+        if (controlPressed && key == sf::Keyboard::Key::F) {
+            auto selection = m_Lines.getSelectionRange();
+            std::string query = (selection.has_value() && selection->first.m_Row == selection->second.m_Row) ?
+                                m_Lines.getSelection().value() : m_FindBar.getQuery();
+
+            m_FindBar.open(query);
+            m_Lines.search(query);
+            m_ShouldRedraw = true;
+            return true;
+        }
+
+        // The pattern is a regular expression, so it isn't searched for as it's typed.
+        if (controlPressed && key == sf::Keyboard::Key::H) {
+            m_FindBar.open(m_FindBar.getQuery(), true);
+            m_Lines.endSearch();
+            m_ShouldRedraw = true;
+            return true;
+        }
+
+        // Like Enter and Shift+Enter, but doesn't go to the text when nothing is searched for.
+        if (key == sf::Keyboard::Key::F3) {
+            (!shiftPressed) ? m_Lines.findNext() : m_Lines.findPrevious();
+            return true;
+        }
+
+        if (!m_FindBar.isOpen())
+            return false;
+
+        if (key == sf::Keyboard::Key::Escape) {
+            m_FindBar.close();
+            m_Lines.endSearch();
+            m_ShouldRedraw = true;
+            return true;
+        }
+
+        if (key == sf::Keyboard::Key::Enter && m_FindBar.isReplacing()) {
+            auto replaced = m_Lines.replaceAll(m_FindBar.getQuery(), m_FindBar.getReplacement());
+            m_FindBar.setMessage(replaced.has_value() ? std::to_string(replaced.value()) + " replaced" : "Invalid pattern");
+            m_ShouldRedraw = true;
+            return true;
+        }
+
+        if (key == sf::Keyboard::Key::Enter) {
+            (!shiftPressed) ? m_Lines.findNext() : m_Lines.findPrevious();
+            return true;
+        }
+
+        if (key == sf::Keyboard::Key::Tab && m_FindBar.isReplacing()) {
+            m_FindBar.switchField();
+            m_ShouldRedraw = true;
+            return true;
+        }
+
+        if (key == sf::Keyboard::Key::Backspace) {
+            if (m_FindBar.erase())
+                onFindQueryChanged();
+            return true;
+        }
+
+        return false;
+    }
+
+    void onFindQueryChanged() {
+        m_ShouldRedraw = true;
+
+        if (!m_FindBar.isReplacing())
+            m_Lines.search(m_FindBar.getQuery());
+    }
+
     void onTransformChanged(sf::Vector2f oldPos, sf::Vector2f oldSize) override {
         m_Lines.setSize(m_Size - (m_Theme.offset + m_Theme.pad));
+
+        // The find bar sits in the top right corner, over the text.
+        const auto& findBarTheme = m_FindBar.getTheme();
+        float findBarWidth = std::min(findBarTheme.width, m_Size.x);
+        m_FindBar.setSize({ findBarWidth, 0 });
+        m_FindBar.setPosition({ m_Size.x - findBarWidth - findBarTheme.pad, findBarTheme.pad });
     }
 
     TextBox m_Lines;
+    FindBar m_FindBar;
+    bool m_ShouldRedraw; // Whether the find bar changed since the last consumeRedraw().
+
+    // Two presses of the left button at the same location, at most this many seconds apart, are a double click.
+    static constexpr double doubleClickTime = 0.5;
+
+    double m_LastClickTime;
+    CursorLocation m_LastClickLocation;
 };
 
-int main() {
+/**
+ * @brief           Feeds the events of an input trace to the editor as fast as possible,
+ *                  then reports how long handling them took, in total and per type of event.
+ *
+ * @param dispatch  Hands an event to the same handlers as the main loop, with the time it was recorded at, in seconds.
+ * @param present   Whether to draw and display a frame after every event.
+ *
+ * @returns         The exit code of the program.
+ */
+int replayTrace(const std::filesystem::path& path, bool present, sf::RenderWindow& window, TextEditor& editor,
+                const std::function<void(const sf::Event&, double)>& dispatch) {
+    using Clock = std::chrono::steady_clock;
+
+    try {
+        InputTrace::Reader reader(path);
+
+        // Start out with the window size the trace was recorded with, so that the same lines are in frame.
+        sf::Vector2u windowSize = reader.getWindowSize();
+        dispatch(sf::Event::Resized{ windowSize }, 0);
+
+        // Don't wait for vsync, or frames would be what's measured.
+        window.setVerticalSyncEnabled(false);
+
+        std::map<std::string, std::vector<double>> durations; // In microseconds, by type of event.
+        uint64_t lastTime = 0;
+
+        // Replay against the whole file, rather than however much of it was indexed by now.
+        editor.waitForBackgroundWork();
+
+        double total = 0; // In milliseconds, without the waits in between events.
+        while (auto traced = reader.next()) {
+            const char* type = traced->event.is<sf::Event::KeyPressed>() ? "KeyPressed" :
+                               traced->event.is<sf::Event::TextEntered>() ? "TextEntered" :
+                               traced->event.is<sf::Event::MouseWheelScrolled>() ? "MouseWheelScrolled" :
+                               traced->event.is<sf::Event::MouseButtonPressed>() ? "MouseButtonPressed" : "Resized";
+
+            auto eventBegin = Clock::now();
+
+            // Pass the recorded time between events, so that anything time-based behaves the same.
+            dispatch(traced->event, traced->time / 1e6);
+            editor.update((traced->time - lastTime) / 1e6);
+            lastTime = traced->time;
+
+            if (editor.consumeRedraw() && present) {
+                window.clear(sf::Color(0, 0, 0));
+                window.draw(editor);
+                window.display();
+            }
+
+            double duration = std::chrono::duration<double, std::micro>(Clock::now() - eventBegin).count();
+            durations[type].push_back(duration);
+            total += duration / 1000;
+
+            // A search that's still counting would compete with the next events, differently every run.
+            editor.waitForBackgroundWork();
+        }
+
+        size_t events = 0;
+        for (const auto& [type, times] : durations)
+            events += times.size();
+
+        std::cout << "[REPLAY]: " << events << " events in " << total << " ms, recorded over "
+                  << lastTime / 1e6 << " s" << (present ? "" : ", without presenting frames") << std::endl;
+
+        for (auto& [type, times] : durations) {
+            std::sort(times.begin(), times.end());
+
+            double sum = 0;
+            for (double time : times)
+                sum += time;
+
+            std::cout << "[REPLAY]: " << type << "  " << times.size() << " events" <<
+                         "  mean: " << sum / times.size() << " us" <<
+                         "  p50: " << times[times.size() / 2] << " us" <<
+                         "  p99: " << times[(times.size() - 1) * 99 / 100] << " us" <<
+                         "  max: " << times.back() << " us" << std::endl;
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "[TRACE]: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char** argv) {
     Theme::AllThemes& themes = Theme::Get<Theme::AllThemes>();
     uint32_t& windowWidth = themes.windowWidth;
     uint32_t& windowHeight = themes.windowHeight;
@@ -120,42 +409,110 @@ int main() {
     window.setVerticalSyncEnabled(true);
 
     TextEditor editor({0, 0}, {static_cast<float>(windowWidth), static_cast<float>(windowHeight)});
+
+    // Usage: main [file] [--record <trace>] [--replay <trace> [--no-present]]
+    std::filesystem::path recordPath, replayPath;
+    bool present = true;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+            recordPath = argv[++i];
+        else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+            replayPath = argv[++i];
+        else if (std::strcmp(argv[i], "--no-present") == 0)
+            present = false;
+        else
+            editor.open(argv[i]);
+    }
+
+    // Every event the editor reacts to is written to the trace, if recording.
+    std::optional<InputTrace::Writer> recorder;
+    if (!recordPath.empty()) {
+        try {
+            recorder.emplace(recordPath, window.getSize());
+        }
+        catch (const std::exception& e) {
+            std::cerr << "[TRACE]: " << e.what() << std::endl;
+        }
+    }
+
     sf::Clock deltaClock, clock; 
 
     const auto onClose = [&window](const sf::Event::Closed& closedEvent) {
         window.close();
     };
 
-    const auto onResize = [&window, &windowWidth, &windowHeight, &editor](const sf::Event::Resized& resizedEvent) {
+    const auto onResize = [&window, &windowWidth, &windowHeight, &editor, &recorder](const sf::Event::Resized& resizedEvent) {
+        if (recorder) recorder->record(resizedEvent);
+
         windowWidth = resizedEvent.size.x; windowHeight = resizedEvent.size.y;
 		auto size = sf::Vector2f(static_cast<float>(windowWidth),
                                  static_cast<float>(windowHeight));
         editor.setSize(size);
 	};
 
-    const auto onMouseWheelScroll = [&window, &editor](const sf::Event::MouseWheelScrolled& mouseWheelEvent) {
+    const auto onMouseWheelScroll = [&window, &editor, &recorder](const sf::Event::MouseWheelScrolled& mouseWheelEvent) {
+        if (recorder) recorder->record(mouseWheelEvent);
         editor.onMouseWheelScroll(mouseWheelEvent);
     };
 
-    const auto onKeyPressed = [&editor](const sf::Event::KeyPressed& keyPressedEvent) {
+    // Replays hand the recorded time of every event over, so that double clicks replay as double clicks.
+    std::optional<double> replayTime;
+
+    const auto onMouseButtonPressed = [&editor, &recorder, &clock, &replayTime](const sf::Event::MouseButtonPressed& mouseButtonEvent) {
+        if (recorder) recorder->record(mouseButtonEvent);
+        editor.onMouseButtonPressed(mouseButtonEvent, replayTime.value_or(clock.getElapsedTime().asSeconds()));
+    };
+
+    const auto onKeyPressed = [&editor, &recorder](const sf::Event::KeyPressed& keyPressedEvent) {
+        if (recorder) recorder->record(keyPressedEvent);
 		editor.onKeyPressed(keyPressedEvent);
     };
 
-    const auto onTextEntered = [&editor](const sf::Event::TextEntered& textEnteredEvent) {
+    const auto onTextEntered = [&editor, &recorder](const sf::Event::TextEntered& textEnteredEvent) {
+        if (recorder) recorder->record(textEnteredEvent);
         editor.onTextEntered(textEnteredEvent);
     };
 
+    if (!replayPath.empty()) {
+        return replayTrace(replayPath, present, window, editor, [&](const sf::Event& event, double time) {
+            replayTime = time;
+            event.visit(Overloaded{ onResize, onMouseWheelScroll, onMouseButtonPressed, onKeyPressed, onTextEntered, [](const auto&) {} });
+        });
+    }
+
+    const Config::Properties& config = Config::Get();
+    const bool onDemand = (config.renderMode == "onDemand");
+    RenderStats stats(config.renderStats);
+
     while (window.isOpen()) {
+        // Sleep until there is an event, unless work in the background can still change
+        // what is shown, like indexing a file. In that case, wake up regularly to pick it up.
+        if (onDemand) {
+            sf::Time timeout = editor.hasPendingWork() ? sf::milliseconds(config.wakeupInterval) : sf::Time::Zero;
+
+            if (const auto event = window.waitEvent(timeout))
+                event->visit(Overloaded{ onClose, onResize, onMouseWheelScroll, onMouseButtonPressed, onKeyPressed, onTextEntered, [](const auto&) {} });
+        }
+
+        stats.onWakeup();
+
         double deltaTime = deltaClock.restart().asSeconds();
-        window.handleEvents(onClose, onResize, onMouseWheelScroll, onKeyPressed, onTextEntered);
+        window.handleEvents(onClose, onResize, onMouseWheelScroll, onMouseButtonPressed, onKeyPressed, onTextEntered);
 
         editor.update(deltaTime);
-        
-        window.clear(sf::Color(0, 0, 0));
-        
-        window.draw(editor);
 
-        window.display();
+        // The last frame is still on screen if nothing changed since.
+        if (editor.consumeRedraw() || !onDemand) {
+            window.clear(sf::Color(0, 0, 0));
+
+            window.draw(editor);
+
+            window.display();
+            stats.onFrame();
+        }
+
+        stats.report();
     }
 
     return 0;